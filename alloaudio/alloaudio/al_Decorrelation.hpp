@@ -48,8 +48,12 @@
 #ifndef INC_AL_DECORRELATION_HPP
 #define INC_AL_DECORRELATION_HPP
 
+#include <string>
+#include <vector>
 #include <allocore/io/al_AudioIO.hpp>
-#include <alloaudio/al_Convolver.hpp>
+#include <allocore/io/al_MappedFile.hpp>
+#include <allocore/system/al_ThreadPool.hpp>
+#include <alloaudio/al_PartitionedConvolver.hpp>
 
 namespace al {
 
@@ -68,15 +72,20 @@ public:
 	 * @param numOuts number of output channels to process
 	 * @param seed Seed for initial generation of decorrelation IRs. If -1, then
 	 * seed is taken from current time
+	 * @param pool Thread pool on which IRs are generated and convolved
 	 */
 	Decorrelation(int size = 1024, int inChannel = 0, int numOuts = 8,
-				  bool inputsAreBuses = false);
+				  bool inputsAreBuses = false,
+				  ThreadPool &pool = ThreadPool::global());
 	~Decorrelation();
 
 	/**
 	 * @brief configure() calculates the decorrelation IRs and configures the convolver engine
 	 *
 	 * This function calculates the IRs using the Kendall method for FIR random phase all-pass filters.
+	 * Each IR draws its phases from its own random stream derived from the
+	 * seed, so the IRs are generated in parallel and are the same for a
+	 * given seed on any machine.
 	 *
 	 * @param io The AudioIO object for audio rendering
 	 * @param seed The seed for the random number generator used to calculate random phase. A value of -1 means seed to current time.
@@ -119,6 +128,30 @@ public:
 	 */
 	long getCurrentSeed();
 
+	/**
+	 * @brief Set a directory in which to cache generated IRs
+	 *
+	 * IRs generated from a seed >= 0 are written to a binary file in this
+	 * directory, named after the size, number of outputs, seed and the other
+	 * parameters of generation. Later configurations with the same values,
+	 * e.g. on the next launch, map the file instead of generating the IRs.
+	 * An empty directory, the default, disables caching.
+	 */
+	void setCacheDirectory(std::string directory);
+	std::string getCacheDirectory();
+
+	/**
+	 * @brief Whether the current IRs were loaded from the cache
+	 */
+	bool loadedFromCache();
+
+	/**
+	 * @brief Get the path of the cache file of the current IRs
+	 *
+	 * Returns an empty string when the IRs were not cached.
+	 */
+	std::string getCachePath();
+
 	virtual void onAudioCB(AudioIOData &io);
 
 	/**
@@ -137,18 +170,34 @@ public:
 
 private:
 
+	enum Method {
+		KENDALL = 1,
+		ZOTTER = 2
+	};
+
 	void freeIRs();
+	void allocateIRs();
 	void generateIRs(long seed = -1, float maxjump = -1.0, float phaseFactor = 1.0);
 	void generateDeterministicIRs(long seed = -1,
 	                              float deltaFreq = 30, float maxFreqDev = 10, float maxTau = 1.0,
 	                              float startPhase = 0.0, float phaseDev = 0.0);
+	void configureConvolver(al::AudioIO &io);
+
+	std::string cachePath(Method method, const float *params, int numParams);
+	bool loadCache(Method method, const float *params, int numParams);
+	void storeCache(Method method, const float *params, int numParams);
 
-	vector<float *>mIRs;
+	std::vector<float *>mIRs;
+	std::vector<float> mIRData; // IRs when generated
+	MappedFile mCacheFile; // IRs when loaded from the cache
+	std::string mCacheDir;
+	std::string mCachePath; // cache file of the current IRs
 	int mSize;
 	int mInChannel;
 	int mNumOuts;
 	bool mInputsAreBuses;
-	Convolver mConv;
+	ThreadPool &mPool;
+	PartitionedConvolver mConv;
 	unsigned long mSeed;
 };
 
@@ -55,8 +55,6 @@
 #include "allocore/system/al_Thread.hpp"
 
 
-typedef struct BUTTER_ BUTTER;
-
 namespace al {
 
 typedef enum {
@@ -128,17 +126,23 @@ class OutputMaster : public osc::Recv, public al::AudioCallback
      */
     void setMuteAll(bool muteAll);
 
-    /** If clipperOn is true, the output signal for a channel is clipped if it is greater
-     * than the global gain set with setGlobalGain(). If false, there is no clipping.
+    /** If clipperOn is true, the output signal for a channel is clipped if its magnitude
+     * is greater than the global gain set with setMasterGain(). If false, there is no clipping.
      * It is recommended that for systems with large numbers of channels you set this to
      * to avoid loud surprises.
      */
     void setClipperOn(bool clipperOn);
 
-    /** Set the frequency at which peak meter data is updated. During the update period,
-     * a single value (maximum sample peak) is stored, and will only be avialable once
-     * the period is completed, as this is passed to the non-audio context through a
-     * lock-free ring buffer.
+    /** Set the time in seconds over which changes to channel and master gains are
+     * ramped, to avoid clicks. A time of 0, the default, applies changes immediately.
+     * The gains set before the first block is processed are always applied immediately.
+     */
+    void setGainRampTime(al_sec time);
+
+    /** Set the frequency at which meter data is updated. During the update period,
+     * the maximum absolute sample value and the RMS level of each channel are
+     * measured, and will only be avialable once the period is completed, as they
+     * are passed to the non-audio context through lock-free ring buffers.
      */
     void setMeterUpdateFreq(double freq);
 
@@ -160,6 +164,11 @@ class OutputMaster : public osc::Recv, public al::AudioCallback
      */
     void setMeterOn(bool meterOn);
 
+    /** Enable true peak metering. The output of each channel is oversampled 4 times
+     * to find peaks between samples, which are provided by getTruePeakValues().
+     */
+    void setTruePeakOn(bool truePeakOn);
+
     /** Fill the values array with the peak meter values. Note that because the values
      * are stored in a ringbuffer, this function cannot be used together with OSC meters
      * as the OSC thread will empty the values before they are read here.
@@ -168,6 +177,21 @@ class OutputMaster : public osc::Recv, public al::AudioCallback
      */
     int getMeterValues(float *values);
 
+    /** Fill the values array with the RMS meter values of the oldest update period
+     * not yet read.
+     *
+     * @return returns the number of meter values read.
+     */
+    int getRmsValues(float *values);
+
+    /** Fill the values array with the true peak meter values of the oldest update
+     * period not yet read. Values are only available if setTruePeakOn() is enabled.
+     * Subwoofer channels report their sample peak.
+     *
+     * @return returns the number of meter values read.
+     */
+    int getTruePeakValues(float *values);
+
     /** Get the number of channels processed by this OutputMaster object */
     int getNumChnls();
 
@@ -202,11 +226,45 @@ protected:
     void setClipperOnTimestamped(al_sec until, bool on);
     void setMuteAllTimestamped(al_sec until, bool on);
     void setMeterOnTimestamped(al_sec until, bool on);
+    void setTruePeakOnTimestamped(al_sec until, bool on);
     void setMeterupdateFreqTimestamped(al_sec until, double freq);
     void setBassManagementFreqTimestamped(al_sec until, double freq);
     void setBassManagementModeTimestamped(al_sec until, int mode);
 
 private:
+    /* Channels are processed in groups, one channel per lane, so that the
+       loops over lanes can be vectorized by the compiler */
+    enum {
+        LANES = 8,      /* channels per group */
+        CHUNK = 64,     /* frames processed at a time */
+        TP_PHASES = 4,  /* oversampling of true peak meter */
+        TP_TAPS = 12    /* taps per phase of true peak interpolator */
+    };
+
+    struct Biquad {
+        float a0, a1, a2, b1, b2;
+
+        /* transposed direct form II */
+        float operator()(float x, float &s1, float &s2) const {
+            float y = a0 * x + s1;
+            s1 = a1 * x - b1 * y + s2;
+            s2 = a2 * x - b2 * y;
+            return y;
+        }
+    };
+
+    struct ChannelGroup {
+        float lp1[2][LANES], lp2[2][LANES]; /* filter states */
+        float hp1[2][LANES], hp2[2][LANES];
+        float gain[LANES];
+        float gainStep[LANES];
+        float gainTarget[LANES];
+        float peak[LANES];
+        float truePeak[LANES];
+        double sumSq[LANES];
+        float history[TP_TAPS - 1][LANES]; /* previous outputs for true peak */
+    };
+
 	const int m_numChnls;
 
 	/* parameters */
@@ -216,6 +274,8 @@ private:
     double m_masterGain;
     bool m_clipperOn;
 	bool m_meterOn;
+	bool m_truePeakOn;
+	al_sec m_gainRampTime;
 	bool m_meterAddrHasChannel;
     int m_meterUpdateSamples; /* number of samples between level updates */
 
@@ -225,8 +285,10 @@ private:
     MsgQueue m_parameterQueue;
 
     /* output data */
-    std::vector<float> m_meters;
-    SingleRWRingBuffer m_meterBuffer;
+    std::vector<float> m_meters, m_rms, m_truePeaks;
+    SingleRWRingBuffer m_meterBuffer, m_rmsBuffer, m_truePeakBuffer;
+    float m_swPeak[4];
+    double m_swSumSq[4];
     int m_meterCounter; /* count samples for level updates */
     std::string m_sendAddress;
     int m_sendPort;
@@ -235,14 +297,26 @@ private:
     pthread_mutex_t m_meterMutex;
     pthread_cond_t m_meterCond;
 
-    /* bass management filters */
-    std::vector<BUTTER *> m_lopass1, m_lopass2, m_hipass1, m_hipass2;
+    /* processing state */
+    std::vector<ChannelGroup> m_groups;
+    Biquad m_lopass, m_hipass; /* bass management filters */
+    float m_truePeakTaps[TP_PHASES][TP_TAPS];
+    float m_master, m_masterStep, m_masterTarget;
+    bool m_started;
 
     double m_framesPerSec; // Sample rate
 
     int chanIsSubwoofer(int index);
     void initializeData();
     void allocateChannels(int numChnls);
+    void updateGains();
+    void rampMaster(float *master, float *limit, int nframes);
+    template <int Mode>
+    void processGroup(ChannelGroup &g, float (*buf)[LANES], float (*bass)[LANES],
+                      const float *master, const float *limit, int nframes);
+    void measureTruePeak(ChannelGroup &g, float (*buf)[LANES], int nframes);
+    void publishMeters();
+    void resetMeters();
     static void *meterThreadFunc(void *arg);
 
     struct OSCHandler : public osc::PacketHandler{
@@ -0,0 +1,242 @@
+/*	Alloaudio --
+    Audio facilities for large multichannel systems
+
+    Copyright (C) 2014. AlloSphere Research Group, Media Arts & Technology, UCSB.
+    Copyright (C) 2014. The Regents of the University of California.
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+        Redistributions of source code must retain the above copyright notice,
+        this list of conditions and the following disclaimer.
+
+        Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+
+        Neither the name of the University of California nor the names of its
+        contributors may be used to endorse or promote products derived from
+        this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+
+
+
+    File description:
+    Multichannel convolution with non-uniformly partitioned impulse responses,
+    computed with Gamma's FFT and the allocore thread pool.
+*/
+
+
+#ifndef INC_AL_PARTITIONEDCONVOLVER_HPP
+#define INC_AL_PARTITIONEDCONVOLVER_HPP
+
+#include <atomic>
+#include <vector>
+
+#include "allocore/io/al_AudioIO.hpp"
+#include "allocore/system/al_ThreadPool.hpp"
+
+namespace gam {
+template <class T> class RFFT;
+}
+
+namespace al {
+
+/** \addtogroup alloaudio
+ *  @{
+ */
+
+/**
+ * @brief Realtime multichannel convolution without added latency
+ *
+ * Any input channel can be convolved with an IR into any output channel, so
+ * IR matrices for decorrelation (one to many or many to many) and room
+ * correction (many to many) are supported. IRs feeding the same output
+ * are summed.
+ *
+ * IRs are split into partitions which grow with the distance from the start
+ * of the IR. For blocks smaller than the minimum partition, the start of the
+ * IR is convolved directly in the time domain. The partitions of the size of
+ * the block are computed in the audio callback. Larger partitions are needed
+ * later than their input is available, so they are computed on a thread pool
+ * while the following blocks are processed.
+ *
+ * If a partition is not ready when its output is due, the audio callback
+ * waits for it while running tasks of the pool (see TaskGroup::wait()). This
+ * only happens when the pool is overloaded, but it may then run tasks of
+ * other users of the pool, so a dedicated pool is best for real-time use.
+ *
+ * \code
+	al::PartitionedConvolver conv;
+	conv.addIR(0, 0, irLeft, irLength);
+	conv.addIR(0, 1, irRight, irLength);
+	conv.configure(io.framesPerBuffer());
+	io.append(conv);
+ * \endcode
+ */
+class PartitionedConvolver : public AudioCallback
+{
+public:
+
+	enum {
+		MIN_PARTITION = 64,	///< Smallest partition computed with the FFT
+		GROWTH = 4			///< Ratio of partition sizes of consecutive levels
+	};
+
+	/**
+	 * @param pool the pool on which the larger partitions are computed;
+	 * the audio callback may run any of its tasks when it falls behind
+	 */
+	PartitionedConvolver(ThreadPool &pool = ThreadPool::global());
+
+	~PartitionedConvolver();
+
+	/**
+	 * @brief Add the convolution of an input channel by an IR to an output channel
+	 *
+	 * The IR is copied. configure() must be called afterwards.
+	 *
+	 * @param input index of the input channel
+	 * @param output index of the output channel
+	 * @param ir the impulse response
+	 * @param length number of samples in ir
+	 */
+	void addIR(int input, int output, const float *ir, int length);
+
+	/// @brief Remove all IRs. configure() must be called afterwards.
+	void clearIRs();
+
+	/// @brief Set whether onAudioCB() reads AudioIO's buses instead of its inputs
+	void inputsAreBuses(bool v) { mInputsAreBuses = v; }
+
+	/**
+	 * @brief Prepare the partitions of the IRs and clear the signal state
+	 *
+	 * This allocates memory and computes FFTs, so it should not be called
+	 * while processing.
+	 *
+	 * @param blockSize the number of frames processed at a time
+	 * @param maxPartition the largest partition size. Larger partitions take
+	 * less computation in total, but more at a time.
+	 * @return Returns 0 upon success
+	 */
+	int configure(int blockSize, int maxPartition = 8192);
+
+	/// @brief Clear the signal state, so that the output of earlier input stops
+	void reset();
+
+	/**
+	 * @brief Process one block
+	 *
+	 * @param inputs buffers of the input channels, indexed by channel
+	 * @param outputs buffers of the output channels, indexed by channel. Only
+	 * outputs which have IRs are written to.
+	 */
+	void process(const float * const *inputs, float * const *outputs);
+
+	/// @brief Convolve the inputs (or buses) of io into its outputs
+	virtual void onAudioCB(AudioIOData &io);
+
+	/// @brief Number of input channels read, one more than the highest input index
+	int numInputs() const { return mNumInputs; }
+
+	/// @brief Number of output channels, one more than the highest output index
+	int numOutputs() const { return mNumOutputs; }
+
+	/// @brief Number of frames processed at a time
+	int blockSize() const { return mBlockSize; }
+
+	/// @brief Number of samples at the start of IRs convolved in the time domain
+	int headSize() const { return mHeadSize; }
+
+	/// @brief Number of partition levels; each has a different partition size
+	int numLevels() const { return mLevels.size(); }
+
+	/// @brief Partition size of a level
+	int partitionSize(int level) const { return mLevels[level]->size; }
+
+	/// @brief Number of partitions of a level
+	int partitionCount(int level) const { return mLevels[level]->count; }
+
+private:
+
+	struct Route {
+		int input, output;		// channel indices
+		int in, out;			// indices into mInputChannels, mOutputChannels
+		std::vector<float> ir;
+	};
+
+	// Partitions of one size, computed together once every size samples
+	struct Level {
+		int size;				// partition size
+		int offset;				// start of first partition in the IRs
+		int count;				// number of partitions
+		bool async;				// whether computed on the pool
+		std::vector<int> parts;	// number of non-empty partitions of each route
+		std::vector<float> spectra;	// IR partitions, split complex
+		std::vector<float> inputs;	// spectra of past input segments, per input
+		std::vector<float> outputs;	// two output segments per output
+		std::vector<float> scratch;	// FFT buffer per input and per output
+		std::vector<float> acc;		// spectrum sum per output
+		std::vector<gam::RFFT<float> *> ffts; // per input and per output
+		long long segment;		// index of segment being computed
+		TaskGroup group;
+		std::atomic<int> remaining;	// input transforms left in segment
+		PartitionedConvolver *owner;
+
+		struct Transform {
+			Level *level;
+			void operator()(int64_t begin, int64_t end);
+		} transform;
+		struct Accumulate {
+			Level *level;
+			void operator()(int64_t begin, int64_t end);
+		} accumulate;
+
+		Level(ThreadPool &pool): group(pool) {}
+		int bins() const { return size + 1; }
+		float *spectrum(int route, int part) { return &spectra[(route * count + part) * 2 * bins()]; }
+		float *inputSpectrum(int in, long long seg);
+		float *output(int out, long long seg) { return &outputs[(out * 2 + (seg & 1)) * size]; }
+	};
+
+	ThreadPool &mPool;
+	std::vector<Route> mRoutes;
+	std::vector<int> mInputChannels, mOutputChannels;
+	std::vector<std::vector<int> > mOutputRoutes; // routes of each output
+	std::vector<Level *> mLevels;
+	std::vector<float> mHistory;	// ring of past input per input
+	std::vector<float> mHeadInput;	// input for direct convolution
+	std::vector<const float *> mInPtrs;
+	std::vector<float *> mOutPtrs;
+	int mHistorySize;
+	int mBlockSize;
+	int mHeadSize;
+	int mNumInputs, mNumOutputs;
+	long long mFrame;				// frames processed
+	bool mInputsAreBuses;
+
+	void clearLevels();
+	const float *history(int in) const { return &mHistory[in * mHistorySize]; }
+	void transformInput(Level &level, int in);
+	void accumulateOutput(Level &level, int out);
+	void startSegment(Level &level);
+};
+
+/** @} */
+
+} // al::
+
+#endif
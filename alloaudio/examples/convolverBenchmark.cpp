@@ -0,0 +1,104 @@
+/*
+Compares the cost per block of PartitionedConvolver and the zita-convolver
+based Convolver, for decorrelation of one channel to many and for long IRs
+on each of several channels. Audio runs on the dummy backend as fast as
+possible, so the timings are of the audio callback alone.
+
+Convolver computes its later partitions on its own threads, and
+PartitionedConvolver on the allocore thread pool, so both use the other
+cores as well.
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "allocore/io/al_AudioIO.hpp"
+#include "allocore/system/al_Time.hpp"
+#include "alloaudio/al_Convolver.hpp"
+#include "alloaudio/al_PartitionedConvolver.hpp"
+
+using namespace std;
+using namespace al;
+
+#define NUM_BLOCKS 2000
+
+struct Timing {
+	double mean, worst; // microseconds per block
+};
+
+static Timing run(AudioIO &io)
+{
+	Timing t = {0, 0};
+	for (int i = 0; i < io.channelsBus(); i++) {
+		float *bus = io.busBuffer(i);
+		for (int n = 0; n < io.framesPerBuffer(); n++) {
+			bus[n] = rand() / (float) RAND_MAX - 0.5f;
+		}
+	}
+	al_sec start = al_time();
+	for (int b = 0; b < NUM_BLOCKS; b++) {
+		al_sec blockStart = al_time();
+		io.processAudio();
+		t.worst = std::max(t.worst, (al_time() - blockStart) * 1e6);
+	}
+	t.mean = (al_time() - start) * 1e6 / NUM_BLOCKS;
+	return t;
+}
+
+// inChannel < 0 convolves each channel with its own IR, as with Convolver
+static void compare(const char *name, int numChannels, int inChannel,
+                    int irLength, int blockSize)
+{
+	vector<float *> IRs;
+	for (int i = 0; i < numChannels; i++) {
+		float *ir = new float[irLength];
+		for (int n = 0; n < irLength; n++) {
+			ir[n] = (rand() / (float) RAND_MAX - 0.5f) * (1.0f - n / (float) irLength);
+		}
+		IRs.push_back(ir);
+	}
+
+	Timing zita, partitioned;
+	{
+		AudioIO io(blockSize, 48000, NULL, NULL, numChannels, 0, AudioIO::DUMMY);
+		io.channelsBus(numChannels);
+		Convolver conv;
+		io.append(conv);
+		conv.configure(io, IRs, irLength, inChannel, true, vector<int>(), blockSize, 1);
+		zita = run(io);
+		conv.shutdown();
+	}
+	{
+		AudioIO io(blockSize, 48000, NULL, NULL, numChannels, 0, AudioIO::DUMMY);
+		io.channelsBus(numChannels);
+		PartitionedConvolver conv;
+		io.append(conv);
+		for (int i = 0; i < numChannels; i++) {
+			conv.addIR(inChannel < 0 ? i : inChannel, i, IRs[i], irLength);
+		}
+		conv.inputsAreBuses(true);
+		conv.configure(blockSize);
+		partitioned = run(io);
+	}
+
+	printf("%-28s block %4d: Convolver %8.1f us (worst %8.1f), "
+	       "PartitionedConvolver %8.1f us (worst %8.1f)\n",
+	       name, blockSize, zita.mean, zita.worst, partitioned.mean, partitioned.worst);
+
+	for (unsigned i = 0; i < IRs.size(); i++) {
+		delete[] IRs[i];
+	}
+}
+
+int main()
+{
+	int blockSizes[] = {64, 256, 1024};
+	for (int i = 0; i < 3; i++) {
+		compare("decorrelation 1 to 60", 60, 0, 1024, blockSizes[i]);
+		compare("decorrelation 1 to 60, long", 60, 0, 4096, blockSizes[i]);
+		compare("room correction 8 x 1 s", 8, -1, 48000, blockSizes[i]);
+	}
+	return 0;
+}
@@ -45,13 +45,16 @@
 	Andres Cabrera, mantaraya36@gmail.com
 */
 
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
 #include <iostream>
 #include <cmath>
 #include <cassert>
 
 #include "alloaudio/al_Decorrelation.hpp"
+#include "allocore/math/al_Random.hpp"
 #include <Gamma/FFT.h>
 
 using namespace al;
@@ -61,10 +64,52 @@ using namespace std;
 #define M_PI		3.14159265358979323846
 #endif
 
+namespace {
+
+const uint32_t CACHE_VERSION = 1;
+const int MAX_PARAMS = 5;
+
+// Cache file header, followed by the IRs one after the other
+struct CacheHeader {
+	char magic[4];			// "ALDC"
+	uint32_t version;		// also detects a foreign byte order
+	uint32_t method;		// Decorrelation::Method
+	uint32_t size;			// IR length
+	uint32_t numOuts;		// number of IRs
+	uint32_t numParams;
+	uint64_t seed;
+	float params[MAX_PARAMS];
+	uint32_t reserved[3];
+};
+
+static_assert(sizeof(CacheHeader) == 64, "unexpected cache header size");
+
+// Seed of the random stream of an IR, mixed so that the streams of
+// neighbouring seeds and IRs are unrelated
+uint32_t irSeed(unsigned long seed, int irIndex)
+{
+	uint64_t z = uint64_t(seed) + 0x9E3779B97F4A7C15ull * uint64_t(irIndex + 1);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return uint32_t(z ^ (z >> 31));
+}
+
+// Inverse FFT of the half spectrum, which the IR then holds
+void spectrumToIR(float *complexSpectrum, float *ir, int size)
+{
+	gam::RFFT<float> fftObj(size);
+	fftObj.inverse(complexSpectrum, true);
+	for (int i=1; i <= size; i++) {
+		ir[i - 1] = complexSpectrum[i]/size;
+	}
+}
+
+} // ::
+
 Decorrelation::Decorrelation(int size, int inChannel, int numOuts,
-                             bool inputsAreBuses) :
+                             bool inputsAreBuses, ThreadPool &pool) :
     mSize(size), mInChannel(inChannel), mNumOuts(numOuts),
-    mInputsAreBuses(inputsAreBuses)
+    mInputsAreBuses(inputsAreBuses), mPool(pool), mConv(pool)
 {
 }
 
@@ -78,119 +123,205 @@ long al::Decorrelation::getCurrentSeed()
 	return mSeed;
 }
 
+void Decorrelation::setCacheDirectory(string directory)
+{
+	mCacheDir = directory;
+	if (!mCacheDir.empty() && mCacheDir.back() != '/' && mCacheDir.back() != '\\') {
+		mCacheDir += "/";
+	}
+}
+
+string Decorrelation::getCacheDirectory()
+{
+	return mCacheDir;
+}
+
+bool Decorrelation::loadedFromCache()
+{
+	return mCacheFile.opened();
+}
+
+string Decorrelation::getCachePath()
+{
+	return mCachePath;
+}
+
+void Decorrelation::allocateIRs()
+{
+	mIRData.assign(mSize * mNumOuts, 0.0f);
+	for (int irIndex = 0; irIndex < mNumOuts; irIndex++) {
+		mIRs.push_back(&mIRData[irIndex * mSize]);
+	}
+}
+
 void Decorrelation::generateIRs(long seed, float maxjump, float phaseFactor)
 {
-	float *ampSpectrum = (float *) calloc(mSize, sizeof(float));
-	float *phsSpectrum = (float *) calloc(mSize, sizeof(float));
-	float *complexSpectrum = (float *) calloc(mSize * 2, sizeof(float));;
 	//	#    max_jump -  is the maximum phase difference (in radians) between bins
 	//	#             if -1, the random numbers are used directly (no jumping).
 
 	freeIRs();
 
-	int n = mSize/2; // before mirroring
-
 	// Seed random number generator
 	if (seed >= 0) {
 		mSeed = seed;
 	} else {
 		mSeed = time(0);
 	}
-	srand(mSeed);
-	for (int irIndex = 0; irIndex < mNumOuts; irIndex++) {
+
+	float params[] = {maxjump, phaseFactor};
+	if (seed >= 0 && loadCache(KENDALL, params, 2)) {
+		return;
+	}
+	allocateIRs();
+
+	int n = mSize/2; // before mirroring
+	mPool.parallelFor(0, mNumOuts, 1, [&](int64_t irIndex) {
+		vector<float> complexSpectrum(mSize * 2, 0.0f);
+		rnd::Random<> rng(irSeed(mSeed, irIndex));
+
 		// Fill in DC and Nyquist
-		ampSpectrum[0] = 1.0;
-		phsSpectrum[0] = 0.0;
-		complexSpectrum[0] = ampSpectrum[0] * cos(phsSpectrum[0]);
-		complexSpectrum[1] = ampSpectrum[0] * sin(phsSpectrum[0]);
-		complexSpectrum[(n*2)] = ampSpectrum[0] * cos(phsSpectrum[0]);
-		complexSpectrum[(n*2) + 1] = ampSpectrum[0] * sin(phsSpectrum[0]);
+		complexSpectrum[0] = 1.0;
+		complexSpectrum[(n*2)] = 1.0;
 
 		float old_phase = 0;
 		for (int i=1; i < n; i++) {
-			ampSpectrum[i] = 1.0;
+			float phase;
 			if (maxjump == -1.0) {
-				phsSpectrum[i] = ((rand() / (float) RAND_MAX) * M_PI)- (M_PI/2.0);
+				phase = (rng.uniform() * M_PI) - (M_PI/2.0);
 			} else {
 				// make phase only move +- limit
-				float delta = ((rand() / ((float) RAND_MAX)) * 2.0 * maxjump) - maxjump;
-//				std::cout << "delta " << delta << std::endl;
+				float delta = (rng.uniform() * 2.0 * maxjump) - maxjump;
 				float new_phase = old_phase + delta;
-				phsSpectrum[i] = new_phase * phaseFactor;
+				phase = new_phase * phaseFactor;
 				old_phase = new_phase;
 			}
-			
-			complexSpectrum[i*2] = ampSpectrum[i] * cos(phsSpectrum[i]); // Real part
-			complexSpectrum[i*2 + 1] = ampSpectrum[i] * sin(phsSpectrum[i]); // Imaginary
-//			std::cout << complexSpectrum[i*2] << ", " << complexSpectrum[i*2 + 1] << ",";
+			complexSpectrum[i*2] = cos(phase); // Real part
+			complexSpectrum[i*2 + 1] = sin(phase); // Imaginary
 		}
+		spectrumToIR(&complexSpectrum[0], mIRs[irIndex], mSize);
+	});
 
-//		std::cout << ".... " <<std::endl;
-		gam::RFFT<float> fftObj(mSize);
-
-		fftObj.inverse(complexSpectrum, true);
-		float *irdata = (float *) calloc(mSize, sizeof(float));
-
-		for (int i=1; i <= mSize; i++) {
-			irdata[i - 1] = complexSpectrum[i]/mSize;
-//			std::cout << complexSpectrum[i]/mSize << "," << std::endl;
-		}
-		mIRs.push_back(irdata);
+	if (seed >= 0) {
+		storeCache(KENDALL, params, 2);
 	}
-	free(ampSpectrum);
-	free(phsSpectrum);
-	free(complexSpectrum);
 }
 
 void Decorrelation::generateDeterministicIRs(long seed, float deltaFreq, float maxFreqDev,
                                              float maxTau, float startPhase, float phaseDev)
 {
-	float *ampSpectrum = (float *) calloc(mSize, sizeof(float));
-	float *phsSpectrum = (float *) calloc(mSize, sizeof(float));
-	float *complexSpectrum = (float *) calloc(mSize * 2, sizeof(float));;
-	//	#    max_jump -  is the maximum phase difference (in radians) between bins
-	//	#             if -1, the random numbers are used directly (no jumping).
-
 	freeIRs();
 
-	int n = mSize/2; // before mirroring
-
 	// Seed random number generator
 	if (seed >= 0) {
 		mSeed = seed;
 	} else {
 		mSeed = time(0);
 	}
-	srand(mSeed);
 
-	for (int irIndex = 0; irIndex < mNumOuts; irIndex++) {
-		float freq = deltaFreq + ((2.0 * maxFreqDev * rand() / (float) RAND_MAX) - maxFreqDev);
-		std::cout << "freq " << irIndex << ":" << freq << std::endl;
-		for (int i=0; i < n + 1; i++) {
-			ampSpectrum[i] = 1.0;
-			float phaseOffset = startPhase + ((2.0 * phaseDev * rand() / (float) RAND_MAX) - phaseDev);
-			phsSpectrum[i] = maxTau * sin(phaseOffset + (2 * M_PI * i * freq / n));
+	float params[] = {deltaFreq, maxFreqDev, maxTau, startPhase, phaseDev};
+	if (seed >= 0 && loadCache(ZOTTER, params, 5)) {
+		return;
+	}
+	allocateIRs();
+
+	int n = mSize/2; // before mirroring
+	mPool.parallelFor(0, mNumOuts, 1, [&](int64_t irIndex) {
+		vector<float> complexSpectrum(mSize * 2, 0.0f);
+		rnd::Random<> rng(irSeed(mSeed, irIndex));
 
-			complexSpectrum[i*2] = ampSpectrum[i] * cos(phsSpectrum[i]); // Real part
-			complexSpectrum[i*2 + 1] = ampSpectrum[i] * sin(phsSpectrum[i]); // Imaginary
-//			std::cout << complexSpectrum[i*2] << ", " << complexSpectrum[i*2 + 1] << ",";
+		float freq = deltaFreq + rng.uniformS(maxFreqDev);
+		for (int i=0; i < n + 1; i++) {
+			float phaseOffset = startPhase + rng.uniformS(phaseDev);
+			float phase = maxTau * sin(phaseOffset + (2 * M_PI * i * freq / n));
+			complexSpectrum[i*2] = cos(phase); // Real part
+			complexSpectrum[i*2 + 1] = sin(phase); // Imaginary
 		}
+		spectrumToIR(&complexSpectrum[0], mIRs[irIndex], mSize);
+	});
 
-//		std::cout << ".... " <<std::endl;
-		gam::RFFT<float> fftObj(mSize);
+	if (seed >= 0) {
+		storeCache(ZOTTER, params, 5);
+	}
+}
 
-		fftObj.inverse(complexSpectrum, true);
-		float *irdata = (float *) calloc(mSize, sizeof(float));
+string Decorrelation::cachePath(Method method, const float *params, int numParams)
+{
+	// Parameters are floats, so name the file after their bits
+	uint32_t h = 2166136261u;
+	const unsigned char *bytes = (const unsigned char *) params;
+	for (unsigned i = 0; i < numParams * sizeof(float); i++) {
+		h = (h ^ bytes[i]) * 16777619u;
+	}
+	char name[128];
+	snprintf(name, sizeof(name), "decorrelation_%s_%d_%d_%lu_%08x.aldc",
+	         method == KENDALL ? "kendall" : "zotter", mSize, mNumOuts, mSeed, h);
+	return mCacheDir + name;
+}
 
-		for (int i=1; i <= mSize; i++) {
-			irdata[i - 1] = complexSpectrum[i]/mSize;
-//			std::cout << complexSpectrum[i]/mSize << "," << std::endl;
-		}
-		mIRs.push_back(irdata);
+bool Decorrelation::loadCache(Method method, const float *params, int numParams)
+{
+	if (mCacheDir.empty()) {
+		return false;
 	}
-	free(ampSpectrum);
-	free(phsSpectrum);
-	free(complexSpectrum);
+	MappedFile file;
+	if (!file.open(cachePath(method, params, numParams), MappedFile::PRIVATE)) {
+		return false;
+	}
+	size_t dataSize = sizeof(float) * mSize * mNumOuts;
+	if (file.size() != sizeof(CacheHeader) + dataSize) {
+		return false;
+	}
+	CacheHeader h;
+	memcpy(&h, file.data(), sizeof(h));
+	if (memcmp(h.magic, "ALDC", 4) || h.version != CACHE_VERSION
+	        || h.method != uint32_t(method)
+	        || h.size != uint32_t(mSize) || h.numOuts != uint32_t(mNumOuts)
+	        || h.seed != mSeed || h.numParams != uint32_t(numParams)
+	        || memcmp(h.params, params, numParams * sizeof(float))) {
+		return false;
+	}
+	mCacheFile = std::move(file);
+	mCachePath = mCacheFile.path();
+	float *data = (float *) (mCacheFile.data() + sizeof(CacheHeader));
+	for (int irIndex = 0; irIndex < mNumOuts; irIndex++) {
+		mIRs.push_back(data + irIndex * mSize);
+	}
+	return true;
+}
+
+void Decorrelation::storeCache(Method method, const float *params, int numParams)
+{
+	if (mCacheDir.empty()) {
+		return;
+	}
+	CacheHeader h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, "ALDC", 4);
+	h.version = CACHE_VERSION;
+	h.method = method;
+	h.size = mSize;
+	h.numOuts = mNumOuts;
+	h.numParams = numParams;
+	h.seed = mSeed;
+	memcpy(h.params, params, numParams * sizeof(float));
+
+	// Write to a temporary file, so that a partly written cache is never read
+	string path = cachePath(method, params, numParams);
+	string tmpPath = path + ".tmp";
+	FILE *fp = fopen(tmpPath.c_str(), "wb");
+	if (!fp) {
+		cout << "Could not write decorrelation cache: " << path << endl;
+		return;
+	}
+	bool ok = fwrite(&h, sizeof(h), 1, fp) == 1;
+	ok = ok && fwrite(&mIRData[0], sizeof(float), mIRData.size(), fp) == mIRData.size();
+	ok = (fclose(fp) == 0) && ok;
+	if (!ok || rename(tmpPath.c_str(), path.c_str()) != 0) {
+		remove(tmpPath.c_str());
+		cout << "Could not write decorrelation cache: " << path << endl;
+		return;
+	}
+	mCachePath = path;
 }
 
 void Decorrelation::onAudioCB(al::AudioIOData &io)
@@ -213,10 +344,10 @@ int al::Decorrelation::getSize()
 
 void al::Decorrelation::freeIRs()
 {
-	for (unsigned int i = 0; i < mIRs.size(); i++){
-		free(mIRs[i]);
-	}
 	mIRs.clear();
+	mIRData.clear();
+	mCacheFile.close();
+	mCachePath.clear();
 }
 
 void Decorrelation::configure(al::AudioIO &io, long seed, float maxjump, float phaseFactor)
@@ -229,20 +360,24 @@ void Decorrelation::configure(al::AudioIO &io, long seed, float maxjump, float p
 		cout << "Invalid size: " << mSize << " numOuts: " << mNumOuts << endl;
 		return;
 	}
-	if (mSize >= 64) {
-		int options = 2; //vector mode
-		mConv.configure(io, mIRs, mSize, mInChannel, mInputsAreBuses, vector<int>(),
-						io.framesPerBuffer(), options);
-	}
+	configureConvolver(io);
 }
 
 void Decorrelation::configureDeterministic(AudioIO &io, long seed, float deltaFreq,
                                            float deltaFreqDev, float maxTau, float startPhase, float phaseDev)
 {
 	generateDeterministicIRs(seed, deltaFreq, deltaFreqDev, maxTau, startPhase, phaseDev);
-	if (mSize >= 64) {
-		int options = 2; //vector mode
-		mConv.configure(io, mIRs, mSize, mInChannel, mInputsAreBuses, vector<int>(),
-		                io.framesPerBuffer(), options);
+	configureConvolver(io);
+}
+
+void Decorrelation::configureConvolver(AudioIO &io)
+{
+	// One to many, or each channel to itself for parallel decorrelation
+	mConv.clearIRs();
+	for (unsigned int i = 0; i < mIRs.size(); i++) {
+		int input = mInChannel < 0 ? i : mInChannel;
+		mConv.addIR(input, i, mIRs[i], mSize);
 	}
+	mConv.inputsAreBuses(mInputsAreBuses);
+	mConv.configure(io.framesPerBuffer());
 }
@@ -1,20 +1,73 @@
 
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
 #include <iostream>
 #include <sstream>
 
 #include "alloaudio/al_OutputMaster.hpp"
 #include "allocore/system/al_Time.hpp"
 
-#include "alloaudio/butter.h"
-
 //#include "firfilter.h"
 
+#ifndef M_PI
+#define M_PI 3.14159265358979323846	/* pi */
+#endif
+
 using namespace al;
 
+namespace {
+
+/* Room for a number of meter updates */
+size_t meterRingSize(int numChnls)
+{
+	return std::max<size_t>(1024, 4 * numChnls) * sizeof(float);
+}
+
+/* Coefficients of a second order Butterworth section, calculated from table 6.1
+   in the Audio Programming Book, page 484, but there is a typo, so double checked
+   with Richard Dobson's code from DVD chapter 2 */
+void butterworth(float &a0, float &a1, float &a2, float &b1, float &b2,
+				 double fc, double sr, bool lp)
+{
+	double lambda;
+	if (lp) {
+		lambda = 1/tan(fc * M_PI / sr);
+	} else {
+		lambda = tan(fc * M_PI / sr);
+	}
+	double lambda_2 = lambda * lambda;
+	double a = 1.0/(1.0 + (sqrt(2.0)*lambda) + (lambda_2));
+	a0 = a2 = a;
+	b2 = a * (1.0 - (sqrt(2.0)*lambda) + (lambda_2));
+	if (lp) {
+		a1 = 2.0 * a;
+		b1 = 2.0 * a * (1.0 - lambda_2);
+	} else {
+		a1 = - 2.0 * a;
+		b1 = 2.0 * a * (lambda_2 - 1.0);
+	}
+}
+
+/* Move towards target by step per frame, stopping at target. Returns the
+   increment per frame over the next nframes. */
+float rampIncrement(float current, float target, float step, int nframes)
+{
+	float end = target;
+	if (fabsf(target - current) > fabsf(step) * nframes) {
+		end = current + step * nframes;
+	}
+	return (end - current) / nframes;
+}
+
+}
+
+
 OutputMaster::OutputMaster(int num_chnls, double sampleRate, const char *address, int port,
 						   const char *sendAddress, int sendPort, al_sec msg_timeout):
 	m_numChnls(num_chnls),
-	m_meterBuffer(1024 * sizeof(float)), m_framesPerSec(sampleRate),
+	m_meterBuffer(meterRingSize(num_chnls)), m_rmsBuffer(meterRingSize(num_chnls)),
+	m_truePeakBuffer(meterRingSize(num_chnls)), m_framesPerSec(sampleRate),
 	osc::Recv(port, address, msg_timeout),
 	m_sendAddress(sendAddress), m_sendPort(sendPort)
 {
@@ -44,12 +97,6 @@ OutputMaster::OutputMaster(int num_chnls, double sampleRate, const char *address
 
 OutputMaster::~OutputMaster()
 {
-	for (int i = 0; i < m_numChnls; i++) {
-		butter_free(m_lopass1[i]);
-		butter_free(m_lopass2[i]);
-		butter_free(m_hipass1[i]);
-		butter_free(m_hipass2[i]);
-	}
 	stop(); /* Stops OSC listener */
 	m_runMeterThread = 0;
 	pthread_cond_signal(&m_meterCond);
@@ -81,6 +128,11 @@ void OutputMaster::setClipperOn(bool clipperOn)
 	m_clipperOn = clipperOn;
 }
 
+void OutputMaster::setGainRampTime(al_sec time)
+{
+	m_gainRampTime = time;
+}
+
 void OutputMaster::setMeterUpdateFreq(double freq)
 {
 	m_meterUpdateSamples = (int)(m_framesPerSec/freq);
@@ -88,14 +140,10 @@ void OutputMaster::setMeterUpdateFreq(double freq)
 
 void OutputMaster::setBassManagementFreq(double frequency)
 {
-	int i;
 	if (frequency > 0) {
-		for (i = 0; i < m_numChnls; i++) {
-			butter_set_fc(m_lopass1[i], frequency);
-			butter_set_fc(m_lopass2[i], frequency);
-			butter_set_fc(m_hipass1[i], frequency);
-			butter_set_fc(m_hipass2[i], frequency);
-		}
+		Biquad &lp = m_lopass, &hp = m_hipass;
+		butterworth(lp.a0, lp.a1, lp.a2, lp.b1, lp.b2, frequency, m_framesPerSec, true);
+		butterworth(hp.a0, hp.a1, hp.a2, hp.b1, hp.b2, frequency, m_framesPerSec, false);
 	}
 }
 
@@ -119,115 +167,314 @@ void OutputMaster::setMeterOn(bool meterOn)
 	m_meterOn = meterOn;
 }
 
+void OutputMaster::setTruePeakOn(bool truePeakOn)
+{
+	m_truePeakOn = truePeakOn;
+}
+
 int OutputMaster::getMeterValues(float *values)
 {
 	return m_meterBuffer.read((char *) values, m_numChnls * sizeof(float));
 }
 
+int OutputMaster::getRmsValues(float *values)
+{
+	return m_rmsBuffer.read((char *) values, m_numChnls * sizeof(float));
+}
+
+int OutputMaster::getTruePeakValues(float *values)
+{
+	return m_truePeakBuffer.read((char *) values, m_numChnls * sizeof(float));
+}
+
 int OutputMaster::getNumChnls()
 {
 	return m_numChnls;
 }
 
+void OutputMaster::updateGains()
+{
+	float rampFrames = m_gainRampTime * m_framesPerSec;
+	bool jump = !m_started || rampFrames < 1;
+	for (int chan = 0; chan < m_numChnls; chan++) {
+		ChannelGroup &g = m_groups[chan / LANES];
+		int l = chan % LANES;
+		float target = m_gains[chan];
+		if (jump) {
+			g.gain[l] = g.gainTarget[l] = target;
+			g.gainStep[l] = 0;
+		} else if (target != g.gainTarget[l]) {
+			g.gainTarget[l] = target;
+			g.gainStep[l] = (target - g.gain[l]) / rampFrames;
+		}
+	}
+	float target = m_masterGain * (m_muteAll ? 0.0 : 1.0);
+	if (jump) {
+		m_master = m_masterTarget = target;
+		m_masterStep = 0;
+	} else if (target != m_masterTarget) {
+		m_masterTarget = target;
+		m_masterStep = (target - m_master) / rampFrames;
+	}
+}
+
+void OutputMaster::rampMaster(float *master, float *limit, int nframes)
+{
+	float inc = rampIncrement(m_master, m_masterTarget, m_masterStep, nframes);
+	for (int i = 0; i < nframes; i++) {
+		master[i] = m_master + inc * (i + 1);
+		limit[i] = m_clipperOn ? fabsf(master[i]) : FLT_MAX;
+	}
+	m_master = master[nframes - 1];
+}
+
+template <int Mode>
+void OutputMaster::processGroup(ChannelGroup &g, float (*buf)[LANES], float (*bass)[LANES],
+								const float *master, const float *limit, int nframes)
+{
+	const bool lowpass = Mode == BASSMODE_LOWPASS || Mode == BASSMODE_FULL;
+	const bool highpass = Mode == BASSMODE_HIGHPASS || Mode == BASSMODE_FULL;
+	const Biquad lp = m_lopass, hp = m_hipass;
+
+	/* State is copied to locals, so that the compiler knows it does not alias
+	   the buffers */
+	float lp1[2][LANES], lp2[2][LANES], hp1[2][LANES], hp2[2][LANES];
+	float gain[LANES], inc[LANES], peak[LANES], sumSq[LANES];
+	memcpy(lp1, g.lp1, sizeof(lp1));
+	memcpy(lp2, g.lp2, sizeof(lp2));
+	memcpy(hp1, g.hp1, sizeof(hp1));
+	memcpy(hp2, g.hp2, sizeof(hp2));
+	for (int l = 0; l < LANES; l++) {
+		inc[l] = rampIncrement(g.gain[l], g.gainTarget[l], g.gainStep[l], nframes);
+		gain[l] = g.gain[l];
+		peak[l] = g.peak[l];
+		sumSq[l] = 0;
+	}
+
+	for (int i = 0; i < nframes; i++) {
+		const float m = master[i], lim = limit[i];
+		for (int l = 0; l < LANES; l++) {
+			float x = buf[i][l];
+			float low = x, high = x;
+			if (lowpass) {
+				low = lp(x, lp1[0][l], lp1[1][l]);
+				low = lp(low, lp2[0][l], lp2[1][l]);
+			}
+			if (highpass) {
+				high = hp(x, hp1[0][l], hp1[1][l]);
+				high = hp(high, hp2[0][l], hp2[1][l]);
+			}
+			if (Mode != BASSMODE_NONE) {
+				bass[i][l] += low;
+			}
+			gain[l] += inc[l];
+			float y = high * gain[l] * m;
+			y = y > lim ? lim : (y < -lim ? -lim : y);
+			buf[i][l] = y;
+			float a = fabsf(y);
+			peak[l] = a > peak[l] ? a : peak[l];
+			sumSq[l] += y * y;
+		}
+	}
+
+	for (int l = 0; l < LANES; l++) {
+		for (int k = 0; k < 2; k++) { /* flush denormals as the filters decay */
+			g.lp1[k][l] = fabsf(lp1[k][l]) < 1e-15f ? 0 : lp1[k][l];
+			g.lp2[k][l] = fabsf(lp2[k][l]) < 1e-15f ? 0 : lp2[k][l];
+			g.hp1[k][l] = fabsf(hp1[k][l]) < 1e-15f ? 0 : hp1[k][l];
+			g.hp2[k][l] = fabsf(hp2[k][l]) < 1e-15f ? 0 : hp2[k][l];
+		}
+		g.gain[l] += inc[l] * nframes;
+		if (g.gainStep[l] == 0 || inc[l] == 0) {
+			g.gain[l] = g.gainTarget[l];
+		}
+		g.peak[l] = peak[l];
+		g.sumSq[l] += sumSq[l];
+	}
+}
+
+void OutputMaster::measureTruePeak(ChannelGroup &g, float (*buf)[LANES], int nframes)
+{
+	const int H = TP_TAPS - 1;
+	float x[H + CHUNK][LANES];
+	float peak[LANES], acc[LANES];
+	memcpy(x, g.history, sizeof(g.history));
+	memcpy(x + H, buf, nframes * sizeof(buf[0]));
+	memcpy(peak, g.truePeak, sizeof(peak));
+
+	for (int i = 0; i < nframes; i++) {
+		for (int p = 0; p < TP_PHASES; p++) {
+			const float *h = m_truePeakTaps[p];
+			for (int l = 0; l < LANES; l++) {
+				acc[l] = 0;
+			}
+			for (int k = 0; k < TP_TAPS; k++) {
+				const float *row = x[i + H - k];
+				for (int l = 0; l < LANES; l++) {
+					acc[l] += h[k] * row[l];
+				}
+			}
+			for (int l = 0; l < LANES; l++) {
+				float a = fabsf(acc[l]);
+				peak[l] = a > peak[l] ? a : peak[l];
+			}
+		}
+	}
+
+	memcpy(g.history, x + nframes, sizeof(g.history));
+	memcpy(g.truePeak, peak, sizeof(peak));
+}
+
 void OutputMaster::onAudioCB(AudioIOData &io)
 {
-	int i, chan = 0;
 	int nframes = io.framesPerBuffer();
-	double bass_buf[nframes];
-	double filt_out[nframes];
-	double filt_low[nframes];
-	double in_buf[nframes];
-	double master_gain;
+	float buf[CHUNK][LANES];
+	float bass[CHUNK][LANES];
+	float master[CHUNK], limit[CHUNK];
 
 	m_parameterQueue.update(0);
-	master_gain = m_masterGain * (m_muteAll ? 0.0 : 1.0);
-	memset(bass_buf, 0, nframes * sizeof(double));
-	for (chan = 0; chan < m_numChnls; chan++) {
-		double gain = master_gain * m_gains[chan];
-		const float *in = io.outBuffer(chan);  // Yes, the input here is the output from previous runs for the io object
-		float *out = io.outBuffer(chan);
-		double filt_temp[nframes];
-		double *buf = bass_buf;
-
-		for (i = 0; i < nframes; i++) {
-			in_buf[i] = *in++;
+	updateGains();
+	m_started = true;
+
+	/* Channels are processed in groups a chunk at a time, so that a group's
+	   signal stays in cache from input to metering */
+	for (int start = 0; start < nframes; start += CHUNK) {
+		int n = std::min((int) CHUNK, nframes - start);
+		rampMaster(master, limit, n);
+		if (m_BassManagementMode != BASSMODE_NONE) {
+			memset(bass, 0, sizeof(bass));
 		}
-		switch (m_BassManagementMode) {
-		case BASSMODE_NONE:
-			break;
-		case BASSMODE_MIX:
-			for (i = 0; i < nframes; i++) {
-				filt_low[i] = in_buf[i];
+
+		for (unsigned grp = 0; grp < m_groups.size(); grp++) {
+			ChannelGroup &g = m_groups[grp];
+			int first = grp * LANES;
+			int lanes = std::min((int) LANES, m_numChnls - first);
+			int i, l;
+
+			for (l = 0; l < lanes; l++) {
+				// Yes, the input here is the output from previous runs for the io object
+				const float *in = io.outBuffer(first + l) + start;
+				for (i = 0; i < n; i++) {
+					buf[i][l] = in[i];
+				}
 			}
-			break;
-		case BASSMODE_LOWPASS:
-			butter_next(m_lopass1[chan], in_buf, filt_temp, nframes);
-			butter_next(m_lopass2[chan], filt_temp, filt_low, nframes);
-			break;
-		case BASSMODE_HIGHPASS:
-			for (i = 0; i < nframes; i++) {
-				filt_low[i] = in_buf[i];
+			for (; l < LANES; l++) {
+				for (i = 0; i < n; i++) {
+					buf[i][l] = 0;
+				}
 			}
-			butter_next(m_hipass1[chan], in_buf, filt_temp, nframes);
-			butter_next(m_hipass2[chan], filt_temp, filt_out, nframes);
-			for (i = 0; i < nframes; i++) {
-				in_buf[i] = filt_out[i];
+
+			switch (m_BassManagementMode) {
+			case BASSMODE_MIX:
+				processGroup<BASSMODE_MIX>(g, buf, bass, master, limit, n);
+				break;
+			case BASSMODE_LOWPASS:
+				processGroup<BASSMODE_LOWPASS>(g, buf, bass, master, limit, n);
+				break;
+			case BASSMODE_HIGHPASS:
+				processGroup<BASSMODE_HIGHPASS>(g, buf, bass, master, limit, n);
+				break;
+			case BASSMODE_FULL:
+				processGroup<BASSMODE_FULL>(g, buf, bass, master, limit, n);
+				break;
+			default:
+				processGroup<BASSMODE_NONE>(g, buf, bass, master, limit, n);
+				break;
 			}
-			break;
-		case BASSMODE_FULL:
-			butter_next(m_lopass1[chan], in_buf, filt_temp, nframes);
-			butter_next(m_lopass2[chan], filt_temp, filt_low, nframes);
-			butter_next(m_hipass1[chan], in_buf, filt_temp, nframes);
-			butter_next(m_hipass2[chan], filt_temp, filt_out, nframes);
-			for (i = 0; i < nframes; i++) {
-				in_buf[i] = filt_out[i]; /* a bit inefficient to copy here, but makes code simpler below */
+			if (m_truePeakOn) {
+				measureTruePeak(g, buf, n);
 			}
-			break;
-		default:
-			break;
-		}
-		for (i = 0; i < nframes; i++) { /* accumulate SW signal */
-			*buf++ += filt_low[i];
-		}
-		for (i = 0; i < nframes; i++) {
-			*out = in_buf[i] * gain;
-			if (m_clipperOn && *out > master_gain) {
-				*out = master_gain;
+
+			for (l = 0; l < lanes; l++) {
+				float *out = io.outBuffer(first + l) + start;
+				for (i = 0; i < n; i++) {
+					out[i] = buf[i][l];
+				}
 			}
-			out++;
 		}
-	}
-	if (m_BassManagementMode != BASSMODE_NONE) {
-		int sw;
-		for(sw = 0; sw < 4; sw++) {
-			if (swIndex[sw] < 0) continue;
-			float *out = io.outBuffer(swIndex[sw]);
-			memset(out, 0, nframes * sizeof(float));
-			for (i = 0; i < nframes; i++) {
-				*out++ = bass_buf[i];
+
+		if (m_BassManagementMode != BASSMODE_NONE) {
+			/* The bass is summed across lanes once all groups are done */
+			float sw_buf[CHUNK];
+			for (int i = 0; i < n; i++) {
+				float sum = 0;
+				for (int l = 0; l < LANES; l++) {
+					sum += bass[i][l];
+				}
+				sum *= master[i];
+				sw_buf[i] = sum > limit[i] ? limit[i] : (sum < -limit[i] ? -limit[i] : sum);
 			}
-		}
-	}
-	if (m_meterOn) {
-		for (chan = 0; chan < m_numChnls; chan++) {
-			float *out = io.outBuffer(chan);
-			for (i = 0; i < nframes; i++) {
-				if (m_meters[chan] < *out) {
-					m_meters[chan] = *out;
+			for (int sw = 0; sw < 4; sw++) {
+				if (swIndex[sw] < 0) continue;
+				float *out = io.outBuffer(swIndex[sw]) + start;
+				for (int i = 0; i < n; i++) {
+					out[i] = sw_buf[i];
+					float a = fabsf(sw_buf[i]);
+					m_swPeak[sw] = a > m_swPeak[sw] ? a : m_swPeak[sw];
+					m_swSumSq[sw] += sw_buf[i] * sw_buf[i];
 				}
-				out++;
 			}
 		}
+	}
+
+	if (m_meterOn) {
 		m_meterCounter += nframes;
 		if (m_meterCounter >= m_meterUpdateSamples) {
-			m_meterBuffer.write( (char *) m_meters.data(), sizeof(float) * m_numChnls);
-			memset(m_meters.data(), 0, sizeof(float) * m_numChnls);
-			m_meterCounter = 0; // A little jitter but efficient
+			publishMeters();
 			pthread_cond_signal(&m_meterCond);
 		}
+	} else {
+		resetMeters();
 	}
 }
 
+void OutputMaster::publishMeters()
+{
+	for (int chan = 0; chan < m_numChnls; chan++) {
+		const ChannelGroup &g = m_groups[chan / LANES];
+		int l = chan % LANES;
+		m_meters[chan] = g.peak[l];
+		m_rms[chan] = sqrt(g.sumSq[l] / m_meterCounter);
+		m_truePeaks[chan] = std::max(g.truePeak[l], g.peak[l]);
+	}
+	if (m_BassManagementMode != BASSMODE_NONE) {
+		for (int sw = 0; sw < 4; sw++) {
+			if (swIndex[sw] < 0 || swIndex[sw] >= m_numChnls) continue;
+			m_meters[swIndex[sw]] = m_truePeaks[swIndex[sw]] = m_swPeak[sw];
+			m_rms[swIndex[sw]] = sqrt(m_swSumSq[sw] / m_meterCounter);
+		}
+	}
+
+	/* Only whole sets of values are written, so that readers stay aligned */
+	size_t bytes = sizeof(float) * m_numChnls;
+	if (m_meterBuffer.writeSpace() >= bytes) {
+		m_meterBuffer.write((char *) m_meters.data(), bytes);
+	}
+	if (m_rmsBuffer.writeSpace() >= bytes) {
+		m_rmsBuffer.write((char *) m_rms.data(), bytes);
+	}
+	if (m_truePeakOn && m_truePeakBuffer.writeSpace() >= bytes) {
+		m_truePeakBuffer.write((char *) m_truePeaks.data(), bytes);
+	}
+	resetMeters(); // A little jitter but efficient
+}
+
+void OutputMaster::resetMeters()
+{
+	for (unsigned grp = 0; grp < m_groups.size(); grp++) {
+		ChannelGroup &g = m_groups[grp];
+		for (int l = 0; l < LANES; l++) {
+			g.peak[l] = g.truePeak[l] = 0;
+			g.sumSq[l] = 0;
+		}
+	}
+	for (int sw = 0; sw < 4; sw++) {
+		m_swPeak[sw] = 0;
+		m_swSumSq[sw] = 0;
+	}
+	m_meterCounter = 0;
+}
+
 void OutputMaster::setGainTimestamped(al_sec until, int channelIndex, double gain)
 {
 	setGain(channelIndex, gain);
@@ -253,6 +500,11 @@ void OutputMaster::setMeterOnTimestamped(al_sec until, bool on)
 	setMeterOn(on);
 }
 
+void OutputMaster::setTruePeakOnTimestamped(al_sec until, bool on)
+{
+	setTruePeakOn(on);
+}
+
 void OutputMaster::setMeterupdateFreqTimestamped(al_sec until, double freq)
 {
 	setMeterUpdateFreq(freq);
@@ -305,7 +557,11 @@ void OutputMaster::initializeData()
 	m_addressPrefix = "/Alloaudio";
 	m_meterCounter = 0;
 	m_meterOn = false;
+	m_truePeakOn = false;
 	m_meterAddrHasChannel = false;
+	m_gainRampTime = 0;
+	m_master = m_masterStep = m_masterTarget = 0;
+	m_started = false;
 
 	setBassManagementMode(BASSMODE_NONE);
 	setBassManagementFreq(150);
@@ -316,33 +572,47 @@ void OutputMaster::allocateChannels(int numChnls)
 {
 	m_gains.resize(numChnls);
 	m_meters.resize(numChnls);
-	m_lopass1.resize(numChnls);
-	m_lopass2.resize(numChnls);
-	m_hipass1.resize(numChnls);
-	m_hipass2.resize(numChnls);
+	m_rms.resize(numChnls);
+	m_truePeaks.resize(numChnls);
+	m_groups.resize((numChnls + LANES - 1) / LANES);
 	swIndex[0] = numChnls - 1;
 	swIndex[1] =  swIndex[2] = swIndex[3] = -1;
 
 	for (int i = 0; i < numChnls; i++) {
 		m_gains[i] = 1.0;
-		m_meters[i] = 0;
-		m_lopass1[i] = butter_create(m_framesPerSec, BUTTER_LP);
-		m_lopass2[i] = butter_create(m_framesPerSec, BUTTER_LP);
-		m_hipass1[i] = butter_create(m_framesPerSec, BUTTER_HP);
-		m_hipass2[i] = butter_create(m_framesPerSec, BUTTER_HP);
+	}
+	for (unsigned i = 0; i < m_groups.size(); i++) {
+		memset(&m_groups[i], 0, sizeof(ChannelGroup));
+	}
+	resetMeters();
+
+	/* Interpolator for true peaks: a Hann windowed sinc, with one set of taps
+	   for each fraction of a sample interpolated */
+	for (int p = 0; p < TP_PHASES; p++) {
+		double sum = 0;
+		for (int k = 0; k < TP_TAPS; k++) {
+			double t = k - TP_TAPS / 2 + (double) p / TP_PHASES;
+			double sinc = t == 0 ? 1.0 : sin(M_PI * t) / (M_PI * t);
+			double window = 0.5 + 0.5 * cos(M_PI * t / (TP_TAPS / 2));
+			m_truePeakTaps[p][k] = sinc * window;
+			sum += sinc * window;
+		}
+		for (int k = 0; k < TP_TAPS; k++) { /* unity gain at DC */
+			m_truePeakTaps[p][k] /= sum;
+		}
 	}
 }
 
 void *OutputMaster::meterThreadFunc(void *arg) {
 	int chanindex = 0;
 	OutputMaster *om = static_cast<OutputMaster *>(arg);
-	float meter_levels[om->m_numChnls];
+	std::vector<float> meter_levels(om->m_numChnls);
 
 	al::osc::Send s(om->m_sendPort, om->m_sendAddress.c_str());
 	while(om->m_runMeterThread) {
 		pthread_mutex_lock(&om->m_meterMutex);
 		pthread_cond_wait(&om->m_meterCond, &om->m_meterMutex);
-		int bytes_read = om->m_meterBuffer.read((char *) meter_levels, om->m_numChnls * sizeof(float));
+		int bytes_read = om->m_meterBuffer.read((char *) &meter_levels[0], om->m_numChnls * sizeof(float));
 		if (bytes_read) {
 			if (bytes_read !=  om->m_numChnls * sizeof(float)) {
 				std::cerr << "Alloaudio: Warning. Meter values underrun." << std::endl;
@@ -449,6 +719,23 @@ void OutputMaster::OSCHandler::onMessage(osc::Message &m)
 			std::cerr << "Alloaudio: Wrong type tags for " + outputmaster->m_addressPrefix + "/meter_update_freq: "
 					 << m.typeTags() << std::endl;
 		}
+	} else if (m.addressPattern() == outputmaster->m_addressPrefix + "/true_peak_on") {
+		if (m.typeTags() == "i") {
+			int on;
+			m >> on;
+			outputmaster->m_parameterQueue.send(outputmaster->m_parameterQueue.now(),
+												outputmaster, &OutputMaster::setTruePeakOnTimestamped,
+												(bool) on != 0);
+		} else if (m.typeTags() == "f") {
+			float on;
+			m >> on;
+			outputmaster->m_parameterQueue.send(outputmaster->m_parameterQueue.now(),
+												outputmaster, &OutputMaster::setTruePeakOnTimestamped,
+												(bool) on != 0);
+		} else {
+			std::cerr << "Alloaudio: Wrong type tags for " + outputmaster->m_addressPrefix + "/true_peak_on: "
+					 << m.typeTags() << std::endl;
+		}
 	} else if (m.addressPattern() == outputmaster->m_addressPrefix + "/meter_update_freq") {
 		if (m.typeTags() == "f") {
 			float freq;
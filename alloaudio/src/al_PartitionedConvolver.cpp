@@ -0,0 +1,405 @@
+#include <algorithm>
+#include <cstring>
+
+#include <Gamma/FFT.h>
+
+#include "allocore/system/al_Printing.hpp"
+#include "alloaudio/al_PartitionedConvolver.hpp"
+
+using namespace al;
+
+namespace {
+
+/* Smallest power of two not less than n */
+int ceilPow2(int n)
+{
+	int p = 1;
+	while (p < n) {
+		p <<= 1;
+	}
+	return p;
+}
+
+/* acc += x * h for split complex spectra. Kept free of aliasing, so that it
+   vectorizes. */
+void complexMultiplyAdd(float * __restrict accRe, float * __restrict accIm,
+                        const float * __restrict xRe, const float * __restrict xIm,
+                        const float * __restrict hRe, const float * __restrict hIm,
+                        int n)
+{
+	for (int i = 0; i < n; i++) {
+		accRe[i] += xRe[i] * hRe[i] - xIm[i] * hIm[i];
+		accIm[i] += xRe[i] * hIm[i] + xIm[i] * hRe[i];
+	}
+}
+
+}
+
+
+float *PartitionedConvolver::Level::inputSpectrum(int in, long long seg)
+{
+	return &inputs[(in * count + seg % count) * 2 * bins()];
+}
+
+void PartitionedConvolver::Level::Transform::operator()(int64_t begin, int64_t end)
+{
+	for (int64_t i = begin; i < end; i++) {
+		level->owner->transformInput(*level, i);
+	}
+	/* The last input transformed starts the outputs, which need them all */
+	int n = end - begin;
+	if (level->async && level->remaining.fetch_sub(n) == n) {
+		level->group.runRange(0, level->owner->mOutputChannels.size(), 1, level->accumulate);
+	}
+}
+
+void PartitionedConvolver::Level::Accumulate::operator()(int64_t begin, int64_t end)
+{
+	for (int64_t i = begin; i < end; i++) {
+		level->owner->accumulateOutput(*level, i);
+	}
+}
+
+
+PartitionedConvolver::PartitionedConvolver(ThreadPool &pool) :
+    mPool(pool), mHistorySize(0), mBlockSize(0), mHeadSize(0),
+    mNumInputs(0), mNumOutputs(0), mFrame(0), mInputsAreBuses(false)
+{
+}
+
+PartitionedConvolver::~PartitionedConvolver()
+{
+	clearLevels();
+}
+
+void PartitionedConvolver::addIR(int input, int output, const float *ir, int length)
+{
+	if (input < 0 || output < 0 || length <= 0) {
+		AL_WARN("PartitionedConvolver: invalid IR for input %d, output %d", input, output);
+		return;
+	}
+	Route r;
+	r.input = input;
+	r.output = output;
+	r.in = r.out = 0;
+	r.ir.assign(ir, ir + length);
+	mRoutes.push_back(r);
+}
+
+void PartitionedConvolver::clearIRs()
+{
+	mRoutes.clear();
+}
+
+void PartitionedConvolver::clearLevels()
+{
+	for (unsigned l = 0; l < mLevels.size(); l++) {
+		mLevels[l]->group.wait();
+		for (unsigned i = 0; i < mLevels[l]->ffts.size(); i++) {
+			delete mLevels[l]->ffts[i];
+		}
+		delete mLevels[l];
+	}
+	mLevels.clear();
+}
+
+int PartitionedConvolver::configure(int blockSize, int maxPartition)
+{
+	clearLevels();
+	mBlockSize = 0;
+	if (blockSize <= 0) {
+		AL_WARN("PartitionedConvolver: invalid block size %d", blockSize);
+		return -1;
+	}
+
+	/* Channels are numbered by their order of appearance */
+	mInputChannels.clear();
+	mOutputChannels.clear();
+	mNumInputs = mNumOutputs = 0;
+	int maxLength = 0;
+	for (unsigned r = 0; r < mRoutes.size(); r++) {
+		Route &route = mRoutes[r];
+		std::vector<int>::iterator it;
+		it = std::find(mInputChannels.begin(), mInputChannels.end(), route.input);
+		route.in = it - mInputChannels.begin();
+		if (it == mInputChannels.end()) {
+			mInputChannels.push_back(route.input);
+		}
+		it = std::find(mOutputChannels.begin(), mOutputChannels.end(), route.output);
+		route.out = it - mOutputChannels.begin();
+		if (it == mOutputChannels.end()) {
+			mOutputChannels.push_back(route.output);
+		}
+		mNumInputs = std::max(mNumInputs, route.input + 1);
+		mNumOutputs = std::max(mNumOutputs, route.output + 1);
+		maxLength = std::max(maxLength, (int) route.ir.size());
+	}
+	mOutputRoutes.assign(mOutputChannels.size(), std::vector<int>());
+	for (unsigned r = 0; r < mRoutes.size(); r++) {
+		mOutputRoutes[mRoutes[r].out].push_back(r);
+	}
+	int numIn = mInputChannels.size(), numOut = mOutputChannels.size();
+
+	/* Blocks smaller than the smallest partition get a head convolved
+	   directly, which lasts until the first partition can be computed */
+	int size = blockSize;
+	mHeadSize = 0;
+	if (blockSize < MIN_PARTITION) {
+		size = blockSize * ((MIN_PARTITION + blockSize - 1) / blockSize);
+		mHeadSize = size;
+	}
+
+	/* Partitions of each level start where the next level's first one is
+	   due, two of its sizes in, so that it has a partition's duration to be
+	   computed. The largest level takes the rest of the IRs. */
+	int offset = mHeadSize;
+	int maxSize = size;
+	while (offset < maxLength) {
+		int next = size * GROWTH;
+		int end = next > maxPartition ? maxLength : 2 * next;
+		Level *level = new Level(mPool);
+		level->size = size;
+		level->offset = offset;
+		level->count = (std::min(end, maxLength) - offset + size - 1) / size;
+		level->async = !mLevels.empty();
+		level->segment = -1;
+		level->owner = this;
+		level->transform.level = level;
+		level->accumulate.level = level;
+		mLevels.push_back(level);
+		maxSize = size;
+		offset = end;
+		size = next;
+	}
+
+	for (unsigned l = 0; l < mLevels.size(); l++) {
+		Level &level = *mLevels[l];
+		int P = level.size, bins = level.bins();
+		level.parts.assign(mRoutes.size(), 0);
+		level.spectra.assign(mRoutes.size() * level.count * 2 * bins, 0);
+		level.inputs.assign(numIn * level.count * 2 * bins, 0);
+		level.outputs.assign(numOut * 2 * P, 0);
+		level.scratch.assign((numIn + numOut) * (2 * P + 2), 0);
+		level.acc.assign(numOut * 2 * bins, 0);
+		for (int i = 0; i < numIn + numOut; i++) {
+			level.ffts.push_back(new gam::RFFT<float>(2 * P));
+		}
+
+		/* IR partitions are stored with the scaling of the inverse FFT */
+		float *buf = &level.scratch[0];
+		const float scale = 1.0f / (2 * P);
+		for (unsigned r = 0; r < mRoutes.size(); r++) {
+			const std::vector<float> &ir = mRoutes[r].ir;
+			for (int k = 0; k < level.count; k++) {
+				int start = level.offset + k * P;
+				if (start >= (int) ir.size()) {
+					break;
+				}
+				int n = std::min(P, (int) ir.size() - start);
+				std::fill(buf, buf + 2 * P + 2, 0.0f);
+				memcpy(buf + 1, &ir[start], n * sizeof(float));
+				level.ffts[0]->forward(buf, true, false);
+				float *re = level.spectrum(r, k), *im = re + bins;
+				for (int j = 0; j < bins; j++) {
+					re[j] = buf[2 * j] * scale;
+					im[j] = buf[2 * j + 1] * scale;
+				}
+				level.parts[r] = k + 1;
+			}
+		}
+	}
+
+	/* Input is kept until the largest partitions have been computed from it */
+	mHistorySize = ceilPow2(std::max(4 * maxSize, blockSize));
+	mHistory.assign(numIn * mHistorySize, 0);
+	mHeadInput.assign(mHeadSize ? numIn * (mHeadSize - 1 + blockSize) : 0, 0);
+	mInPtrs.assign(mNumInputs, (const float *) 0);
+	mOutPtrs.assign(mNumOutputs, (float *) 0);
+	mBlockSize = blockSize;
+	reset();
+	return 0;
+}
+
+void PartitionedConvolver::reset()
+{
+	for (unsigned l = 0; l < mLevels.size(); l++) {
+		Level &level = *mLevels[l];
+		level.group.wait();
+		std::fill(level.inputs.begin(), level.inputs.end(), 0.0f);
+		std::fill(level.outputs.begin(), level.outputs.end(), 0.0f);
+		level.segment = -1;
+	}
+	std::fill(mHistory.begin(), mHistory.end(), 0.0f);
+	std::fill(mHeadInput.begin(), mHeadInput.end(), 0.0f);
+	mFrame = 0;
+}
+
+void PartitionedConvolver::transformInput(Level &level, int in)
+{
+	const int P = level.size, bins = level.bins();
+	const int mask = mHistorySize - 1;
+	const float *hist = history(in);
+	float *buf = &level.scratch[in * (2 * P + 2)];
+
+	/* The window holds the previous and the current segment. Before the
+	   first segment it wraps to the end of the history, which is silent. */
+	long long start = (level.segment - 1) * P;
+	int first = start & mask;
+	int n = std::min(2 * P, mHistorySize - first);
+	buf[0] = 0;
+	memcpy(buf + 1, hist + first, n * sizeof(float));
+	memcpy(buf + 1 + n, hist, (2 * P - n) * sizeof(float));
+	buf[2 * P + 1] = 0;
+	level.ffts[in]->forward(buf, true, false);
+
+	float *re = level.inputSpectrum(in, level.segment), *im = re + bins;
+	for (int j = 0; j < bins; j++) {
+		re[j] = buf[2 * j];
+		im[j] = buf[2 * j + 1];
+	}
+}
+
+void PartitionedConvolver::accumulateOutput(Level &level, int out)
+{
+	const int P = level.size, bins = level.bins();
+	const int numIn = mInputChannels.size();
+	const long long seg = level.segment;
+	float *re = &level.acc[out * 2 * bins], *im = re + bins;
+	std::fill(re, re + 2 * bins, 0.0f);
+
+	/* Partition k applies to the input segment k before the current one */
+	const std::vector<int> &routes = mOutputRoutes[out];
+	for (unsigned i = 0; i < routes.size(); i++) {
+		int r = routes[i];
+		int parts = std::min((long long) level.parts[r], seg + 1);
+		for (int k = 0; k < parts; k++) {
+			const float *x = level.inputSpectrum(mRoutes[r].in, seg - k);
+			const float *h = level.spectrum(r, k);
+			complexMultiplyAdd(re, im, x, x + bins, h, h + bins, bins);
+		}
+	}
+
+	float *buf = &level.scratch[(numIn + out) * (2 * P + 2)];
+	for (int j = 0; j < bins; j++) {
+		buf[2 * j] = re[j];
+		buf[2 * j + 1] = im[j];
+	}
+	level.ffts[numIn + out]->inverse(buf, true);
+
+	/* The first half holds the circular wrap; the second is the segment */
+	memcpy(level.output(out, seg), buf + 1 + P, P * sizeof(float));
+}
+
+void PartitionedConvolver::startSegment(Level &level)
+{
+	int numIn = mInputChannels.size();
+	if (level.async) {
+		level.remaining.store(numIn);
+		level.group.runRange(0, numIn, 1, level.transform);
+	}
+	else {
+		level.transform(0, numIn);
+		level.accumulate(0, mOutputChannels.size());
+	}
+}
+
+void PartitionedConvolver::process(const float * const *inputs, float * const *outputs)
+{
+	const int B = mBlockSize;
+	const int numIn = mInputChannels.size(), numOut = mOutputChannels.size();
+	if (B == 0) {
+		return;
+	}
+
+	/* Input is consumed first, so that outputs may alias inputs */
+	int pos = mFrame & (mHistorySize - 1);
+	int n = std::min(B, mHistorySize - pos);
+	for (int i = 0; i < numIn; i++) {
+		const float *in = inputs[mInputChannels[i]];
+		memcpy(&mHistory[i * mHistorySize + pos], in, n * sizeof(float));
+		memcpy(&mHistory[i * mHistorySize], in + n, (B - n) * sizeof(float));
+		if (mHeadSize) {
+			float *x = &mHeadInput[i * (mHeadSize - 1 + B)];
+			memmove(x, x + B, (mHeadSize - 1) * sizeof(float));
+			memcpy(x + mHeadSize - 1, in, B * sizeof(float));
+		}
+	}
+	for (int o = 0; o < numOut; o++) {
+		memset(outputs[mOutputChannels[o]], 0, B * sizeof(float));
+	}
+
+	/* Head, convolved directly */
+	for (unsigned r = 0; mHeadSize && r < mRoutes.size(); r++) {
+		const Route &route = mRoutes[r];
+		const float *h = &route.ir[0];
+		const float *x = &mHeadInput[route.in * (mHeadSize - 1 + B)] + mHeadSize - 1;
+		float *y = outputs[route.output];
+		int n = std::min(mHeadSize, (int) route.ir.size());
+		for (int j = 0; j < n; j++) {
+			const float *xj = x - j;
+			for (int i = 0; i < B; i++) {
+				y[i] += h[j] * xj[i];
+			}
+		}
+	}
+
+	/* Segments completed by this block are computed right away by the
+	   first level, and later on the pool by the others */
+	long long end = mFrame + B;
+	for (unsigned l = 0; l < mLevels.size(); l++) {
+		Level &level = *mLevels[l];
+		if (!level.async && end % level.size == 0) {
+			level.segment = end / level.size - 1;
+			startSegment(level);
+		}
+	}
+
+	for (unsigned l = 0; l < mLevels.size(); l++) {
+		Level &level = *mLevels[l];
+		if (mFrame < level.offset) {
+			continue;
+		}
+		long long s = (mFrame - level.offset) / level.size;
+		int off = (mFrame - level.offset) % level.size;
+		if (s == level.segment) {
+			/* Only still running if the pool is overloaded */
+			level.group.wait();
+		}
+		for (int o = 0; o < numOut; o++) {
+			const float *src = level.output(o, s) + off;
+			float *y = outputs[mOutputChannels[o]];
+			for (int i = 0; i < B; i++) {
+				y[i] += src[i];
+			}
+		}
+	}
+
+	for (unsigned l = 0; l < mLevels.size(); l++) {
+		Level &level = *mLevels[l];
+		if (level.async && end % level.size == 0) {
+			level.group.wait();
+			level.segment = end / level.size - 1;
+			startSegment(level);
+		}
+	}
+
+	mFrame = end;
+}
+
+void PartitionedConvolver::onAudioCB(AudioIOData &io)
+{
+	if (io.framesPerBuffer() != mBlockSize) {
+		AL_WARN_ONCE("PartitionedConvolver: configured for %d frames, got %d",
+		             mBlockSize, io.framesPerBuffer());
+		return;
+	}
+	for (unsigned i = 0; i < mInputChannels.size(); i++) {
+		int c = mInputChannels[i];
+		mInPtrs[c] = mInputsAreBuses ? io.busBuffer(c) : io.inBuffer(c);
+	}
+	for (unsigned o = 0; o < mOutputChannels.size(); o++) {
+		int c = mOutputChannels[o];
+		mOutPtrs[c] = io.outBuffer(c);
+	}
+	process(&mInPtrs[0], &mOutPtrs[0]);
+}
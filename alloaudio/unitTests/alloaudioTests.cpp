@@ -3,6 +3,7 @@
 #include <string>
 #include <sstream>
 #include <cassert>
+#include <cmath>
 //#include <iostream>
 
 #include "alloaudio/al_OutputMaster.hpp"
@@ -270,6 +271,122 @@ void ut_osc_meters()
 	assert(meterValues2[1] == 0.0);
 }
 
+void ut_meter_rms(void)
+{
+	al::AudioIO io(4, 44100.0, NULL, NULL, 2, 2, al::AudioIO::DUMMY);
+	al::OutputMaster outmaster(io.channelsOut(), io.framesPerSecond(), "", -1);
+	io.append(outmaster);
+
+	outmaster.setMasterGain(1.0);
+	outmaster.setMeterOn(true);
+	outmaster.setClipperOn(false);
+	outmaster.setMeterUpdateFreq(11025); // 4 samples
+
+	float *in_0 = io.outBuffer(0);
+	float *in_1 = io.outBuffer(1);
+	for (int i = 0; i < 4; i++) {
+		in_0[i] = (i % 2) ? -0.5 : 0.5;
+		in_1[i] = i == 2 ? -0.75 : 0.0;
+	}
+	io.processAudio();
+
+	float peaks[2], rms[2];
+	assert(outmaster.getMeterValues(peaks) == 2 * sizeof(float));
+	assert(outmaster.getRmsValues(rms) == 2 * sizeof(float));
+	assert(peaks[0] == 0.5);
+	assert(peaks[1] == 0.75);
+	assert(fabs(rms[0] - 0.5) < 1e-6);
+	assert(fabs(rms[1] - 0.375) < 1e-6);
+}
+
+void ut_true_peak(void)
+{
+	al::AudioIO io(64, 44100.0, NULL, NULL, 2, 2, al::AudioIO::DUMMY);
+	al::OutputMaster outmaster(io.channelsOut(), io.framesPerSecond(), "", -1);
+	io.append(outmaster);
+
+	outmaster.setMasterGain(1.0);
+	outmaster.setMeterOn(true);
+	outmaster.setTruePeakOn(true);
+	outmaster.setClipperOn(false);
+	outmaster.setMeterUpdateFreq(44100.0/256);
+
+	// A quarter of the sampling rate, sampled halfway between its peaks
+	for (int block = 0; block < 8; block++) {
+		for (int i = 0; i < 64; i++) {
+			int frame = block * 64 + i;
+			io.outBuffer(0)[i] = sin(M_PI/2 * frame + M_PI/4);
+			io.outBuffer(1)[i] = 0.5 * sin(M_PI/2 * frame);
+		}
+		io.processAudio();
+	}
+
+	// The first update includes the start of the signal
+	float peaks[2], truePeaks[2];
+	assert(outmaster.getTruePeakValues(truePeaks) == 2 * sizeof(float));
+	assert(outmaster.getTruePeakValues(truePeaks) == 2 * sizeof(float));
+	outmaster.getMeterValues(peaks);
+	outmaster.getMeterValues(peaks);
+	assert(fabs(peaks[0] - sqrt(0.5)) < 1e-6);
+	assert(fabs(truePeaks[0] - 1.0) < 0.01);
+	assert(fabs(truePeaks[1] - 0.5) < 0.005);
+}
+
+void ut_gain_ramp(void)
+{
+	al::AudioIO io(4, 44100.0, NULL, NULL, 2, 2, al::AudioIO::DUMMY);
+	al::OutputMaster outmaster(io.channelsOut(), io.framesPerSecond(), "", -1);
+	io.append(outmaster);
+	outmaster.setMasterGain(1.0);
+	outmaster.setGainRampTime(8/44100.0);
+
+	float expected[3][4] = {{1, 1, 1, 1},
+							{0.875, 0.75, 0.625, 0.5},
+							{0.375, 0.25, 0.125, 0}};
+	for (int block = 0; block < 3; block++) {
+		for (int i = 0; i < 4; i++) {
+			io.outBuffer(0)[i] = 1.0;
+			io.outBuffer(1)[i] = 1.0;
+		}
+		io.processAudio();
+		for (int i = 0; i < 4; i++) {
+			assert(fabs(io.outBuffer(0)[i] - expected[block][i]) < 1e-5);
+			assert(io.outBuffer(1)[i] == 1.0);
+		}
+		outmaster.setGain(0, 0.0);
+	}
+}
+
+void ut_bass_management(void)
+{
+	// Channels 0-7 are mains, 8 is the subwoofer
+	al::AudioIO io(512, 44100.0, NULL, NULL, 9, 2, al::AudioIO::DUMMY);
+	al::OutputMaster outmaster(io.channelsOut(), io.framesPerSecond(), "", -1);
+	io.append(outmaster);
+	outmaster.setMasterGain(1.0);
+	outmaster.setClipperOn(false);
+	outmaster.setBassManagementFreq(150);
+
+	al::bass_mgmt_mode_t modes[2] = {al::BASSMODE_LOWPASS, al::BASSMODE_FULL};
+	for (int m = 0; m < 2; m++) {
+		outmaster.setBassManagementMode(modes[m]);
+		for (int block = 0; block < 100; block++) {
+			for (int chan = 0; chan < 9; chan++) {
+				for (int i = 0; i < 512; i++) {
+					io.outBuffer(chan)[i] = chan < 8 ? 0.1 : 0.0;
+				}
+			}
+			io.processAudio();
+		}
+		for (int chan = 0; chan < 8; chan++) {
+			// DC passes the mains unless they are high passed
+			float main = modes[m] == al::BASSMODE_LOWPASS ? 0.1 : 0.0;
+			assert(fabs(io.outBuffer(chan)[511] - main) < 1e-4);
+		}
+		assert(fabs(io.outBuffer(8)[511] - 0.8) < 1e-4);
+	}
+}
+
 
 #define RUNTEST(Name)\
 	printf("%s ", #Name);\
@@ -285,6 +402,10 @@ int main()
 	RUNTEST(clipper);
 	RUNTEST(osc_gain);
 	RUNTEST(osc_meters);
+	RUNTEST(meter_rms);
+	RUNTEST(true_peak);
+	RUNTEST(gain_ramp);
+	RUNTEST(bass_management);
 
 	return 0;
 }
@@ -6,6 +6,7 @@
 #include <cassert>
 #include <iostream>
 #include <cmath>
+#include <vector>
 
 #include "alloaudio/al_Decorrelation.hpp"
 #include "allocore/system/al_Time.hpp"
@@ -22,13 +23,12 @@ void ut_class_test(void)
 	assert(dec.getSize() == 32);
 
 	float *ir = dec.getIR(0);
-	double expected[] = {0.65027274, -0.16738815,  0.1617437 ,  0.18901241,  0.01768662,
-						 -0.0802799 , -0.12612745,  0.09564361,  0.00803435,  0.07643685,
-						 -0.030273  ,  0.26991193, -0.03412993, -0.05709789,  0.05474607,
-						 -0.12850219,  0.03040506, -0.05887395,  0.05779415,  0.12589107,
-						 0.0778308 , -0.19303948,  0.16970104, -0.34332016, -0.14030879,
-						 0.02862106,  0.18978155,  0.02629568, -0.09265464, -0.04808504,
-						 0.00549774,  0.26477413};
+	double expected[] = {0.59150428, 0.04830463, 0.05037183, -0.24740407, 0.39155823, -0.04369229,
+						 0.06890884, 0.33353922, 0.12135151, -0.04466894, -0.02991931, -0.07604699,
+						 0.16378002, -0.06068135, -0.13707513, -0.09884668, -0.03349215, 0.00009230,
+						 0.19609518, 0.03479608, -0.07016544, 0.01993869, -0.01034042, 0.23153135,
+						 0.01065286, -0.23893675, -0.08966702, -0.03216232, -0.21551262, 0.12292721,
+						 -0.00805063, 0.05130990};
 	for (int i = 0; i < 32; i++) {
 //		std::cout << ir[i] << "..." << expected[i];
 		assert(fabs(ir[i] - expected[i]) < 0.000001);
@@ -65,19 +65,17 @@ void ut_decorrelation_test(void)
 	input[1] = 1.0;
 	io.processAudio();
 	float *outbuf = io.outBuffer(0);
-	double expected[] = {0.0, 0.68639828, -0.21015081,  0.04274105, -0.00369917, -0.06308476,
-						 0.24883819,  0.09921908, -0.02740205,  0.03255728, -0.00742716,
-						-0.00136285, -0.11266077, -0.0909083 ,  0.04217425,  0.07128946,
-						-0.01452214, -0.0008219 ,  0.03799216,  0.073492  , -0.04003114,
-						-0.02366538,  0.07602104,  0.15514681,  0.06790056, -0.0044905 ,
-						-0.10180065,  0.03126825, -0.0241807 ,  0.07766891, -0.11034507,
-						 0.02519892, -0.06023501, -0.03090125,  0.07787655, -0.10905136,
-						 0.09593274, -0.10025149,  0.12081278,  0.08383462,  0.03523137,
-						 0.04325256, -0.0628779 , -0.05428473, -0.03601444,  0.06532053,
-						 0.02946899, -0.16636388, -0.20115566, -0.12191195,  0.08616827,
-						 0.00697796,  0.00775061,  0.06617171,  0.14810011,  0.0442153 ,
-						-0.1437734 , -0.02805416,  0.03769239, -0.00884531, -0.1745563 ,
-						 0.13952994,  0.06541837,  0.05971518}; //,  0.153454}; Last value goes as first value in next buffer
+	double expected[] = {0.0, 0.63634545, 0.02798263, -0.09275678, 0.15625994, 0.04369556,
+						 -0.16037135, -0.11076665, 0.07978392, 0.12503433, 0.24163951, -0.11152796,
+						 -0.04929016, 0.07552490, 0.11428574, 0.15788583, 0.12742646, 0.09241187,
+						 -0.02458261, -0.04906720, 0.05225020, -0.05422030, -0.07163366, 0.03643875,
+						 -0.02749686, 0.08189307, 0.07067242, -0.01193138, -0.13704005, -0.00811642,
+						 -0.08605594, -0.04024598, -0.02394260, -0.05454224, 0.03350524, -0.02639943,
+						 0.07456756, 0.02908251, 0.17900907, -0.02783110, -0.04967014, -0.03928424,
+						 0.04833453, -0.01259663, -0.07923790, 0.12435988, -0.04485984, 0.12474373,
+						 0.17097583, -0.06795090, -0.10911045, 0.00393128, -0.20732063, -0.03292694,
+						 0.01526954, 0.05693236, -0.22131011, -0.04382417, 0.03552758, -0.04069985,
+						 0.08013920, 0.07811881, -0.15048440, 0.15828982};
 	for (int i = 0; i < io.framesPerBuffer(); i++) { // Zero out input bus
 //		std::cout << outbuf[i] << " ... "<< expected[i] << std::endl;
 		assert(fabs(expected[i] - outbuf[i]) < 0.000001);
@@ -90,19 +88,17 @@ void ut_decorrelation_test(void)
 	input[6] = 0.5;
 	io.processAudio();
 	outbuf = io.outBuffer(0);
-	double expected2[] = {0.153454, 0.0, 0.0, 0.0, 0.0, 0.0, 0.34319914, -0.1050754 ,  0.02137052, -0.00184959, -0.03154238,
-						  0.12441909,  0.04960954, -0.01370102,  0.01627864, -0.00371358,
-						 -0.00068143, -0.05633038, -0.04545415,  0.02108713,  0.03564473,
-						 -0.00726107, -0.00041095,  0.01899608,  0.036746  , -0.02001557,
-						 -0.01183269,  0.03801052,  0.07757341,  0.03395028, -0.00224525,
-						 -0.05090033,  0.01563412, -0.01209035,  0.03883445, -0.05517253,
-						  0.01259946, -0.03011751, -0.01545062,  0.03893828, -0.05452568,
-						  0.04796637, -0.05012575,  0.06040639,  0.04191731,  0.01761568,
-						  0.02162628, -0.03143895, -0.02714236, -0.01800722,  0.03266027,
-						  0.01473449, -0.08318194, -0.10057783, -0.06095598,  0.04308413,
-						  0.00348898,  0.0038753 ,  0.03308586,  0.07405005,  0.02210765,
-						 -0.0718867 , -0.01402708,  0.0188462 , -0.00442266, -0.08727815,
-						  0.06976497,  0.03270919,  0.02985759,  0.076727};
+	double expected2[] = {-0.06522271, 0.00000001, 0.0, 0.0, 0.0, -0.00000001,
+						 0.31817272, 0.01399132, -0.04637839, 0.07812998, 0.02184778, -0.08018568,
+						 -0.05538332, 0.03989196, 0.06251717, 0.12081976, -0.05576398, -0.02464508,
+						 0.03776244, 0.05714287, 0.07894291, 0.06371323, 0.04620593, -0.01229131,
+						 -0.02453360, 0.02612511, -0.02711015, -0.03581684, 0.01821938, -0.01374843,
+						 0.04094653, 0.03533622, -0.00596569, -0.06852002, -0.00405821, -0.04302798,
+						 -0.02012299, -0.01197129, -0.02727111, 0.01675262, -0.01319971, 0.03728379,
+						 0.01454126, 0.08950453, -0.01391555, -0.02483507, -0.01964212, 0.02416728,
+						 -0.00629832, -0.03961895, 0.06217993, -0.02242992, 0.06237186, 0.08548791,
+						 -0.03397545, -0.05455523, 0.00196563, -0.10366032, -0.01646347, 0.00763477,
+						 0.02846619, -0.11065505, -0.02191209, 0.01776379};
 	for (int i = 0; i < io.framesPerBuffer(); i++) { // Zero out input bus
 //		std::cout << outbuf[i] << " ... "<< expected2[i] << std::endl;
 		assert(fabs(expected2[i] - outbuf[i]) < 0.000001);
@@ -127,43 +123,29 @@ void ut_parallel_test(void)
 	input1[6] = 0.5;
 	io.processAudio();
 	float *outbuf0 = io.outBuffer(0);
-	double expected0[] = {0.0, 0.68639828, -0.21015081,  0.04274105, -0.00369917, -0.06308476,
-						 0.24883819,  0.09921908, -0.02740205,  0.03255728, -0.00742716,
-						-0.00136285, -0.11266077, -0.0909083 ,  0.04217425,  0.07128946,
-						-0.01452214, -0.0008219 ,  0.03799216,  0.073492  , -0.04003114,
-						-0.02366538,  0.07602104,  0.15514681,  0.06790056, -0.0044905 ,
-						-0.10180065,  0.03126825, -0.0241807 ,  0.07766891, -0.11034507,
-						 0.02519892, -0.06023501, -0.03090125,  0.07787655, -0.10905136,
-						 0.09593274, -0.10025149,  0.12081278,  0.08383462,  0.03523137,
-						 0.04325256, -0.0628779 , -0.05428473, -0.03601444,  0.06532053,
-						 0.02946899, -0.16636388, -0.20115566, -0.12191195,  0.08616827,
-						 0.00697796,  0.00775061,  0.06617171,  0.14810011,  0.0442153 ,
-						-0.1437734 , -0.02805416,  0.03769239, -0.00884531, -0.1745563 ,
-						 0.13952994,  0.06541837,  0.05971518};
+	double expected0[] = {0.0, 0.63634545, 0.02798263, -0.09275678, 0.15625994, 0.04369556,
+						 -0.16037135, -0.11076665, 0.07978392, 0.12503433, 0.24163951, -0.11152796,
+						 -0.04929016, 0.07552490, 0.11428574, 0.15788583, 0.12742646, 0.09241187,
+						 -0.02458261, -0.04906720, 0.05225020, -0.05422030, -0.07163366, 0.03643875,
+						 -0.02749686, 0.08189307, 0.07067242, -0.01193138, -0.13704005, -0.00811642,
+						 -0.08605594, -0.04024598, -0.02394260, -0.05454224, 0.03350524, -0.02639943,
+						 0.07456756, 0.02908251, 0.17900907, -0.02783110, -0.04967014, -0.03928424,
+						 0.04833453, -0.01259663, -0.07923790, 0.12435988, -0.04485984, 0.12474373,
+						 0.17097583, -0.06795090, -0.10911045, 0.00393128, -0.20732063, -0.03292694,
+						 0.01526954, 0.05693236, -0.22131011, -0.04382417, 0.03552758, -0.04069985,
+						 0.08013920, 0.07811881, -0.15048440, 0.15828982};
 	float *outbuf1 = io.outBuffer(1);
 	double expected1[] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0,
-						  3.02517613e-01,  -2.32109087e-02,  -2.75845562e-02,
-						  -1.72113803e-03,   6.15500677e-02,  -8.31670347e-02,
-						   2.53485912e-03,   1.41453866e-02,   2.11676636e-02,
-						  -7.02669420e-02,  -6.11342660e-02,  -2.19013541e-02,
-						   8.36450853e-03,  -2.86811823e-02,   2.41311832e-02,
-						   1.40289639e-02,  -1.64321578e-02,   2.20035355e-02,
-						  -8.60046428e-02,  -5.70519388e-02,  -1.15316252e-02,
-						  -3.09964836e-02,  -6.87335720e-02,   1.35391797e-02,
-						   1.22013584e-02,   1.86896796e-01,   5.38287169e-02,
-						   8.80335253e-03,   3.27757220e-02,  -3.07259532e-02,
-						   1.28735169e-02,   3.81044856e-02,  -1.94928250e-02,
-						  -4.24974614e-02,  -1.03116996e-02,   2.43020933e-02,
-						   5.00501514e-03,  -8.58289249e-03,  -5.35512885e-02,
-						  -7.79530011e-02,   1.60749458e-02,   1.90523462e-02,
-						   7.03027226e-02,   2.41724152e-02,   3.06444587e-02,
-						   4.67967531e-02,   7.50780919e-02,  -1.02105498e-01,
-						   5.91697141e-02,   4.33550584e-02,   9.05510447e-05,
-						  -8.35987327e-03,   6.74582611e-02,  -5.12059053e-02,
-						   7.96678706e-02,  -1.41675646e-03,  -1.52523740e-02,
-						   8.71836196e-02,   1.12006741e-02,   8.95507861e-02,
-						  -5.68845955e-02,   4.47655131e-04,  -1.97239112e-02,
-						   7.46189688e-03};
+						 0.31075507, -0.05213062, -0.05285569, -0.05662839, 0.03754724, -0.01487241,
+						 0.06327061, -0.04544936, 0.09113562, 0.01576047, 0.03215227, -0.00110636,
+						 0.09788892, 0.00276614, -0.02156708, 0.08209585, 0.06517912, 0.02990297,
+						 -0.04695846, -0.04941054, 0.02837151, 0.05896287, 0.03817816, 0.01025822,
+						 0.02113666, -0.05812967, 0.03403488, -0.03262576, -0.09048796, 0.02100531,
+						 -0.02611479, 0.02997410, 0.03548750, 0.01330468, 0.03970231, -0.06908895,
+						 0.05534197, 0.04195451, -0.00846772, 0.00556715, -0.03774992, 0.02096787,
+						 -0.02527394, -0.00792311, 0.05933396, 0.11242440, 0.01819783, -0.05174610,
+						 -0.05657379, -0.07518228, 0.02853723, 0.01026844, -0.06238247, -0.03350434,
+						 0.00469193, -0.05623859, -0.10497618, 0.00591359};
 	for (int i = 0; i < io.framesPerBuffer(); i++) { // Zero out input bus
 //		std::cout << outbuf0[i] << " ... "<< expected0[i] << std::endl;
 		assert(fabs(expected0[i] - outbuf0[i]) < 0.000001);
@@ -210,6 +192,64 @@ void ut_deterministic_test(void)
 	float *ir = dec.getIR(0);
 }
 
+void ut_reproducible_test(void)
+{
+	// The same seed gives the same IRs whatever the number of threads
+	al::AudioIO io(64, 44100, 0, 0, 2, 2, al::AudioIO::DUMMY); // Dummy Audio Backend
+	al::ThreadPool onePool(1);
+	al::Decorrelation dec(512, 0, 16, false);
+	al::Decorrelation decOne(512, 0, 16, false, onePool);
+	al::Decorrelation decOther(512, 0, 16, false);
+	dec.configure(io, 1234, 0.2);
+	decOne.configure(io, 1234, 0.2);
+	decOther.configure(io, 1235, 0.2);
+	for (int j = 0; j < 16; j++) {
+		assert(memcmp(dec.getIR(j), decOne.getIR(j), 512 * sizeof(float)) == 0);
+		assert(memcmp(dec.getIR(j), decOther.getIR(j), 512 * sizeof(float)) != 0);
+		if (j > 0) {
+			assert(memcmp(dec.getIR(j), dec.getIR(j - 1), 512 * sizeof(float)) != 0);
+		}
+	}
+}
+
+void ut_cache_test(void)
+{
+	al::AudioIO io(64, 44100, 0, 0, 2, 2, al::AudioIO::DUMMY); // Dummy Audio Backend
+	al::Decorrelation dec(256, 0, 4, false);
+	dec.setCacheDirectory(".");
+	assert(dec.getCacheDirectory() == "./");
+	dec.configureDeterministic(io, 77, 20, 5, 1.0);
+	assert(!dec.loadedFromCache());
+	std::string path = dec.getCachePath();
+	assert(!path.empty());
+	std::vector<float> generated(dec.getIR(0), dec.getIR(0) + 256 * 4);
+
+	// A second configuration with the same values maps the cache
+	al::Decorrelation cached(256, 0, 4, false);
+	cached.setCacheDirectory(".");
+	cached.configureDeterministic(io, 77, 20, 5, 1.0);
+	assert(cached.loadedFromCache());
+	assert(cached.getCachePath() == path);
+	for (int j = 0; j < 4; j++) {
+		assert(memcmp(cached.getIR(j), &generated[j * 256], 256 * sizeof(float)) == 0);
+	}
+
+	// Other parameters or seeds are generated, as are IRs from random seeds
+	cached.configureDeterministic(io, 77, 20, 6, 1.0);
+	assert(!cached.loadedFromCache());
+	remove(cached.getCachePath().c_str());
+	cached.configure(io, 77);
+	assert(!cached.loadedFromCache());
+	remove(cached.getCachePath().c_str());
+	cached.configure(io, -1);
+	assert(!cached.loadedFromCache());
+	assert(cached.getCachePath().empty());
+
+	dec.configure(io, 1); // Unmaps the file
+	remove(dec.getCachePath().c_str());
+	remove(path.c_str());
+}
+
 #define RUNTEST(Name)\
 	printf("%s ", #Name);\
 	ut_##Name();\
@@ -223,6 +263,8 @@ int main()
 	RUNTEST(parallel_test);
 	RUNTEST(max_jump_test);
 	RUNTEST(deterministic_test);
+	RUNTEST(reproducible_test);
+	RUNTEST(cache_test);
 
 	return 0;
 }
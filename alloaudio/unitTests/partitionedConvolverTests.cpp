@@ -0,0 +1,208 @@
+#include <cstdio>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include <cassert>
+#include <cstring>
+
+#include "alloaudio/al_PartitionedConvolver.hpp"
+#include "allocore/io/al_AudioIO.hpp"
+
+using namespace std;
+
+static float randomSample()
+{
+	return rand() / (float) RAND_MAX * 2.0f - 1.0f;
+}
+
+// Convolve the inputs through each IR of the matrix in blocks, and compare
+// to direct convolution
+static void compareToDirect(int blockSize, int maxPartition, int irLength,
+                            int numIns, int numOuts, int numBlocks)
+{
+	al::PartitionedConvolver conv;
+	vector<vector<float> > irs(numIns * numOuts);
+	for (int i = 0; i < numIns; i++) {
+		for (int o = 0; o < numOuts; o++) {
+			vector<float> &ir = irs[i * numOuts + o];
+			ir.resize(irLength - o * 7); // Different lengths
+			for (unsigned j = 0; j < ir.size(); j++) {
+				ir[j] = randomSample() * exp(-4.0 * j / irLength);
+			}
+			conv.addIR(i, o, &ir[0], ir.size());
+		}
+	}
+	int ret = conv.configure(blockSize, maxPartition);
+	assert(ret == 0);
+	assert(conv.numInputs() == numIns);
+	assert(conv.numOutputs() == numOuts);
+
+	int length = blockSize * numBlocks;
+	vector<vector<float> > in(numIns, vector<float>(length));
+	vector<vector<float> > out(numOuts, vector<float>(length));
+	for (int i = 0; i < numIns; i++) {
+		for (int n = 0; n < length; n++) {
+			in[i][n] = randomSample();
+		}
+	}
+	vector<const float *> inPtrs(numIns);
+	vector<float *> outPtrs(numOuts);
+	for (int b = 0; b < numBlocks; b++) {
+		for (int i = 0; i < numIns; i++) {
+			inPtrs[i] = &in[i][b * blockSize];
+		}
+		for (int o = 0; o < numOuts; o++) {
+			outPtrs[o] = &out[o][b * blockSize];
+		}
+		conv.process(&inPtrs[0], &outPtrs[0]);
+	}
+
+	double maxError = 0;
+	for (int o = 0; o < numOuts; o++) {
+		for (int n = 0; n < length; n++) {
+			double expected = 0;
+			for (int i = 0; i < numIns; i++) {
+				const vector<float> &ir = irs[i * numOuts + o];
+				for (int j = 0; j < (int) ir.size() && j <= n; j++) {
+					expected += ir[j] * in[i][n - j];
+				}
+			}
+			maxError = max(maxError, fabs(out[o][n] - expected));
+		}
+	}
+	assert(maxError < 1e-3);
+}
+
+void ut_class_construction(void)
+{
+	al::PartitionedConvolver conv;
+	float ir[3] = {1.0f, 0.5f, 0.25f};
+	conv.addIR(0, 1, ir, 3);
+	conv.addIR(2, 1, ir, 3);
+	assert(conv.configure(64) == 0);
+	assert(conv.numInputs() == 3);
+	assert(conv.numOutputs() == 2);
+	assert(conv.headSize() == 0);
+	assert(conv.numLevels() == 1);
+	assert(conv.partitionSize(0) == 64);
+	assert(conv.configure(0) != 0);
+
+	conv.clearIRs();
+	assert(conv.configure(64) == 0);
+	assert(conv.numInputs() == 0);
+	assert(conv.numLevels() == 0);
+}
+
+void ut_partitions(void)
+{
+	al::PartitionedConvolver conv;
+	vector<float> ir(100000, 0.0f);
+	conv.addIR(0, 0, &ir[0], ir.size());
+
+	// Small blocks get a head, which the first partitions follow
+	conv.configure(16, 4096);
+	assert(conv.headSize() == 64);
+	assert(conv.partitionSize(0) == 64);
+	int covered = conv.headSize();
+	for (int l = 0; l < conv.numLevels(); l++) {
+		assert(conv.partitionSize(l) <= 4096);
+		if (l > 0) {
+			assert(conv.partitionSize(l) == 4 * conv.partitionSize(l - 1));
+			// A partition's duration to compute the first one
+			assert(covered >= 2 * conv.partitionSize(l));
+		}
+		covered += conv.partitionSize(l) * conv.partitionCount(l);
+	}
+	assert(covered >= 100000);
+
+	conv.configure(256, 4096);
+	assert(conv.headSize() == 0);
+	assert(conv.partitionSize(0) == 256);
+	assert(conv.partitionCount(0) == 8);
+	assert(conv.partitionSize(1) == 1024);
+	assert(conv.partitionCount(1) == 6);
+}
+
+void ut_impulse(void)
+{
+	al::PartitionedConvolver conv;
+	const int irLength = 5000, blockSize = 64;
+	vector<float> ir(irLength);
+	for (int i = 0; i < irLength; i++) {
+		ir[i] = randomSample();
+	}
+	conv.addIR(0, 0, &ir[0], irLength);
+	conv.configure(blockSize);
+
+	vector<float> in(blockSize, 0.0f), out(blockSize);
+	const float *inPtr = &in[0];
+	float *outPtr = &out[0];
+	in[0] = 1.0f;
+	for (int b = 0; b * blockSize < irLength + blockSize; b++) {
+		conv.process(&inPtr, &outPtr);
+		in[0] = 0.0f;
+		for (int i = 0; i < blockSize; i++) {
+			int n = b * blockSize + i;
+			float expected = n < irLength ? ir[n] : 0.0f;
+			assert(fabs(out[i] - expected) < 1e-5);
+		}
+	}
+}
+
+void ut_small_blocks(void)
+{
+	compareToDirect(16, 8192, 3000, 2, 3, 400);
+	compareToDirect(1, 8192, 300, 1, 1, 1000);
+}
+
+void ut_large_blocks(void)
+{
+	compareToDirect(512, 8192, 12000, 1, 2, 32);
+	compareToDirect(256, 512, 6000, 1, 2, 60); // Largest level takes the rest
+	compareToDirect(96, 8192, 4000, 1, 2, 80); // Not a power of two
+}
+
+void ut_audio_callback(void)
+{
+	const int blockSize = 64;
+	al::PartitionedConvolver conv;
+	al::AudioIO io(blockSize, 44100.0, NULL, NULL, 2, 0, al::AudioIO::DUMMY);
+	io.channelsBus(2);
+	io.append(conv);
+
+	float IR1[4] = {1.0f, 0.0f, 0.0f, 0.5f};
+	float IR2[4] = {0.0f, 1.0f, 0.25f, 0.0f};
+	conv.addIR(0, 0, IR1, 4);
+	conv.addIR(1, 1, IR2, 4);
+	conv.inputsAreBuses(true);
+	conv.configure(blockSize);
+
+	float *bus1 = io.busBuffer(0);
+	float *bus2 = io.busBuffer(1);
+	memset(bus1, 0, sizeof(float) * blockSize);
+	memset(bus2, 0, sizeof(float) * blockSize);
+	bus1[0] = bus2[0] = 1.0f;
+	io.processAudio();
+	for (int i = 0; i < 4; i++) {
+		assert(fabs(io.out(0, i) - IR1[i]) < 1e-6f);
+		assert(fabs(io.out(1, i) - IR2[i]) < 1e-6f);
+	}
+}
+
+#define RUNTEST(Name)\
+	printf("%s ", #Name);\
+	ut_##Name();\
+	for(size_t i=0; i<32-strlen(#Name); ++i) printf(".");\
+	printf(" pass\n")
+
+int main()
+{
+	srand(1000);
+	RUNTEST(class_construction);
+	RUNTEST(partitions);
+	RUNTEST(impulse);
+	RUNTEST(small_blocks);
+	RUNTEST(large_blocks);
+	RUNTEST(audio_callback);
+	return 0;
+}
@@ -54,9 +54,12 @@
 #include "allocore/graphics/al_Stereographic.hpp"
 #include "allocore/graphics/al_Texture.hpp"
 #include "allocore/io/al_App.hpp"
+#include "allocore/io/al_AudioGraph.hpp"
 #include "allocore/io/al_AudioIO.hpp"
 #include "allocore/io/al_ControlNav.hpp"
 #include "allocore/io/al_File.hpp"
+#include "allocore/io/al_FileIndex.hpp"
+#include "allocore/io/al_MappedFile.hpp"
 #include "allocore/io/al_Socket.hpp"
 #include "allocore/io/al_Window.hpp"
 #include "allocore/math/al_Analysis.hpp"
@@ -75,6 +78,7 @@
 #include "allocore/math/al_Vec.hpp"
 #include "allocore/protocol/al_OSC.hpp"
 #include "allocore/protocol/al_Serialize.hpp"
+#include "allocore/protocol/al_StateDelta.hpp"
 #include "allocore/sound/al_Reverb.hpp"
 #include "allocore/sound/al_Speaker.hpp"
 #include "allocore/sound/al_AudioScene.hpp"
@@ -82,15 +86,22 @@
 #include "allocore/sound/al_Dbap.hpp"
 #include "allocore/sound/al_StereoPanner.hpp"
 #include "allocore/sound/al_Vbap.hpp"
+#include "allocore/spatial/al_BVH.hpp"
+#include "allocore/spatial/al_CullList.hpp"
 #include "allocore/spatial/al_Curve.hpp"
 #include "allocore/spatial/al_DistAtten.hpp"
 #include "allocore/spatial/al_Pose.hpp"
 #include "allocore/system/al_Info.hpp"
 #include "allocore/system/al_MainLoop.hpp"
+#include "allocore/system/al_PeriodicThread.hpp"
 #include "allocore/system/al_Printing.hpp"
+#include "allocore/system/al_Profiler.hpp"
 #include "allocore/system/al_Thread.hpp"
+#include "allocore/system/al_ThreadPool.hpp"
 #include "allocore/system/al_Time.hpp"
 #include "allocore/types/al_Buffer.hpp"
 #include "allocore/types/al_Conversion.hpp"
 #include "allocore/types/al_Array.hpp"
+#include "allocore/types/al_LockFreeQueue.hpp"
 #include "allocore/types/al_SingleRWRingBuffer.hpp"
+#include "allocore/types/al_TimerWheel.hpp"
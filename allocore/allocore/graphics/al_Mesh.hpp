@@ -46,6 +46,7 @@
 
 #include <stdio.h>
 #include <string>
+#include <vector>
 #include "allocore/math/al_Vec.hpp"
 #include "allocore/math/al_Mat.hpp"
 #include "allocore/types/al_Buffer.hpp"
@@ -96,6 +97,13 @@ public:
 	/// Get center of vertices
 	Vertex getCenter() const;
 
+	/// Get vertex indices of triangles, three per triangle
+
+	/// Triangles, triangle strips and fans, and quads are supported; other
+	/// primitives have no triangles.
+	/// @param[out] tris	vertex indices
+	void getTriangles(std::vector<Index>& tris) const;
+
 
 	// destructive edits to internal vertices:
 
@@ -0,0 +1,217 @@
+#ifndef INCLUDE_AL_AUDIO_GRAPH_HPP
+#define INCLUDE_AL_AUDIO_GRAPH_HPP
+
+/*	Allocore --
+	Multimedia / virtual environment application class library
+
+	Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology, UCSB.
+	Copyright (C) 2012. The Regents of the University of California.
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+		Redistributions in binary form must reproduce the above copyright
+		notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+		Neither the name of the University of California nor the names of its
+		contributors may be used to endorse or promote products derived from
+		this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+
+	File description:
+	Parallel dependency graph of audio callbacks
+*/
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include "allocore/io/al_AudioIOData.hpp"
+#include "allocore/system/al_ThreadPool.hpp"
+
+namespace al{
+
+/// Graph of audio callbacks run in dependency order, in parallel where possible
+
+/// Each node is an AudioCallback that declares which input, output and bus
+/// channels it reads and writes. On each channel, nodes that write but do not
+/// read it run first, then nodes that process it in place, then nodes that
+/// only read it. Nodes with the same role on a channel run in the order they
+/// were added. A node that declares no channels is ordered after all nodes
+/// added before it and before all nodes added after it.
+///
+/// Nodes that are not ordered relative to each other may run at the same time
+/// on the workers of a thread pool. The audio thread takes part and waits for
+/// the whole graph without blocking; a node is started by the thread that
+/// finished its last predecessor. As everything touching a channel runs in a
+/// fixed order, the output is the same as running the nodes one after another,
+/// however they are scheduled.
+///
+/// Every node is passed its own AudioIOData with the stream's buffers, so that
+/// nodes can iterate frames and use the temporary buffer at the same time.
+/// Nodes must only touch the channels they declare.
+///
+/// The graph is itself an AudioCallback, usually appended to an AudioIO. It
+/// must not be changed while a stream is processing it.
+///
+/// @ingroup allocore
+class AudioGraph : public AudioCallback{
+public:
+
+	/// Buffer of an audio stream
+	enum Buffer{
+		INPUT,		/**< Input channels */
+		OUTPUT,		/**< Output channels */
+		BUS			/**< Bus channels */
+	};
+
+	/// Timing of a node's callback
+	struct Timing{
+		double last;				///< Time of most recent block, in seconds
+		double mean;				///< Mean time per block, in seconds
+		double max;					///< Maximum time of a block, in seconds
+		unsigned long long blocks;	///< Number of blocks timed
+	};
+
+
+	/// Node of a graph
+	class Node{
+	public:
+
+		/// Declare channels read by node
+		Node& reads(Buffer b, int first, int count=1);
+
+		/// Declare channels written by node
+		Node& writes(Buffer b, int first, int count=1);
+
+		/// Set name
+		Node& name(const std::string& v){ mName=v; return *this; }
+
+		/// Get name
+		const std::string& name() const { return mName; }
+
+		/// Get callback
+		AudioCallback& callback() const { return *mCallback; }
+
+		/// Get timing of callback since added or last reset
+
+		/// This may be called from any thread while the graph is running.
+		///
+		Timing timing() const;
+
+		/// Reset timing
+		void resetTiming();
+
+	private:
+		friend class AudioGraph;
+
+		struct Range{
+			Buffer buffer;
+			int first, count;
+			bool read;
+		};
+
+		AudioCallback * mCallback;
+		std::string mName;
+		std::vector<Range> mRanges;
+		std::vector<int> mSuccessors;
+		int mPredecessors;
+		std::atomic<int> mPending;		// predecessors yet to finish this block
+		std::atomic<long long> mLast, mTotal, mMax, mBlocks;	// timing, in ns
+		AudioIOData mIO;				// view of stream's buffers
+		std::vector<float> mTemp;		// temporary buffer of view
+
+		Node(AudioCallback& cb);
+		int role(Buffer b, int chan) const;
+	};
+
+
+	/// @param[in] pool		pool whose workers run nodes in parallel. If 0,
+	///						nodes are run one after another on the audio
+	///						thread. To keep other work from delaying audio,
+	///						the pool should be dedicated to audio and have
+	///						real-time priority.
+	AudioGraph(ThreadPool * pool = 0);
+
+	virtual ~AudioGraph();
+
+
+	/// Add a node calling a callback
+
+	/// The channels of the node are declared on the returned node.
+	///
+	Node& add(AudioCallback& cb);
+
+	/// Remove all nodes calling a callback
+	AudioGraph& remove(AudioCallback& cb);
+
+	/// Remove all nodes
+	AudioGraph& clear();
+
+	/// Get number of nodes
+	int size() const { return mNodes.size(); }
+
+	/// Get node by index, in the order added
+	Node& node(int i){ return *mNodes[i]; }
+
+	/// Sort nodes by their dependencies
+
+	/// This is done automatically on the first block after the graph has
+	/// changed, but allocates memory, so it is better done before starting
+	/// a stream. If the dependencies have a cycle, a warning is printed and
+	/// the nodes are run one after another in the order added.
+	/// \returns whether the dependencies have no cycle
+	bool sort();
+
+	/// Get indices of nodes in the order they are run when run one at a time
+	const std::vector<int>& order(){ if(mChanged) sort(); return mOrder; }
+
+	/// Whether node i must finish before node j starts
+	bool precedes(int i, int j);
+
+	/// Process one block
+	virtual void onAudioCB(AudioIOData& io);
+
+private:
+	struct Task{
+		AudioGraph * graph;
+		int node;
+		void operator()() const { graph->execute(node); }
+	};
+
+	std::vector<Node *> mNodes;
+	std::vector<int> mOrder;		// topological order
+	std::vector<int> mRoots;		// nodes without predecessors
+	std::vector<Task> mTasks;
+	ThreadPool * mPool;
+	TaskGroup * mGroup;				// group of the current block
+	bool mChanged;
+	bool mSerial;					// run in order, e.g. due to a cycle
+
+	void bind(Node& n, const AudioIOData& io);
+	void release(Node * n);
+	void run(Node& n);
+	void execute(int node);
+
+	AudioGraph(const AudioGraph&);
+	AudioGraph& operator=(const AudioGraph&);
+};
+
+} // al::
+
+#endif
@@ -43,10 +43,13 @@
 */
 
 
+#include <atomic>
 #include <string>
 #include <vector>
 
 #include "allocore/io/al_AudioIOData.hpp"
+#include "allocore/math/al_Analysis.hpp"
+#include "allocore/system/al_Time.hpp"
 
 namespace al{
 
@@ -96,11 +99,61 @@ inline AudioDevice::StreamMode operator| (const AudioDevice::StreamMode& a, cons
 }
 
 /// Audio input/output streaming
+
+/// Each block processed by the stream is timed. Its load, the processing time
+/// divided by the duration of the block, is kept for the most recent blocks
+/// along with counts of the under- and overflows reported by the backend.
+/// These can be queried at any time from another thread with load().
 ///
 /// @ingroup allocore
 class AudioIO : public AudioIOData {
 public:
 
+	/// Stream status flags of a block, as reported by the backend
+	enum Status{
+		INPUT_UNDERFLOW		= 1,	/**< Input was not available; zeros were used */
+		INPUT_OVERFLOW		= 2,	/**< Input was discarded */
+		OUTPUT_UNDERFLOW	= 4,	/**< Output had a gap before this block */
+		OUTPUT_OVERFLOW		= 8		/**< Output of this block will be discarded */
+	};
+
+	/// Load statistics of recent blocks
+	struct Load{
+		MinMeanMax<double> load;			///< Processing time over block duration
+		std::vector<float> history;			///< Loads of analyzed blocks, sorted ascending
+		unsigned samples;					///< Number of blocks analyzed
+		unsigned long long blocks;			///< Number of blocks since start
+		unsigned long long overloads;		///< Number of blocks since start with load of 1 or more
+		unsigned long long inputUnderflows;	///< Number of input underflows since start
+		unsigned long long inputOverflows;	///< Number of input overflows since start
+		unsigned long long outputUnderflows;///< Number of output underflows since start
+		unsigned long long outputOverflows;	///< Number of output overflows since start
+
+		/// Get load at a percentile, in [0,1], of analyzed blocks
+		double percentile(double p) const;
+
+		/// Get total number of under- and overflows since start
+		unsigned long long xruns() const {
+			return inputUnderflows + inputOverflows + outputUnderflows + outputOverflows;
+		}
+	};
+
+	/// Load callback type, called from the audio thread
+	typedef void (* loadCallback)(AudioIO& io, double load, bool overloaded);
+
+	/// Number of recent blocks kept for load statistics
+	static const unsigned LOAD_SAMPLES = 1024;
+
+	/// Input generator type of the OFFLINE backend
+
+	/// @param[out] buffer		non-interleaved input samples to fill, one block
+	///							of frames per channel
+	/// @param[in] channels		number of input channels
+	/// @param[in] frames		number of frames per channel
+	/// @param[in] frame		index of first frame of block in stream
+	/// @param[in] userData		user data passed in with generator
+	typedef void (* audioGenerator)(float * buffer, int channels, int frames, unsigned long long frame, void * userData);
+
 	/// Creates AudioIO using default I/O devices.
 
 	/// @param[in] framesPerBuf		Number of sample frames to process per callback
@@ -142,10 +195,75 @@ public:
 	bool zeroNANs() const;						///< Returns whether to zero NANs in output buffer going to DAC
 
 	void processAudio();						///< Call callback manually
+
+	/// Process one block of the stream
+
+	/// This zeros the output, calls the callbacks, applies gain, NaN zeroing
+	/// and clipping, and records the load of the block and any status flags.
+	/// Backends call this for each block; it may also be called manually to
+	/// drive a DUMMY backend.
+	void processBlock(unsigned status = 0);
+
+	/// Get load statistics of recent blocks
+
+	/// This is lock-free and may be called from any thread while the stream
+	/// is running.
+	Load load() const;
+
+	/// Set function called when the load crosses thresholds
+
+	/// The function is called with overloaded=true for the first block whose
+	/// load reaches 'high' and with overloaded=false for the first block after
+	/// that whose load is below 'low'. As it is called from the audio thread,
+	/// it must not block. Pass in 0 to remove the function.
+	AudioIO& onLoad(loadCallback func, double high=0.8, double low=0.5);
+
+	/// Get number of blocks processed per second since start
+
+	/// This is the number of blocks divided by the time from the start of the
+	/// first block to the end of the last, as measured by clock().
+	///
+	double blocksPerSecond() const;
+
+	/// Set clock used to time blocks, in nanoseconds
+
+	/// The default is al_steady_time_nsec. Another clock can be used to get
+	/// deterministic loads, e.g., when testing.
+	AudioIO& clock(al_nsec (* func)());
 	bool open();								///< Opens audio device.
 	bool close();								///< Closes audio device. Will stop active IO.
 	bool start();								///< Starts the audio IO.  Will open audio device if necessary.
 	bool stop();								///< Stops the audio IO.
+	bool isRunning() const;						///< Returns whether the audio IO is running
+
+	/// Set WAV file the OFFLINE backend reads input from
+
+	/// Channels missing from the file are zero. Unless a duration is set,
+	/// processing stops at the end of the file.
+	AudioIO& offlineInput(const std::string& path);
+
+	/// Set generator the OFFLINE backend fills input with
+	AudioIO& offlineInput(audioGenerator gen, void * userData=0);
+
+	/// Set sound file the OFFLINE backend writes output to
+
+	/// The file has 32-bit float samples. It is a CAF file if the path ends in
+	/// ".caf" and otherwise a WAV file, which is limited to 4 GB. The file is
+	/// complete once processing has stopped. An empty path writes no file.
+	AudioIO& offlineOutput(const std::string& path);
+
+	/// Set speed of the OFFLINE backend as a multiple of real time
+
+	/// The default of 0 processes as fast as possible.
+	///
+	AudioIO& offlineSpeed(double v);
+
+	/// Set duration, in seconds, after which the OFFLINE backend stops
+
+	/// The default of 0 runs until stopped or the end of the input file.
+	/// Settings of the OFFLINE backend take effect when it is started.
+	AudioIO& offlineDuration(double sec);
+
 
 	void autoZeroOut(bool v){ mAutoZeroOut=v; }
 
@@ -165,6 +283,8 @@ public:
 	void deviceOut(const AudioDevice& v);		///< Set output device
 	void framesPerSecond(double v);				///< Set number of frames per second
 	void framesPerBuffer(int n);				///< Set number of frames per processing buffer
+	void scratchSize(size_t bytes);				///< Set bytes of scratch memory per buffer; not thread-safe
+	size_t scratchSize() const { return scratch().capacity(); } ///< Get bytes of scratch memory per buffer
 	void zeroNANs(bool v){ mZeroNANs=v; }		///< Set whether to zero NANs in output buffer going to DAC
 
 	void print() const;							///< Prints info about current i/o devices to stdout.
@@ -184,7 +304,20 @@ private:
 	bool mAutoZeroOut;		// whether to automatically zero output buffers each block
 	std::vector<AudioCallback *> mAudioCallbacks;
 
+	// Load history written by the audio thread and read lock-free by others
+	std::atomic<float> mLoads[LOAD_SAMPLES];
+	std::atomic<unsigned long long> mLoadCount;
+	std::atomic<unsigned long long> mOverloads;
+	std::atomic<unsigned long long> mXruns[4];	// counts of each Status flag
+	std::atomic<al_nsec> mFirstBlock, mLastBlock;	// start of first and end of last block
+	al_nsec (* mClock)();
+	loadCallback mOnLoad;
+	double mLoadHigh, mLoadLow;
+	bool mOverloaded;		// whether load went above high and not yet below low
+
 	void init(int outChannels, int inChannels);			//
+	void clearLoad();
+	void recordLoad(al_nsec begin, al_nsec end, unsigned status);
 	void reopen();			// reopen stream (restarts stream if needed)
 	void resizeBuffer(bool forOutput);
 };
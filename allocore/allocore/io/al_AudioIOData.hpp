@@ -44,6 +44,7 @@
 
 #include <cstdio>
 #include <cassert>
+#include "allocore/system/al_RTMemory.hpp"
 
 namespace al{
 
@@ -206,7 +207,8 @@ public:
 
 	typedef enum {
 		PORTAUDIO,
-		DUMMY
+		DUMMY,
+		OFFLINE
 	} Backend;
 
 	/// Iterate frame counter, returning true while more frames
@@ -256,6 +258,12 @@ public:
 
 	void * user() const{ return mUser; } ///< Get pointer to user data
 
+	/// Get memory for scratch buffers that last until the end of the block
+
+	/// AudioIO frees all of it before each block. Allocation is lock-free and
+	/// thread-safe, and returns NULL when the arena is full.
+	LinearArena& scratch() const { return *mScratch; }
+
 	template<class UserDataType>
 	UserDataType& user() const { return *(static_cast<UserDataType *>(mUser)); }
 
@@ -278,6 +286,7 @@ public:
 	bool usingGain() const { return mGain != 1.f || mGainPrev != 1.f; }
 
 protected:
+	friend class AudioGraph;
 	AudioBackend * mImpl;
 	void * mUser;					// User specified data
 	mutable int mFrame;
@@ -286,6 +295,8 @@ protected:
 	float *mBufI, *mBufO, *mBufB;	// input, output, and aux buffers
 	float * mBufT;					// temporary one channel buffer
 	int mNumI, mNumO, mNumB;		// input, output, and aux channels
+	LinearArena * mScratch;			// scratch memory of the stream
+	LinearArena mScratchArena;		// owned scratch memory
 public:
 	float mGain, mGainPrev;
 };
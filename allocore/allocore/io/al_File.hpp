@@ -46,6 +46,7 @@
 #include <stdio.h>
 #include <string>
 #include <list>
+#include <memory>
 #include <vector>
 #include <algorithm>
 #include "allocore/system/al_Config.h"
@@ -65,6 +66,9 @@
 
 namespace al{
 
+class FileIndex;
+class MappedFile;
+
 
 class FilePath;
 
@@ -155,6 +159,16 @@ public:
 	/// Returns character string of file contents (read mode only)
 	const char * readAll();
 
+	/// Map file contents into memory instead of copying them
+
+	/// The file need not be opened. Unlike with readAll(), the contents are
+	/// not null-terminated.
+	/// @param[out] view	mapping of the file
+	/// @param[in]  mode	how the mapping may be used, a MappedFile::Mode
+	///						(default is MappedFile::READ_ONLY)
+	/// \returns whether the file was mapped
+	bool readAll(MappedFile& view, int mode = 0);
+
 
 	/// Returns whether file is open
 	bool opened() const { return 0 != mFP; }
@@ -432,7 +446,7 @@ public:
 	typedef std::list<searchpath> searchpathlist;
 	typedef std::list<searchpath>::iterator iterator;
 
-	SearchPaths(){}
+	SearchPaths(): mIndexRefreshed(0){}
 	SearchPaths(const std::string& file);
 	SearchPaths(int argc, char * const argv[], bool recursive=true);
 	SearchPaths(const SearchPaths& cpy);
@@ -441,6 +455,17 @@ public:
 	FilePath find(const std::string& filename);
 	FileList glob(const std::string& regex);
 
+	/// look up files with find() in an index of the searchpaths:
+	/// directories are crawled once, in parallel, instead of on every call,
+	/// and only directories that changed are read again.
+	/// param[in] cacheFile: if not empty, the index is loaded from this file
+	/// and saved to it whenever it changes, so later runs need not crawl.
+	/// Copies of this object share the index.
+	SearchPaths& useIndex(const std::string& cacheFile = "");
+
+	/// get the index used by find(), or NULL if none
+	FileIndex * index() const { return mIndex.get(); }
+
 	/// add a path to search in; recursive searching is optional
 	void addSearchPath(const std::string& path, bool recursive = true);
 	void addRelativePath(std::string rel, bool recursive=true) {
@@ -464,6 +489,11 @@ public:
 protected:
 	std::list<searchpath> mSearchPaths;
 	std::string mAppPath;
+	std::shared_ptr<FileIndex> mIndex;
+	std::string mIndexCache;
+	al_sec mIndexRefreshed;
+
+	FilePath findIndexed(const std::string& filename);
 };
 
 } // al::
@@ -0,0 +1,154 @@
+#ifndef INCLUDE_AL_FILE_INDEX_HPP
+#define INCLUDE_AL_FILE_INDEX_HPP
+
+/*	Allocore --
+	Multimedia / virtual environment application class library
+
+	Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology, UCSB.
+	Copyright (C) 2012. The Regents of the University of California.
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+		Redistributions in binary form must reproduce the above copyright
+		notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+		Neither the name of the University of California nor the names of its
+		contributors may be used to endorse or promote products derived from
+		this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+
+	File description:
+	Index of file names in directory trees, for fast lookup of files by name
+*/
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "allocore/io/al_File.hpp"
+#include "allocore/system/al_ThreadPool.hpp"
+#include "allocore/system/pstdint.h"
+
+namespace al{
+
+/// Index of file names in directory trees
+
+/// The index maps the name of each regular file to the directories containing
+/// it, so that finding a file by name is a hash table lookup instead of a walk
+/// of the directory tree. Directories are crawled in parallel on a thread
+/// pool, one level of the tree at a time.
+///
+/// The index is kept up to date incrementally. The modification time of a
+/// directory changes when entries are added to or removed from it, so
+/// refresh() only has to check the time of each directory and read the
+/// directories that changed. Directories known to have changed, for example
+/// through a file system monitor, can be marked with invalidate() so that they
+/// are read again on the next lookup.
+///
+/// The index can be saved to and loaded from a cache file, so that later runs
+/// can look up files without crawling.
+///
+/// As with the directory walk of SearchPaths, subdirectories whose names begin
+/// with '.' are not indexed. This class is not thread-safe.
+///
+/// @ingroup allocore
+class FileIndex {
+public:
+
+	/// @param[in] pool		pool on which to crawl directories
+	FileIndex(ThreadPool& pool = ThreadPool::global());
+
+
+	/// Find a file by name
+
+	/// Directories under the search directory that have not been indexed yet
+	/// are crawled first. If several directories contain the file, the one
+	/// nearest to the search directory is chosen.
+	/// @param[in]  name		file name without directory
+	/// @param[in]  dir			directory to search in
+	/// @param[in]  recursive	whether to search subdirectories
+	/// @param[out] result		location of file, if found
+	/// \returns whether the file was found
+	bool find(const std::string& name, const std::string& dir, bool recursive, FilePath& result);
+
+	/// Check all indexed directories for changes and read the changed ones
+
+	/// \returns number of directories read
+	///
+	unsigned refresh();
+
+	/// Mark a directory as changed, so that it is read on the next lookup
+	void invalidate(const std::string& dir);
+
+	/// Remove all entries
+	void clear();
+
+
+	/// Load index from a cache file
+
+	/// The loaded entries replace the current ones. They are used as they are
+	/// until refresh() is called or a lookup finds a file that no longer
+	/// exists.
+	/// \returns whether the file could be read
+	bool load(const std::string& path);
+
+	/// Save index to a cache file
+
+	/// \returns whether the file could be written
+	///
+	bool save(const std::string& path);
+
+	/// Whether the index changed since it was last loaded or saved
+	bool dirty() const { return mDirty; }
+
+
+	/// Get number of indexed directories
+	unsigned numDirs() const { return mDirs.size(); }
+
+	/// Get number of indexed files
+	unsigned numFiles() const { return mNames.size(); }
+
+private:
+	struct Entry{
+		int64_t modified;				// modification time, in microseconds
+		std::vector<std::string> files;	// names of regular files
+		std::vector<std::string> dirs;	// names of subdirectories
+		bool recursive;					// whether subdirectories are indexed
+		Entry(): modified(0), recursive(false){}
+	};
+
+	struct Scan;
+
+	ThreadPool& mPool;
+	std::unordered_map<std::string, Entry> mDirs;				// directory -> entry
+	std::unordered_multimap<std::string, std::string> mNames;	// file name -> directory
+	std::unordered_set<std::string> mInvalid;					// directories to read again
+	bool mDirty;
+
+	void crawl(std::vector<std::string>& dirs, bool recursive);
+	void set(const std::string& dir, Scan& scan, bool recursive);
+	void erase(const std::string& dir);
+	void unlinkNames(const std::string& dir, const Entry& e);
+	void update();
+};
+
+} // al::
+
+#endif
@@ -0,0 +1,230 @@
+#ifndef INCLUDE_AL_MAPPED_FILE_HPP
+#define INCLUDE_AL_MAPPED_FILE_HPP
+
+/*	Allocore --
+	Multimedia / virtual environment application class library
+
+	Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology, UCSB.
+	Copyright (C) 2012. The Regents of the University of California.
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+		Redistributions in binary form must reproduce the above copyright
+		notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+		Neither the name of the University of California nor the names of its
+		contributors may be used to endorse or promote products derived from
+		this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+
+	File description:
+	Memory-mapped files and prefetching of files into the page cache
+*/
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "allocore/system/al_Thread.hpp"
+
+namespace al{
+
+/// File mapped into memory
+
+/// The contents of the file are accessed directly through the page cache, so
+/// nothing is copied and pages are read from disk only when first touched.
+/// The mapping is released when the object is destroyed.
+///
+/// An empty file can be mapped; it has a size of 0 and a non-null data
+/// pointer.
+///
+/// @ingroup allocore
+class MappedFile{
+public:
+
+	/// How the mapping may be used
+	enum Mode{
+		READ_ONLY,	/**< Contents can only be read */
+		SHARED,		/**< Writes go to the file */
+		PRIVATE		/**< Writes only change this mapping (copy-on-write) */
+	};
+
+	/// Expected access pattern, used to tune read-ahead
+	enum Access{
+		NORMAL,		/**< No particular pattern */
+		SEQUENTIAL,	/**< Read from start to end; read ahead aggressively */
+		RANDOM		/**< Scattered reads; do not read ahead */
+	};
+
+	/// Mapping options
+	enum Flags{
+		HUGE_PAGES	= 1<<0,	/**< Ask for large pages, where supported */
+		POPULATE	= 1<<1	/**< Read the whole file in when mapping */
+	};
+
+
+	MappedFile();
+
+	/// @param[in] path		path of file
+	/// @param[in] mode		how the mapping may be used
+	/// @param[in] flags	mapping options (see Flags)
+	MappedFile(const std::string& path, Mode mode=READ_ONLY, int flags=0);
+
+	MappedFile(MappedFile&& other);
+	MappedFile& operator= (MappedFile&& other);
+
+	/// Unmaps the file
+	~MappedFile();
+
+
+	/// Map a file into memory
+
+	/// Any previous mapping is released first.
+	/// @param[in] path		path of file
+	/// @param[in] mode		how the mapping may be used
+	/// @param[in] flags	mapping options (see Flags)
+	/// \returns whether the file was mapped
+	bool open(const std::string& path, Mode mode=READ_ONLY, int flags=0);
+
+	/// Unmap the file
+	void close();
+
+	/// Set the expected access pattern of the whole mapping
+	MappedFile& advise(Access v);
+
+	/// Start reading a range of the file in the background
+
+	/// This returns immediately. A later access to the range will not have
+	/// to wait for the disk.
+	MappedFile& willNeed(size_t offset=0, size_t length=size_t(-1));
+
+	/// Write changes of a SHARED mapping to the file
+
+	/// @param[in] wait		whether to wait for the write to finish
+	/// \returns whether the changes were written or scheduled
+	bool flush(bool wait=true);
+
+
+	/// Whether a file is mapped
+	bool opened() const { return 0 != mData; }
+
+	/// Get mapped contents
+	char * data(){ return mData; }
+	const char * data() const { return mData; }
+
+	/// Get size of mapped contents, in bytes
+	size_t size() const { return mSize; }
+
+	/// Get copy of mapped contents as a string
+	std::string str() const { return std::string(mData ? mData : "", mSize); }
+
+	/// Get path of mapped file
+	const std::string& path() const { return mPath; }
+
+	/// Get mode of mapping
+	Mode mode() const { return mMode; }
+
+
+	/// Get size of virtual memory pages, in bytes
+	static size_t pageSize();
+
+private:
+	char * mData;
+	size_t mSize;
+	std::string mPath;
+	Mode mMode;
+	void * mHandle;	// mapping handle on Windows
+
+	MappedFile(const MappedFile&);
+	MappedFile& operator= (const MappedFile&);
+};
+
+
+
+/// Warms files into the operating system's page cache on a background thread
+
+/// This is intended for loading screens: files that will be needed soon are
+/// read ahead of time, so that opening, mapping or reading them later does
+/// not wait for the disk. Files are read in chunks, in the order given, and
+/// the data is discarded.
+///
+/// @ingroup allocore
+class FilePrefetcher{
+public:
+
+	FilePrefetcher();
+
+	/// Cancels prefetching and waits for the thread
+	~FilePrefetcher();
+
+
+	/// Add files to prefetch
+
+	/// Files are prefetched after those of earlier calls. This does not
+	/// block.
+	void start(const std::vector<std::string>& paths);
+
+	/// Add a file to prefetch
+	void start(const std::string& path);
+
+	/// Stop prefetching after the current chunk and drop remaining files
+	void cancel();
+
+	/// Wait until all files have been prefetched
+	void wait();
+
+	/// Whether all files have been prefetched
+	bool done();
+
+
+	/// Get number of files prefetched so far
+	unsigned files() const { return mFiles.load(); }
+
+	/// Get number of bytes prefetched so far
+	size_t bytes() const { return mBytes.load(); }
+
+private:
+	struct Func : public ThreadFunction{
+		FilePrefetcher * self;
+		void operator()(){ self->run(); }
+	};
+
+	std::deque<std::string> mQueue;
+	std::mutex mMutex;
+	std::condition_variable mIdle;
+	Thread mThread;
+	Func mFunc;
+	bool mRunning;		// whether thread is taking files from queue
+	bool mStarted;		// whether thread needs to be joined
+	std::atomic<bool> mCancel;
+	std::atomic<unsigned> mFiles;
+	std::atomic<size_t> mBytes;
+
+	void run();
+
+	FilePrefetcher(const FilePrefetcher&);
+	FilePrefetcher& operator= (const FilePrefetcher&);
+};
+
+} // al::
+
+#endif
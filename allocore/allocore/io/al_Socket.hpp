@@ -68,7 +68,10 @@ public:
 
 		// Families
 		INET	= 1<<16, /**< IPv4 Internet protocols */
-		INET6	= 2<<16  /**< IPv6 Internet protocols */
+		INET6	= 2<<16, /**< IPv6 Internet protocols */
+
+		// Options
+		BROADCAST = 1<<24 /**< Allow sending to a broadcast address (UDP) */
 	};
 
 
@@ -103,6 +106,12 @@ public:
 	/// Get timeout duration, in seconds
 	al_sec timeout() const;
 
+	/// Get native socket descriptor, or -1 if not open
+
+	/// This can be used to wait for data with Main::watch rather than
+	/// polling recv().
+	int descriptor() const;
+
 
 	/// Open socket (reopening if currently open)
 	bool open(uint16_t port, const char * address, al_sec timeout, int type);
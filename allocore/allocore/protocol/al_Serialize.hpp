@@ -81,6 +81,90 @@ template<> inline uint8_t getType<int16_t >(){ return 'H'; }
 template<> inline uint8_t getType<int32_t >(){ return 'i'; }
 template<> inline uint8_t getType<int64_t >(){ return 'I'; }
 
+
+/// Returns whether the host byte order is big endian
+inline bool hostIsBigEndian(){
+	const uint16_t v = 1;
+	return *(const uint8_t *)&v == 0;
+}
+
+
+/// Layout description of a plain-old-data struct
+
+/// A schema lists the fields of a struct once so that arrays of the struct
+/// can be written and read in bulk by SchemaSerializer and SchemaDeserializer.
+/// The byte offsets are normally obtained with offsetof:
+/// \code
+///	struct Particle{ float pos[3]; float vel[3]; uint32_t id; };
+///	ser::Schema schema(sizeof(Particle));
+///	schema.add<float>(offsetof(Particle, pos), 3)
+///	      .add<float>(offsetof(Particle, vel), 3)
+///	      .add<uint32_t>(offsetof(Particle, id));
+/// \endcode
+class Schema{
+public:
+
+	/// A field of the struct
+	struct Field{
+		uint8_t type;		///< serialization type (see SER_FLOAT32, etc.)
+		uint32_t offset;	///< byte offset from start of struct
+		uint32_t count;		///< number of consecutive elements
+	};
+
+	/// @param[in] structSize	size of struct in bytes, i.e. sizeof(S)
+	explicit Schema(uint32_t structSize=0);
+
+	/// Add a field of element type T
+	template <class T>
+	Schema& add(uint32_t offset, uint32_t count=1){
+		return add(getType<T>(), offset, count);
+	}
+
+	/// Add a field of a given serialization type
+	Schema& add(uint8_t type, uint32_t offset, uint32_t count=1);
+
+	/// Set size of struct in bytes
+	Schema& structSize(uint32_t v);
+
+	/// Get size of struct in bytes
+	uint32_t structSize() const { return mStructSize; }
+
+	/// Get hash identifying the layout; written into each serialized block
+	uint32_t id() const { return mID; }
+
+	/// Get fields
+	const std::vector<Field>& fields() const { return mFields; }
+
+	/// Reverse byte order of all multi-byte fields of an array of structs
+	void swapBytes(void * structs, uint32_t num) const;
+
+private:
+	std::vector<Field> mFields;
+	uint32_t mStructSize;
+	uint32_t mID;
+	void updateID();
+};
+
+
+/// Zero-copy view of an array of structs inside a serialized buffer
+template <class T>
+class SchemaView{
+public:
+	SchemaView(): mData(0), mSize(0){}
+	SchemaView(const T * data, uint32_t size): mData(data), mSize(size){}
+
+	const T * data() const { return mData; }
+	uint32_t size() const { return mSize; }
+	bool empty() const { return 0 == mSize; }
+	const T& operator[](uint32_t i) const { return mData[i]; }
+	const T * begin() const { return mData; }
+	const T * end() const { return mData + mSize; }
+
+private:
+	const T * mData;
+	uint32_t mSize;
+};
+
 } // ser::
 
 
@@ -133,6 +217,115 @@ private:
 
 
 
+/// Bulk serializer for arrays of plain-old-data structs
+
+/// Each call to add writes a single header followed by the raw bytes of the
+/// array in host byte order, so an array of any length costs one memcpy. The
+/// header records the byte order and the schema id so the reader can validate
+/// the layout and swap bytes only when the byte orders differ.
+///
+/// @ingroup allocore
+struct SchemaSerializer{
+
+	/// @param[in] schema	layout of structs; must outlive the serializer
+	SchemaSerializer(const ser::Schema& schema);
+
+	/// Append an array of structs
+	template <class T>
+	SchemaSerializer& add(const T * v, uint32_t num){
+		return addStructs(v, num, sizeof(T));
+	}
+
+	/// Append an array of structs given as raw bytes
+	SchemaSerializer& addStructs(const void * v, uint32_t num, uint32_t structSize);
+
+	/// Reserve memory for a number of structs in a single block
+	SchemaSerializer& reserve(uint32_t numStructs);
+
+	/// Clear contents while retaining allocated memory
+	SchemaSerializer& clear();
+
+	const std::vector<char>& buf() const { return mBuf; }
+
+	const ser::Schema& schema() const { return *mSchema; }
+
+	/// Size in bytes of block header
+	static uint32_t headerSize(){ return 16; }
+
+	/// Size in bytes of a block holding a number of structs
+	uint32_t blockSize(uint32_t numStructs) const;
+
+private:
+	const ser::Schema * mSchema;
+	std::vector<char> mBuf;
+};
+
+
+/// Bulk deserializer for buffers written by SchemaSerializer
+
+/// Arrays are returned as views pointing directly into the buffer. If the
+/// buffer was written on a host with a different byte order, the structs are
+/// swapped in place the first time they are read, hence the buffer must be
+/// mutable and must outlive any views.
+///
+/// @ingroup allocore
+struct SchemaDeserializer{
+
+	/// @param[in] schema	layout of structs; must outlive the deserializer
+	/// @param[in] b		serialized data
+	/// @param[in] n		size of serialized data in bytes
+	SchemaDeserializer(const ser::Schema& schema, char * b, uint32_t n);
+
+	SchemaDeserializer(const ser::Schema& schema, std::vector<char>& b);
+
+	/// Get view of next array of structs
+
+	/// \returns true on success or false if there are no more blocks or the
+	/// block does not match the schema
+	template <class T>
+	bool read(ser::SchemaView<T>& v){
+		uint32_t num;
+		const void * d = next(num, sizeof(T));
+		if(!d) return false;
+		v = ser::SchemaView<T>((const T *)d, num);
+		return true;
+	}
+
+	/// Copy next array of structs into an array
+
+	/// \returns number of structs copied
+	template <class T>
+	uint32_t read(T * dst, uint32_t maxNum){
+		uint32_t num;
+		const void * d = next(num, sizeof(T));
+		if(!d) return 0;
+		if(num > maxNum) num = maxNum;
+		memcpy(dst, d, num*sizeof(T));
+		return num;
+	}
+
+	/// Get pointer to next array of structs and number of structs in array
+	const void * next(uint32_t& num, uint32_t structSize);
+
+	/// Whether all blocks read so far were valid
+	bool good() const { return mGood; }
+
+	/// Whether there is unread data left
+	bool atEnd() const { return mPos >= mSize; }
+
+	/// Move read position back to start of buffer
+	SchemaDeserializer& rewind(){ mPos=0; mGood=true; return *this; }
+
+private:
+	const ser::Schema * mSchema;
+	char * mBuf;
+	uint32_t mSize;
+	uint32_t mPos;
+	bool mGood;
+};
+
+
+
 
 // =============================================================================
 // Implementation
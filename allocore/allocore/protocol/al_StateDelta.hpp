@@ -0,0 +1,312 @@
+#ifndef INCLUDE_AL_STATE_DELTA_HPP
+#define INCLUDE_AL_STATE_DELTA_HPP
+
+/*	Allocore --
+	Multimedia / virtual environment application class library
+
+	Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology, UCSB.
+	Copyright (C) 2012. The Regents of the University of California.
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+		Redistributions in binary form must reproduce the above copyright
+		notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+		Neither the name of the University of California nor the names of its
+		contributors may be used to endorse or promote products derived from
+		this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+
+	File description:
+	Delta compression of replicated state for network transmission
+*/
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include "allocore/io/al_Socket.hpp"
+#include "allocore/system/al_Config.h"
+#include "allocore/system/al_Thread.hpp"
+
+namespace al{
+
+/// Encodes successive versions of a block of memory as compact deltas
+
+/// Each call to encode compares the new state against the previously encoded
+/// one at a fixed block granularity (e.g., a cache line or a page). Changed
+/// blocks are XOR-ed against their previous contents and run-length encoded,
+/// so that mostly unchanged data shrinks to a few bytes. The result is split
+/// into independently decodable packets no larger than the packet size. Every
+/// so often a keyframe containing the complete state is emitted so that
+/// receivers can recover from lost packets.
+///
+/// Packets are written in host byte order.
+///
+/// @ingroup allocore
+class StateDeltaEncoder{
+public:
+
+	/// @param[in] stateSize	size of state in bytes
+	/// @param[in] blockSize	granularity of change detection in bytes
+	/// @param[in] packetSize	maximum size of a packet in bytes
+	StateDeltaEncoder(uint32_t stateSize=0, uint32_t blockSize=64, uint32_t packetSize=1400);
+
+
+	/// Set size of state in bytes; forces a keyframe
+	StateDeltaEncoder& stateSize(uint32_t v);
+
+	/// Set granularity of change detection in bytes
+	StateDeltaEncoder& blockSize(uint32_t v);
+
+	/// Set maximum size of a packet in bytes
+	StateDeltaEncoder& packetSize(uint32_t v);
+
+	/// Set number of frames between keyframes (0 means only the first frame)
+	StateDeltaEncoder& keyframeInterval(uint32_t v){ mKeyInterval=v; return *this; }
+
+	/// Make the next encoded frame a keyframe
+	StateDeltaEncoder& forceKeyframe(){ mForceKey=true; return *this; }
+
+
+	/// Encode a new version of the state
+
+	/// \returns number of packets produced
+	///
+	uint32_t encode(const void * state);
+
+
+	/// Get number of packets produced by last call to encode
+	uint32_t numPackets() const { return mPacketLens.size(); }
+
+	/// Get a packet produced by last call to encode
+	const char * packet(uint32_t i) const { return &mPackets[i*mPacketSize]; }
+
+	/// Get size, in bytes, of a packet produced by last call to encode
+	uint32_t packetLength(uint32_t i) const { return mPacketLens[i]; }
+
+	/// Get total size, in bytes, of all packets produced by last call to encode
+	uint32_t bytesEncoded() const;
+
+	/// Get number of blocks that changed in last call to encode
+	uint32_t blocksChanged() const { return mBlocksChanged; }
+
+	/// Get sequence number of last encoded frame
+	uint32_t sequence() const { return mSeq; }
+
+	/// Whether the last encoded frame was a keyframe
+	bool keyframe() const { return mKey; }
+
+	uint32_t stateSize() const { return mPrev.size(); }
+	uint32_t blockSize() const { return mBlockSize; }
+	uint32_t packetSize() const { return mPacketSize; }
+	uint32_t keyframeInterval() const { return mKeyInterval; }
+
+private:
+	std::vector<char> mPrev;
+	std::vector<char> mPackets;
+	std::vector<uint32_t> mPacketLens;
+	uint32_t mBlockSize, mPacketSize, mKeyInterval;
+	uint32_t mSeq, mLastKeySeq, mBlocksChanged;
+	uint32_t mPos;			// write position in current packet
+	uint32_t mEntry;		// position of open entry in current packet, or 0
+	bool mKey, mForceKey, mHasPrev;
+
+	char * cur(){ return &mPackets[(mPacketLens.size()-1) * mPacketSize]; }
+	void beginPacket();
+	void endPacket();
+	void encodeRange(const char * a, const char * b, uint32_t off, uint32_t len);
+};
+
+
+
+/// Reconstructs a state from packets produced by StateDeltaEncoder
+
+/// Packets are applied in place to a back buffer. When all packets of a frame
+/// have arrived, the back buffer is swapped with the front buffer, which
+/// always holds the most recent complete state. The regions changed by that
+/// frame are copied into the new back buffer just before the next delta is
+/// applied, so the full state is never copied during steady operation.
+///
+/// If a packet is lost, the frame is dropped and all following deltas are
+/// ignored until the next keyframe arrives.
+///
+/// @ingroup allocore
+class StateDeltaDecoder{
+public:
+
+	/// @param[in] stateSize	size of state in bytes
+	StateDeltaDecoder(uint32_t stateSize=0);
+
+	/// Set size of state in bytes; discards current state
+	StateDeltaDecoder& stateSize(uint32_t v);
+
+
+	/// Decode a received packet
+
+	/// \returns true if the packet completed a frame and a new state is
+	/// available through state()
+	bool decode(const char * packet, uint32_t size);
+
+
+	/// Get most recent complete state (front buffer)
+	const void * state() const { return mBufs[mFront].empty() ? NULL : &mBufs[mFront][0]; }
+
+	/// Whether a complete state has been received
+	bool valid() const { return mHasState; }
+
+	/// Get sequence number of most recent complete state
+	uint32_t sequence() const { return mSeq; }
+
+	/// Get number of frames completed
+	uint32_t framesCompleted() const { return mCompleted; }
+
+	/// Get number of frames lost due to missing packets or a missing keyframe
+	uint32_t framesDropped() const { return mDropped; }
+
+	/// Get number of malformed or mismatched packets
+	uint32_t packetsRejected() const { return mRejected; }
+
+	uint32_t stateSize() const { return mBufs[0].size(); }
+
+
+	/// Read the frame fields of a packet's header
+
+	/// \returns false if the packet is not a state delta packet
+	static bool frameInfo(
+		const char * packet, uint32_t size,
+		uint32_t& seq, uint32_t& index, uint32_t& count
+	);
+
+private:
+	struct Range{ uint32_t off, len; };
+
+	std::vector<char> mBufs[2];
+	std::vector<Range> mDirty;			// ranges changed by front buffer's frame
+	std::vector<Range> mPendingDirty;	// ranges changed by pending frame
+	std::vector<char> mGot;				// packets of pending frame received
+	int mFront;
+	uint32_t mSeq, mPendingSeq, mPendingRecv, mLastDropSeq;
+	uint32_t mCompleted, mDropped, mRejected;
+	bool mHasState, mPending, mPendingKey, mNeedKey;
+
+	bool validate(const char * packet, uint32_t size);
+	void beginFrame(uint32_t seq, bool key, uint32_t count);
+	void dropFrame(uint32_t seq);
+	void apply(const char * packet, bool key);
+	static void addRange(std::vector<Range>& r, uint32_t off, uint32_t len);
+};
+
+
+
+/// Receives state deltas over UDP on a background thread
+
+/// A thread reads packets as soon as they arrive and collects them into
+/// frames. Complete frames are queued until they are decoded on the calling
+/// thread by pop() or poll(). This keeps a large frame, such as a keyframe of
+/// a multi-megabyte state, from overflowing the socket's receive buffer while
+/// the calling thread is busy rendering.
+///
+/// Frames whose packets do not all arrive before a newer frame starts are
+/// discarded, as are the oldest frames when too many are waiting.
+///
+/// @ingroup allocore
+class StateDeltaReceiver{
+public:
+
+	/// @param[in] stateSize		size of state in bytes
+	/// @param[in] maxPacketSize	size of largest packet to receive in bytes
+	StateDeltaReceiver(uint32_t stateSize=0, uint32_t maxPacketSize=65535);
+
+	~StateDeltaReceiver();
+
+
+	/// Bind to a port and start the receiving thread
+
+	/// @param[in] port		Local port number
+	/// @param[in] address	Local IP address. If empty, binds all network interfaces.
+	/// \returns whether the socket was bound and the thread started
+	bool start(uint16_t port, const char * address = "");
+
+	/// Stop the receiving thread and close the socket
+	void stop();
+
+
+	/// Decode the oldest complete frame
+
+	/// \returns true if a new state is available through state()
+	bool pop();
+
+	/// Decode all complete frames
+
+	/// \returns true if a new state is available through state()
+	bool poll();
+
+	/// Get number of complete frames waiting to be decoded
+	unsigned pending() const;
+
+	/// Get number of frames discarded before being decoded
+	uint32_t framesDiscarded() const;
+
+	/// Get most recent complete state
+	const void * state() const { return mDecoder.state(); }
+
+	/// Whether a complete state has been received
+	bool valid() const { return mDecoder.valid(); }
+
+	/// Get decoder; it must only be used from the thread calling pop() or poll()
+	StateDeltaDecoder& decoder(){ return mDecoder; }
+
+	/// Maximum number of complete frames waiting to be decoded
+	static const unsigned MAX_PENDING = 64;
+
+private:
+	struct Frame{
+		uint32_t seq, received;
+		std::vector<char> data;			// packets in order of arrival
+		std::vector<uint32_t> offsets;	// offset of each packet in data
+		std::vector<uint32_t> lengths;	// length of each packet, 0 if missing
+	};
+
+	StateDeltaDecoder mDecoder;
+	SocketServer mSocket;
+	Thread mThread;
+	std::vector<char> mPacket;
+	Frame * mFrame;					// frame being assembled by thread
+	uint32_t mLastSeq;				// last frame finished or discarded by thread
+	bool mHasLast;
+	std::atomic<bool> mRunning;
+
+	mutable std::mutex mLock;		// guards the members below
+	std::deque<Frame *> mReady;
+	std::vector<Frame *> mFree;
+	uint32_t mDiscarded;
+
+	static void * receiveThread(void * user);
+	void receive(const char * packet, uint32_t size);
+	void finish(Frame * f, bool complete);
+	Frame * take();
+	bool decode(Frame * f);
+	void recycle(Frame * f);
+};
+
+} // al::
+
+#endif
@@ -49,6 +49,7 @@
 #include <vector>
 #include <list>
 #include "allocore/types/al_Buffer.hpp"
+#include "allocore/types/al_LockFreeQueue.hpp"
 #include "allocore/math/al_Interpolation.hpp"
 #include "allocore/math/al_Vec.hpp"
 #include "allocore/spatial/al_DistAtten.hpp"
@@ -57,6 +58,8 @@
 #include "allocore/sound/al_Speaker.hpp"
 #include "allocore/sound/al_Reverb.hpp"
 #include "allocore/sound/al_Biquad.hpp"
+#include "allocore/sound/al_DelayLine.hpp"
+#include "allocore/sound/al_DistanceFilter.hpp"
 
 namespace al{
 
@@ -207,6 +210,7 @@ protected:
 
 	Spatializer * mSpatializer;
 	std::vector<Quatd> mQuatHistory;// buffer of interpolated orientations
+	std::vector<DistanceFilter::State> mFilterStates; // per source slot
 	Quatd mQuatPrev;				// orientation in previous block
 	bool mIsCompiled;
 };
@@ -236,9 +240,11 @@ public:
 	/// @param[in] delaySize	Size of internal delay line. This should be
 	///							large enough for the most distant sound:
 	///							samples = sampleRate * (near + range)/speedOfSound
+	///							If 0, it is sized from farClip with
+	///							defaultDelaySize().
 	SoundSource(
 	        double nearClip=0.1, double farClip=20, AttenuationLaw law = ATTEN_INVERSE, DopplerType dopplerType = DOPPLER_SYMMETRICAL,
-	        double farBias=0, int delaySize=100000
+	        double farBias=0, int delaySize=0
 	        );
 
 	virtual ~SoundSource(){}
@@ -247,6 +253,9 @@ public:
 	/// Returns whether distance-based attenuation is enabled
 	bool useAttenuation() const { return mUseAtten; }
 
+	/// Returns whether distance-based lowpass filtering is enabled
+	bool useDistanceFilter() const { return mUseDistanceFilter; }
+
 	/// Returns Doppler Type
 	DopplerType dopplerType() const { return mDopplerType; }
 
@@ -258,6 +267,9 @@ public:
 	/// Get size of delay in samples
 	int delaySize() const { return mSound.size(); }
 
+	/// Get interpolation used for reading from the delay-line
+	DelayLine::Interpolation interpolation() const { return mSound.interpolation(); }
+
 	/// Convert delay, in seconds, to an index
 	double delayToIndex(double delay, double sampleRate) const {
 		if(mDopplerType == DOPPLER_NONE) return 0;
@@ -270,33 +282,53 @@ public:
 	}
 
 	/// Returns maximum index that can be used for reading samples
-	int maxIndex() const { return delaySize()-2; }
+	int maxIndex() const { return mSound.maxDelay(); }
+
+	/// Read sample from delay-line using interpolation
 
-	/// Read sample from delay-line using linear interpolation
 	/// The index specifies how many samples ago by which to read back from
-	/// the buffer. The index must be less than or equal to bufferSize()-2.
-	float readSample(double index) const {
-		int index0 = index;
-		float a = mSound.read(index0);
-		float b = mSound.read(index0+1);
-		float frac = index - index0;
-		//return ipl::linear(frac, a, b);
-
-		float a0 = mSound.read(index0-1);
-		float b1 = mSound.read(index0+2);
-		return ipl::cubic(frac, a0, a, b, b1);
+	/// the buffer. It is clamped to maxIndex().
+	float readSample(double index) const { return mSound.read(index); }
 
+	/// Read samples from delay-line at an index for each sample
+	void readSamples(float * dst, const double * indices, int n) const {
+		mSound.read(dst, indices, n);
+	}
+
+	/// Read consecutive samples from delay-line
+
+	/// Sample i is read at index + n-1-i, so the last is at the given index.
+	void readSamples(float * dst, int n, double index) const {
+		mSound.readBlock(dst, n, index);
 	}
 
 	/// Enable/disable distance-based gain attenuation
 	void useAttenuation(bool enable){ mUseAtten = enable; }
 
+	/// Enable/disable distance-based lowpass filtering (disabled by default)
+
+	/// The filter is set by AudioScene::distanceFilter().
+	///
+	void useDistanceFilter(bool enable){ mUseDistanceFilter = enable; }
+
 	/// Set Doppler Type
 	void dopplerType(DopplerType type){ mDopplerType = type; }
 
+	/// Set size of delay in samples; this clears the delay-line
+	void delaySize(int samples){ mSound.resize(samples); }
+
+	/// Set interpolation used for reading from the delay-line
+	void interpolation(DelayLine::Interpolation v){ mSound.interpolation(v); }
+
 	/// Write sample to internal delay-line
 	void writeSample(float v){ mSound.write(v); }
 
+	/// Clear delay-line and position history, e.g. before reusing a source
+	void reset();
+
+	/// Returns whether the source has been added to a scene
+	bool inScene() const { return mSceneSlot >= 0; }
+
 	/// optional onProcessSample for sample rate processing of sound sources
 	virtual void onProcessSample(int frame){}
 
@@ -316,19 +348,38 @@ public:
 	// probably want to add io.samplesPerBuffer() to this for safety.
 	static int bufferSize(double samplerate, double speedOfSound, double distance);
 
+	/// Get delay size for sound to travel a distance at up to 96 kHz and 340 m/s, plus a buffer of up to 4096 frames
+	static int defaultDelaySize(double distance);
+
 	BiQuadNX presenceFilter; //used for presence filtering and spatial modulation BW control
 
 
 protected:
-	RingBuffer<float> mSound;		// spherical wave around position
+	friend class AudioScene;
+
+	DelayLine mSound;				// spherical wave around position
 	bool mUseAtten;
+	bool mUseDistanceFilter;
 	DopplerType mDopplerType;
 	bool mUsePerSampleProcessing;
     unsigned int mCachedIndex; // for VBAP with multiple sources
+	int mSceneSlot;				// registry slot in scene or -1 if not in scene
+	uint32_t mSceneGeneration;	// generation of registry slot
+	bool mPooled;				// whether owned by a scene's source pool
 };
 
 
 /// An audio scene consisting of Listeners and Sources.
+
+/// Sources are kept in a registry with a fixed number of slots. They can be
+/// added and removed from any thread; the changes are posted through a
+/// lock-free queue and applied by the audio thread at the start of the next
+/// call to render(), so rendering always iterates over a dense, stable list of
+/// active sources. Each slot has a generation counter so that requests made
+/// through a stale slot are ignored.
+///
+/// The scene can also own a pool of preallocated sources, including their
+/// delay-lines, to avoid allocating memory when sources are spawned.
 ///
 /// @ingroup allocore
 class AudioScene {
@@ -338,11 +389,12 @@ public:
 	typedef std::vector<Listener *> Listeners;
 
 	/// A set of sources
-	typedef std::list<SoundSource *> Sources;
+	typedef std::vector<SoundSource *> Sources;
 
 
 	/// @param[in] numFrames	block size of audio buffers
-	AudioScene(int numFrames);
+	/// @param[in] maxSources	maximum number of sources in the scene
+	AudioScene(int numFrames, int maxSources=1024);
 
 	~AudioScene();
 
@@ -351,12 +403,23 @@ public:
 	Listeners& listeners(){ return mListeners; }
 	const Listeners& listeners() const { return mListeners; }
 
-	/// Get sources
-	Sources& sources(){ return mSources; }
+	/// Get active sources
+
+	/// This should only be accessed from the audio thread. Sources added or
+	/// removed since the last call to updateSources() are not reflected.
 	const Sources& sources() const { return mSources; }
 
 	void numFrames(int v);
 
+	/// Set maximum number of sources
+
+	/// This removes all sources from the scene and is not thread-safe.
+	///
+	void maxSources(int v);
+
+	/// Get maximum number of sources
+	int maxSources() const { return mSlots.size(); }
+
 	/// Create a new listener for this scene using the given spatializer
 
 	/// The returned Listener is allocated internally and will be deleted
@@ -364,11 +427,46 @@ public:
 	Listener * createListener(Spatializer * spatializer);
 
 	/// Add a sound source to scene
-	void addSource(SoundSource& src);
+
+	/// This can be called from any thread. The source will be rendered from
+	/// the next audio block on. A source can only be in one scene at a time.
+	/// \returns false if the source is already in a scene or the scene is full
+	bool addSource(SoundSource& src);
 
 	/// Remove a sound source from scene
+
+	/// This can be called from any thread. The source must remain valid until
+	/// the start of the next audio block. Sources from the scene's pool are
+	/// returned to the pool.
 	void removeSource(SoundSource& src);
 
+	/// Apply pending source additions and removals
+
+	/// This is called at the start of render() and should only be called from
+	/// the audio thread.
+	void updateSources();
+
+
+	/// Preallocate a pool of sources
+
+	/// This is not thread-safe and must be called while no pooled sources are
+	/// in the scene.
+	/// @param[in] count		number of sources
+	/// @param[in] delaySize	size of delay-line of each source; if 0, it is
+	///							sized from the far clip of a source
+	void allocateSourcePool(int count, int delaySize=0);
+
+	/// Take a source from the pool and add it to the scene
+
+	/// This can be called from any thread and does not allocate memory. The
+	/// source is reset, but keeps any settings from its previous use. Remove
+	/// it with removeSource() to return it to the pool.
+	/// \returns a pooled source or NULL if the pool is empty or the scene is full
+	SoundSource * spawnSource();
+
+	/// Get filter applied to sources with distance filtering enabled
+	DistanceFilter& distanceFilter(){ return mDistanceFilter; }
+
 	/// Perform rendering
 	void render(AudioIOData& io);
 
@@ -385,12 +483,52 @@ public:
 	}
 
 protected:
+	enum{ SOURCE_ADD, SOURCE_REMOVE };
+
+	struct SourceCommand{
+		SoundSource * src;
+		uint32_t slot;
+		uint32_t generation;
+		int type;
+	};
+
+	struct SourceSlot{
+		uint32_t generation;	// incremented each time slot is freed
+		int dense;				// index into mSources or -1 if inactive
+	};
+
 	Listeners mListeners;
-	Sources mSources;
+	Sources mSources;				// active sources, audio thread only
+	std::vector<uint32_t> mSourceSlots;	// slot of each active source
+	std::vector<SourceSlot> mSlots;
+	LockFreeQueue<uint32_t> mFreeSlots;
+	LockFreeQueue<SourceCommand> mSourceCommands;
+	std::vector<SoundSource *> mPool;
+	LockFreeQueue<SoundSource *> mPoolFree;
 	int mNumFrames;				// audio frames per block
-	std::vector<float> mBuffer;	// temporary frame buffer
+	DistanceFilter mDistanceFilter;
+	LinearArena mScratch;		// scratch buffers when the stream has none
 	double mSpeedOfSound;		// distance per second
 	bool mPerSampleProcessing;
+
+	// Per block scratch buffers
+	struct Scratch{
+		float * samples;	// samples of a group of sources
+		Vec3d * relpos;		// per frame positions relative to listener of a group
+		double * delays;	// per frame delay-line read index
+		float * gains;		// per frame attenuation
+	};
+
+	// Read block of a source from its delay-line into buf, with attenuation
+	// and positions relative to the listener in relposBuf (one per frame, or
+	// one per block without per sample processing)
+	// \returns distance to the listener at the end of the block
+	double readSource(
+		SoundSource& src, Listener& l, int il, int numFrames, double sampleRate,
+		float * buf, Vec3d * relposBuf, const Scratch& scratch
+	);
+
+	static bool allocScratch(Scratch& s, LinearArena& arena, int numFrames);
 };
 
 } // al::
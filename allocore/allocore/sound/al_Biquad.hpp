@@ -5,6 +5,8 @@
 #ifndef __AL_BIQUAD__
 #define __AL_BIQUAD__
 
+#include <vector>
+
 namespace al
 {
     
@@ -44,7 +46,15 @@ public:
     
     void enable(bool on) {enabled = on;}
     
+    /// Compute the coefficients a0 to a4 of bd for a response
+    
+    /// @return false if type is invalid, in which case bd is unchanged
+    static bool coefficients(BiquadData& bd, BIQUADTYPE type, double sampleRate,
+                             double freq, double bandwidth, double dbGain);
+    
 private:
+    friend class BiQuadNX;
+
     BIQUADTYPE mType;
     BiquadData mBD;
     double mSampleRate;
@@ -54,6 +64,9 @@ private:
 /// Cascaded Biquad to acheive steeper filters
 /// Default params of numFilters = 8 and bandwidth = 0.26 work well for an anti-aliasing LPF filter @ 19k
 ///
+/// processBuffer() computes up to 8 filters in parallel, each a sample behind
+/// the one before it, rather than running the buffer through each in turn.
+///
 /// @ingroup allocore
 class BiQuadNX
 {
@@ -71,6 +84,67 @@ public:
 private:
     int numFilters;
     BiQuad *mFilters;
+    
+    void processFilters(int first, double *buffer, int count);
+};
+
+/// Cascaded Biquads on many channels at once
+///
+/// Channels are processed in groups of LANES, one channel per lane, so that
+/// a group's filters are computed together in SIMD registers. Filters are in
+/// transposed direct form II in single precision. All stages of a channel
+/// share its settings, as with BiQuadNX.
+///
+/// With smoothing on, settings changed between blocks are interpolated
+/// across the next block, so that filters can be swept without zipper noise.
+/// Otherwise they apply from the start of the next block.
+///
+/// @ingroup allocore
+class BiQuadBank
+{
+public:
+    
+    enum { LANES = 8 };
+    
+    BiQuadBank(int numChannels = 1, int numStages = 1, BIQUADTYPE _type = BIQUAD_LPF, double _sampleRate = 44100);
+    
+    /// Set number of channels and stages of each; this clears the filters
+    void resize(int numChannels, int numStages);
+    
+    /// Set response of all channels
+    void set(double freq, double bandwidth = 1.9, double dbGain = 0);
+    /// Set response of one channel
+    void setChannel(int channel, double freq, double bandwidth = 1.9, double dbGain = 0);
+    /// Set sample rate used by later calls to set()
+    void setSampleRate(double _rate){mSampleRate = _rate;}
+    /// Set whether changes of response are interpolated across a block
+    void smooth(bool on){mSmooth = on;}
+    
+    /// Filter non-interleaved channels in place
+    
+    /// @param[in,out] buffers	one buffer for each channel
+    /// @param[in] count		number of samples in each buffer
+    void processBuffers(float * const *buffers, int count);
+    
+    /// Clear filter history
+    void clear();
+    
+    int channels() const {return mNumChannels;}
+    int stages() const {return mNumStages;}
+    
+private:
+    enum { COEFS = 5, CHUNK = 64 };
+    
+    BIQUADTYPE mType;
+    double mSampleRate;
+    int mNumChannels, mNumStages;
+    bool mSmooth, mChanged;
+    std::vector<float> mCoefs;      // current b0, b1, b2, a1, a2 of each group
+    std::vector<float> mTargets;    // as set
+    std::vector<float> mState;      // two of each stage of each group
+    
+    template <bool Ramp>
+    void processGroup(int group, float (*buf)[LANES], const float (*inc)[LANES], int count);
 };
 
 }
@@ -0,0 +1,136 @@
+#ifndef INCLUDE_AL_DELAY_LINE_HPP
+#define INCLUDE_AL_DELAY_LINE_HPP
+
+/*	Allocore --
+	Multimedia / virtual environment application class library
+
+	Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology, UCSB.
+	Copyright (C) 2012. The Regents of the University of California.
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+		Redistributions in binary form must reproduce the above copyright
+		notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+		Neither the name of the University of California nor the names of its
+		contributors may be used to endorse or promote products derived from
+		this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+
+	File description:
+	Delay-line with interpolated reads at fractional delays
+*/
+
+#include <vector>
+
+namespace al{
+
+/// Delay-line with interpolated reads at fractional delays
+
+/// The oldest samples of the buffer are mirrored past its end, so that the
+/// taps of an interpolation kernel are always contiguous and reads never wrap
+/// in the middle of one. Block reads can then compute many outputs without
+/// per-tap index wrapping.
+///
+/// Delays are measured in samples back from the newest sample, which has a
+/// delay of 0. Reads are clamped to [0, maxDelay()]. Below a delay of
+/// taps/2 - 1 the kernel extends past the newest sample onto the oldest, so
+/// only integer delays are exact there, as with a RingBuffer.
+///
+/// @ingroup allocore
+class DelayLine{
+public:
+
+	enum Interpolation{
+		CUBIC,			///< 4-point Catmull-Rom spline, as ipl::cubic
+		LAGRANGE4,		///< 4-point third order Lagrange
+		LAGRANGE6,		///< 6-point fifth order Lagrange
+		SINC8			///< 8-point Blackman windowed sinc, for high quality
+	};
+
+	/// @param[in] size		number of samples
+	/// @param[in] ipl		interpolation used for reads
+	DelayLine(int size=0, Interpolation ipl=CUBIC);
+
+
+	/// Get number of samples
+	int size() const { return mSize; }
+
+	/// Get interpolation type
+	Interpolation interpolation() const { return mIpl; }
+
+	/// Get smallest delay that can be read
+	double minDelay() const { return 0; }
+
+	/// Get largest delay that can be read
+	double maxDelay() const { return mSize - 1 - halfTaps(); }
+
+
+	/// Resize; this clears the delay-line
+	void resize(int size);
+
+	/// Set interpolation type
+	DelayLine& interpolation(Interpolation v){ mIpl=v; return *this; }
+
+	/// Zero all samples
+	void clear();
+
+
+	/// Write a new sample
+	void write(float v){
+		if(++mPos == mSize) mPos = 0;
+		mBuf[mPos] = v;
+		if(mPos < GUARD) mBuf[mSize + mPos] = v;
+	}
+
+	/// Write a block of new samples, oldest first
+	void write(const float * src, int n);
+
+	/// Read sample at a fractional delay
+	float read(double delay) const;
+
+	/// Read samples at fractional delays
+
+	/// @param[out] dst		output samples
+	/// @param[in] delays	delay of each output sample
+	/// @param[in] n		number of samples
+	void read(float * dst, const double * delays, int n) const;
+
+	/// Read a block of consecutive samples
+
+	/// Output i is read at a delay of delay + n-1-i, so the last output is at
+	/// the given delay. The interpolation weights are the same for all outputs.
+	void readBlock(float * dst, int n, double delay) const;
+
+protected:
+	enum{ GUARD = 8 };			// mirrored samples; at least taps - 1
+
+	std::vector<float> mBuf;	// size + GUARD samples
+	int mSize;
+	int mPos;					// index of newest sample
+	Interpolation mIpl;
+
+	int taps() const { return SINC8 == mIpl ? 8 : (LAGRANGE6 == mIpl ? 6 : 4); }
+	int halfTaps() const { return taps()/2; }
+};
+
+} // al::
+
+#endif
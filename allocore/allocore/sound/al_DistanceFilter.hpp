@@ -0,0 +1,121 @@
+#ifndef INCLUDE_AL_DISTANCE_FILTER_HPP
+#define INCLUDE_AL_DISTANCE_FILTER_HPP
+
+/*	Allocore --
+	Multimedia / virtual environment application class library
+
+	Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology, UCSB.
+	Copyright (C) 2012. The Regents of the University of California.
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+		Redistributions in binary form must reproduce the above copyright
+		notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+		Neither the name of the University of California nor the names of its
+		contributors may be used to endorse or promote products derived from
+		this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+
+	File description:
+	Distance dependent lowpass filtering of sound sources, in batches
+*/
+
+namespace al{
+
+/// Lowpass filtering of sound sources by distance, in batches
+
+/// Each source is filtered by a one-pole lowpass whose cutoff falls with
+/// distance, approximating absorption by air, which grows with the square of
+/// frequency. The coefficient of each source is set once per block and
+/// interpolated linearly across it from that of the previous block.
+///
+/// The state of each source is kept by the caller, so that sources can be
+/// filtered in any grouping. Up to LANES sources are filtered together, one
+/// in each SIMD lane.
+///
+/// @ingroup allocore
+class DistanceFilter{
+public:
+
+	enum{ LANES = 8 };
+
+	/// Filter history of one source
+	struct State{
+		float prev;		///< previous output
+		float coef;		///< coefficient at end of previous block; < 0 if none
+
+		State(): prev(0), coef(-1){}
+	};
+
+
+	/// @param[in] sampleRate	sample rate
+	/// @param[in] absorption	attenuation at 10 kHz, in dB per unit of distance
+	DistanceFilter(double sampleRate=44100, double absorption=0.1);
+
+
+	/// Get sample rate
+	double sampleRate() const { return mSampleRate; }
+
+	/// Get attenuation at 10 kHz, in dB per unit of distance
+	double absorption() const { return mAbsorption; }
+
+	/// Set sample rate
+	DistanceFilter& sampleRate(double v){ mSampleRate=v; return *this; }
+
+	/// Set attenuation at 10 kHz, in dB per unit of distance
+
+	/// About 0.1 dB per meter is typical of air at room temperature and
+	/// moderate humidity.
+	DistanceFilter& absorption(double v){ mAbsorption=v; return *this; }
+
+	/// Get -3 dB cutoff frequency at a distance
+	double cutoff(double distance) const;
+
+	/// Get filter coefficient at a distance
+
+	/// This is 1, which passes the input unchanged, when the cutoff is near
+	/// or above Nyquist.
+	float coefficient(double distance) const;
+
+
+	/// Filter buffers of sources in place, LANES sources at a time
+
+	/// @param[in,out] bufs		buffer of each source
+	/// @param[in,out] states	filter history of each source
+	/// @param[in] coefs		coefficient of each source at the end of the block
+	/// @param[in] numSources	number of sources
+	/// @param[in] numFrames	number of frames in each buffer
+	static void process(
+		float * const * bufs, State * const * states, const float * coefs,
+		int numSources, int numFrames
+	);
+
+	/// Filter buffer of one source in place, one sample at a time
+	static void process(float * buf, State& state, float coef, int numFrames);
+
+protected:
+	double mSampleRate;
+	double mAbsorption;
+};
+
+} // al::
+
+#endif
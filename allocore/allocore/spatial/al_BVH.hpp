@@ -0,0 +1,339 @@
+#ifndef INCLUDE_AL_BVH_HPP
+#define INCLUDE_AL_BVH_HPP
+
+/*	Allocore --
+	Multimedia / virtual environment application class library
+
+	Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology, UCSB.
+	Copyright (C) 2012. The Regents of the University of California.
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+		Redistributions in binary form must reproduce the above copyright
+		notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+		Neither the name of the University of California nor the names of its
+		contributors may be used to endorse or promote products derived from
+		this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+
+	File description:
+	Bounding volume hierarchies for fast ray casting against many objects
+*/
+
+#include <algorithm>
+#include <cfloat>
+#include <limits>
+#include <vector>
+#include "allocore/math/al_Ray.hpp"
+#include "allocore/math/al_Vec.hpp"
+#include "allocore/system/al_ThreadPool.hpp"
+#include "allocore/system/pstdint.h"
+
+namespace al{
+
+/// Bounding volume hierarchy over axis-aligned boxes
+
+/// The hierarchy is a binary tree of boxes built top-down with the surface
+/// area heuristic (SAH): each node is split where the expected cost of
+/// tracing a ray through its children is lowest. Candidate splits are found
+/// by binning primitive centers along each axis. Large subtrees are built in
+/// parallel when a thread pool is given.
+///
+/// Primitives are referred to by their index in the list of boxes passed to
+/// build(). After primitives have moved, refit() updates the bounds of the
+/// nodes without changing the tree, which is much faster than rebuilding but
+/// lowers the quality of the tree if primitives move far.
+///
+/// @ingroup allocore
+class BVH{
+public:
+
+	/// Axis-aligned box
+	struct Box{
+		Vec3f min, max;
+
+		Box(){ reset(); }
+		Box(const Vec3f& mn, const Vec3f& mx): min(mn), max(mx){}
+
+		/// Make empty
+		void reset(){ min.set(FLT_MAX); max.set(-FLT_MAX); }
+
+		/// Whether box contains anything
+		bool valid() const { return min.x <= max.x; }
+
+		/// Grow to contain a point
+		void extend(const Vec3f& p){
+			for(int i=0; i<3; ++i){
+				if(p[i] < min[i]) min[i] = p[i];
+				if(p[i] > max[i]) max[i] = p[i];
+			}
+		}
+
+		/// Grow to contain a box
+		void extend(const Box& b){
+			for(int i=0; i<3; ++i){
+				if(b.min[i] < min[i]) min[i] = b.min[i];
+				if(b.max[i] > max[i]) max[i] = b.max[i];
+			}
+		}
+
+		Vec3f center() const { return (min + max) * 0.5f; }
+
+		/// Get half of the surface area
+		float area() const {
+			if(!valid()) return 0.f;
+			Vec3f d = max - min;
+			return d.x*d.y + d.y*d.z + d.z*d.x;
+		}
+	};
+
+	/// Node of tree
+	struct Node{
+		Box box;
+		int32_t first;	///< Index of first child if interior, else position of first primitive in order()
+		int32_t count;	///< Number of primitives if leaf, else 0
+		bool leaf() const { return count > 0; }
+	};
+
+
+	BVH(){}
+
+	/// Build tree
+
+	/// @param[in] boxes	bounds of primitives
+	/// @param[in] pool		pool to build large subtrees on, or 0 to build on
+	///						the calling thread only
+	/// @param[in] maxLeaf	maximum number of primitives per leaf; groups of
+	///						this many or fewer are not split
+	void build(const std::vector<Box>& boxes, ThreadPool * pool = 0, int maxLeaf = 4);
+
+	/// Update bounds of nodes after primitives have moved
+
+	/// @param[in] boxes	bounds of primitives; must be as many as when built
+	///
+	void refit(const std::vector<Box>& boxes);
+
+	/// Update bounds of nodes above some primitives that have moved
+
+	/// This is faster than refitting the whole tree when few primitives
+	/// have moved.
+	/// @param[in] boxes	bounds of primitives; must be as many as when built
+	/// @param[in] moved	indices of primitives that have moved
+	void refit(const std::vector<Box>& boxes, const std::vector<unsigned>& moved);
+
+	/// Remove all nodes
+	void clear(){ mNodes.clear(); mOrder.clear(); mParents.clear(); mLeaves.clear(); }
+
+
+	/// Visit leaves hit by a ray, roughly from near to far
+
+	/// @param[in] origin	origin of ray
+	/// @param[in] dir		direction of ray; need not be normalized
+	/// @param[in] tMax		maximum ray parameter
+	/// @param[in] onLeaf	function called as onLeaf(first, count, tMax) for
+	///						each leaf hit, where first is the position of its
+	///						first primitive in order() and tMax is a float
+	///						reference which can be lowered to skip farther nodes
+	template <class LeafFunc>
+	void traverse(const Vec3f& origin, const Vec3f& dir, float tMax, LeafFunc&& onLeaf) const;
+
+
+	/// Get nodes; the first is the root
+	const std::vector<Node>& nodes() const { return mNodes; }
+
+	/// Get primitive indices in the order referred to by leaves
+	const std::vector<unsigned>& order() const { return mOrder; }
+
+	/// Get bounds of all primitives
+	const Box& bounds() const { static Box none; return mNodes.empty() ? none : mNodes[0].box; }
+
+	/// Whether tree has no nodes
+	bool empty() const { return mNodes.empty(); }
+
+	/// Test ray against box
+
+	/// @param[in]  b		box
+	/// @param[in]  o		origin of ray
+	/// @param[in]  inv		reciprocal of ray direction
+	/// @param[in]  tMax	maximum ray parameter
+	/// @param[out] tNear	ray parameter where box is entered
+	static bool hit(const Box& b, const Vec3f& o, const Vec3f& inv, float tMax, float& tNear);
+
+private:
+	struct Builder;
+	std::vector<Node> mNodes;
+	std::vector<unsigned> mOrder;
+	std::vector<int32_t> mParents;	// parent of each node
+	std::vector<int32_t> mLeaves;	// leaf of each primitive
+};
+
+
+
+/// Bounding volume hierarchy over triangles, for ray casting
+
+/// Triangles are stored in the order of the leaves of the tree, with each
+/// vertex component in its own array, so that the triangles of a leaf are
+/// tested against a ray together in a loop that compilers vectorize.
+///
+/// @ingroup allocore
+class TriangleBVH{
+public:
+
+	/// Intersection of ray and triangle
+	struct Hit{
+		double t;		///< Ray parameter at hit
+		int triangle;	///< Index of triangle hit, or -1 if none
+		float u, v;		///< Barycentric coordinates of hit point (1-u-v)*v0 + u*v1 + v*v2
+		Hit(): t(-1), triangle(-1), u(0), v(0){}
+	};
+
+	/// Maximum number of triangles per leaf
+	static const int LEAF_SIZE = 4;
+
+	TriangleBVH(){}
+
+	/// Build hierarchy
+
+	/// @param[in] vertices		vertex positions
+	/// @param[in] numVertices	number of vertices
+	/// @param[in] triangles	three vertex indices per triangle; triangles
+	///							with indices out of range are ignored
+	/// @param[in] pool			pool to build on, or 0 to use the calling
+	///							thread only
+	void build(
+		const Vec3f * vertices, unsigned numVertices,
+		const std::vector<unsigned>& triangles,
+		ThreadPool * pool = &ThreadPool::global()
+	);
+
+	/// Update hierarchy after vertices have moved
+
+	/// The triangles, and so the number of vertices, must not have changed.
+	///
+	void refit(const Vec3f * vertices);
+
+	/// Remove all triangles
+	void clear();
+
+
+	/// Find nearest triangle hit by a ray
+
+	/// Triangles are hit from both sides.
+	/// @param[in]  ray		ray; the direction need not be normalized
+	/// @param[out] hit		nearest hit, if any
+	/// @param[in]  tMax	maximum ray parameter
+	/// \returns whether a triangle was hit
+	bool intersect(const Rayd& ray, Hit& hit, double tMax = std::numeric_limits<double>::max()) const;
+
+
+	/// Get number of triangles
+	unsigned size() const { return mTriangles.size()/3; }
+
+	/// Get vertex indices of triangles, three per triangle
+	const std::vector<unsigned>& triangles() const { return mTriangles; }
+
+	/// Get tree
+	const BVH& bvh() const { return mBVH; }
+
+private:
+	BVH mBVH;
+	std::vector<unsigned> mTriangles;
+	std::vector<BVH::Box> mBoxes;
+	std::vector<float> mV0[3], mE1[3], mE2[3]; // in leaf order
+
+	void pack(const Vec3f * vertices);
+};
+
+
+
+
+// Implementation --------------------------------------------------------------
+
+inline bool BVH::hit(const Box& b, const Vec3f& o, const Vec3f& inv, float tMax, float& tNear){
+	float t0 = (b.min.x - o.x) * inv.x;
+	float t1 = (b.max.x - o.x) * inv.x;
+	float tmin = std::min(t0, t1), tmax = std::max(t0, t1);
+	t0 = (b.min.y - o.y) * inv.y;
+	t1 = (b.max.y - o.y) * inv.y;
+	tmin = std::max(tmin, std::min(t0, t1));
+	tmax = std::min(tmax, std::max(t0, t1));
+	t0 = (b.min.z - o.z) * inv.z;
+	t1 = (b.max.z - o.z) * inv.z;
+	tmin = std::max(tmin, std::min(t0, t1));
+	tmax = std::min(tmax, std::max(t0, t1));
+	tNear = tmin;
+	return tmax >= std::max(tmin, 0.f) && tmin <= tMax;
+}
+
+template <class LeafFunc>
+void BVH::traverse(const Vec3f& o, const Vec3f& d, float tMax, LeafFunc&& onLeaf) const {
+	if(mNodes.empty()) return;
+
+	// A finite reciprocal for zero components avoids 0*inf when the ray lies
+	// in the plane of a box face
+	Vec3f inv;
+	for(int i=0; i<3; ++i) inv[i] = d[i] != 0.f ? 1.f/d[i] : FLT_MAX;
+	float tNear;
+	if(!hit(mNodes[0].box, o, inv, tMax, tNear)) return;
+
+	// Nodes to visit with the ray parameter where they are entered. The
+	// builder limits the depth of the tree to fit this stack.
+	struct Entry{ int node; float t; };
+	Entry stack[128];
+	int top = 0;
+	stack[top].node = 0;
+	stack[top++].t = tNear;
+
+	while(top){
+		Entry e = stack[--top];
+		if(e.t > tMax) continue;	// a nearer hit has been found since
+		const Node& n = mNodes[e.node];
+		if(n.leaf()){
+			onLeaf(n.first, n.count, tMax);
+			continue;
+		}
+
+		float t0, t1;
+		bool h0 = hit(mNodes[n.first  ].box, o, inv, tMax, t0);
+		bool h1 = hit(mNodes[n.first+1].box, o, inv, tMax, t1);
+
+		// Push farther child first, so nearer one is visited first
+		if(h0 && h1){
+			int nearer = t0 <= t1 ? 0 : 1;
+			stack[top].node = n.first + 1-nearer;
+			stack[top++].t = nearer ? t0 : t1;
+			stack[top].node = n.first + nearer;
+			stack[top++].t = nearer ? t1 : t0;
+		}
+		else if(h0){
+			stack[top].node = n.first;
+			stack[top++].t = t0;
+		}
+		else if(h1){
+			stack[top].node = n.first+1;
+			stack[top++].t = t1;
+		}
+	}
+}
+
+} // al::
+
+#endif
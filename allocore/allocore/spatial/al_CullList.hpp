@@ -0,0 +1,197 @@
+#ifndef INCLUDE_AL_CULL_LIST_HPP
+#define INCLUDE_AL_CULL_LIST_HPP
+
+/*	Allocore --
+	Multimedia / virtual environment application class library
+
+	Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology, UCSB.
+	Copyright (C) 2012. The Regents of the University of California.
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+		Redistributions in binary form must reproduce the above copyright
+		notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+		Neither the name of the University of California nor the names of its
+		contributors may be used to endorse or promote products derived from
+		this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+
+	File description:
+	Retained list of bounded items for culling against multiple view frusta
+*/
+
+#include <vector>
+#include "allocore/math/al_Frustum.hpp"
+#include "allocore/spatial/al_BVH.hpp"
+#include "allocore/spatial/al_Pose.hpp"
+
+namespace al{
+
+/// Retained list of bounded items culled against several view frusta at once
+
+/// The list is typically refilled once per frame with a bounding sphere for
+/// each drawable item. A call to cull() then tests every item against every
+/// view and stores the result as a bitmask per item, so that several passes
+/// over the same scene (e.g., the faces and eyes of a cube map) can each
+/// submit only their visible subset.
+///
+/// Large lists are culled through a bounding volume hierarchy over the items,
+/// so that whole groups of items are accepted or rejected by a few plane
+/// tests, and all views are handled in the same pass over the tree. The
+/// hierarchy is kept between calls to cull(). Moving a few items with set()
+/// only updates the nodes above them. Refilling the list with the same
+/// number of items, e.g. the same items each frame, refits the whole tree,
+/// and other changes rebuild it. Since refitting costs about as much as
+/// testing each item against a few views, refilled lists are only culled
+/// hierarchically when there are many views, or as few as the six faces of a
+/// cube map if the last cull found most items outside all views.
+///
+/// Views can be any frusta, e.g. from Lens::frustum for each eye of a stereo
+/// pair, or the faces of a cube map.
+///
+/// @ingroup allocore
+class CullList{
+public:
+
+	enum{ MAX_VIEWS = 32 };		///< Maximum number of views
+	enum{ HIERARCHY_SIZE = 256 };	///< Minimum number of items to cull hierarchically
+
+	/// A bounded item
+	struct Item{
+		Vec3d center;		///< center of bounding sphere
+		double radius;		///< radius of bounding sphere
+		int id;				///< user identifier
+	};
+
+
+	CullList();
+
+
+	/// Remove all items
+	CullList& clear();
+
+	/// Add an item
+
+	/// @param[in] center	center of bounding sphere
+	/// @param[in] radius	radius of bounding sphere
+	/// @param[in] id		user identifier; if negative, the item index is used
+	/// \returns index of item
+	int add(const Vec3d& center, double radius, int id=-1);
+
+	/// Change the bounds of an item
+
+	/// This is the cheapest way to update a large list in which few items
+	/// move.
+	CullList& set(int item, const Vec3d& center, double radius);
+
+	/// Get number of items
+	int size() const { return mItems.size(); }
+
+	/// Get an item
+	const Item& item(int i) const { return mItems[i]; }
+
+
+	/// Remove all views
+	CullList& clearViews();
+
+	/// Add a view frustum
+
+	/// \returns index of view or -1 if there are already MAX_VIEWS views
+	int addView(const Frustumd& f);
+
+	/// Add the six faces of a cube map centered on a pose
+
+	/// The faces are added in the order of the GL_TEXTURE_CUBE_MAP_POSITIVE_X
+	/// to GL_TEXTURE_CUBE_MAP_NEGATIVE_Z targets, i.e. the pose's +x, -x, +y,
+	/// -y, +z and -z directions.
+	/// \returns index of first face or -1 if there is not enough room
+	int addCubeFaces(const Pose& pose, double near, double far);
+
+	/// Get number of views
+	int numViews() const { return mViews.size(); }
+
+	/// Get a view frustum
+	const Frustumd& view(int i) const { return mViews[i]; }
+
+
+	/// Compute visibility of all items in all views
+
+	/// @param[in] inflate	amount added to all item radii, e.g. to account
+	///						for vertex displacement in a shader
+	void cull(double inflate=0);
+
+	/// Set whether large lists are culled through a hierarchy (default true)
+	CullList& hierarchical(bool v){ mHierarchical=v; return *this; }
+
+	/// Whether large lists are culled through a hierarchy
+	bool hierarchical() const { return mHierarchical; }
+
+	/// Rebuild the hierarchy on the next cull, e.g. after items were reordered
+	CullList& rebuild(){ mRebuild=true; return *this; }
+
+	/// Get visibility bitmask of an item; bit i is set if visible in view i
+	uint32_t mask(int item) const { return mMasks[item]; }
+
+	/// Whether an item is visible in a view
+	bool visible(int item, int view) const { return (mMasks[item] >> view) & 1; }
+
+	/// Get indices of items visible in a view
+	const std::vector<int>& visibleItems(int view) const { return mVisible[view]; }
+
+
+	/// Get number of item/view pairs found visible by last cull
+	unsigned numVisible() const { return mNumVisible; }
+
+	/// Get number of item/view pairs found not visible by last cull
+	unsigned numCulled() const { return size()*numViews() - mNumVisible; }
+
+	/// Get fraction of item/view pairs culled by last cull
+	double culledRatio() const {
+		unsigned n = size()*numViews();
+		return n ? double(numCulled())/n : 0.;
+	}
+
+private:
+	std::vector<Item> mItems;
+	std::vector<uint32_t> mMasks;
+	std::vector<Frustumd> mViews;
+	std::vector<int> mVisible[MAX_VIEWS];
+	unsigned mNumVisible;
+
+	BVH mTree;
+	std::vector<BVH::Box> mBoxes;
+	std::vector<float> mPlanes;	// per view, 8 each of plane nx, ny, nz and d
+	std::vector<unsigned> mMoved;	// items moved with set() since last cull
+	unsigned mNumMoved;				// items moved with set() since last build
+	unsigned mNumShown;				// items visible in any view in last cull
+	float mTreeCost;
+	bool mHierarchical, mRebuild, mAllMoved, mRefilled;
+
+	void cullLinear(double inflate);
+	void cullTree(double inflate);
+	void updateBox(int i);
+	void updateTree();
+	void updatePlanes();
+};
+
+} // al::
+
+#endif
@@ -44,6 +44,9 @@
 
 #include "allocore/system/al_Time.h"
 #include "allocore/types/al_MsgQueue.hpp"
+#include "allocore/types/al_TimerWheel.hpp"
+#include <functional>
+#include <map>
 #include <vector>
 
 
@@ -59,18 +62,52 @@ public:
 	// interface for handlers:
 	class Handler {
 	public:
+		Handler();
 		virtual ~Handler();
 		virtual void onTick() {}
 		virtual void onExit() {}
+
+		/// Set time budget for onTick, in seconds; 0 means no budget
+
+		/// The first tick that exceeds the budget prints a warning.
+		///
+		Handler& budget(al_sec v){ mBudget=v; return *this; }
+
+		/// Get time budget for onTick, in seconds
+		al_sec budget() const { return mBudget; }
+
+		/// Get time spent in onTick, in seconds, averaged over recent ticks
+		al_sec tickTime() const { return mTickTime; }
+
+		/// Get maximum time spent in onTick, in seconds
+		al_sec tickTimeMax() const { return mTickTimeMax; }
+
+		/// Get number of ticks that exceeded the time budget
+		unsigned overBudget() const { return mOverBudget; }
+
+	private:
+		friend class Main;
+		al_sec mBudget, mTickTime, mTickTimeMax;
+		unsigned mOverBudget;
 	};
 
 	enum Driver {
 		SLEEP = 0,
 		GLUT,
 		NATIVE,
+		EVENT,		/**< Wait for watched descriptors, timers and ticks */
 		NUM_DRIVERS
 	};
 
+	/// Readiness of a watched file descriptor
+	enum IOEvent {
+		READABLE = 1,
+		WRITABLE = 2
+	};
+
+	/// Function called when a watched file descriptor is ready
+	typedef std::function<void(int fd, int events)> IOCallback;
+
 	/// mainloop is a singleton; this is how to access it:
 	static Main& get();
 
@@ -120,6 +157,41 @@ public:
 	Main& add(Main::Handler& v);
 	Main& remove(Main::Handler& v);
 
+
+	/// Call a function when a file descriptor becomes ready
+
+	/// With the EVENT driver, the loop sleeps until a watched descriptor,
+	/// such as a socket, is ready, so it is serviced without polling. With
+	/// other drivers, watched descriptors are checked once per tick.
+	/// Watching a descriptor again replaces its function and events.
+	/// @param[in] fd		file descriptor
+	/// @param[in] func		function to call with descriptor and IOEvent flags
+	/// @param[in] events	IOEvent flags to wait for
+	/// \returns whether the descriptor could be watched
+	bool watch(int fd, const IOCallback& func, int events = READABLE);
+
+	/// Stop watching a file descriptor
+	Main& unwatch(int fd);
+
+
+	/// Call a function after a delay and then optionally periodically
+
+	/// Timers are kept in a timing wheel with millisecond resolution and
+	/// called with the logical time they were due. With the EVENT driver,
+	/// the loop wakes up for each timer; with other drivers, due timers are
+	/// called at the next tick.
+	/// @param[in] delay	time from now, in seconds
+	/// @param[in] func		function to call
+	/// @param[in] period	if greater than 0, repeat with this period
+	/// \returns identifier used to cancel the timer
+	TimerWheel::Id timer(al_sec delay, const TimerWheel::Callback& func, al_sec period = 0);
+
+	/// Cancel a timer
+	bool cancel(TimerWheel::Id id);
+
+	/// Get timers
+	TimerWheel& timers() { return mTimers; }
+
 	// INTERNAL USE:
 
 	/// trigger a mainloop step (typically for implementation use only)
@@ -128,12 +200,21 @@ public:
 	/// calls any registerd Handlers' onExit() methods
 	void exit();
 
+	/// call due timers and scheduled functions, and ready descriptors
+	/// (typically for implementation use only)
+
+	/// @param[in] timeout	maximum time to wait for descriptors, in seconds
+	void dispatch(al_sec timeout = 0);
+
 	// used to switch the driver
 	// typically not called by user code
 	// but e.g. creating a GLUT window will switch to GLUT mode
 	// or creating a Native window will switch to NATIVE mode
 	Main& driver(Driver v);
 
+	/// get current driver
+	Driver driver() const { return mDriver; }
+
 private:
 	// private constructor for singleton pattern
 	Main();
@@ -150,8 +231,19 @@ private:
 	/// functor scheduler attached to the main loop
 	MsgQueue mQueue;
 
+	/// timers attached to the main loop
+	TimerWheel mTimers;
+
 	std::vector<Handler *> mHandlers;
 
+	/// watched file descriptors
+	class Poller;
+	Poller * mPoller;
+	std::map<int, IOCallback> mWatched;
+	std::vector<std::pair<int,int> > mReady;
+
+	void runEvents();
+
 	bool mActive;
 	bool mInited[NUM_DRIVERS];
 
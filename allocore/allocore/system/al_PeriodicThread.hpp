@@ -42,6 +42,8 @@
 	Lance Putnam, 2013, putnam.lance@gmail.com
 */
 
+#include <atomic>
+#include "allocore/math/al_Analysis.hpp"
 #include "allocore/system/al_Thread.hpp"
 #include "allocore/system/al_Time.hpp"
 
@@ -53,10 +55,37 @@ namespace al{
 /// user-supplied thread function. This prevents drift that would occur in a
 /// more simplistic implementation using a fixed sleep interval.
 ///
+/// For tighter timing, the thread can run in real-time mode. It then sleeps
+/// until absolute deadlines spaced exactly one period apart, optionally
+/// busy-waits the last part of each period, and runs under a real-time
+/// scheduling policy.
+///
+/// The thread records the timing of its most recent iterations. These can be
+/// queried at any time from another thread with timing().
+///
 /// @ingroup allocore
 class PeriodicThread : public Thread{
 public:
 
+	/// Real-time scheduling policy
+	enum Policy{
+		FIFO,	/**< Run until blocking or preempted by higher priority */
+		RR		/**< Like FIFO, but round-robin among equal priorities */
+	};
+
+	/// Timing statistics of recent iterations
+	struct Timing{
+		MinMeanMax<double> latency;		///< Start of iteration after its deadline, in seconds
+		MinMeanMax<double> execution;	///< Time spent in thread function, in seconds
+		double latencyP99;				///< 99th percentile of latency, in seconds
+		unsigned samples;				///< Number of iterations analyzed
+		unsigned overruns;				///< Number of analyzed iterations that overran their period
+		unsigned long long totalOverruns;///< Number of overruns since start
+	};
+
+	/// Number of recent iterations kept for timing statistics
+	static const unsigned TIMING_SAMPLES = 1024;
+
 	/// @param[in] periodSec	calling period in seconds
 	PeriodicThread(double periodSec=1);
 
@@ -82,6 +111,47 @@ public:
 	/// Get period, in seconds
 	double period() const;
 
+	/// Set real-time mode
+
+	/// In real-time mode, each iteration is started at an absolute deadline
+	/// spaced one period after the previous one rather than sleeping for a
+	/// relative amount. Deadlines that have already passed are skipped and
+	/// counted as overruns; the autocorrection factor is not used.
+	/// If the priority is greater than 0, the thread switches itself to the
+	/// given real-time scheduling policy when started. This usually requires
+	/// elevated privileges; on failure, a warning is printed and the thread
+	/// runs with normal scheduling. Real-time settings must be made before
+	/// calling start().
+	///
+	/// @param[in] priority		real-time priority in [1, 99] or 0 to keep
+	///							the default scheduling
+	/// @param[in] policy		real-time scheduling policy
+	/// @param[in] lockMemory	whether to lock all pages of the process into
+	///							memory so that page faults cannot stall the
+	///							thread. This affects the whole process and is
+	///							not undone when the thread stops.
+	PeriodicThread& realTime(int priority, Policy policy=FIFO, bool lockMemory=true);
+
+	/// Disable real-time mode
+	PeriodicThread& noRealTime();
+
+	/// Whether real-time mode is set
+	bool realTime() const { return mRealTime; }
+
+	/// Set time, in seconds, to busy-wait before each deadline
+
+	/// In real-time mode, the thread sleeps until this amount of time before
+	/// a deadline, then spins until the deadline. This removes the wake-up
+	/// latency of the operating system at the cost of CPU time. A good value
+	/// is slightly more than the observed maximum latency without spinning.
+	PeriodicThread& spin(double sec);
+
+	/// Get timing statistics of recent iterations
+
+	/// This is lock-free and may be called from any thread while the thread
+	/// is running.
+	Timing timing() const;
+
 	/// Start calling the supplied function periodically
 	void start(ThreadFunction& func);
 
@@ -94,16 +164,37 @@ public:
 	PeriodicThread& operator= (PeriodicThread other);
 
 private:
+	// Ring of packed timing samples written by the thread and read lock-free
+	// by any other thread. Copying copies the most recent samples.
+	struct TimingRing{
+		TimingRing(): mCount(0), mOverruns(0){}
+		TimingRing(const TimingRing& o){ *this = o; }
+		TimingRing& operator= (const TimingRing& o);
+		void clear();
+		void add(al_nsec latency, al_nsec execution, bool overrun);
+		std::atomic<unsigned long long> mSamples[TIMING_SAMPLES];
+		std::atomic<unsigned long long> mCount;
+		std::atomic<unsigned long long> mOverruns;
+	};
+
 	static void * sPeriodicFunc(void * userData);
 	void go();
+	void goRealTime();
+	void sleepUntil(al_nsec deadline);
 
 	al_nsec mPeriod;
 	al_nsec mTimeCurr, mTimePrev;	// time measurements between frames
 	al_nsec mWait;					// actual time to sleep between frames
 	al_nsec mTimeBehind;
+	al_nsec mSpin;					// time to busy-wait before deadlines
 	float mAutocorrect;
+	int mPriority;
+	Policy mPolicy;
 	ThreadFunction * mUserFunc;
-	bool mRun;
+	TimingRing mTiming;
+	std::atomic<bool> mRun;
+	bool mRealTime;
+	bool mLockMemory;
 };
 
 } // al::
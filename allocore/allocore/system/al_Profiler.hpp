@@ -0,0 +1,206 @@
+#ifndef INCLUDE_AL_PROFILER_HPP
+#define INCLUDE_AL_PROFILER_HPP
+
+/*	Allocore --
+	Multimedia / virtual environment application class library
+
+	Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology, UCSB.
+	Copyright (C) 2012. The Regents of the University of California.
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+		Redistributions in binary form must reproduce the above copyright
+		notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+		Neither the name of the University of California nor the names of its
+		contributors may be used to endorse or promote products derived from
+		this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+
+	File description:
+	Lightweight profiling of timed zones across threads
+*/
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include "allocore/math/al_Analysis.hpp"
+#include "allocore/system/al_Time.h"
+
+namespace al{
+
+/// Records timed zones of code on any thread for later analysis
+
+/// Zones are marked with the AL_PROFILE_SCOPE macro, which times the rest of
+/// the enclosing scope:
+/// \code
+///		void render(){
+///			AL_PROFILE_SCOPE("render");
+///			...
+///		}
+/// \endcode
+/// Each thread writes its zones into its own ring buffer, without locking or
+/// allocating, so zones can be placed in audio callbacks. Buffers for the
+/// first PREALLOCATED_THREADS threads are allocated by enable(); later
+/// threads allocate theirs when first recording. Only the most recent
+/// EVENTS_PER_THREAD zones of each thread are kept.
+///
+/// Buffers of threads that have exited are reused by new threads, so up to
+/// MAX_THREADS threads can record at the same time. The zones of an exited
+/// thread are kept, under the same thread index as those of the thread
+/// reusing its buffer.
+///
+/// While disabled, which is the default, a zone costs a single relaxed
+/// atomic load. Defining AL_PROFILE_DISABLE removes zones at compile time.
+///
+/// The recorded zones can be written as a Chrome trace, to be viewed in
+/// chrome://tracing or Perfetto, or summarized per zone.
+///
+/// @ingroup allocore
+class Profiler{
+public:
+
+	enum{
+		MAX_THREADS = 64,			///< Maximum number of threads recording at once
+		PREALLOCATED_THREADS = 8,	///< Number of buffers allocated when enabled
+		EVENTS_PER_THREAD = 8192	///< Number of recent zones kept per thread
+	};
+
+	/// A timed zone
+	struct Event{
+		const char * name;	///< Name of zone
+		al_nsec start;		///< Start time, from al_steady_time_nsec
+		al_nsec end;		///< End time, from al_steady_time_nsec
+		int thread;			///< Index of thread
+	};
+
+	/// Statistics of one zone
+	struct ZoneStats{
+		std::string name;			///< Name of zone
+		unsigned count;				///< Number of times recorded
+		MinMeanMax<double> time;	///< Duration, in seconds
+		double p99;					///< 99th percentile of duration, in seconds
+		double total;				///< Total duration, in seconds
+	};
+
+
+	/// Set whether zones are recorded
+	static void enable(bool v=true);
+
+	/// Whether zones are recorded
+	static bool enabled(){ return sEnabled.load(std::memory_order_relaxed); }
+
+	/// Set name of calling thread, as shown in traces
+	static void threadName(const std::string& name);
+
+	/// Record a zone on the calling thread
+	static void record(const char * name, al_nsec start, al_nsec end);
+
+	/// Remove all recorded zones
+	static void clear();
+
+
+	/// Get recorded zones of all threads, ordered by start time
+	static void events(std::vector<Event>& events);
+
+	/// Get statistics of recorded zones, ordered by name
+	static void summary(std::vector<ZoneStats>& stats);
+
+	/// Write recorded zones as a Chrome trace (JSON)
+
+	/// \returns whether the file was written
+	static bool writeChromeTrace(const std::string& path);
+
+	/// Get recorded zones as a Chrome trace (JSON)
+	static std::string chromeTrace();
+
+	/// Send statistics of zones as OSC messages
+
+	/// One message is sent per zone with arguments name (string), count
+	/// (int), and minimum, mean, maximum and 99th percentile durations in
+	/// milliseconds (float).
+	/// @param[in] send		an osc::Send or any object with the same send
+	///						method
+	/// @param[in] addr		OSC address of messages
+	/// \returns number of messages sent
+	template <class OSCSend>
+	static int sendSummary(OSCSend& send, const std::string& addr = "/profile");
+
+private:
+	static std::atomic<bool> sEnabled;
+};
+
+
+/// Times the scope it is declared in, if the Profiler is enabled
+class ProfileScope{
+public:
+	ProfileScope(const char * name)
+	:	mName(Profiler::enabled() ? name : 0)
+	{
+		if(mName) mStart = al_steady_time_nsec();
+	}
+
+	~ProfileScope(){
+		if(mName) Profiler::record(mName, mStart, al_steady_time_nsec());
+	}
+
+private:
+	const char * mName;
+	al_nsec mStart;
+	ProfileScope(const ProfileScope&);
+	ProfileScope& operator= (const ProfileScope&);
+};
+
+
+#define AL_PROFILE_CONCAT_(a,b) a##b
+#define AL_PROFILE_CONCAT(a,b) AL_PROFILE_CONCAT_(a,b)
+
+/// Time the rest of the enclosing scope as a zone with the given name
+
+/// The name must be a string that outlives the Profiler's records, such as
+/// a string literal.
+#ifdef AL_PROFILE_DISABLE
+	#define AL_PROFILE_SCOPE(name)
+#else
+	#define AL_PROFILE_SCOPE(name)\
+		::al::ProfileScope AL_PROFILE_CONCAT(alProfileScope, __LINE__)(name)
+#endif
+
+
+
+// Implementation --------------------------------------------------------------
+
+template <class OSCSend>
+int Profiler::sendSummary(OSCSend& send, const std::string& addr){
+	std::vector<ZoneStats> stats;
+	summary(stats);
+	for(unsigned i=0; i<stats.size(); ++i){
+		const ZoneStats& z = stats[i];
+		send.send(addr, z.name, int(z.count),
+			float(z.time.min()*1e3), float(z.time.mean()*1e3),
+			float(z.time.max()*1e3), float(z.p99*1e3)
+		);
+	}
+	return stats.size();
+}
+
+} // al::
+
+#endif
@@ -0,0 +1,309 @@
+#ifndef INCLUDE_AL_RT_MEMORY_HPP
+#define INCLUDE_AL_RT_MEMORY_HPP
+
+/*	Allocore --
+	Multimedia / virtual environment application class library
+
+	Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology, UCSB.
+	Copyright (C) 2012. The Regents of the University of California.
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+		Redistributions in binary form must reproduce the above copyright
+		notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+		Neither the name of the University of California nor the names of its
+		contributors may be used to endorse or promote products derived from
+		this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+
+	File description:
+	Memory allocation that is safe on real-time threads
+*/
+
+#include <atomic>
+#include <new>
+#include <stddef.h>
+#include <utility>
+#include "allocore/types/al_LockFreeQueue.hpp"
+
+namespace al{
+
+/// Lock-free pool of fixed-size memory blocks
+
+/// All blocks are allocated up front, so that any thread can take and return
+/// blocks without locking or reaching the heap. This is meant for messages
+/// and events passed to and from an audio thread.
+///
+/// @ingroup allocore
+class MemoryPool{
+public:
+
+	/// @param[in] blockSize	bytes of each block; rounded up to a multiple of 16
+	/// @param[in] numBlocks	number of blocks
+	MemoryPool(size_t blockSize=0, uint32_t numBlocks=0);
+
+	~MemoryPool();
+
+
+	/// Set size and number of blocks
+
+	/// This is not thread-safe and must be called while no blocks are in use.
+	///
+	void resize(size_t blockSize, uint32_t numBlocks);
+
+	/// Get size of each block in bytes
+	size_t blockSize() const { return mBlockSize; }
+
+	/// Get number of blocks
+	uint32_t numBlocks() const { return mNumBlocks; }
+
+	/// Get number of free blocks; only a snapshot when used concurrently
+	uint32_t available() const { return mFree.size(); }
+
+	/// Whether a pointer is to a block of this pool
+	bool owns(const void * p) const {
+		return p >= mMem && p < mMem + mBlockSize*mNumBlocks;
+	}
+
+
+	/// Take a block
+
+	/// \returns a block of blockSize() bytes or NULL if none are free
+	///
+	void * alloc();
+
+	/// Return a block taken with alloc()
+	void free(void * block);
+
+	/// Take a block and construct an object in it
+
+	/// \returns the object or NULL if the object does not fit or no blocks
+	/// are free
+	template <class T, class... Args>
+	T * construct(Args&&... args){
+		if(sizeof(T) > mBlockSize) return 0;
+		void * p = alloc();
+		return p ? new (p) T(std::forward<Args>(args)...) : 0;
+	}
+
+	/// Destroy an object made with construct() and return its block
+	template <class T>
+	void destroy(T * p){
+		if(p){
+			p->~T();
+			free(p);
+		}
+	}
+
+private:
+	char * mMem;
+	size_t mBlockSize;
+	uint32_t mNumBlocks;
+	LockFreeQueue<void *> mFree;
+
+	MemoryPool(const MemoryPool&);
+	MemoryPool& operator=(const MemoryPool&);
+};
+
+
+
+/// Linear memory arena for scratch memory with a short lifetime
+
+/// Allocation bumps an offset into a buffer allocated up front, so it never
+/// reaches the heap, and is lock-free so several threads can allocate at
+/// once. Memory is not freed item by item; reset() frees everything at once,
+/// e.g. at the start of each audio block.
+///
+/// @ingroup allocore
+class LinearArena{
+public:
+
+	/// @param[in] capacity		size in bytes
+	LinearArena(size_t capacity=0);
+
+	~LinearArena();
+
+
+	/// Set size in bytes and free all memory
+
+	/// This is not thread-safe.
+	///
+	void resize(size_t capacity);
+
+	/// Get size in bytes
+	size_t capacity() const { return mCapacity; }
+
+	/// Get number of bytes allocated since the last reset
+	size_t used() const;
+
+	/// Get most bytes allocated, or requested, between resets
+	size_t peak() const;
+
+
+	/// Allocate memory
+
+	/// This is thread-safe and lock-free.
+	/// @param[in] size		number of bytes
+	/// @param[in] align	alignment in bytes; must be a power of two
+	/// \returns the memory or NULL if there was not enough left
+	void * alloc(size_t size, size_t align=16);
+
+	/// Allocate memory for an array of elements, without constructing them
+	template <class T>
+	T * alloc(size_t n){
+		return static_cast<T *>(alloc(n*sizeof(T), alignof(T) > 16 ? alignof(T) : 16));
+	}
+
+	/// Free all memory
+
+	/// This must not be called while other threads allocate.
+	///
+	void reset();
+
+
+	/// Get arena made current on the calling thread by a Scope, or NULL
+	static LinearArena * current();
+
+	/// Makes an arena current on the calling thread for its lifetime
+	class Scope{
+	public:
+		Scope(LinearArena& a);
+		~Scope();
+	private:
+		LinearArena * mPrev;
+	};
+
+private:
+	char * mMem;
+	size_t mCapacity;
+	std::atomic<size_t> mUsed;
+	size_t mPeak;
+
+	LinearArena(const LinearArena&);
+	LinearArena& operator=(const LinearArena&);
+};
+
+
+
+/// STL allocator that allocates from a LinearArena
+
+/// A default constructed allocator uses the current arena of the thread
+/// constructing it, or the heap if there is none. This lets containers with
+/// an allocator parameter, such as Buffer and RingBuffer, be used for scratch
+/// memory on an audio thread. Deallocation from an arena does nothing.
+/// Allocation throws std::bad_alloc when the arena is full.
+///
+/// @ingroup allocore
+template <class T>
+class ArenaAllocator{
+public:
+	typedef T value_type;
+	typedef T * pointer;
+	typedef const T * const_pointer;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+
+	template <class U>
+	struct rebind{ typedef ArenaAllocator<U> other; };
+
+	ArenaAllocator(): mArena(LinearArena::current()){}
+
+	ArenaAllocator(LinearArena& a): mArena(&a){}
+
+	template <class U>
+	ArenaAllocator(const ArenaAllocator<U>& other): mArena(other.arena()){}
+
+	/// Get arena allocated from; NULL if the heap
+	LinearArena * arena() const { return mArena; }
+
+	T * allocate(size_t n){
+		if(!mArena) return static_cast<T *>(::operator new(n*sizeof(T)));
+		T * p = mArena->alloc<T>(n);
+		if(!p) throw std::bad_alloc();
+		return p;
+	}
+
+	void deallocate(T * p, size_t){
+		if(!mArena) ::operator delete(p);
+	}
+
+	template <class U, class... Args>
+	void construct(U * p, Args&&... args){
+		::new((void *)p) U(std::forward<Args>(args)...);
+	}
+
+	template <class U>
+	void destroy(U * p){ p->~U(); }
+
+	size_t max_size() const { return size_t(-1) / sizeof(T); }
+
+private:
+	LinearArena * mArena;
+};
+
+template <class T, class U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b){
+	return a.arena() == b.arena();
+}
+
+template <class T, class U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b){
+	return !(a == b);
+}
+
+
+
+/// Detection of heap use on real-time threads
+
+/// Threads are marked as real-time with a Scope; AudioIO does so while it
+/// runs its callbacks. When allocore is built with AL_RT_HEAP_CHECK defined,
+/// global operator new and delete assert that the calling thread is not
+/// real-time, so that any allocation on the audio path is caught in testing.
+/// Calls to malloc and free are not checked.
+///
+/// @ingroup allocore
+class RTHeapCheck{
+public:
+
+	/// Whether heap use is checked, i.e., built with AL_RT_HEAP_CHECK
+	static bool enabled();
+
+	/// Whether the calling thread is marked as real-time
+	static bool realtime();
+
+	/// Marks the calling thread as real-time, or not, for its lifetime
+
+	/// Construct with false around code on a real-time thread that may
+	/// knowingly use the heap, such as error reporting.
+	class Scope{
+	public:
+		Scope(bool realtime=true);
+		~Scope();
+	private:
+		bool mPrev;
+	};
+};
+
+} // al::
+
+#endif
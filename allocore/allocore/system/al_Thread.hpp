@@ -106,6 +106,13 @@ public:
 	///					makes the thread "real-time".
 	Thread& priority(int v);
 
+	/// Set processor core the thread will run on
+
+	/// This must be called before the thread is started.
+	/// @param[in] core	index of processor core or -1 to run on any core.
+	///					This is ignored on platforms without affinity control.
+	Thread& affinity(int core);
+
 
 	/// Start executing thread function
 	bool start(ThreadFunction& func);
@@ -0,0 +1,255 @@
+#ifndef INCLUDE_AL_THREAD_POOL_HPP
+#define INCLUDE_AL_THREAD_POOL_HPP
+
+/*	Allocore --
+	Multimedia / virtual environment application class library
+
+	Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology, UCSB.
+	Copyright (C) 2012. The Regents of the University of California.
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+		Redistributions in binary form must reproduce the above copyright
+		notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+		Neither the name of the University of California nor the names of its
+		contributors may be used to endorse or promote products derived from
+		this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+
+	File description:
+	Persistent work-stealing thread pool and parallel loops
+*/
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+#include "allocore/system/al_Thread.hpp"
+#include "allocore/system/pstdint.h"
+
+namespace al{
+
+class TaskGroup;
+
+
+/// Persistent pool of worker threads with work-stealing scheduling
+
+/// Worker threads are created once and sleep when there is no work, so
+/// scheduling parallel work costs no thread creation. Each worker has its own
+/// deque of tasks. It pushes and pops tasks at one end, and idle workers steal
+/// from the other end of other workers' deques. Threads that are not workers
+/// submit tasks to a shared deque. While they wait for their tasks, they help
+/// by running pending tasks instead of blocking.
+///
+/// Tasks are small, fixed-size records, so scheduling does not allocate
+/// memory. If a deque is full, the task is run immediately by the submitting
+/// thread.
+///
+/// @ingroup allocore
+class ThreadPool{
+public:
+
+	/// Scheduled unit of work
+
+	/// A task calls its function on the index range [begin, end). Ranges
+	/// larger than the grain size are split in half before running, and one
+	/// half is pushed back so that other threads can steal it.
+	struct Task{
+		void (*func)(void * context, int64_t begin, int64_t end);
+		void * context;
+		int64_t begin, end, grain;
+		TaskGroup * group;
+	};
+
+
+	/// @param[in] numThreads	number of worker threads; if negative, one less
+	///							than the number of hardware threads (at least 1)
+	/// @param[in] pinThreads	whether to run each worker on its own core
+	/// @param[in] priority		priority of workers in [0, 99]. A value greater
+	///							than 0 makes the workers "real-time".
+	ThreadPool(int numThreads=-1, bool pinThreads=false, int priority=0);
+
+	/// Stops and joins all workers; pending tasks are not run
+	~ThreadPool();
+
+
+	/// Get number of worker threads
+	int size() const { return mWorkers.size(); }
+
+	/// Get index of worker calling this, or -1 if not a worker of this pool
+	int workerIndex() const;
+
+
+	/// Call fn(i) for each index i in [begin, end) in parallel
+
+	/// The calling thread takes part and returns once all indices have been
+	/// processed.
+	/// @param[in] begin	first index
+	/// @param[in] end		one past last index
+	/// @param[in] grain	maximum number of indices processed by one task
+	/// @param[in] fn		function object taking an int64_t index
+	template <class Func>
+	void parallelFor(int64_t begin, int64_t end, int64_t grain, Func&& fn);
+
+	/// Call fn(b, e) over sub-ranges [b, e) of [begin, end) in parallel
+
+	/// This is like parallelFor, but lets the function process a contiguous
+	/// sub-range of up to grain indices at once.
+	template <class Func>
+	void parallelForRange(int64_t begin, int64_t end, int64_t grain, Func&& fn);
+
+
+	/// Schedule a task
+	void submit(const Task& t);
+
+	/// Run one pending task on the calling thread
+
+	/// \returns whether a task was run
+	///
+	bool runPending();
+
+
+	/// Get a pool shared by the whole application
+
+	/// The pool has default settings and is created on first use.
+	///
+	static ThreadPool& global();
+
+private:
+	struct Deque;
+	struct Worker;
+
+	std::vector<Deque *> mDeques;	// one per worker plus one shared
+	std::vector<Worker *> mWorkers;
+	std::atomic<int> mQueued;		// number of tasks in all deques
+	std::atomic<int> mSleepers;		// number of sleeping workers
+	std::atomic<bool> mRunning;
+	std::mutex mSleepMutex;
+	std::condition_variable mWake;
+
+	bool push(const Task& t);
+	bool pop(Task& t);
+	void execute(Task t);
+	void workerLoop(int index);
+
+	ThreadPool(const ThreadPool&);
+	ThreadPool& operator=(const ThreadPool&);
+};
+
+
+
+/// Group of tasks that can be waited on together
+
+/// Function objects passed to run() are scheduled on the pool. They must
+/// remain valid until wait() returns.
+///
+/// @ingroup allocore
+class TaskGroup{
+public:
+
+	/// @param[in] pool		pool on which to schedule tasks
+	TaskGroup(ThreadPool& pool = ThreadPool::global());
+
+	/// Waits for all tasks
+	~TaskGroup(){ wait(); }
+
+
+	/// Schedule a function object taking no arguments
+	template <class Func>
+	void run(Func& fn);
+
+	/// Schedule fn(b, e) over sub-ranges of [begin, end) of up to grain indices
+	template <class Func>
+	void runRange(int64_t begin, int64_t end, int64_t grain, Func& fn);
+
+	/// Wait for all tasks to complete
+
+	/// The calling thread runs pending tasks of the pool while waiting
+	/// instead of sleeping. This is not strictly real-time safe: the deques
+	/// are guarded by short spin locks, so a real-time thread can spin while
+	/// a preempted lower-priority thread holds one, and the tasks it helps
+	/// with may belong to other groups and take any amount of time. On an
+	/// audio thread, only wait on groups that should already be done, and
+	/// use a pool that runs nothing else.
+	void wait();
+
+	/// Whether all tasks have completed
+	bool done() const { return mPending.load(std::memory_order_acquire) == 0; }
+
+	/// Get pool tasks are scheduled on
+	ThreadPool& pool(){ return mPool; }
+
+private:
+	friend class ThreadPool;
+	ThreadPool& mPool;
+	std::atomic<int> mPending;
+
+	void schedule(void (*func)(void *, int64_t, int64_t), void * context,
+		int64_t begin, int64_t end, int64_t grain);
+
+	TaskGroup(const TaskGroup&);
+	TaskGroup& operator=(const TaskGroup&);
+};
+
+
+
+
+// Implementation --------------------------------------------------------------
+
+template <class Func>
+void TaskGroup::run(Func& fn){
+	struct Call{
+		static void func(void * c, int64_t, int64_t){ (*(Func *)c)(); }
+	};
+	schedule(&Call::func, (void *)&fn, 0, 1, 1);
+}
+
+template <class Func>
+void TaskGroup::runRange(int64_t begin, int64_t end, int64_t grain, Func& fn){
+	struct Call{
+		static void func(void * c, int64_t b, int64_t e){ (*(Func *)c)(b, e); }
+	};
+	if(begin < end) schedule(&Call::func, (void *)&fn, begin, end, grain);
+}
+
+template <class Func>
+void ThreadPool::parallelForRange(int64_t begin, int64_t end, int64_t grain, Func&& fn){
+	TaskGroup group(*this);
+	group.runRange(begin, end, grain, fn);
+	group.wait();
+}
+
+template <class Func>
+void ThreadPool::parallelFor(int64_t begin, int64_t end, int64_t grain, Func&& fn){
+	typedef typename std::remove_reference<Func>::type F;
+	struct Each{
+		Each(F& f): fn(f){}
+		void operator()(int64_t b, int64_t e) const { for(int64_t i=b; i<e; ++i) fn(i); }
+		F& fn;
+	};
+	Each each(fn);
+	parallelForRange(begin, end, grain, each);
+}
+
+} // al::
+
+#endif
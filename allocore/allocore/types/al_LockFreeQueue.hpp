@@ -0,0 +1,187 @@
+#ifndef INCLUDE_AL_LOCKFREEQUEUE_HPP
+#define INCLUDE_AL_LOCKFREEQUEUE_HPP
+
+/*	Allocore --
+	Multimedia / virtual environment application class library
+
+	Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology, UCSB.
+	Copyright (C) 2012. The Regents of the University of California.
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+		Redistributions in binary form must reproduce the above copyright
+		notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+		Neither the name of the University of California nor the names of its
+		contributors may be used to endorse or promote products derived from
+		this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+
+	File description:
+	Bounded lock-free queue for passing messages between threads
+*/
+
+#include <atomic>
+#include "allocore/system/pstdint.h"
+
+namespace al {
+
+/// Bounded, lock-free multi-producer multi-consumer queue
+
+/// Any number of threads can push and pop concurrently without locking or
+/// allocating memory, which makes this suitable for posting messages to and
+/// from an audio thread. Each slot carries a sequence number telling whether
+/// it is ready to be written or read, so producers and consumers only
+/// contend on their own index.
+///
+/// The element type must be default constructible and copy assignable.
+///
+/// @ingroup allocore
+template <class T>
+class LockFreeQueue {
+public:
+
+	/// @param[in] capacity		maximum number of elements; rounded up to the
+	///							next power of two
+	LockFreeQueue(uint32_t capacity=256);
+
+	~LockFreeQueue(){ delete[] mCells; }
+
+
+	/// Set maximum number of elements and discard all elements
+
+	/// This is not thread-safe.
+	///
+	void resize(uint32_t capacity);
+
+	/// Get maximum number of elements
+	uint32_t capacity() const { return mMask+1; }
+
+
+	/// Add an element to the back of the queue
+
+	/// \returns false if the queue was full
+	///
+	bool push(const T& v);
+
+	/// Remove an element from the front of the queue
+
+	/// \returns false if the queue was empty
+	///
+	bool pop(T& v);
+
+	/// Get number of elements; only a snapshot when used concurrently
+	uint32_t size() const {
+		return uint32_t(mTail.load(std::memory_order_acquire) - mHead.load(std::memory_order_acquire));
+	}
+
+	/// Whether the queue is empty; only a snapshot when used concurrently
+	bool empty() const { return size() == 0; }
+
+private:
+	struct Cell{
+		std::atomic<size_t> seq;
+		T value;
+	};
+
+	Cell * mCells;
+	size_t mMask;
+	char mPad0[64];
+	std::atomic<size_t> mHead;	// next position to read
+	char mPad1[64];
+	std::atomic<size_t> mTail;	// next position to write
+	char mPad2[64];
+
+	LockFreeQueue(const LockFreeQueue&);
+	LockFreeQueue& operator=(const LockFreeQueue&);
+};
+
+
+
+// Implementation -------------------------------------------------------------
+
+template <class T>
+LockFreeQueue<T>::LockFreeQueue(uint32_t capacity)
+:	mCells(0), mMask(0), mHead(0), mTail(0)
+{
+	resize(capacity);
+}
+
+template <class T>
+void LockFreeQueue<T>::resize(uint32_t capacity){
+	uint32_t n = 2;
+	while(n < capacity) n <<= 1;
+	delete[] mCells;
+	mCells = new Cell[n];
+	mMask = n-1;
+	for(size_t i=0; i<n; ++i) mCells[i].seq.store(i, std::memory_order_relaxed);
+	mHead.store(0, std::memory_order_relaxed);
+	mTail.store(0, std::memory_order_release);
+}
+
+template <class T>
+bool LockFreeQueue<T>::push(const T& v){
+	Cell * cell;
+	size_t pos = mTail.load(std::memory_order_relaxed);
+	for(;;){
+		cell = &mCells[pos & mMask];
+		size_t seq = cell->seq.load(std::memory_order_acquire);
+		intptr_t dif = intptr_t(seq) - intptr_t(pos);
+		if(0 == dif){
+			if(mTail.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed)) break;
+		}
+		else if(dif < 0){
+			return false;
+		}
+		else{
+			pos = mTail.load(std::memory_order_relaxed);
+		}
+	}
+	cell->value = v;
+	cell->seq.store(pos+1, std::memory_order_release);
+	return true;
+}
+
+template <class T>
+bool LockFreeQueue<T>::pop(T& v){
+	Cell * cell;
+	size_t pos = mHead.load(std::memory_order_relaxed);
+	for(;;){
+		cell = &mCells[pos & mMask];
+		size_t seq = cell->seq.load(std::memory_order_acquire);
+		intptr_t dif = intptr_t(seq) - intptr_t(pos+1);
+		if(0 == dif){
+			if(mHead.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed)) break;
+		}
+		else if(dif < 0){
+			return false;
+		}
+		else{
+			pos = mHead.load(std::memory_order_relaxed);
+		}
+	}
+	v = cell->value;
+	cell->seq.store(pos+mMask+1, std::memory_order_release);
+	return true;
+}
+
+} // al::
+
+#endif
@@ -75,6 +75,9 @@ public:
 	// how many messages are scheduled?
 	int len() const { return mLen; }
 
+	// time of the next scheduled message, or a very large value if none
+	al_sec nextTime() const;
+
 	// template wrappers for multi-argument functions
 	// be sure to cast the send arguments to exactly match the function argument types!
 	void send(al_sec at, void (*f)(al_sec t)) {
@@ -42,13 +42,18 @@
 	Graham Wakefield, 2010, grrrwaaa@gmail.com
 */
 
+#include "allocore/system/al_Printing.hpp"
+#include "allocore/system/al_RTMemory.hpp"
 #include "allocore/system/al_Time.h"
+#include "allocore/types/al_LockFreeQueue.hpp"
 #include "allocore/types/al_SingleRWRingBuffer.hpp"
 #include <string.h>
-#include <queue>
 #include <cstring>
+#include <queue>
 
 #define AL_MSGTUBE_DEFAULT_SIZE_BITS (14) // 16384 bytes
+#define AL_MSGTUBE_CACHE_SIZE (256)       // messages cached without the heap
+#define AL_MSGTUBE_CACHE_BLOCK_SIZE (256) // bytes of each pooled message
 
 /*
 	A C++ class for deferred function calls
@@ -92,15 +97,34 @@ public:
 
 	/*
 		Cache of messages, when the ringbuffer is full
-		TODO: set a cache limit? track when flushing fails for a prolonged period?
+		Up to cacheSize messages are copied into blocks of a pool, so that a
+		sender on an audio thread does not reach the heap; messages larger
+		than a block are copied onto the heap. Once cacheSize messages are
+		cached, further messages go to an unbounded heap queue. A real-time
+		sender (see RTHeapCheck) never reaches the heap: messages that would
+		are dropped and counted in numDropped().
 	*/
-	std::queue<char *> cacheq;
+	LockFreeQueue<char *> cacheq;
+	char * cacheFront;	// oldest cached message, taken from cacheq
+	MemoryPool cachePool;
+	std::queue<char *> overflowq;	// messages past the cache, in order
+	size_t dropped;
 
-	MsgTube(int bits = AL_MSGTUBE_DEFAULT_SIZE_BITS);
+	/*
+		bits: log2 of the ringbuffer size in bytes
+		cacheSize: messages cached without the heap when the ringbuffer is full
+	*/
+	MsgTube(int bits = AL_MSGTUBE_DEFAULT_SIZE_BITS, int cacheSize = AL_MSGTUBE_CACHE_SIZE);
 	~MsgTube();
 
 	void executeUntil(al_sec until);
 
+	/*
+		Number of messages of real-time senders dropped because the cache
+		was full or they were larger than a block
+	*/
+	size_t numDropped() const { return dropped; }
+
 	/*
 		Copies 'data', so you can safely free it after this call
 	*/
@@ -212,23 +236,59 @@ public:
 protected:
 
 	void cache(const void * src, size_t size) {
+		if (overflowq.empty()) {
+			char * mem = NULL;
+			if (size <= cachePool.blockSize()) {
+				mem = (char *)cachePool.alloc();
+			} else if (!RTHeapCheck::realtime()) {
+				mem = new char[size];
+			}
+			if (mem) {
+				memcpy(mem, src, size);
+				if (cacheq.push(mem)) return;
+				uncache(mem);
+			}
+		}
+		// keep order behind the overflow queue; only off real-time threads
+		if (RTHeapCheck::realtime()) {
+			AL_WARN_ONCE("MsgTube cache full or message too large, dropping messages");
+			++dropped;
+			return;
+		}
 		char * mem = new char[size];
 		memcpy(mem, src, size);
-		cacheq.push(mem);
+		overflowq.push(mem);
+	}
+
+	void uncache(char * data) {
+		if (cachePool.owns(data)) {
+			cachePool.free(data);
+		} else {
+			delete[] data;
+		}
 	}
 
 	bool flushCache() {
-		while (!cacheq.empty()) {
-			char * data = cacheq.front();
-			size_t size = *((size_t *)data);
+		while (cacheFront || cacheq.pop(cacheFront)) {
+			size_t size = *((size_t *)cacheFront);
 			if (size >= rb.writeSpace()) {
 				return false;
 			}
 
 			// send cached message:
+			rb.write(cacheFront, size);
+			uncache(cacheFront);
+			cacheFront = 0;
+		}
+		while (!overflowq.empty()) {
+			char * data = overflowq.front();
+			size_t size = *((size_t *)data);
+			if (size >= rb.writeSpace()) {
+				return false;
+			}
 			rb.write(data, size);
 			delete[] data;
-			cacheq.pop();
+			overflowq.pop();
 		}
 		return true;
 	}
@@ -242,9 +302,7 @@ protected:
 			rb.write(data, size);
 		} else {
 			//printf("cached message\n");
-			char * cpy = new char[size];
-			memcpy(cpy, data, size);
-			cache(cpy, size);
+			cache(data, size);
 		}
 	}
 };
@@ -254,16 +312,26 @@ protected:
 */
 #pragma mark Inline Implementation
 
-inline MsgTube :: MsgTube(int bits)
+inline MsgTube :: MsgTube(int bits, int cacheSize)
 :	now(0),
 	memsize(1<<bits),
-	rb(memsize)
+	rb(memsize),
+	cacheq(cacheSize),
+	cacheFront(0),
+	cachePool(AL_MSGTUBE_CACHE_BLOCK_SIZE, cacheSize),
+	dropped(0)
 {
 	//printf("created buffer of %d size\n", memsize);
 }
 
 inline MsgTube :: ~MsgTube() {
-	// TODO: empty the cache
+	if (cacheFront) uncache(cacheFront);
+	char * data;
+	while (cacheq.pop(data)) uncache(data);
+	while (!overflowq.empty()) {
+		delete[] overflowq.front();
+		overflowq.pop();
+	}
 }
 
 inline void MsgTube :: executeUntil(al_sec until) {
@@ -0,0 +1,156 @@
+#ifndef INCLUDE_AL_TIMER_WHEEL_HPP
+#define INCLUDE_AL_TIMER_WHEEL_HPP
+
+/*	Allocore --
+	Multimedia / virtual environment application class library
+
+	Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology, UCSB.
+	Copyright (C) 2012. The Regents of the University of California.
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+		Redistributions in binary form must reproduce the above copyright
+		notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+		Neither the name of the University of California nor the names of its
+		contributors may be used to endorse or promote products derived from
+		this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+
+	File description:
+	Hierarchical timing wheel of scheduled function calls
+*/
+
+#include <functional>
+#include <vector>
+#include "allocore/system/al_Time.h"
+#include "allocore/system/pstdint.h"
+
+namespace al {
+
+/// Hierarchical timing wheel of scheduled function calls
+
+/// Time is divided into ticks of a fixed resolution. Timers due within the
+/// next 64 ticks are kept in one slot per tick. Timers due later are kept in
+/// coarser wheels whose slots span 64, 64^2 and 64^3 ticks, and are moved
+/// into finer wheels as their time approaches. Adding and removing a timer
+/// takes constant time regardless of the number of timers, and advancing
+/// only visits timers that are due or need to be moved.
+///
+/// Timers are called in order of their tick. The order of timers due within
+/// the same tick is unspecified.
+///
+/// @ingroup allocore
+class TimerWheel {
+public:
+
+	/// Timer identifier; 0 is never a valid identifier
+	typedef uint64_t Id;
+
+	/// Timer function, called with the time the timer was due
+	typedef std::function<void(al_sec t)> Callback;
+
+
+	/// @param[in] resolution	duration of one tick, in seconds
+	TimerWheel(al_sec resolution = 0.001);
+
+
+	/// Get duration of one tick, in seconds
+	al_sec resolution() const { return mResolution; }
+
+	/// Get time up to which the wheel has advanced, in seconds
+	al_sec now() const { return mTick * mResolution; }
+
+	/// Get number of scheduled timers
+	unsigned size() const { return mCount; }
+
+	/// Whether there are no scheduled timers
+	bool empty() const { return 0 == mCount; }
+
+
+	/// Schedule a timer
+
+	/// @param[in] at		time to call function, in seconds. Past times are
+	///						called on the next advance.
+	/// @param[in] func		function to call
+	/// @param[in] period	if greater than 0, the timer repeats with this
+	///						period until removed
+	/// \returns identifier of timer
+	Id add(al_sec at, const Callback& func, al_sec period = 0);
+
+	/// Remove a timer
+
+	/// A timer may remove itself or others from within its function.
+	/// \returns whether the timer was scheduled
+	bool remove(Id id);
+
+	/// Remove all timers
+	void clear();
+
+
+	/// Call all timers due up to and including a time
+	void advance(al_sec until);
+
+	/// Get earliest time at which a timer may be due
+
+	/// This is exact for timers due within the next 64 ticks and otherwise a
+	/// lower bound, so it is suitable for choosing how long to sleep.
+	/// \returns next due time or a very large value if there are no timers
+	al_sec nextDue() const;
+
+private:
+	enum{
+		SLOT_BITS = 6,
+		SLOTS = 1 << SLOT_BITS,
+		LEVELS = 4,
+		OVERFLOW_LIST = LEVELS * SLOTS,	// timers beyond the coarsest wheel
+		FIRING_LIST,					// timers being called
+		NUM_LISTS
+	};
+
+	struct Timer{
+		Callback func;
+		uint64_t due;		// tick
+		uint64_t period;	// ticks
+		uint32_t gen;		// incremented when freed
+		int prev, next;		// links in list
+		int list;			// list index or -1 if free
+	};
+
+	std::vector<Timer> mTimers;
+	int mLists[NUM_LISTS];	// head of each list or -1
+	int mTails[NUM_LISTS];	// tail of each list or -1
+	int mFree;				// head of free list
+	unsigned mCount;
+	uint64_t mTick;			// next tick to process
+	uint64_t mLevel0;		// bit set for each non-empty slot of finest wheel
+	al_sec mResolution;
+
+	void link(int i, int list);
+	void unlink(int i);
+	void insert(int i);
+	void cascade(int level);
+	void release(int i);
+	Id makeId(int i) const { return (uint64_t(mTimers[i].gen) << 32) | uint32_t(i+1); }
+};
+
+} // al::
+
+#endif
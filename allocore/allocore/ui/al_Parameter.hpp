@@ -46,11 +46,14 @@
 #include <atomic>
 #include <iostream>
 #include "allocore/protocol/al_OSC.hpp"
+#include "allocore/system/al_Time.h"
+#include "allocore/types/al_LockFreeQueue.hpp"
 
 namespace al
 {
 
 class Parameter;
+class ParameterReader;
 
 
 template<typename DataType = float>
@@ -351,12 +354,136 @@ public:
 	 */
 	virtual float get() override;
 
+	/**
+	 * @brief set the parameter's value and ramp its readers to it
+	 *
+	 * This function is thread-safe and can be called from any number of threads.
+	 * The value is set as with set(), but each ParameterReader of the
+	 * parameter ramps to it over the given time instead of its smoothing time.
+	 *
+	 * @param value The new value
+	 * @param seconds Duration of the ramp
+	 */
+	void rampTo(float value, float seconds);
+
 	const float operator= (const float value) { this->set(value); return value; }
 
 private:
+	friend class ParameterReader;
+
+	void notifyReaders(float value, float rampTime);
+
 	float mFloatValue;
+	std::vector<ParameterReader *> mReaders;
+	std::mutex mReadersLock;
 };
 
+
+/**
+ * @brief The ParameterReader class reads a Parameter in an audio callback
+ *
+ * Each change of the parameter is queued lock-free, with the time it was
+ * set, and rendered into blocks of values that ramp from the previous value,
+ * so that audio-rate consumers get no zipper noise:
+ * @code
+	ParameterReader gainReader(gain, 44100);
+	// In the audio thread
+	gainReader.fillBlock(gains, io.framesPerBuffer());
+ * @endcode
+ *
+ * A change starts at the offset in the block that matches when it was set
+ * within the period of the previous block, so the timing of changes is kept
+ * at a latency of one block. The parameter must outlive its readers.
+ *
+ * @ingroup allocore
+ */
+class ParameterReader
+{
+public:
+	/// Curve of the ramp to each new value
+	enum Mode {
+		STEP,			/**< Jump to each value at its offset in the block */
+		LINEAR,			/**< Linear ramp over the smoothing time */
+		EXPONENTIAL		/**< Exponential approach, -60 dB over the smoothing time */
+	};
+
+	/**
+	 * @brief ParameterReader
+	 *
+	 * @param parameter The parameter to read
+	 * @param sampleRate Sample rate of the audio thread
+	 * @param smoothTime Duration in seconds of the ramp to each new value
+	 * @param mode Curve of the ramp
+	 */
+	ParameterReader(Parameter &parameter, double sampleRate,
+	                float smoothTime = 0.02, Mode mode = LINEAR);
+
+	~ParameterReader();
+
+	/// Set sample rate of the audio thread
+	void sampleRate(double v) { mSampleRate = v; }
+	double sampleRate() const { return mSampleRate; }
+
+	/// Set duration in seconds of the ramp to each new value
+	void smoothTime(float seconds) { mSmoothTime = seconds; }
+	float smoothTime() const { return mSmoothTime; }
+
+	/// Set curve of the ramp to each new value
+	void mode(Mode v) { mMode = v; }
+	Mode mode() const { return mMode; }
+
+	/**
+	 * @brief Write the values of the parameter for the next block
+	 *
+	 * This function is lock-free and must only be called from one thread,
+	 * normally the audio thread.
+	 *
+	 * @param out Buffer of numFrames values
+	 * @param numFrames Number of frames in the block
+	 */
+	void fillBlock(float *out, int numFrames);
+
+	/// Get value at the end of the last block
+	float value() const { return mValue; }
+
+	/// Whether a ramp is still in progress at the end of the last block
+	bool ramping() const { return mRemain > 0; }
+
+	/// Get the parameter read
+	Parameter &parameter() { return mParameter; }
+
+private:
+	friend class Parameter;
+
+	struct Event {
+		float value;
+		float rampTime; // < 0 for the smoothing time
+		al_sec time;
+	};
+
+	// Called by the parameter from the thread that sets it
+	void push(float value, float rampTime);
+
+	void start(float target, float rampTime);
+	void render(float *out, int numFrames);
+
+	Parameter &mParameter;
+	LockFreeQueue<Event> mEvents;
+	std::atomic<float> mLatest;		// latest value, if events were dropped
+	std::atomic<bool> mDropped;
+	double mSampleRate;
+	float mSmoothTime;
+	Mode mMode;
+
+	float mValue, mTarget;
+	float mInc;				// increment of a linear ramp
+	float mRatio;			// ratio of an exponential ramp
+	bool mExponential;		// curve of the current ramp
+	int mRemain;			// samples left in the current ramp
+	al_sec mBlockTime;		// time of the previous block
+};
+
+
 class ParameterBool : public ParameterWrapper<float>
 {
 public:
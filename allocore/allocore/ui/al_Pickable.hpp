@@ -4,6 +4,7 @@
 
 #include <vector>
 
+#include "allocore/spatial/al_BVH.hpp"
 #include "allocore/ui/al_Gnomon.hpp"
 #include "allocore/ui/al_BoundingBox.hpp"
 
@@ -34,20 +35,30 @@ struct PickableBase : virtual PickableState {
   /// intersection test must be specified
   virtual double intersect(Rayd &r) = 0;
 
+  /// bounds in local space, excluding children, that contain everything
+  /// intersect() can hit. Returns false if unknown, in which case the
+  /// pickable is always tested.
+  virtual bool bounds(BVH::Box &b){ return false; }
+
   /// override these callbacks
   virtual bool onPoint(Rayd &r, double t, bool child){return false;}
   virtual bool onPick(Rayd &r, double t, bool child){return false;}
   virtual bool onDrag(Rayd &r, double t, bool child){return false;}
   virtual bool onUnpick(Rayd &r, double t, bool child){return false;}
+
+  typedef bool (PickableBase::*Callback)(Rayd &r, double t, bool child);
   
   /// do interaction on self and children, call onPoint callbacks
   virtual bool point(Rayd &r){
     bool child = false;  
     double t = intersect(r);
     if(t > 0.0 || alwaysTestChildren){
+      Rayd local = transformRayLocal(r);
+      cullChildren(local);
       for(int i=0; i < children.size(); i++){
-        Rayd ray = transformRayLocal(r);
-        child |= children[i]->point(ray);
+        Rayd ray = local;
+        if(childHit[i]) child |= children[i]->point(ray);
+        else children[i]->missed(ray, &PickableBase::onPoint);
       }
     }
     return onPoint(r,t,child);
@@ -58,9 +69,12 @@ struct PickableBase : virtual PickableState {
     bool child = false;  
     double t = intersect(r);
     if(t > 0.0 || alwaysTestChildren){
+      Rayd local = transformRayLocal(r);
+      cullChildren(local);
       for(int i=0; i < children.size(); i++){
-        Rayd ray = transformRayLocal(r);
-        child |= children[i]->pick(ray);
+        Rayd ray = local;
+        if(childHit[i]) child |= children[i]->pick(ray);
+        else children[i]->missed(ray, &PickableBase::onPick);
       }
     }
     return onPick(r,t,child);
@@ -68,11 +82,13 @@ struct PickableBase : virtual PickableState {
 
   /// do interaction on self and children, call onDrag callbacks
   virtual bool drag(Rayd &r){
+    // not culled, since selected pickables follow the ray wherever it is
     bool child = false;  
     double t = intersect(r);
     if(t > 0.0 || alwaysTestChildren){
+      Rayd local = transformRayLocal(r);
       for(int i=0; i < children.size(); i++){
-        Rayd ray = transformRayLocal(r);
+        Rayd ray = local;
         child |= children[i]->drag(ray);
       }
     }
@@ -84,14 +100,73 @@ struct PickableBase : virtual PickableState {
     bool child = false;  
     double t = intersect(r);
     if(t > 0.0 || alwaysTestChildren){
+      Rayd local = transformRayLocal(r);
+      cullChildren(local);
       for(int i=0; i < children.size(); i++){
-        Rayd ray = transformRayLocal(r);
-        child |= children[i]->unpick(ray);
+        Rayd ray = local;
+        if(childHit[i]) child |= children[i]->unpick(ray);
+        else children[i]->missed(ray, &PickableBase::onUnpick);
       }
     }
     return onUnpick(r,t,child);
   }
 
+  /// call a callback on self and children as if the ray missed them all
+  void missed(Rayd &r, Callback cb){
+    if(alwaysTestChildren){
+      Rayd local = transformRayLocal(r);
+      for(int i=0; i < children.size(); i++){
+        Rayd ray = local;
+        children[i]->missed(ray, cb);
+      }
+    }
+    (this->*cb)(r, -1, false);
+  }
+
+  /// mark the cached bounds of this pickable and its ancestors out of date.
+  /// Call after changing pose, scale, or what bounds() returns directly;
+  /// the methods of pickables and handles do so themselves.
+  void invalidateBounds(){
+    boundsDirty = true;
+    for(PickableBase *p = this; p->parent; p = p->parent){
+      PickableBase *q = p->parent;
+      // a dirty node's ancestors are already dirty
+      bool done = q->boundsDirty;
+      q->boundsDirty = q->childrenDirty = true;
+      if(done) break;
+    }
+  }
+
+  /// get bounds of self and descendants in parent space.
+  /// Returns false if any of them is unbounded.
+  /// The result is cached until invalidateBounds() is called.
+  bool subtreeBounds(BVH::Box &b){
+    if(boundsDirty || boundsChildren != children.size()){
+      subtreeBounded = computeSubtreeBounds(subtreeBox);
+      boundsChildren = children.size();
+      boundsDirty = false;
+    }
+    b = subtreeBox;
+    return subtreeBounded;
+  }
+
+  /// mark which children (in childHit) may be hit by a ray in local space.
+  /// Only the hierarchy over the children's bounds is traversed; it is
+  /// refit after the children's bounds changed, or rebuilt if children were
+  /// added.
+  void cullChildren(const Rayd &local){
+    updateChildBVH();
+    int N = children.size();
+    childHit.assign(N, 0);
+    for(int i=0; i < unboundedChildren.size(); i++) childHit[unboundedChildren[i]] = 1;
+    if(unboundedChildren.size() == N) return;
+
+    const std::vector<unsigned>& order = childBVH.order();
+    childBVH.traverse(Vec3f(local.o), Vec3f(local.d), FLT_MAX, [&](int first, int count, float&){
+      for(int i=first; i < first+count; i++) childHit[order[i]] = 1;
+    });
+  }
+
   virtual void draw(Graphics &g){}
   virtual void drawChildren(Graphics &g){
     pushMatrix(g);
@@ -104,9 +179,11 @@ struct PickableBase : virtual PickableState {
   bool intersects(Rayd &r){ return intersect(r) > 0.0; }
   bool intersectsChild(Rayd &r){
     bool child = false;
+    Rayd local = transformRayLocal(r);
+    cullChildren(local);
     for(int i=0; i < children.size(); i++){
-      Rayd ray = transformRayLocal(r);
-      child |= children[i]->intersects(ray);
+      Rayd ray = local;
+      if(childHit[i]) child |= children[i]->intersects(ray);
     }
     return child;
   }
@@ -114,6 +191,7 @@ struct PickableBase : virtual PickableState {
   void addChild(PickableBase &pickable){
     pickable.parent = this;
     children.push_back(&pickable);
+    pickable.invalidateBounds();
   }
 
   /// apply pickable pose transforms
@@ -152,33 +230,113 @@ struct PickableBase : virtual PickableState {
     Vec4d o = invModel.transform(Vec4d(v, w));
     return Vec3f(o.sub<3>(0));
   }
+
+protected:
+  BVH childBVH; // hierarchy over bounds of children
+  std::vector<BVH::Box> childBoxes;
+  std::vector<int> unboundedChildren; // children tested without culling
+  std::vector<char> childHit;
+
+  // cached bounds of self and descendants in parent space
+  BVH::Box subtreeBox;
+  bool subtreeBounded = false;
+  size_t boundsChildren = 0; // number of children when cached
+  // a dirty node's parent is always dirty, so invalidation stops early
+  bool boundsDirty = true;   // subtreeBox is out of date
+  bool childrenDirty = true; // childBoxes and childBVH are out of date
+
+  bool computeSubtreeBounds(BVH::Box &b){
+    BVH::Box local;
+    if(!bounds(local)) return false;
+    for(int i=0; i < children.size(); i++){
+      BVH::Box cb;
+      if(!children[i]->subtreeBounds(cb)) return false;
+      local.extend(cb);
+    }
+    b.reset();
+    if(!local.valid()) return true;
+    for(int c=0; c < 8; c++){
+      Vec3f corner(c&1 ? local.max.x : local.min.x, c&2 ? local.max.y : local.min.y, c&4 ? local.max.z : local.min.z);
+      b.extend(transformVecWorld(corner));
+    }
+    return true;
+  }
+
+  void updateChildBVH(){
+    int N = children.size();
+    if(!childrenDirty && childBoxes.size() == N) return;
+    childBoxes.resize(N);
+    unboundedChildren.clear();
+    for(int i=0; i < N; i++){
+      if(!children[i]->subtreeBounds(childBoxes[i])){
+        // an empty box is never hit, so test separately
+        childBoxes[i].reset();
+        unboundedChildren.push_back(i);
+      }
+    }
+    if(unboundedChildren.size() < N){
+      if(childBVH.order().size() != N) childBVH.build(childBoxes, 0, 1);
+      else childBVH.refit(childBoxes);
+    }
+    childrenDirty = false;
+  }
 };
 
 
-/// Bounding Box Pickable
+/// Bounding Box Pickable, optionally picking individual triangles
 struct Pickable : PickableBase {
-  Mesh *mesh; // pointer to mesh that is wrapped
+  Mesh *mesh = 0; // pointer to mesh that is wrapped
   BoundingBox bb; // original bounding box
   BoundingBox aabb; // axis aligned bounding box (after pose/scale transforms)
 
+  TriangleBVH bvh; // triangles of mesh, if triangle picking is enabled
+  TriangleBVH::Hit hit; // triangle hit by last intersect(), if any
+
   // used for moving pickable naturally
   Vec3f selectOffset;
   float selectDist;
 
   Pickable(){}
-  Pickable(Mesh &m){set(m);}
+  Pickable(Mesh &m, bool triangles=false){set(m, triangles);}
 
-  /// initialize bounding box;
-  void set(Mesh &m){
+  /// initialize bounding box; if triangles is true, rays are tested
+  /// against the mesh's triangles instead of its bounding box.
+  void set(Mesh &m, bool triangles=false){
     mesh = &m;
     bb.set(*mesh);
+    if(triangles) buildBVH();
+    else bvh.clear();
+    invalidateBounds();
+  }
+
+  /// build triangle hierarchy of mesh for triangle-accurate picking
+  void buildBVH(){
+    std::vector<Mesh::Index> tris;
+    mesh->getTriangles(tris);
+    if(mesh->vertices().size()){
+      bvh.build(mesh->vertices().elems(), mesh->vertices().size(), tris);
+    }
+  }
+
+  /// update bounds and triangle hierarchy after the mesh's vertices moved
+  void refitBVH(){
+    bb.set(*mesh);
+    if(bvh.size()) bvh.refit(mesh->vertices().elems());
+    invalidateBounds();
   }
 
   /// override base methods
   double intersect(Rayd &r){
+    if(bvh.size()) return intersectMesh(r);
     return intersectBB(r);
   }
 
+  bool bounds(BVH::Box &b){
+    if(!mesh) return false;
+    b = BVH::Box(bb.min, bb.max);
+    return true;
+  }
+
   bool onPoint(Rayd &r, double t, bool child){
     if(t > 0.0){
       if(child){
@@ -211,6 +369,7 @@ struct Pickable : PickableBase {
       } else if(selected){
         Vec3f newPos = r(selectDist) + selectOffset;
         pose.pos().set(newPos);
+        invalidateBounds();
         return true;
       }
     // }
@@ -289,6 +448,7 @@ struct Pickable : PickableBase {
     updateAABB();
     Vec3f offset = aabb.cen - pose.pos();
     pose.pos().set(pos - offset);
+    invalidateBounds();
   }
 
   /// set pickable's orientation maintaining same center position
@@ -306,6 +466,15 @@ struct Pickable : PickableBase {
     return r.intersectBox(bb.cen, bb.dim);
   }
 
+  /// intersect ray with triangles of mesh, storing triangle and
+  /// barycentric coordinates of the nearest one in hit
+  double intersectMesh(Rayd &ray){
+    Rayd r = transformRayLocal(ray);
+    if(bvh.intersect(r, hit)) return hit.t;
+    hit = TriangleBVH::Hit();
+    return -1.0;
+  }
+
   /// intersect ray with pickable AxisAlignedBoundingBox
   double intersectAABB(Rayd &ray){
     return ray.intersectBox(aabb.cen, aabb.dim);
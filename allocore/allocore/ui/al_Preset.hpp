@@ -86,6 +86,17 @@ public:
 	float getMorphTime();
 	void setMorphTime(float time);
 
+	/**
+	 * @brief Set whether to morph on the audio clock
+	 *
+	 * When enabled, recalling a preset sets each parameter to its new value
+	 * right away with Parameter::rampTo(), so that its ParameterReader objects
+	 * ramp to it sample by sample over the morph time, instead of stepping
+	 * the parameter from the morphing thread every 50 ms.
+	 */
+	void setMorphOnAudioClock(bool audioClock) { mMorphOnAudioClock = audioClock; }
+	bool getMorphOnAudioClock() { return mMorphOnAudioClock; }
+
 	void setSubDirectory(std::string directory);
 
 	std::vector<std::string> availableSubDirectories();
@@ -127,6 +138,7 @@ private:
 	std::mutex mFileLock;
 	bool mRunning; // To keep the morphing thread alive
 	bool mMorph; // To be able to trip and stop morphing at any time.
+	bool mMorphOnAudioClock;
 	int mMorphRemainingSteps;
 	float mMorphInterval;
 	Parameter mMorphTime;
@@ -154,6 +154,7 @@ struct RotateHandle : PickableBase {
             parent->pose.quat().set(parent->pose.quat() * rotate);
             Vec3f p2 = parent->transformVecWorld(pose.pos());
             parent->pose.pos() += p1-p2;
+            parent->invalidateBounds();
           }
           return true;
         }
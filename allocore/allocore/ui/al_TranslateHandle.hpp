@@ -89,8 +89,12 @@ struct TranslateHandle : PickableBase {
               case 2: dir = parent->pose.uz(); break;
             }
             parent->pose.pos() += dir*translate[i];
+            parent->invalidateBounds();
 
-          } else pose.pos()[i] += translate[i];
+          } else {
+            pose.pos()[i] += translate[i];
+            invalidateBounds();
+          }
           return true;
         } 
       }
@@ -0,0 +1,87 @@
+/*
+Allocore Example: Serialization benchmark
+
+Description:
+This compares the element-wise Serializer with the schema-based
+SchemaSerializer when sending an array of particles. The Serializer writes a
+header per field per particle and the Deserializer copies everything back out.
+The SchemaSerializer writes one header and one memcpy for the whole array and
+the SchemaDeserializer reads it in place without copying.
+*/
+
+#include <stddef.h>
+#include <stdio.h>
+#include <vector>
+#include "allocore/protocol/al_Serialize.hpp"
+#include "allocore/system/al_Time.h"
+using namespace al;
+
+struct Particle{
+	float pos[3];
+	float vel[3];
+	float mass;
+	uint32_t id;
+};
+
+int main(){
+	const uint32_t N = 100000;	// number of particles
+	const int iters = 20;		// number of timing iterations
+
+	std::vector<Particle> particles(N);
+	for(uint32_t i=0; i<N; ++i){
+		Particle& p = particles[i];
+		for(int k=0; k<3; ++k){ p.pos[k] = i+k; p.vel[k] = -float(k); }
+		p.mass = 1;
+		p.id = i;
+	}
+
+	// Describe the particle layout once
+	ser::Schema schema(sizeof(Particle));
+	schema	.add<float>(offsetof(Particle, pos), 3)
+			.add<float>(offsetof(Particle, vel), 3)
+			.add<float>(offsetof(Particle, mass))
+			.add<uint32_t>(offsetof(Particle, id));
+
+	std::vector<Particle> received(N);
+	double checksum = 0;
+
+	// Element-wise Serializer
+	al_sec t0 = al_steady_time();
+	for(int it=0; it<iters; ++it){
+		Serializer s;
+		for(uint32_t i=0; i<N; ++i){
+			const Particle& p = particles[i];
+			s.add(p.pos, 3).add(p.vel, 3) << p.mass << p.id;
+		}
+
+		Deserializer d(s.buf());
+		for(uint32_t i=0; i<N; ++i){
+			Particle& p = received[i];
+			d >> p.pos >> p.vel >> p.mass >> p.id;
+		}
+		checksum += received[N-1].id;
+	}
+	al_sec tSer = (al_steady_time() - t0) / iters;
+
+	// Schema-based serializer with zero-copy view
+	SchemaSerializer s(schema);
+	std::vector<char> packet; // stands in for a network receive buffer
+	t0 = al_steady_time();
+	for(int it=0; it<iters; ++it){
+		s.clear();
+		s.add(&particles[0], N);
+
+		packet.assign(s.buf().begin(), s.buf().end());
+		SchemaDeserializer d(schema, packet);
+		ser::SchemaView<Particle> view;
+		d.read(view);
+		checksum += view[N-1].id;
+	}
+	al_sec tSchema = (al_steady_time() - t0) / iters;
+
+	printf("%u particles (%u bytes each), average of %d runs\n", N, unsigned(sizeof(Particle)), iters);
+	printf("Serializer      : %8.3f ms\n", tSer*1000);
+	printf("SchemaSerializer: %8.3f ms\n", tSchema*1000);
+	printf("Speedup         : %8.1fx\n", tSer/tSchema);
+	printf("(checksum %g)\n", checksum);
+}
@@ -0,0 +1,77 @@
+/*
+Allocore Example: Thread pool
+
+Description:
+This example computes the mean of an array many times, as a per-frame
+parallel loop would. It compares spawning new threads each time through
+Threads<> with scheduling work on a persistent ThreadPool.
+*/
+
+#include <stdio.h>
+#include <atomic>
+#include <vector>
+#include "allocore/system/al_Thread.hpp"
+#include "allocore/system/al_ThreadPool.hpp"
+#include "allocore/system/al_Time.hpp"
+using namespace al;
+
+// The function each worker thread will execute
+struct Func : public ThreadFunction{
+	Func(): sum(0){}
+	void operator()(){
+		sum = 0;
+		for(unsigned i=ival[0]; i<ival[1]; ++i) sum += data[i];
+	}
+	unsigned ival[2];
+	double sum;
+	const double * data;
+};
+
+int main(){
+	const unsigned N = 100000;	// size of our array
+	const int frames = 1000;	// number of times to compute
+	std::vector<double> data(N);
+
+	for(unsigned i=0; i<N; ++i){
+		double f = double(i)/N;
+		data[i] = 1 - f*f;
+	}
+
+	ThreadPool& pool = ThreadPool::global();
+	int Nthreads = pool.size() + 1;
+
+	// Fork-join threads, created for every frame
+	Threads<Func> threads(Nthreads);
+	for(int i=0; i<Nthreads; ++i){
+		threads.getInterval(threads.function(i).ival, i, N);
+		threads.function(i).data = &data[0];
+	}
+
+	double sumThreads = 0;
+	al_sec t0 = al_steady_time();
+	for(int k=0; k<frames; ++k){
+		threads.start();
+		sumThreads = 0;
+		for(int i=0; i<Nthreads; ++i) sumThreads += threads.function(i).sum;
+	}
+	al_sec tThreads = al_steady_time() - t0;
+
+	// Persistent pool; the calling thread helps
+	double sumPool = 0;
+	t0 = al_steady_time();
+	for(int k=0; k<frames; ++k){
+		std::atomic<int64_t> chunks(0);
+		std::vector<double> partial(128, 0.);
+		pool.parallelForRange(0, N, N/64 + 1, [&](int64_t b, int64_t e){
+			double s = 0;
+			for(int64_t i=b; i<e; ++i) s += data[i];
+			partial[chunks++] = s;
+		});
+		sumPool = 0;
+		for(int i=0; i<chunks; ++i) sumPool += partial[i];
+	}
+	al_sec tPool = al_steady_time() - t0;
+
+	printf("Mean (threads): %g, %.3f ms per frame\n", sumThreads/N, tThreads*1000/frames);
+	printf("Mean (pool)   : %g, %.3f ms per frame\n", sumPool/N, tPool*1000/frames);
+}
@@ -3,6 +3,7 @@ find_package(APR QUIET)
 
 set(APR_HEADERS
     allocore/io/al_File.hpp
+    allocore/io/al_FileIndex.hpp
     allocore/io/al_Socket.hpp
     allocore/system/al_Memory.hpp
     allocore/system/al_Time.h
@@ -15,6 +16,7 @@ message(STATUS "Building APR module.")
 list(APPEND ALLOCORE_SRC
     src/io/al_File.cpp
     src/io/al_FileAPR.cpp
+    src/io/al_FileIndex.cpp
     src/io/al_SocketAPR.cpp
     src/system/al_Memory.cpp
     src/system/al_Time.cpp)
@@ -632,6 +632,42 @@ Mesh::Vertex Mesh::getCenter() const {
 	return min+(max-min)*0.5;
 }
 
+void Mesh::getTriangles(std::vector<Index>& tris) const {
+	tris.clear();
+	bool indexed = indices().size() > 0;
+	unsigned N = indexed ? indices().size() : vertices().size();
+	#define IDX(i) (indexed ? indices()[i] : Index(i))
+
+	switch(primitive()){
+	case Graphics::TRIANGLES:
+		for(unsigned i=0; i+2<N; i+=3){
+			tris.push_back(IDX(i)); tris.push_back(IDX(i+1)); tris.push_back(IDX(i+2));
+		}
+		break;
+	case Graphics::TRIANGLE_STRIP:
+		for(unsigned i=0; i+2<N; ++i){
+			// Odd numbered triangles must have orientation flipped
+			unsigned odd = i & 1;
+			tris.push_back(IDX(i)); tris.push_back(IDX(i+1+odd)); tris.push_back(IDX(i+2-odd));
+		}
+		break;
+	case Graphics::TRIANGLE_FAN:
+		for(unsigned i=1; i+1<N; ++i){
+			tris.push_back(IDX(0)); tris.push_back(IDX(i)); tris.push_back(IDX(i+1));
+		}
+		break;
+	case Graphics::QUADS:
+		for(unsigned i=0; i+3<N; i+=4){
+			tris.push_back(IDX(i)); tris.push_back(IDX(i+1)); tris.push_back(IDX(i+2));
+			tris.push_back(IDX(i)); tris.push_back(IDX(i+2)); tris.push_back(IDX(i+3));
+		}
+		break;
+	default:;
+	}
+
+	#undef IDX
+}
+
 void Mesh::unitize(bool proportional) {
 	Vertex min(0), max(0);
 	getBounds(min, max);
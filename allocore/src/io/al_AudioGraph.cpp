@@ -0,0 +1,277 @@
+#include <algorithm>
+#include "allocore/io/al_AudioGraph.hpp"
+#include "allocore/system/al_Printing.hpp"
+#include "allocore/system/al_Time.h"
+
+namespace al{
+
+namespace{
+	// Roles of a node on a channel, in the order they run
+	enum{ NONE=-1, WRITER, IN_PLACE, READER };
+}
+
+
+AudioGraph::Node::Node(AudioCallback& cb)
+:	mCallback(&cb), mPredecessors(0), mPending(0),
+	mLast(0), mTotal(0), mMax(0), mBlocks(0), mIO(0)
+{}
+
+AudioGraph::Node& AudioGraph::Node::reads(Buffer b, int first, int count){
+	Range r = {b, first, count, true};
+	mRanges.push_back(r);
+	return *this;
+}
+
+AudioGraph::Node& AudioGraph::Node::writes(Buffer b, int first, int count){
+	Range r = {b, first, count, false};
+	mRanges.push_back(r);
+	return *this;
+}
+
+int AudioGraph::Node::role(Buffer b, int chan) const {
+	bool r = false, w = false;
+	for(unsigned i=0; i<mRanges.size(); ++i){
+		const Range& range = mRanges[i];
+		if(range.buffer == b && chan >= range.first && chan < range.first + range.count){
+			(range.read ? r : w) = true;
+		}
+	}
+	return w ? (r ? IN_PLACE : WRITER) : (r ? READER : NONE);
+}
+
+AudioGraph::Timing AudioGraph::Node::timing() const {
+	Timing t;
+	t.blocks = mBlocks.load(std::memory_order_relaxed);
+	t.last = mLast.load(std::memory_order_relaxed) * 1e-9;
+	t.max = mMax.load(std::memory_order_relaxed) * 1e-9;
+	t.mean = t.blocks ? mTotal.load(std::memory_order_relaxed) * 1e-9 / t.blocks : 0;
+	return t;
+}
+
+void AudioGraph::Node::resetTiming(){
+	mBlocks.store(0);
+	mLast.store(0);
+	mTotal.store(0);
+	mMax.store(0);
+}
+
+
+
+AudioGraph::AudioGraph(ThreadPool * pool)
+:	mPool(pool), mGroup(0), mChanged(false), mSerial(false)
+{}
+
+AudioGraph::~AudioGraph(){
+	clear();
+}
+
+AudioGraph::Node& AudioGraph::add(AudioCallback& cb){
+	mNodes.push_back(new Node(cb));
+	mChanged = true;
+	return *mNodes.back();
+}
+
+AudioGraph& AudioGraph::remove(AudioCallback& cb){
+	std::vector<Node *>::iterator it = mNodes.begin();
+	while(it != mNodes.end()){
+		if((*it)->mCallback == &cb){
+			release(*it);
+			it = mNodes.erase(it);
+		}
+		else{
+			++it;
+		}
+	}
+	mChanged = true;
+	return *this;
+}
+
+AudioGraph& AudioGraph::clear(){
+	for(unsigned i=0; i<mNodes.size(); ++i) release(mNodes[i]);
+	mNodes.clear();
+	mChanged = true;
+	return *this;
+}
+
+void AudioGraph::release(Node * n){
+	// The buffers belong to the stream or the node
+	AudioIOData& v = n->mIO;
+	v.mBufI = v.mBufO = v.mBufB = v.mBufT = 0;
+	delete n;
+}
+
+bool AudioGraph::sort(){
+	const int N = mNodes.size();
+	mChanged = false;
+	mSerial = false;
+
+	// Order each pair of nodes by their roles on the channels they share
+	std::vector<char> edges(N*N, 0);
+	for(int i=0; i<N; ++i){
+		const Node& a = *mNodes[i];
+		for(int j=i+1; j<N; ++j){
+			const Node& b = *mNodes[j];
+			bool before = a.mRanges.empty() || b.mRanges.empty();
+			bool after = false;
+			for(unsigned k=0; k<a.mRanges.size(); ++k){
+				const Node::Range& r = a.mRanges[k];
+				for(int c=r.first; c<r.first+r.count; ++c){
+					int ra = a.role(r.buffer, c);
+					int rb = b.role(r.buffer, c);
+					if(NONE == rb || (READER == ra && READER == rb)) continue;
+					(ra <= rb ? before : after) = true;
+				}
+			}
+			edges[i*N + j] = before;
+			edges[j*N + i] = after;
+		}
+	}
+
+	for(int i=0; i<N; ++i){
+		Node& n = *mNodes[i];
+		n.mSuccessors.clear();
+		n.mPredecessors = 0;
+	}
+	for(int i=0; i<N; ++i){
+		for(int j=0; j<N; ++j){
+			if(edges[i*N + j]){
+				mNodes[i]->mSuccessors.push_back(j);
+				++mNodes[j]->mPredecessors;
+			}
+		}
+	}
+
+	// Sort topologically, taking the earliest added of the ready nodes
+	mOrder.clear();
+	mRoots.clear();
+	std::vector<int> pending(N);
+	for(int i=0; i<N; ++i){
+		pending[i] = mNodes[i]->mPredecessors;
+		if(0 == pending[i]) mRoots.push_back(i);
+	}
+	std::vector<char> done(N, 0);
+	for(int k=0; k<N; ++k){
+		int next = -1;
+		for(int i=0; i<N; ++i){
+			if(!done[i] && 0 == pending[i]){
+				next = i;
+				break;
+			}
+		}
+		if(next < 0) break;
+		done[next] = 1;
+		mOrder.push_back(next);
+		const std::vector<int>& s = mNodes[next]->mSuccessors;
+		for(unsigned i=0; i<s.size(); ++i) --pending[s[i]];
+	}
+
+	mTasks.resize(N);
+	for(int i=0; i<N; ++i){
+		mTasks[i].graph = this;
+		mTasks[i].node = i;
+	}
+
+	if(int(mOrder.size()) != N){
+		AL_WARN("AudioGraph: dependencies have a cycle; running nodes in the order added");
+		mSerial = true;
+		mOrder.resize(N);
+		for(int i=0; i<N; ++i) mOrder[i] = i;
+		return false;
+	}
+	return true;
+}
+
+bool AudioGraph::precedes(int i, int j){
+	if(mChanged) sort();
+	if(mSerial) return i < j;
+	std::vector<char> seen(mNodes.size(), 0);
+	std::vector<int> stack(1, i);
+	while(!stack.empty()){
+		int n = stack.back();
+		stack.pop_back();
+		const std::vector<int>& s = mNodes[n]->mSuccessors;
+		for(unsigned k=0; k<s.size(); ++k){
+			if(s[k] == j) return true;
+			if(!seen[s[k]]){
+				seen[s[k]] = 1;
+				stack.push_back(s[k]);
+			}
+		}
+	}
+	return false;
+}
+
+void AudioGraph::bind(Node& n, const AudioIOData& io){
+	if(int(n.mTemp.size()) != io.mFramesPerBuffer) n.mTemp.resize(io.mFramesPerBuffer);
+	AudioIOData& v = n.mIO;
+	v.mImpl = io.mImpl;
+	v.mUser = io.mUser;
+	v.mFramesPerBuffer = io.mFramesPerBuffer;
+	v.mFramesPerSecond = io.mFramesPerSecond;
+	v.mBufI = io.mBufI;
+	v.mBufO = io.mBufO;
+	v.mBufB = io.mBufB;
+	v.mBufT = n.mTemp.empty() ? 0 : &n.mTemp[0];
+	v.mNumI = io.mNumI;
+	v.mNumO = io.mNumO;
+	v.mNumB = io.mNumB;
+	v.mScratch = io.mScratch;
+	v.mGain = io.mGain;
+	v.mGainPrev = io.mGainPrev;
+}
+
+void AudioGraph::run(Node& n){
+	RTHeapCheck::Scope realtime;
+	al_nsec begin = al_steady_time_nsec();
+	n.mIO.frame(0);
+	n.mCallback->onAudioCB(n.mIO);
+	al_nsec dt = al_steady_time_nsec() - begin;
+
+	// A node is only run by one thread at a time
+	n.mLast.store(dt, std::memory_order_relaxed);
+	n.mTotal.store(n.mTotal.load(std::memory_order_relaxed) + dt, std::memory_order_relaxed);
+	if(dt > n.mMax.load(std::memory_order_relaxed)) n.mMax.store(dt, std::memory_order_relaxed);
+	n.mBlocks.store(n.mBlocks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void AudioGraph::execute(int node){
+	while(node >= 0){
+		Node& n = *mNodes[node];
+		run(n);
+
+		// Continue with one of the nodes made ready and hand the others to
+		// the pool
+		node = -1;
+		for(unsigned i=0; i<n.mSuccessors.size(); ++i){
+			int s = n.mSuccessors[i];
+			if(1 == mNodes[s]->mPending.fetch_sub(1, std::memory_order_acq_rel)){
+				if(node < 0) node = s;
+				else mGroup->run(mTasks[s]);
+			}
+		}
+	}
+}
+
+void AudioGraph::onAudioCB(AudioIOData& io){
+	if(mChanged) sort();
+	if(mNodes.empty()) return;
+	for(unsigned i=0; i<mNodes.size(); ++i) bind(*mNodes[i], io);
+
+	if(mSerial || !mPool || 0 == mPool->size()){
+		for(unsigned i=0; i<mOrder.size(); ++i) run(*mNodes[mOrder[i]]);
+		return;
+	}
+
+	for(unsigned i=0; i<mNodes.size(); ++i){
+		mNodes[i]->mPending.store(mNodes[i]->mPredecessors, std::memory_order_relaxed);
+	}
+
+	TaskGroup group(*mPool);
+	mGroup = &group;
+	for(unsigned i=1; i<mRoots.size(); ++i) group.run(mTasks[mRoots[i]]);
+	execute(mRoots[0]);
+	group.wait();
+	mGroup = 0;
+}
+
+} // al::
@@ -1,4 +1,6 @@
 #include <algorithm>
+#include <atomic>
+#include <cctype>
 #include <cstdlib>
 #include <cstdio>
 #include <cstring>		/* memset() */
@@ -8,6 +10,10 @@
 #include "portaudio.h"
 #include "allocore/system/al_Config.h"
 #include "allocore/io/al_AudioIO.hpp"
+#include "allocore/system/al_Printing.hpp"
+#include "allocore/system/al_Profiler.hpp"
+#include "allocore/system/al_Thread.hpp"
+#include "allocore/system/al_Time.hpp"
 
 namespace al{
 
@@ -68,6 +74,477 @@ protected:
 };
 
 
+//==============================================================================
+
+namespace{
+
+	void putLE(char * p, uint64_t v, int bytes){
+		for(int i=0; i<bytes; ++i) p[i] = char(v >> (8*i));
+	}
+
+	void putBE(char * p, uint64_t v, int bytes){
+		for(int i=0; i<bytes; ++i) p[i] = char(v >> (8*(bytes-1-i)));
+	}
+
+	uint64_t getLE(const char * p, int bytes){
+		uint64_t v = 0;
+		for(int i=0; i<bytes; ++i) v |= uint64_t((unsigned char)p[i]) << (8*i);
+		return v;
+	}
+
+	bool hasExtension(const std::string& path, const char * ext){
+		size_t n = strlen(ext);
+		if(path.size() < n) return false;
+		for(size_t i=0; i<n; ++i){
+			if(tolower(path[path.size()-n+i]) != ext[i]) return false;
+		}
+		return true;
+	}
+
+	// Reads integer or floating-point WAV files as interleaved floats
+	struct WavReader{
+		FILE * fp;
+		int channels, bits;
+		bool isFloat;
+		double frameRate;
+		unsigned long long framesLeft;
+		std::vector<char> raw;
+
+		WavReader(): fp(0), channels(0), bits(0), isFloat(false), frameRate(0), framesLeft(0){}
+		~WavReader(){ close(); }
+
+		bool open(const std::string& path){
+			close();
+			fp = fopen(path.c_str(), "rb");
+			if(!fp) return false;
+			char hdr[12];
+			if(fread(hdr, 1, 12, fp) != 12 || memcmp(hdr, "RIFF", 4) || memcmp(hdr+8, "WAVE", 4)){
+				close();
+				return false;
+			}
+
+			// Go through chunks until the samples
+			char ck[8];
+			bool gotFormat = false;
+			while(fread(ck, 1, 8, fp) == 8){
+				uint64_t size = getLE(ck+4, 4);
+				if(0 == memcmp(ck, "fmt ", 4) && size >= 16 && size <= 64){
+					char f[64];
+					if(fread(f, 1, size, fp) != size) break;
+					int format = getLE(f, 2);
+					if(0xFFFE == format && size >= 26) format = getLE(f+24, 2); // sub-format
+					channels = getLE(f+2, 2);
+					frameRate = getLE(f+4, 4);
+					bits = getLE(f+14, 2);
+					isFloat = 3 == format;
+					gotFormat = (1 == format && (16 == bits || 24 == bits || 32 == bits))
+						|| (isFloat && (32 == bits || 64 == bits));
+					if(size & 1) fseek(fp, 1, SEEK_CUR);
+				}
+				else if(0 == memcmp(ck, "data", 4)){
+					if(!gotFormat || channels < 1) break;
+					framesLeft = size / (channels * bits/8);
+					return true;
+				}
+				else{
+					fseek(fp, long(size + (size & 1)), SEEK_CUR);
+				}
+			}
+			close();
+			return false;
+		}
+
+		void close(){
+			if(fp) fclose(fp);
+			fp = 0;
+			framesLeft = 0;
+		}
+
+		// Returns number of frames read
+		int read(float * dst, int frames){
+			if(framesLeft < (unsigned long long)frames) frames = int(framesLeft);
+			int bytes = bits/8;
+			raw.resize(size_t(frames) * channels * bytes);
+			frames = raw.empty() ? 0 : int(fread(&raw[0], size_t(channels) * bytes, frames, fp));
+			framesLeft = frames ? framesLeft - frames : 0;
+			const char * p = raw.empty() ? 0 : &raw[0];
+			for(int i=0; i<frames*channels; ++i, p+=bytes){
+				if(isFloat){
+					if(4 == bytes){
+						uint32_t u = uint32_t(getLE(p, 4));
+						float v; memcpy(&v, &u, 4);
+						dst[i] = v;
+					}
+					else{
+						uint64_t u = getLE(p, 8);
+						double v; memcpy(&v, &u, 8);
+						dst[i] = float(v);
+					}
+				}
+				else{
+					// Sign-extend from the top of 32 bits
+					int32_t v = int32_t(uint32_t(getLE(p, bytes)) << (32 - bits));
+					dst[i] = float(v / 2147483648.);
+				}
+			}
+			return frames;
+		}
+	};
+
+	// Writes interleaved floats to a WAV or, for files ending in .caf, CAF file
+	struct SoundFileWriter{
+		FILE * fp;
+		bool caf;
+		int channels;
+		unsigned long long frames;
+
+		SoundFileWriter(): fp(0), caf(false), channels(0), frames(0){}
+		~SoundFileWriter(){ close(); }
+
+		bool open(const std::string& path, int chans, double frameRate){
+			close();
+			fp = fopen(path.c_str(), "wb");
+			if(!fp) return false;
+			caf = hasExtension(path, ".caf");
+			channels = chans;
+			frames = 0;
+			std::vector<char> h;
+			if(caf){
+				h.assign(68, 0);
+				memcpy(&h[0], "caff", 4);
+				putBE(&h[4], 1, 2);				// version
+				memcpy(&h[8], "desc", 4);
+				putBE(&h[12], 32, 8);
+				uint64_t rate;
+				memcpy(&rate, &frameRate, 8);
+				putBE(&h[20], rate, 8);
+				memcpy(&h[28], "lpcm", 4);
+				putBE(&h[32], 3, 4);			// float, little-endian
+				putBE(&h[36], 4*chans, 4);		// bytes per packet
+				putBE(&h[40], 1, 4);			// frames per packet
+				putBE(&h[44], chans, 4);
+				putBE(&h[48], 32, 4);			// bits per channel
+				memcpy(&h[52], "data", 4);
+				putBE(&h[56], uint64_t(-1), 8);	// size not yet known
+			}
+			else{
+				// More than two channels need the extensible format
+				bool ext = chans > 2;
+				int fmtSize = ext ? 40 : 18;
+				h.assign(12 + 8+fmtSize + 12 + 8, 0);
+				char * p = &h[0];
+				memcpy(p, "RIFF", 4);
+				memcpy(p+8, "WAVE", 4);
+				p += 12;
+				memcpy(p, "fmt ", 4);
+				putLE(p+4, fmtSize, 4);
+				putLE(p+8, ext ? 0xFFFE : 3, 2);
+				putLE(p+10, chans, 2);
+				putLE(p+12, uint32_t(frameRate), 4);
+				putLE(p+16, uint32_t(frameRate) * 4*chans, 4);
+				putLE(p+20, 4*chans, 2);
+				putLE(p+22, 32, 2);
+				putLE(p+24, fmtSize - 18, 2);
+				if(ext){
+					static const unsigned char floatFormat[16] = {
+						3,0,0,0, 0,0,0x10,0, 0x80,0,0,0xaa,0,0x38,0x9b,0x71
+					};
+					putLE(p+26, 32, 2);			// valid bits
+					memcpy(p+32, floatFormat, 16);
+				}
+				p += 8 + fmtSize;
+				memcpy(p, "fact", 4);
+				putLE(p+4, 4, 4);
+				memcpy(p+12, "data", 4);
+			}
+			if(fwrite(&h[0], 1, h.size(), fp) != h.size()){
+				close();
+				return false;
+			}
+			return true;
+		}
+
+		// Samples are in the host's byte order, which is little-endian on all
+		// supported platforms
+		bool write(const float * src, int numFrames){
+			frames += numFrames;
+			return fwrite(src, sizeof(float) * channels, numFrames, fp) == size_t(numFrames);
+		}
+
+		bool close(){
+			if(!fp) return true;
+			uint64_t bytes = frames * 4 * channels;
+			char b[8];
+			bool ok = true;
+			if(caf){
+				putBE(b, bytes + 4, 8);
+				ok = 0 == fseek(fp, 56, SEEK_SET) && 8 == fwrite(b, 1, 8, fp);
+			}
+			else{
+				if(bytes > 0xffffffffull - 100){
+					AL_WARN("AudioIO: %s", "WAV file is too large for its header; use a .caf file");
+				}
+				long fmtSize = channels > 2 ? 40 : 18;
+				long fact = 12 + 8 + fmtSize;
+				putLE(b, 4 + 8+fmtSize + 12 + 8 + bytes, 4);
+				ok = 0 == fseek(fp, 4, SEEK_SET) && 4 == fwrite(b, 1, 4, fp);
+				putLE(b, frames, 4);
+				ok = ok && 0 == fseek(fp, fact + 8, SEEK_SET) && 4 == fwrite(b, 1, 4, fp);
+				putLE(b, bytes, 4);
+				ok = ok && 0 == fseek(fp, fact + 16, SEEK_SET) && 4 == fwrite(b, 1, 4, fp);
+			}
+			ok = !ferror(fp) && ok;
+			ok = 0 == fclose(fp) && ok;
+			fp = 0;
+			return ok;
+		}
+	};
+
+	// Blocks of interleaved samples passed from one thread to another
+	struct BlockRing{
+		std::vector<float> data;
+		unsigned blockSize, numBlocks;
+		std::atomic<unsigned long long> written, read;
+
+		BlockRing(): blockSize(0), numBlocks(0), written(0), read(0){}
+
+		void resize(unsigned size, unsigned num){
+			blockSize = size;
+			numBlocks = num;
+			data.assign(size * num, 0.f);
+			written = read = 0;
+		}
+
+		// Returns block to fill or 0 if full
+		float * back(){
+			unsigned long long w = written.load(std::memory_order_relaxed);
+			if(w - read.load(std::memory_order_acquire) >= numBlocks) return 0;
+			return &data[(w % numBlocks) * blockSize];
+		}
+		void push(){ written.store(written.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+		// Returns oldest block or 0 if empty
+		const float * front(){
+			unsigned long long r = read.load(std::memory_order_relaxed);
+			if(r == written.load(std::memory_order_acquire)) return 0;
+			return &data[(r % numBlocks) * blockSize];
+		}
+		void pop(){ read.store(read.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+	};
+}
+
+
+// Processes blocks on its own thread, as fast as possible or at a multiple of
+// real time, reading input from a file or generator and writing output to a
+// file
+class OfflineAudioBackend : public DummyAudioBackend{
+public:
+	OfflineAudioBackend()
+	:	mIO(0), mGenerator(0), mGeneratorUser(0), mSpeed(0), mDuration(0),
+		mFrames(0), mActive(false), mStop(false), mFinish(false),
+		mStarted(false), mWriterStarted(false)
+	{}
+
+	virtual ~OfflineAudioBackend(){ stop(); }
+
+	virtual bool isRunning() const { return mActive.load(); }
+
+	virtual void printInfo() const {
+		printf("Using offline backend (%s).\n", mSpeed > 0 ? "timed" : "as fast as possible");
+	}
+
+	virtual double time(){
+		return mIO ? mFrames.load(std::memory_order_relaxed) / mIO->framesPerSecond() : 0.;
+	}
+
+	virtual bool open(int framesPerSecond, int framesPerBuffer, void *userdata){
+		mIO = (AudioIO *)userdata;
+		mIsOpen = true;
+		return true;
+	}
+
+	virtual bool close(){
+		stop();
+		mIsOpen = false;
+		return true;
+	}
+
+	virtual bool start(int framesPerSecond, int framesPerBuffer, void *userdata){
+		if(isRunning()) return true;
+		join();
+		if(!isOpen()) open(framesPerSecond, framesPerBuffer, userdata);
+		AudioIO& io = *mIO;
+
+		if(!mInputPath.empty() && !mReader.open(mInputPath)){
+			AL_WARN("AudioIO: could not open input file %s", mInputPath.c_str());
+			return false;
+		}
+		if(mReader.fp && mReader.frameRate != io.framesPerSecond()){
+			AL_WARN("AudioIO: input file %s has frame rate %g rather than %g",
+				mInputPath.c_str(), mReader.frameRate, io.framesPerSecond());
+		}
+		if(!mOutputPath.empty()){
+			if(!mWriter.open(mOutputPath, io.channelsOut(), io.framesPerSecond())){
+				AL_WARN("AudioIO: could not open output file %s", mOutputPath.c_str());
+				mReader.close();
+				return false;
+			}
+			// A quarter second of audio, to absorb stalls of the disk
+			unsigned blocks = unsigned(0.25 * io.framesPerSecond() / framesPerBuffer);
+			mRing.resize(framesPerBuffer * io.channelsOut(), blocks < 4 ? 4 : blocks);
+		}
+
+		mFrames = 0;
+		mFrameLimit = mDuration > 0 ? (unsigned long long)(mDuration * io.framesPerSecond() + 0.5) : 0;
+		mStop = false;
+		mFinish = false;
+		mActive = true;
+		mWriterStarted = mWriter.fp && mWriterThread.start(writerFunc, this);
+		mStarted = (!mWriter.fp || mWriterStarted) && mThread.start(processFunc, this);
+		if(!mStarted){
+			AL_WARN("AudioIO: could not start offline processing thread");
+			mActive = false;
+			finish();
+		}
+		return mStarted;
+	}
+
+	virtual bool stop(){
+		mStop = true;
+		join();
+		return true;
+	}
+
+	void inputFile(const std::string& path){ mInputPath = path; mGenerator = 0; }
+	void inputGenerator(AudioIO::audioGenerator gen, void * user){
+		mInputPath.clear();
+		mGenerator = gen;
+		mGeneratorUser = user;
+	}
+	void outputFile(const std::string& path){ mOutputPath = path; }
+	void speed(double v){ mSpeed = v; }
+	void duration(double v){ mDuration = v; }
+
+private:
+	AudioIO * mIO;
+	std::string mInputPath, mOutputPath;
+	AudioIO::audioGenerator mGenerator;
+	void * mGeneratorUser;
+	double mSpeed, mDuration;
+	WavReader mReader;
+	SoundFileWriter mWriter;
+	BlockRing mRing;
+	std::vector<float> mInterleaved;
+	unsigned long long mFrameLimit;			// frames to write, 0 if unlimited
+	std::atomic<unsigned long long> mFrames;
+	std::atomic<bool> mActive, mStop, mFinish;
+	Thread mThread, mWriterThread;
+	bool mStarted, mWriterStarted;
+
+	void join(){
+		if(mStarted) mThread.join();
+		mStarted = false;
+	}
+
+	// Stop writer after it has written everything, then close files
+	void finish(){
+		mFinish = true;
+		if(mWriterStarted) mWriterThread.join();
+		mWriterStarted = false;
+		if(mWriter.fp && !mWriter.close()){
+			AL_WARN("AudioIO: could not finish writing %s", mOutputPath.c_str());
+		}
+		mReader.close();
+	}
+
+	// Fill inputs of next block; returns false at end of input
+	bool readInput(){
+		AudioIO& io = *mIO;
+		int frames = io.framesPerBuffer();
+		int chans = io.channelsIn();
+		if(chans <= 0) return true;
+		float * in = const_cast<float *>(&io.in(0,0));
+
+		if(mGenerator){
+			mGenerator(in, chans, frames, mFrames.load(std::memory_order_relaxed), mGeneratorUser);
+		}
+		else if(mReader.fp){
+			if(0 == mReader.framesLeft && mDuration <= 0) return false;
+			int fileChans = mReader.channels;
+			mInterleaved.resize(size_t(frames) * fileChans);
+			int n = mReader.read(&mInterleaved[0], frames);
+			for(int c=0; c<chans; ++c){
+				float * dst = in + c*frames;
+				for(int i=0; i<frames; ++i){
+					dst[i] = (c < fileChans && i < n) ? mInterleaved[i*fileChans + c] : 0.f;
+				}
+			}
+		}
+		else{
+			zero(in, chans * frames);
+		}
+		return true;
+	}
+
+	void process(){
+		AudioIO& io = *mIO;
+		const int frames = io.framesPerBuffer();
+		const int chans = io.channelsOut();
+		const double fps = io.framesPerSecond();
+		const unsigned long long limit = mFrameLimit;
+		const al_nsec t0 = al_steady_time_nsec();
+
+		while(!mStop.load()){
+			unsigned long long frame = mFrames.load(std::memory_order_relaxed);
+			if(limit && frame >= limit) break;
+			if(!readInput()) break;
+
+			io.processBlock();
+
+			if(mWriter.fp){
+				// Wait for the writer rather than drop output
+				float * dst;
+				while(!(dst = mRing.back()) && !mStop.load()) al_sleep(0.001);
+				if(!dst) break;
+				for(int c=0; c<chans; ++c){
+					const float * src = io.outBuffer(c);
+					for(int i=0; i<frames; ++i) dst[i*chans + c] = src[i];
+				}
+				mRing.push();
+			}
+			mFrames.store(frame + frames, std::memory_order_relaxed);
+
+			if(mSpeed > 0){
+				al_nsec deadline = t0 + al_nsec((frame + frames) / fps / mSpeed * 1e9);
+				al_nsec dt = deadline - al_steady_time_nsec();
+				if(dt > 0) al_sleep_nsec(dt);
+			}
+		}
+
+		finish();
+		mActive = false;
+	}
+
+	void write(){
+		for(;;){
+			bool finishing = mFinish.load();
+			const float * src;
+			while((src = mRing.front())){
+				// The last block is cut off at the duration
+				unsigned long long n = mIO->framesPerBuffer();
+				if(mFrameLimit && mFrameLimit - mWriter.frames < n) n = mFrameLimit - mWriter.frames;
+				mWriter.write(src, int(n));
+				mRing.pop();
+			}
+			if(finishing) break;
+			al_sleep(0.001);
+		}
+	}
+
+	static void * processFunc(void * user){ ((OfflineAudioBackend *)user)->process(); return NULL; }
+	static void * writerFunc(void * user){ ((OfflineAudioBackend *)user)->write(); return NULL; }
+};
+
 //==============================================================================
 
 class PortAudioBackend : public AudioBackend{
@@ -258,45 +735,8 @@ protected:
 			memcpy(const_cast<float *>(&io.in(i,0)),  inBuffers[i], frameCount * sizeof(float));
 		}
 
-		if(io.autoZeroOut()) io.zeroOut();
-
-		io.processAudio();	// call callback
-
-
-		// apply smoothly-ramped gain to all output channels
-		if(io.usingGain()){
-
-			float dgain = (io.mGain-io.mGainPrev) / frameCount;
-
-			for(int j=0; j<io.channelsOutDevice(); ++j){
-				float * out = io.outBuffer(j);
-				float gain = io.mGainPrev;
-
-				for(unsigned i=0; i<frameCount; ++i){
-					out[i] *= gain;
-					gain += dgain;
-				}
-			}
-
-			io.mGainPrev = io.mGain;
-		}
-
-		// kill pesky nans so we don't hurt anyone's ears
-		if(io.zeroNANs()){
-			for(unsigned i=0; i<unsigned(frameCount*io.channelsOutDevice()); ++i){
-				float& s = (&io.out(0,0))[i];
-				//if(isnan(s)) s = 0.f;
-				if(s != s) s = 0.f; // portable isnan; only nans do not equal themselves
-			}
-		}
-
-		if(io.clipOut()){
-			for(unsigned i=0; i<unsigned(frameCount*io.channelsOutDevice()); ++i){
-				float& s = (&io.out(0,0))[i];
-				if		(s<-1.f) s =-1.f;
-				else if	(s> 1.f) s = 1.f;
-			}
-		}
+		// AudioIO::Status has the same flags as PortAudio
+		io.processBlock(statusFlags);
 
 		float **outBuffers = (float **) output;
 		for (int i = 0; i < io.channelsOutDevice(); i++) {
@@ -421,8 +861,10 @@ AudioIO::AudioIO(int framesPerBuf, double framesPerSec, void (* callbackA)(Audio
 	int outChansA, int inChansA, AudioIO::Backend backend)
 :	AudioIOData(userData),
 	callback(callbackA),
-	mZeroNANs(true), mClipOut(true), mAutoZeroOut(true)
+	mZeroNANs(true), mClipOut(true), mAutoZeroOut(true),
+	mClock(al_steady_time_nsec), mOnLoad(0), mLoadHigh(0.8), mLoadLow(0.5)
 {
+	clearLoad();
 	switch(backend) {
 	case PORTAUDIO:
 		mImpl = new PortAudioBackend;
@@ -432,8 +874,12 @@ AudioIO::AudioIO(int framesPerBuf, double framesPerSec, void (* callbackA)(Audio
 	case DUMMY:
 		mImpl = new DummyAudioBackend;
 		break;
+	case OFFLINE:
+		mImpl = new OfflineAudioBackend;
+		break;
 	}
 	init(outChansA, inChansA);
+	scratchSize(1<<20);
 	this->framesPerBuffer(framesPerBuf);
 	channels(inChansA, false);
 	channels(outChansA, true);
@@ -613,12 +1059,52 @@ void AudioIO::framesPerBuffer(int n){
 }
 
 
-bool AudioIO::start(){ return mImpl->start(mFramesPerSecond, mFramesPerBuffer, this); }
+bool AudioIO::start(){
+	if(!mImpl->isRunning()) clearLoad();
+	return mImpl->start(mFramesPerSecond, mFramesPerBuffer, this);
+}
 
 bool AudioIO::stop(){ return mImpl->stop(); }
 
+bool AudioIO::isRunning() const { return mImpl->isRunning(); }
+
+static OfflineAudioBackend * offlineBackend(AudioBackend * b){
+	OfflineAudioBackend * o = dynamic_cast<OfflineAudioBackend *>(b);
+	if(!o) warn("offline settings need the OFFLINE backend", "AudioIO");
+	return o;
+}
+
+AudioIO& AudioIO::offlineInput(const std::string& path){
+	if(OfflineAudioBackend * o = offlineBackend(mImpl)) o->inputFile(path);
+	return *this;
+}
+
+AudioIO& AudioIO::offlineInput(audioGenerator gen, void * userData){
+	if(OfflineAudioBackend * o = offlineBackend(mImpl)) o->inputGenerator(gen, userData);
+	return *this;
+}
+
+AudioIO& AudioIO::offlineOutput(const std::string& path){
+	if(OfflineAudioBackend * o = offlineBackend(mImpl)) o->outputFile(path);
+	return *this;
+}
+
+AudioIO& AudioIO::offlineSpeed(double v){
+	if(OfflineAudioBackend * o = offlineBackend(mImpl)) o->speed(v);
+	return *this;
+}
+
+AudioIO& AudioIO::offlineDuration(double sec){
+	if(OfflineAudioBackend * o = offlineBackend(mImpl)) o->duration(sec);
+	return *this;
+}
+
 bool AudioIO::supportsFPS(double fps) const { return mImpl->supportsFPS(fps); }
 
+void AudioIO::scratchSize(size_t bytes){
+	mScratchArena.resize(bytes);
+}
+
 void AudioIO::print() const {
 	if(mInDevice.id() == mOutDevice.id()){
 		printf("I/O Device:  "); mInDevice.print();
@@ -638,6 +1124,13 @@ void AudioIO::print() const {
 
 //void AudioIO::processAudio(){ frame(0); if(callback) callback(*this); }
 void AudioIO::processAudio(){
+	AL_PROFILE_SCOPE("AudioIO::processAudio");
+
+	// Callbacks run as real-time and their scratch memory lasts one block
+	RTHeapCheck::Scope realtime;
+	LinearArena::Scope arena(scratch());
+	scratch().reset();
+
 	frame(0);
 	if(callback) callback(*this);
 
@@ -648,6 +1141,136 @@ void AudioIO::processAudio(){
 	}
 }
 
+void AudioIO::processBlock(unsigned status){
+	al_nsec begin = mClock();
+	int frameCount = framesPerBuffer();
+
+	if(autoZeroOut()) zeroOut();
+
+	processAudio();	// call callback
+
+	// apply smoothly-ramped gain to all output channels
+	if(usingGain()){
+
+		float dgain = (mGain-mGainPrev) / frameCount;
+
+		for(int j=0; j<channelsOutDevice(); ++j){
+			float * out = outBuffer(j);
+			float gain = mGainPrev;
+
+			for(int i=0; i<frameCount; ++i){
+				out[i] *= gain;
+				gain += dgain;
+			}
+		}
+
+		mGainPrev = mGain;
+	}
+
+	// kill pesky nans so we don't hurt anyone's ears
+	if(zeroNANs()){
+		for(unsigned i=0; i<unsigned(frameCount*channelsOutDevice()); ++i){
+			float& s = (&out(0,0))[i];
+			//if(isnan(s)) s = 0.f;
+			if(s != s) s = 0.f; // portable isnan; only nans do not equal themselves
+		}
+	}
+
+	if(clipOut()){
+		for(unsigned i=0; i<unsigned(frameCount*channelsOutDevice()); ++i){
+			float& s = (&out(0,0))[i];
+			if		(s<-1.f) s =-1.f;
+			else if	(s> 1.f) s = 1.f;
+		}
+	}
+
+	recordLoad(begin, mClock(), status);
+}
+
+void AudioIO::clearLoad(){
+	mLoadCount.store(0);
+	mOverloads.store(0);
+	for(int i=0; i<4; ++i) mXruns[i].store(0);
+	mFirstBlock.store(0);
+	mLastBlock.store(0);
+	mOverloaded = false;
+}
+
+void AudioIO::recordLoad(al_nsec begin, al_nsec end, unsigned status){
+	for(int i=0; i<4; ++i){
+		if(status & (1<<i)) mXruns[i].fetch_add(1, std::memory_order_relaxed);
+	}
+
+	double load = (end - begin) / (secondsPerBuffer() * 1e9);
+	if(load >= 1.) mOverloads.fetch_add(1, std::memory_order_relaxed);
+
+	unsigned long long c = mLoadCount.load(std::memory_order_relaxed);
+	mLoads[c % LOAD_SAMPLES].store(float(load), std::memory_order_relaxed);
+	if(0 == c) mFirstBlock.store(begin, std::memory_order_relaxed);
+	mLastBlock.store(end, std::memory_order_relaxed);
+	mLoadCount.store(c + 1, std::memory_order_release);
+
+	// Separate thresholds keep a load hovering around one from calling back
+	// every block
+	if(mOnLoad){
+		if(!mOverloaded && load >= mLoadHigh){
+			mOverloaded = true;
+			mOnLoad(*this, load, true);
+		}
+		else if(mOverloaded && load < mLoadLow){
+			mOverloaded = false;
+			mOnLoad(*this, load, false);
+		}
+	}
+}
+
+AudioIO::Load AudioIO::load() const {
+	Load l;
+	unsigned long long count = mLoadCount.load(std::memory_order_acquire);
+	unsigned n = count < LOAD_SAMPLES ? unsigned(count) : LOAD_SAMPLES;
+
+	l.history.reserve(n);
+	for(unsigned i=0; i<n; ++i){
+		float v = mLoads[(count - 1 - i) % LOAD_SAMPLES].load(std::memory_order_relaxed);
+		l.load(v);
+		l.history.push_back(v);
+	}
+	std::sort(l.history.begin(), l.history.end());
+
+	l.samples = n;
+	l.blocks = count;
+	l.overloads = mOverloads.load(std::memory_order_relaxed);
+	l.inputUnderflows = mXruns[0].load(std::memory_order_relaxed);
+	l.inputOverflows = mXruns[1].load(std::memory_order_relaxed);
+	l.outputUnderflows = mXruns[2].load(std::memory_order_relaxed);
+	l.outputOverflows = mXruns[3].load(std::memory_order_relaxed);
+	return l;
+}
+
+double AudioIO::Load::percentile(double p) const {
+	if(history.empty()) return 0;
+	p = p < 0. ? 0. : p > 1. ? 1. : p;
+	return history[unsigned((history.size() - 1) * p + 0.5)];
+}
+
+AudioIO& AudioIO::onLoad(loadCallback func, double high, double low){
+	mOnLoad = func;
+	mLoadHigh = high;
+	mLoadLow = low;
+	return *this;
+}
+
+double AudioIO::blocksPerSecond() const {
+	unsigned long long count = mLoadCount.load(std::memory_order_acquire);
+	al_nsec dt = mLastBlock.load(std::memory_order_relaxed) - mFirstBlock.load(std::memory_order_relaxed);
+	return count && dt > 0 ? count / (dt * 1e-9) : 0.;
+}
+
+AudioIO& AudioIO::clock(al_nsec (* func)()){
+	mClock = func ? func : al_steady_time_nsec;
+	return *this;
+}
+
 int AudioIO::channels(bool forOutput) const {
 	return forOutput ? channelsOut() : channelsIn();
 }
@@ -38,7 +38,7 @@ AudioIOData::AudioIOData(void * userData)
 :	mImpl(NULL), mUser(userData), mFrame(0),
 	mFramesPerBuffer(0), mFramesPerSecond(0),
 	mBufI(0), mBufO(0), mBufB(0), mBufT(0), mNumI(0), mNumO(0), mNumB(0),
-	mGain(1), mGainPrev(1)
+	mScratch(&mScratchArena), mGain(1), mGainPrev(1)
 {
 }
 
@@ -2,6 +2,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include "allocore/io/al_File.hpp"
+#include "allocore/io/al_MappedFile.hpp"
 #include "allocore/system/al_Config.h"
 #include <stdlib.h> // realpath (POSIX), _fullpath (Windows)
 #ifdef AL_WINDOWS
@@ -84,6 +85,12 @@ const char * File::readAll(){
 	return mContent;
 }
 
+bool File::readAll(MappedFile& view, int mode){
+	if(!view.open(path(), MappedFile::Mode(mode))) return false;
+	view.advise(MappedFile::SEQUENTIAL);
+	return true;
+}
+
 std::string File::read(const std::string& path){
 	File f(path, "rb");
 	f.open();
@@ -241,18 +248,25 @@ void FileList::print() const {
 }
 
 
-SearchPaths::SearchPaths(const std::string& file) {
+SearchPaths::SearchPaths(const std::string& file)
+:	mIndexRefreshed(0)
+{
 	FilePath fp(file);
 	addAppPaths(fp.path());
 }
 
-SearchPaths::SearchPaths(int argc, char * const argv[], bool recursive){
+SearchPaths::SearchPaths(int argc, char * const argv[], bool recursive)
+:	mIndexRefreshed(0)
+{
 	addAppPaths(argc,argv,recursive);
 }
 
 SearchPaths::SearchPaths(const SearchPaths& cpy)
 :	mSearchPaths(cpy.mSearchPaths),
-	mAppPath(cpy.mAppPath)
+	mAppPath(cpy.mAppPath),
+	mIndex(cpy.mIndex),
+	mIndexCache(cpy.mIndexCache),
+	mIndexRefreshed(cpy.mIndexRefreshed)
 {}
 
 void SearchPaths::addAppPaths(std::string path, bool recursive) {
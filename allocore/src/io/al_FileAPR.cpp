@@ -271,6 +271,7 @@ public:
 
 // This is the one sour egg that needs APR impl for directory scanning...
 FilePath SearchPaths::find(const std::string& name) {
+	if (mIndex) return findIndexed(name);
 	FilePath result;
 	bool found = false;
 	std::list<SearchPaths::searchpath>::iterator iter = mSearchPaths.begin();
@@ -0,0 +1,324 @@
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include "allocore/io/al_FileIndex.hpp"
+#include "allocore/system/al_Time.hpp"
+
+namespace al{
+
+namespace{
+	const char * CACHE_HEADER = "AlloFileIndex 1";
+
+	// Minimum time between refreshes caused by failed lookups
+	const al_sec REFRESH_INTERVAL = 1.;
+
+	// Times are stored as integers so that they compare exactly
+	int64_t micros(al_sec t){ return int64_t(t*1e6 + 0.5); }
+
+	void removeName(
+		std::unordered_multimap<std::string, std::string>& names,
+		const std::string& name, const std::string& dir
+	){
+		typedef std::unordered_multimap<std::string, std::string>::iterator It;
+		std::pair<It, It> r = names.equal_range(name);
+		for(It it = r.first; it != r.second; ++it){
+			if(it->second == dir){
+				names.erase(it);
+				return;
+			}
+		}
+	}
+}
+
+
+// Contents of one directory, read on a worker thread
+struct FileIndex::Scan{
+	int64_t modified;
+	std::vector<std::string> files;
+	std::vector<std::string> dirs;
+	bool ok;
+
+	Scan(): modified(0), ok(false){}
+
+	void read(const std::string& path){
+		// Take the time first, so that changes made while reading are seen
+		// by the next refresh
+		modified = micros(File::modified(path));
+		if(!File::isDirectory(path)) return;
+		Dir dir;
+		if(!dir.open(path)) return;
+		ok = true;
+		while(dir.read()){
+			const FileInfo& e = dir.entry();
+			const std::string& name = e.name();
+			if(FileInfo::REG == e.type()){
+				files.push_back(name);
+			}
+			else if(FileInfo::DIR == e.type() && !name.empty() && name[0] != '.'){
+				dirs.push_back(name);
+			}
+		}
+	}
+};
+
+
+FileIndex::FileIndex(ThreadPool& pool)
+:	mPool(pool), mDirty(false)
+{}
+
+void FileIndex::clear(){
+	mDirs.clear();
+	mNames.clear();
+	mInvalid.clear();
+	mDirty = true;
+}
+
+void FileIndex::unlinkNames(const std::string& dir, const Entry& e){
+	for(unsigned i=0; i<e.files.size(); ++i) removeName(mNames, e.files[i], dir);
+}
+
+void FileIndex::erase(const std::string& dir){
+	std::unordered_map<std::string, Entry>::iterator it = mDirs.find(dir);
+	if(it == mDirs.end()) return;
+	unlinkNames(dir, it->second);
+	std::vector<std::string> sub;
+	sub.swap(it->second.dirs);
+	mDirs.erase(it);
+	mInvalid.erase(dir);
+	mDirty = true;
+	for(unsigned i=0; i<sub.size(); ++i) erase(dir + sub[i] + AL_FILE_DELIMITER_STR);
+}
+
+void FileIndex::set(const std::string& dir, Scan& scan, bool recursive){
+	if(!scan.ok){
+		erase(dir);
+		return;
+	}
+
+	Entry& e = mDirs[dir];
+	unlinkNames(dir, e);
+
+	// Drop subdirectories that went away, along with everything below them
+	if(!e.dirs.empty()){
+		std::unordered_set<std::string> now(scan.dirs.begin(), scan.dirs.end());
+		for(unsigned i=0; i<e.dirs.size(); ++i){
+			if(!now.count(e.dirs[i])) erase(dir + e.dirs[i] + AL_FILE_DELIMITER_STR);
+		}
+	}
+
+	e.modified = scan.modified;
+	e.files.swap(scan.files);
+	e.dirs.swap(scan.dirs);
+	e.recursive = e.recursive || recursive;
+	for(unsigned i=0; i<e.files.size(); ++i){
+		mNames.insert(std::make_pair(e.files[i], dir));
+	}
+	mInvalid.erase(dir);
+	mDirty = true;
+}
+
+void FileIndex::crawl(std::vector<std::string>& dirs, bool recursive){
+	// APR is initialized on first use, which must not happen on several
+	// threads at once
+	{ Dir init; }
+
+	std::vector<Scan> scans;
+	std::vector<std::string> next;
+
+	// Read one level of the tree at a time
+	while(!dirs.empty()){
+		scans.clear();
+		scans.resize(dirs.size());
+		mPool.parallelFor(0, dirs.size(), 1, [&](int64_t i){
+			scans[i].read(dirs[i]);
+		});
+
+		next.clear();
+		for(unsigned i=0; i<dirs.size(); ++i){
+			set(dirs[i], scans[i], recursive);
+			if(!recursive || !scans[i].ok) continue;
+			const std::vector<std::string>& sub = mDirs[dirs[i]].dirs;
+			for(unsigned j=0; j<sub.size(); ++j){
+				std::string path = dirs[i] + sub[j] + AL_FILE_DELIMITER_STR;
+				std::unordered_map<std::string, Entry>::const_iterator it = mDirs.find(path);
+				if(it == mDirs.end() || !it->second.recursive) next.push_back(path);
+			}
+		}
+		dirs.swap(next);
+	}
+}
+
+void FileIndex::update(){
+	if(mInvalid.empty()) return;
+
+	std::vector<std::string> dirs[2];	// non-recursive and recursive
+	for(std::unordered_set<std::string>::iterator it = mInvalid.begin(); it != mInvalid.end(); ++it){
+		std::unordered_map<std::string, Entry>::const_iterator d = mDirs.find(*it);
+		if(d != mDirs.end()) dirs[d->second.recursive].push_back(*it);
+	}
+	mInvalid.clear();
+	crawl(dirs[0], false);
+	crawl(dirs[1], true);
+}
+
+void FileIndex::invalidate(const std::string& dir){
+	std::string path = File::conformDirectory(dir);
+	if(mDirs.count(path)) mInvalid.insert(path);
+}
+
+unsigned FileIndex::refresh(){
+	std::vector<std::string> dirs;
+	dirs.reserve(mDirs.size());
+	for(std::unordered_map<std::string, Entry>::iterator it = mDirs.begin(); it != mDirs.end(); ++it){
+		dirs.push_back(it->first);
+	}
+
+	{ Dir init; }
+	std::vector<int64_t> times(dirs.size());
+	mPool.parallelFor(0, dirs.size(), 64, [&](int64_t i){
+		times[i] = micros(File::modified(dirs[i]));
+	});
+
+	for(unsigned i=0; i<dirs.size(); ++i){
+		if(mDirs[dirs[i]].modified != times[i]) mInvalid.insert(dirs[i]);
+	}
+	unsigned count = mInvalid.size();
+	update();
+	return count;
+}
+
+bool FileIndex::find(
+	const std::string& name, const std::string& searchDir, bool recursive,
+	FilePath& result
+){
+	std::string dir = File::conformDirectory(searchDir);
+	update();
+
+	std::unordered_map<std::string, Entry>::const_iterator it = mDirs.find(dir);
+	if(it == mDirs.end() || (recursive && !it->second.recursive)){
+		std::vector<std::string> dirs(1, dir);
+		crawl(dirs, recursive);
+	}
+
+	// Choose the shallowest match, then the first by name, so that results
+	// do not depend on the order of the hash table
+	typedef std::unordered_multimap<std::string, std::string>::const_iterator It;
+	std::pair<It, It> r = mNames.equal_range(name);
+	const std::string * best = 0;
+	for(It i = r.first; i != r.second; ++i){
+		const std::string& d = i->second;
+		bool inside = recursive ? 0 == d.compare(0, dir.size(), dir) : d == dir;
+		if(inside && (!best || d.size() < best->size() || (d.size() == best->size() && d < *best))){
+			best = &d;
+		}
+	}
+
+	if(best){
+		result.file(name);
+		result.path(*best);
+		return true;
+	}
+	return false;
+}
+
+bool FileIndex::save(const std::string& path){
+	// Write to a temporary file first, so that the cache is never left
+	// half-written
+	std::string tmp = path + ".tmp";
+	{
+		std::ofstream f(tmp.c_str(), std::ios::out | std::ios::trunc);
+		if(!f.good()) return false;
+		f << CACHE_HEADER << "\n";
+		for(std::unordered_map<std::string, Entry>::iterator it = mDirs.begin(); it != mDirs.end(); ++it){
+			const Entry& e = it->second;
+			if(it->first.find('\n') != std::string::npos) continue;
+			f << "d " << e.recursive << " " << e.modified << " " << it->first << "\n";
+			for(unsigned i=0; i<e.files.size(); ++i){
+				if(e.files[i].find('\n') == std::string::npos) f << "f " << e.files[i] << "\n";
+			}
+			for(unsigned i=0; i<e.dirs.size(); ++i){
+				if(e.dirs[i].find('\n') == std::string::npos) f << "s " << e.dirs[i] << "\n";
+			}
+		}
+		if(!f.good()) return false;
+	}
+	if(0 != std::rename(tmp.c_str(), path.c_str())){
+		std::remove(tmp.c_str());
+		return false;
+	}
+	mDirty = false;
+	return true;
+}
+
+bool FileIndex::load(const std::string& path){
+	std::ifstream f(path.c_str());
+	std::string line;
+	if(!std::getline(f, line) || line != CACHE_HEADER) return false;
+
+	clear();
+	Entry * e = 0;
+	std::string dir;
+	while(std::getline(f, line)){
+		if(line.size() < 2) continue;
+		if('d' == line[0]){
+			int recursive = 0;
+			long long modified = 0;
+			int n = 0;
+			if(2 != std::sscanf(line.c_str(), "d %d %lld %n", &recursive, &modified, &n) || 0 == n){
+				e = 0;
+				continue;
+			}
+			dir = line.substr(n);
+			e = &mDirs[dir];
+			e->modified = modified;
+			e->recursive = recursive != 0;
+		}
+		else if(e && 'f' == line[0]){
+			e->files.push_back(line.substr(2));
+			mNames.insert(std::make_pair(e->files.back(), dir));
+		}
+		else if(e && 's' == line[0]){
+			e->dirs.push_back(line.substr(2));
+		}
+	}
+	mDirty = false;
+	return true;
+}
+
+
+
+FilePath SearchPaths::findIndexed(const std::string& name){
+	FilePath result;
+	for(int pass=0; pass<2; ++pass){
+		bool found = false;
+		iterator it = mSearchPaths.begin();
+		while(!found && it != mSearchPaths.end()){
+			found = mIndex->find(name, it->first, it->second, result);
+			++it;
+		}
+		if(found && File::exists(result.filepath())) break;
+		result = FilePath();
+
+		// The index is out of date if it named a file that is gone. Otherwise
+		// the file may have been created since, but checking is limited so
+		// that repeated lookups of missing files stay cheap.
+		al_sec now = al_steady_time();
+		if(pass || (!found && mIndexRefreshed >= 0 && now - mIndexRefreshed < REFRESH_INTERVAL)) break;
+		mIndexRefreshed = now;
+		mIndex->refresh();
+	}
+
+	if(!mIndexCache.empty() && mIndex->dirty()) mIndex->save(mIndexCache);
+	return result;
+}
+
+SearchPaths& SearchPaths::useIndex(const std::string& cacheFile){
+	mIndex = std::make_shared<FileIndex>();
+	mIndexCache = cacheFile;
+	// A loaded index is checked on the first failed lookup
+	mIndexRefreshed = al_steady_time();
+	if(!cacheFile.empty() && mIndex->load(cacheFile)) mIndexRefreshed = -1;
+	return *this;
+}
+
+} // al::
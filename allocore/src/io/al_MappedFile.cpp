@@ -0,0 +1,315 @@
+#include <cstdio>
+#include "allocore/io/al_MappedFile.hpp"
+#include "allocore/system/al_Config.h"
+#include "allocore/system/al_Printing.hpp"
+
+#ifdef AL_WINDOWS
+	#define WIN32_LEAN_AND_MEAN
+	#define VC_EXTRALEAN
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace al{
+
+namespace{
+	// Data of empty mappings, which must not be null
+	char gEmpty[1] = {0};
+
+	// Size of chunks read by prefetcher
+	const size_t PREFETCH_CHUNK = 1<<20;
+}
+
+MappedFile::MappedFile()
+:	mData(0), mSize(0), mMode(READ_ONLY), mHandle(0)
+{}
+
+MappedFile::MappedFile(const std::string& path, Mode mode, int flags)
+:	mData(0), mSize(0), mMode(READ_ONLY), mHandle(0)
+{
+	open(path, mode, flags);
+}
+
+MappedFile::MappedFile(MappedFile&& other)
+:	mData(other.mData), mSize(other.mSize), mPath(other.mPath),
+	mMode(other.mMode), mHandle(other.mHandle)
+{
+	other.mData = 0;
+	other.mSize = 0;
+	other.mHandle = 0;
+}
+
+MappedFile& MappedFile::operator= (MappedFile&& other){
+	if(this != &other){
+		close();
+		mData = other.mData;
+		mSize = other.mSize;
+		mPath = other.mPath;
+		mMode = other.mMode;
+		mHandle = other.mHandle;
+		other.mData = 0;
+		other.mSize = 0;
+		other.mHandle = 0;
+	}
+	return *this;
+}
+
+MappedFile::~MappedFile(){
+	close();
+}
+
+#ifdef AL_WINDOWS
+
+size_t MappedFile::pageSize(){
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwAllocationGranularity;
+}
+
+bool MappedFile::open(const std::string& path, Mode mode, int flags){
+	close();
+	mPath = path;
+	mMode = mode;
+
+	DWORD access = SHARED == mode ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ;
+	HANDLE file = CreateFileA(path.c_str(), access, FILE_SHARE_READ | FILE_SHARE_WRITE,
+		NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if(INVALID_HANDLE_VALUE == file) return false;
+
+	LARGE_INTEGER size;
+	if(!GetFileSizeEx(file, &size)){
+		CloseHandle(file);
+		return false;
+	}
+	mSize = size_t(size.QuadPart);
+	if(0 == mSize){
+		CloseHandle(file);
+		mData = gEmpty;
+		return true;
+	}
+
+	DWORD protect = READ_ONLY == mode ? PAGE_READONLY : SHARED == mode ? PAGE_READWRITE : PAGE_WRITECOPY;
+	DWORD view = READ_ONLY == mode ? FILE_MAP_READ : SHARED == mode ? FILE_MAP_WRITE : FILE_MAP_COPY;
+	HANDLE map = CreateFileMappingA(file, NULL, protect, 0, 0, NULL);
+	CloseHandle(file);
+	if(NULL == map){
+		mSize = 0;
+		return false;
+	}
+
+	mData = (char *)MapViewOfFile(map, view, 0, 0, 0);
+	if(!mData){
+		CloseHandle(map);
+		mSize = 0;
+		return false;
+	}
+	mHandle = map;
+	if(flags & POPULATE) willNeed();
+	return true;
+}
+
+void MappedFile::close(){
+	if(mData && mData != gEmpty) UnmapViewOfFile(mData);
+	if(mHandle) CloseHandle((HANDLE)mHandle);
+	mData = 0;
+	mSize = 0;
+	mHandle = 0;
+}
+
+MappedFile& MappedFile::advise(Access v){
+	// Windows sets read-ahead per file handle when opening
+	return *this;
+}
+
+MappedFile& MappedFile::willNeed(size_t offset, size_t length){
+	if(mSize && offset < mSize){
+		if(length > mSize - offset) length = mSize - offset;
+		// Touch one byte per page
+		volatile char sum = 0;
+		size_t step = pageSize();
+		for(size_t i=offset; i<offset+length; i+=step) sum += mData[i];
+	}
+	return *this;
+}
+
+bool MappedFile::flush(bool wait){
+	if(!mSize || SHARED != mMode) return true;
+	return FALSE != FlushViewOfFile(mData, 0);
+}
+
+#else
+
+size_t MappedFile::pageSize(){
+	return size_t(sysconf(_SC_PAGESIZE));
+}
+
+bool MappedFile::open(const std::string& path, Mode mode, int flags){
+	close();
+	mPath = path;
+	mMode = mode;
+
+	int fd = ::open(path.c_str(), SHARED == mode ? O_RDWR : O_RDONLY);
+	if(fd < 0) return false;
+
+	struct stat s;
+	if(0 != fstat(fd, &s)){
+		::close(fd);
+		return false;
+	}
+	mSize = size_t(s.st_size);
+	if(0 == mSize){
+		::close(fd);
+		mData = gEmpty;
+		return true;
+	}
+
+	int prot = READ_ONLY == mode ? PROT_READ : PROT_READ | PROT_WRITE;
+	int share = SHARED == mode ? MAP_SHARED : MAP_PRIVATE;
+	#ifdef MAP_POPULATE
+	if(flags & POPULATE) share |= MAP_POPULATE;
+	#endif
+
+	void * p = mmap(0, mSize, prot, share, fd, 0);
+	::close(fd); // the mapping keeps the file open
+	if(MAP_FAILED == p){
+		mSize = 0;
+		return false;
+	}
+	mData = (char *)p;
+
+	if(flags & HUGE_PAGES){
+		#ifdef MADV_HUGEPAGE
+		madvise(mData, mSize, MADV_HUGEPAGE);
+		#endif
+	}
+	#ifndef MAP_POPULATE
+	if(flags & POPULATE) willNeed();
+	#endif
+	return true;
+}
+
+void MappedFile::close(){
+	if(mData && mData != gEmpty) munmap(mData, mSize);
+	mData = 0;
+	mSize = 0;
+}
+
+MappedFile& MappedFile::advise(Access v){
+	if(mSize){
+		int advice = MADV_NORMAL;
+		switch(v){
+		case SEQUENTIAL:	advice = MADV_SEQUENTIAL; break;
+		case RANDOM:		advice = MADV_RANDOM; break;
+		default:;
+		}
+		madvise(mData, mSize, advice);
+	}
+	return *this;
+}
+
+MappedFile& MappedFile::willNeed(size_t offset, size_t length){
+	if(mSize && offset < mSize){
+		if(length > mSize - offset) length = mSize - offset;
+		// The range must start on a page boundary
+		size_t start = offset - offset % pageSize();
+		madvise(mData + start, length + (offset - start), MADV_WILLNEED);
+	}
+	return *this;
+}
+
+bool MappedFile::flush(bool wait){
+	if(!mSize || SHARED != mMode) return true;
+	return 0 == msync(mData, mSize, wait ? MS_SYNC : MS_ASYNC);
+}
+
+#endif
+
+
+
+FilePrefetcher::FilePrefetcher()
+:	mRunning(false), mStarted(false), mCancel(false), mFiles(0), mBytes(0)
+{
+	mFunc.self = this;
+}
+
+FilePrefetcher::~FilePrefetcher(){
+	cancel();
+	wait();
+	if(mStarted) mThread.join();
+}
+
+void FilePrefetcher::start(const std::string& path){
+	start(std::vector<std::string>(1, path));
+}
+
+void FilePrefetcher::start(const std::vector<std::string>& paths){
+	if(paths.empty()) return;
+	std::lock_guard<std::mutex> lock(mMutex);
+	mQueue.insert(mQueue.end(), paths.begin(), paths.end());
+	mCancel = false;
+	if(!mRunning){
+		// The previous thread has left its loop and is about to end
+		if(mStarted) mThread.join();
+		mRunning = true;
+		mStarted = mThread.start(mFunc);
+		if(!mStarted){
+			AL_WARN("FilePrefetcher: could not start thread");
+			mRunning = false;
+			mQueue.clear();
+		}
+	}
+}
+
+void FilePrefetcher::cancel(){
+	std::lock_guard<std::mutex> lock(mMutex);
+	mCancel = true;
+	mQueue.clear();
+}
+
+bool FilePrefetcher::done(){
+	std::lock_guard<std::mutex> lock(mMutex);
+	return !mRunning;
+}
+
+void FilePrefetcher::wait(){
+	std::unique_lock<std::mutex> lock(mMutex);
+	while(mRunning) mIdle.wait(lock);
+}
+
+void FilePrefetcher::run(){
+	std::vector<char> buf(PREFETCH_CHUNK);
+	for(;;){
+		std::string path;
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			if(mQueue.empty()){
+				mRunning = false;
+				mIdle.notify_all();
+				return;
+			}
+			path = mQueue.front();
+			mQueue.pop_front();
+		}
+
+		// Reading the file is the most portable way to load it into the page
+		// cache; the kernel is also told to read ahead on its own.
+		FILE * fp = fopen(path.c_str(), "rb");
+		if(!fp) continue;
+		#if defined(POSIX_FADV_WILLNEED)
+		posix_fadvise(fileno(fp), 0, 0, POSIX_FADV_SEQUENTIAL);
+		posix_fadvise(fileno(fp), 0, 0, POSIX_FADV_WILLNEED);
+		#endif
+		size_t n;
+		while(!mCancel.load() && (n = fread(&buf[0], 1, buf.size(), fp)) > 0){
+			mBytes += n;
+		}
+		fclose(fp);
+		if(!mCancel.load()) ++mFiles;
+	}
+}
+
+} // al::
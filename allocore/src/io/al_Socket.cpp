@@ -177,6 +177,14 @@ public:
 			return false;
 		}
 
+		// Without this, connecting to a broadcast address fails
+		if(type & BROADCAST){
+			BOOL on = TRUE;
+			if(SOCKET_ERROR == ::setsockopt(mSocket, SOL_SOCKET, SO_BROADCAST, (char *)&on, sizeof(on))){
+				AL_WARN("unable to enable broadcast on socket at %s:%i: %S", address.c_str(), port, errorString());
+			}
+		}
+
 		// Set timeout
 		timeout(timeoutSec);
 
@@ -344,6 +352,10 @@ uint16_t Socket::port() const { return mImpl->mPort; }
 
 al_sec Socket::timeout() const { return mImpl->mTimeout; }
 
+int Socket::descriptor() const {
+	return mImpl->opened() ? int(mImpl->mSocket) : -1;
+}
+
 bool Socket::bind(){ return mImpl->bind(); }
 
 bool Socket::connect(){ return mImpl->connect(); }
@@ -28,8 +28,13 @@ You can actually use connect() on UDP socket as an option. In that case, you can
 #include "../private/al_ImplAPR.h"
 #if defined(AL_LINUX)
 #include "apr-1.0/apr_network_io.h"
+#include "apr-1.0/apr_portable.h"
 #else
 #include "apr-1/apr_network_io.h"
+#include "apr-1/apr_portable.h"
+#endif
+#ifndef AL_WINDOWS
+#include <sys/socket.h>
 #endif
 
 #define PRINT_SOCKADDR(s)\
@@ -146,6 +151,17 @@ struct Socket::Impl : public ImplAPR {
 			apr_socket_create(&mSock, mSockAddr->family, sockType, sockProto, mPool)
 		);
 
+		// Without this, connecting to a broadcast address fails
+		if(type & BROADCAST){
+			apr_os_sock_t fd;
+			int on = 1;
+			if(APR_SUCCESS != apr_os_sock_get(&fd, mSock)
+				|| 0 != setsockopt(fd, SOL_SOCKET, SO_BROADCAST, (const char *)&on, sizeof(on))
+			){
+				AL_WARN("unable to enable broadcast on socket at %s:%i", address.c_str(), port);
+			}
+		}
+
 		// Set timeout
 		timeout(timeoutSec);
 
@@ -276,6 +292,12 @@ uint16_t Socket::port() const { return mImpl->mPort; }
 
 al_sec Socket::timeout() const { return mImpl->mTimeout; }
 
+int Socket::descriptor() const {
+	apr_os_sock_t fd;
+	if(!mImpl->opened() || APR_SUCCESS != apr_os_sock_get(&fd, mImpl->mSock)) return -1;
+	return int(fd);
+}
+
 bool Socket::bind(){ return mImpl->bind(); }
 
 bool Socket::connect(){ return mImpl->connect(); }
@@ -3,6 +3,7 @@
 
 #ifdef __cplusplus
 #include "allocore/protocol/al_Serialize.hpp"
+#include "allocore/system/al_Printing.hpp"
 
 namespace al{
 
@@ -41,6 +42,159 @@ const std::vector<char>& Deserializer::buf() const { return mBuf; }
 
 char * Deserializer::bufDec(){ return &mBuf[mStart]; }
 
+
+
+namespace ser{
+
+Schema::Schema(uint32_t structSize_)
+:	mStructSize(structSize_), mID(0)
+{	updateID(); }
+
+Schema& Schema::add(uint8_t type, uint32_t offset, uint32_t count){
+	Field f = { type, offset, count };
+	mFields.push_back(f);
+	updateID();
+	return *this;
+}
+
+Schema& Schema::structSize(uint32_t v){
+	mStructSize = v;
+	updateID();
+	return *this;
+}
+
+void Schema::swapBytes(void * structs, uint32_t num) const {
+	char * s = (char *)structs;
+	for(uint32_t k=0; k<num; ++k){
+		for(unsigned j=0; j<mFields.size(); ++j){
+			const Field& f = mFields[j];
+			char * b = s + f.offset;
+			switch(serTypeSize(f.type)){
+			case 2: for(uint32_t i=0; i<f.count; ++i) serSwapBytes2(b + i*2); break;
+			case 4: for(uint32_t i=0; i<f.count; ++i) serSwapBytes4(b + i*4); break;
+			case 8: for(uint32_t i=0; i<f.count; ++i) serSwapBytes8(b + i*8); break;
+			default:;
+			}
+		}
+		s += mStructSize;
+	}
+}
+
+// FNV-1a hash over the layout
+void Schema::updateID(){
+	uint32_t h = 2166136261u;
+	#define HASH(v) { uint32_t x=(v); for(int i=0;i<4;++i){ h^=(x>>(i*8))&0xff; h*=16777619u; } }
+	HASH(mStructSize);
+	for(unsigned j=0; j<mFields.size(); ++j){
+		HASH(mFields[j].type);
+		HASH(mFields[j].offset);
+		HASH(mFields[j].count);
+	}
+	#undef HASH
+	mID = h;
+}
+
+} // ser::
+
+
+/*
+Block layout (16-byte header followed by structs padded to 8 bytes):
+	0	uint8		'S'
+	1	uint8		byte order of writer (0 = little, 1 = big)
+	2	uint16		reserved
+	4	uint32		schema id
+	8	uint32		struct size in bytes
+	12	uint32		number of structs
+All header words are in the byte order of the writer.
+*/
+static const char SCHEMA_MAGIC = 'S';
+
+static inline uint32_t schemaPad(uint32_t n){ return (n + 7) & ~7u; }
+
+SchemaSerializer::SchemaSerializer(const ser::Schema& schema)
+:	mSchema(&schema)
+{}
+
+uint32_t SchemaSerializer::blockSize(uint32_t numStructs) const {
+	return headerSize() + schemaPad(numStructs * mSchema->structSize());
+}
+
+SchemaSerializer& SchemaSerializer::addStructs(const void * v, uint32_t num, uint32_t structSize){
+	if(structSize != mSchema->structSize()){
+		AL_WARN("Struct size (%u) does not match schema (%u)", structSize, mSchema->structSize());
+		return *this;
+	}
+
+	size_t start = mBuf.size();
+	mBuf.resize(start + blockSize(num));
+	char * b = &mBuf[start];
+
+	uint32_t words[3] = { mSchema->id(), structSize, num };
+	b[0] = SCHEMA_MAGIC;
+	b[1] = ser::hostIsBigEndian() ? 1 : 0;
+	b[2] = b[3] = 0;
+	memcpy(b+4, words, sizeof(words));
+	if(num) memcpy(b + headerSize(), v, num * structSize);
+	return *this;
+}
+
+SchemaSerializer& SchemaSerializer::reserve(uint32_t numStructs){
+	mBuf.reserve(mBuf.size() + blockSize(numStructs));
+	return *this;
+}
+
+SchemaSerializer& SchemaSerializer::clear(){
+	mBuf.clear();
+	return *this;
+}
+
+
+SchemaDeserializer::SchemaDeserializer(const ser::Schema& schema, char * b, uint32_t n)
+:	mSchema(&schema), mBuf(b), mSize(n), mPos(0), mGood(true)
+{}
+
+SchemaDeserializer::SchemaDeserializer(const ser::Schema& schema, std::vector<char>& b)
+:	mSchema(&schema), mBuf(b.empty() ? NULL : &b[0]), mSize(b.size()), mPos(0), mGood(true)
+{}
+
+const void * SchemaDeserializer::next(uint32_t& num, uint32_t structSize){
+	num = 0;
+	const uint32_t hdr = SchemaSerializer::headerSize();
+	if(!mGood || mPos + hdr > mSize) return NULL;
+
+	char * b = mBuf + mPos;
+	if(b[0] != SCHEMA_MAGIC){ mGood=false; return NULL; }
+
+	uint32_t words[3];
+	memcpy(words, b+4, sizeof(words));
+	bool swap = (b[1] != 0) != ser::hostIsBigEndian();
+	if(swap){
+		for(int i=0; i<3; ++i) serSwapBytes4(words+i);
+	}
+
+	if(words[0] != mSchema->id() || words[1] != mSchema->structSize() || words[1] != structSize){
+		mGood=false; return NULL;
+	}
+
+	// Check the count against the space left before multiplying, as a
+	// count from the network could make the size wrap around
+	const uint32_t avail = mSize - mPos - hdr;
+	if(0 == words[1] || words[2] > avail / words[1]){ mGood=false; return NULL; }
+	uint32_t bytes = words[1] * words[2];
+
+	char * data = b + hdr;
+	if(swap){
+		// Convert in place once and mark block as native
+		mSchema->swapBytes(data, words[2]);
+		b[1] = ser::hostIsBigEndian() ? 1 : 0;
+		memcpy(b+4, words, sizeof(words));
+	}
+
+	mPos += hdr + schemaPad(bytes);
+	num = words[2];
+	return data;
+}
+
 } // al::
 #endif
 
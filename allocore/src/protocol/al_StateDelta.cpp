@@ -0,0 +1,591 @@
+#include <string.h>
+#include "allocore/protocol/al_StateDelta.hpp"
+#include "allocore/system/al_Printing.hpp"
+
+/*
+Packet layout (host byte order):
+	0	uint8[2]	magic 'D','S'
+	2	uint8		flags (bit 0: keyframe)
+	3	uint8		version
+	4	uint32		frame sequence number
+	8	uint32		state size in bytes
+	12	uint32		packet index within frame
+	16	uint32		number of packets in frame
+	20	uint16		number of entries
+	22	uint16		reserved
+	24	entries...
+
+Entry layout:
+	0	uint32		byte offset into state
+	4	uint16		number of state bytes covered
+	6	uint16		number of encoded bytes following
+	8	encoded bytes...
+
+Encoded bytes are a sequence of tokens. A token byte with the high bit set is
+a run of (t & 127) + 1 zero bytes. Otherwise it is followed by (t + 1) literal
+bytes. Bytes are XOR-ed against the previous state, except in keyframes where
+they are the state itself.
+*/
+
+namespace al{
+
+namespace{
+
+const uint32_t HEADER_SIZE = 24;
+const uint32_t ENTRY_SIZE = 8;
+const uint8_t VERSION = 2;
+const uint8_t FLAG_KEY = 1;
+
+template <class T>
+inline T get(const char * b){ T v; memcpy(&v, b, sizeof(T)); return v; }
+
+template <class T>
+inline void put(char * b, T v){ memcpy(b, &v, sizeof(T)); }
+
+// Returns whether sequence number a is newer than b (with wrap-around)
+inline bool newer(uint32_t a, uint32_t b){ return int32_t(a - b) > 0; }
+
+// XOR-RLE encode n bytes of a against b (or against zero if b is NULL).
+// Stops on a token boundary when output capacity is reached.
+// Returns bytes written; 'consumed' receives the number of input bytes used.
+uint32_t rleEncode(
+	const char * a, const char * b, uint32_t n,
+	char * out, uint32_t cap, uint32_t& consumed
+){
+	#define X(i) (b ? char(a[i]^b[i]) : a[i])
+	uint32_t i=0, o=0;
+	while(i<n && o<cap){
+		if(0 == X(i)){
+			uint32_t r = 1;
+			while(r<128 && i+r<n && 0 == X(i+r)) ++r;
+			out[o++] = char(0x80 | (r-1));
+			i += r;
+		}
+		else{
+			// Literal runs end at a pair of zeros
+			uint32_t L = 1;
+			while(L<128 && i+L<n && !(0 == X(i+L) && (i+L+1<n && 0 == X(i+L+1)))) ++L;
+			if(o + 1 + L > cap) L = cap - o - 1;
+			if(0 == L) break;
+			out[o++] = char(L-1);
+			for(uint32_t k=0; k<L; ++k) out[o++] = X(i+k);
+			i += L;
+		}
+	}
+	#undef X
+	consumed = i;
+	return o;
+}
+
+// Returns number of state bytes covered by encoded data or -1 if malformed
+int rleLength(const char * enc, uint32_t n){
+	int len = 0;
+	uint32_t i = 0;
+	while(i<n){
+		uint8_t t = enc[i++];
+		if(t & 0x80){
+			len += (t & 127) + 1;
+		}
+		else{
+			i += t + 1;
+			if(i > n) return -1;
+			len += t + 1;
+		}
+	}
+	return len;
+}
+
+// Apply encoded data to dst, either XOR-ing or assigning
+void rleDecode(const char * enc, uint32_t n, char * dst, bool assign){
+	uint32_t i = 0;
+	while(i<n){
+		uint8_t t = enc[i++];
+		uint32_t r = (t & 127) + 1;
+		if(t & 0x80){
+			if(assign) memset(dst, 0, r);
+		}
+		else if(assign){
+			memcpy(dst, enc+i, r);
+			i += r;
+		}
+		else{
+			for(uint32_t k=0; k<r; ++k) dst[k] ^= enc[i+k];
+			i += r;
+		}
+		dst += r;
+	}
+}
+
+} // ::
+
+
+StateDeltaEncoder::StateDeltaEncoder(uint32_t size, uint32_t blockSize_, uint32_t packetSize_)
+:	mBlockSize(64), mPacketSize(1400), mKeyInterval(60),
+	mSeq(0), mLastKeySeq(0), mBlocksChanged(0), mPos(0), mEntry(0),
+	mKey(false), mForceKey(false), mHasPrev(false)
+{
+	stateSize(size);
+	blockSize(blockSize_);
+	packetSize(packetSize_);
+}
+
+StateDeltaEncoder& StateDeltaEncoder::stateSize(uint32_t v){
+	mPrev.assign(v, 0);
+	mHasPrev = false;
+	return *this;
+}
+
+StateDeltaEncoder& StateDeltaEncoder::blockSize(uint32_t v){
+	mBlockSize = v ? v : 1;
+	return *this;
+}
+
+StateDeltaEncoder& StateDeltaEncoder::packetSize(uint32_t v){
+	// Must hold header, one entry and at least a few encoded bytes, and
+	// entry lengths must fit in 16 bits
+	const uint32_t minSize = HEADER_SIZE + ENTRY_SIZE + 16;
+	if(v < minSize) v = minSize;
+	if(v > 65535) v = 65535;
+	mPacketSize = v;
+	return *this;
+}
+
+uint32_t StateDeltaEncoder::bytesEncoded() const {
+	uint32_t n = 0;
+	for(unsigned i=0; i<mPacketLens.size(); ++i) n += mPacketLens[i];
+	return n;
+}
+
+void StateDeltaEncoder::beginPacket(){
+	mPacketLens.push_back(0);
+	if(mPackets.size() < mPacketLens.size() * mPacketSize){
+		mPackets.resize(mPacketLens.size() * mPacketSize);
+	}
+	char * p = cur();
+	p[0] = 'D';
+	p[1] = 'S';
+	p[2] = mKey ? FLAG_KEY : 0;
+	p[3] = VERSION;
+	put<uint32_t>(p+4, mSeq);
+	put<uint32_t>(p+8, mPrev.size());
+	put<uint32_t>(p+12, mPacketLens.size()-1);
+	put<uint32_t>(p+16, 0);
+	put<uint16_t>(p+20, 0);
+	put<uint16_t>(p+22, 0);
+	mPos = HEADER_SIZE;
+	mEntry = 0;
+}
+
+void StateDeltaEncoder::endPacket(){
+	mPacketLens.back() = mPos;
+}
+
+void StateDeltaEncoder::encodeRange(const char * a, const char * b, uint32_t off, uint32_t len){
+	uint32_t pos = 0;
+	while(pos < len){
+		char * p = cur();
+
+		// Continue open entry if contiguous, otherwise start a new one
+		bool extend = mEntry
+			&& (get<uint32_t>(p+mEntry) + get<uint16_t>(p+mEntry+4) == off+pos);
+		uint32_t need = extend ? 2 : ENTRY_SIZE + 2;
+		if(mPos + need > mPacketSize){
+			endPacket();
+			beginPacket();
+			continue;
+		}
+		if(!extend){
+			mEntry = mPos;
+			put<uint32_t>(p+mEntry, off+pos);
+			put<uint16_t>(p+mEntry+4, 0);
+			put<uint16_t>(p+mEntry+6, 0);
+			put<uint16_t>(p+20, get<uint16_t>(p+20)+1);
+			mPos += ENTRY_SIZE;
+		}
+
+		// Entry raw length is limited to 16 bits
+		uint32_t raw = get<uint16_t>(p+mEntry+4);
+		uint32_t chunk = len - pos;
+		if(chunk > 65535 - raw) chunk = 65535 - raw;
+
+		uint32_t consumed;
+		uint32_t enc = rleEncode(
+			a+pos, b ? b+pos : NULL, chunk, p+mPos, mPacketSize-mPos, consumed
+		);
+		mPos += enc;
+		put<uint16_t>(p+mEntry+4, raw + consumed);
+		put<uint16_t>(p+mEntry+6, get<uint16_t>(p+mEntry+6) + enc);
+		pos += consumed;
+
+		// Packet or entry full
+		if(pos < len){
+			if(raw + consumed >= 65535){
+				mEntry = 0;
+			}
+			else{
+				endPacket();
+				beginPacket();
+			}
+		}
+	}
+}
+
+uint32_t StateDeltaEncoder::encode(const void * state){
+	const char * s = (const char *)state;
+	const uint32_t N = mPrev.size();
+
+	++mSeq;
+	mKey = mForceKey || !mHasPrev
+		|| (mKeyInterval && (mSeq - mLastKeySeq) >= mKeyInterval);
+	if(mKey){
+		mLastKeySeq = mSeq;
+		mForceKey = false;
+	}
+
+	mPacketLens.clear();
+	mBlocksChanged = 0;
+	beginPacket();
+
+	char * prev = N ? &mPrev[0] : NULL;
+	for(uint32_t off=0; off<N; off+=mBlockSize){
+		uint32_t len = N - off;
+		if(len > mBlockSize) len = mBlockSize;
+		if(!mKey && 0 == memcmp(s+off, prev+off, len)) continue;
+		++mBlocksChanged;
+		encodeRange(s+off, mKey ? NULL : prev+off, off, len);
+		memcpy(prev+off, s+off, len);
+	}
+	endPacket();
+	mHasPrev = true;
+
+	uint32_t count = mPacketLens.size();
+	for(uint32_t i=0; i<count; ++i) put<uint32_t>(&mPackets[i*mPacketSize]+16, count);
+	return count;
+}
+
+
+
+StateDeltaDecoder::StateDeltaDecoder(uint32_t size)
+:	mFront(0), mSeq(0), mPendingSeq(0), mPendingRecv(0), mLastDropSeq(0),
+	mCompleted(0), mDropped(0), mRejected(0),
+	mHasState(false), mPending(false), mPendingKey(false), mNeedKey(true)
+{
+	stateSize(size);
+}
+
+StateDeltaDecoder& StateDeltaDecoder::stateSize(uint32_t v){
+	mBufs[0].assign(v, 0);
+	mBufs[1].assign(v, 0);
+	mDirty.clear();
+	mPendingDirty.clear();
+	mHasState = mPending = false;
+	mNeedKey = true;
+	return *this;
+}
+
+void StateDeltaDecoder::addRange(std::vector<Range>& r, uint32_t off, uint32_t len){
+	if(!r.empty() && r.back().off + r.back().len == off){
+		r.back().len += len;
+	}
+	else{
+		Range x = { off, len };
+		r.push_back(x);
+	}
+}
+
+bool StateDeltaDecoder::validate(const char * p, uint32_t size){
+	if(size < HEADER_SIZE) return false;
+	if(p[0] != 'D' || p[1] != 'S' || uint8_t(p[3]) != VERSION) return false;
+	if(get<uint32_t>(p+8) != stateSize()) return false;
+	uint32_t index = get<uint32_t>(p+12);
+	uint32_t count = get<uint32_t>(p+16);
+	if(index >= count) return false;
+	// Every packet of a frame but an empty one covers at least one byte
+	if(count > stateSize() + 1) return false;
+
+	uint16_t numEntries = get<uint16_t>(p+20);
+	uint32_t pos = HEADER_SIZE;
+	for(uint16_t i=0; i<numEntries; ++i){
+		if(pos + ENTRY_SIZE > size) return false;
+		uint32_t off = get<uint32_t>(p+pos);
+		uint32_t raw = get<uint16_t>(p+pos+4);
+		uint32_t enc = get<uint16_t>(p+pos+6);
+		pos += ENTRY_SIZE;
+		if(pos + enc > size) return false;
+		if(off > stateSize() || raw > stateSize() - off) return false;
+		if(rleLength(p+pos, enc) != int(raw)) return false;
+		pos += enc;
+	}
+	return true;
+}
+
+void StateDeltaDecoder::apply(const char * p, bool key){
+	char * back = stateSize() ? &mBufs[1-mFront][0] : NULL;
+	uint16_t numEntries = get<uint16_t>(p+20);
+	uint32_t pos = HEADER_SIZE;
+	for(uint16_t i=0; i<numEntries; ++i){
+		uint32_t off = get<uint32_t>(p+pos);
+		uint32_t raw = get<uint16_t>(p+pos+4);
+		uint32_t enc = get<uint16_t>(p+pos+6);
+		pos += ENTRY_SIZE;
+		rleDecode(p+pos, enc, back+off, key);
+		if(!key) addRange(mPendingDirty, off, raw);
+		pos += enc;
+	}
+}
+
+void StateDeltaDecoder::dropFrame(uint32_t seq){
+	// Count each lost frame once, no matter how many of its packets arrive
+	if(mLastDropSeq != seq){
+		++mDropped;
+		mLastDropSeq = seq;
+	}
+	mNeedKey = true;
+}
+
+void StateDeltaDecoder::beginFrame(uint32_t seq, bool key, uint32_t count){
+	mPending = true;
+	mPendingSeq = seq;
+	mPendingKey = key;
+	mPendingRecv = 0;
+	mGot.assign(count, 0);
+	mPendingDirty.clear();
+
+	if(key){
+		// Keyframe overwrites everything
+		Range all = { 0, stateSize() };
+		mPendingDirty.push_back(all);
+	}
+	else if(stateSize()){
+		// Bring back buffer up to date with front buffer
+		const char * src = &mBufs[mFront][0];
+		char * dst = &mBufs[1-mFront][0];
+		for(unsigned i=0; i<mDirty.size(); ++i){
+			memcpy(dst + mDirty[i].off, src + mDirty[i].off, mDirty[i].len);
+		}
+	}
+}
+
+bool StateDeltaDecoder::frameInfo(
+	const char * p, uint32_t size,
+	uint32_t& seq, uint32_t& index, uint32_t& count
+){
+	if(size < HEADER_SIZE) return false;
+	if(p[0] != 'D' || p[1] != 'S' || uint8_t(p[3]) != VERSION) return false;
+	seq = get<uint32_t>(p+4);
+	index = get<uint32_t>(p+12);
+	count = get<uint32_t>(p+16);
+	return index < count;
+}
+
+bool StateDeltaDecoder::decode(const char * p, uint32_t size){
+	if(!validate(p, size)){
+		++mRejected;
+		return false;
+	}
+
+	bool key = p[2] & FLAG_KEY;
+	uint32_t seq = get<uint32_t>(p+4);
+	uint32_t index = get<uint32_t>(p+12);
+	uint32_t count = get<uint32_t>(p+16);
+
+	if(mPending && seq == mPendingSeq){
+		if(mGot[index] || count != mGot.size()) return false; // duplicate
+	}
+	else{
+		// Stale packet
+		if(mHasState && !newer(seq, mSeq)) return false;
+		if(mPending){
+			if(!newer(seq, mPendingSeq)) return false;
+			// Pending frame is incomplete and back buffer is now inconsistent
+			dropFrame(mPendingSeq);
+			mPending = false;
+		}
+
+		// A delta can only be applied on top of its predecessor
+		if(!key && (mNeedKey || !mHasState || seq != mSeq+1)){
+			dropFrame(seq);
+			return false;
+		}
+		beginFrame(seq, key, count);
+	}
+
+	apply(p, key);
+	mGot[index] = 1;
+
+	if(++mPendingRecv == mGot.size()){
+		mFront = 1-mFront;
+		mSeq = mPendingSeq;
+		mDirty.swap(mPendingDirty);
+		mHasState = true;
+		mPending = false;
+		mNeedKey = false;
+		++mCompleted;
+		return true;
+	}
+	return false;
+}
+
+
+
+
+StateDeltaReceiver::StateDeltaReceiver(uint32_t stateSize, uint32_t maxPacketSize)
+:	mDecoder(stateSize), mPacket(maxPacketSize), mFrame(NULL),
+	mLastSeq(0), mHasLast(false), mRunning(false), mDiscarded(0)
+{}
+
+StateDeltaReceiver::~StateDeltaReceiver(){
+	stop();
+	delete mFrame;
+	for(unsigned i=0; i<mReady.size(); ++i) delete mReady[i];
+	for(unsigned i=0; i<mFree.size(); ++i) delete mFree[i];
+}
+
+bool StateDeltaReceiver::start(uint16_t port, const char * address){
+	stop();
+	// The timeout bounds how long stop() waits for the thread
+	if(!mSocket.open(port, address, 0.05, Socket::UDP | Socket::DGRAM)){
+		AL_WARN("StateDeltaReceiver unable to bind port %d", port);
+		return false;
+	}
+	mRunning = true;
+	if(!mThread.start(receiveThread, this)){
+		mRunning = false;
+		mSocket.close();
+		return false;
+	}
+	return true;
+}
+
+void StateDeltaReceiver::stop(){
+	if(mRunning){
+		mRunning = false;
+		mThread.join();
+		mSocket.close();
+	}
+}
+
+void * StateDeltaReceiver::receiveThread(void * user){
+	StateDeltaReceiver& r = *static_cast<StateDeltaReceiver *>(user);
+	while(r.mRunning){
+		size_t n = r.mSocket.recv(&r.mPacket[0], r.mPacket.size());
+		if(n) r.receive(&r.mPacket[0], n);
+	}
+	return NULL;
+}
+
+void StateDeltaReceiver::receive(const char * p, uint32_t size){
+	uint32_t seq, index, count;
+	if(!StateDeltaDecoder::frameInfo(p, size, seq, index, count)) return;
+
+	// Late packets of finished or discarded frames
+	if(mHasLast && !newer(seq, mLastSeq)) return;
+
+	if(mFrame && mFrame->seq != seq){
+		if(!newer(seq, mFrame->seq)) return;
+		finish(mFrame, false);
+		mFrame = NULL;
+	}
+
+	if(!mFrame){
+		// Bound the receive map as the decoder does
+		if(count > mDecoder.stateSize() + 1) return;
+		{
+			std::lock_guard<std::mutex> lock(mLock);
+			if(!mFree.empty()){
+				mFrame = mFree.back();
+				mFree.pop_back();
+			}
+		}
+		if(!mFrame) mFrame = new Frame;
+		mFrame->seq = seq;
+		mFrame->received = 0;
+		mFrame->data.clear();
+		// Growing the buffer mid-frame stalls the thread on large copies.
+		// All but the last packet are usually of the same size.
+		size_t expect = size_t(count) * size;
+		size_t maxSize = size_t(mDecoder.stateSize()) * 2 + mPacket.size();
+		mFrame->data.reserve(expect < maxSize ? expect : maxSize);
+		mFrame->offsets.assign(count, 0);
+		mFrame->lengths.assign(count, 0);
+	}
+
+	Frame& f = *mFrame;
+	if(count != f.lengths.size() || f.lengths[index]) return; // duplicate
+	f.offsets[index] = f.data.size();
+	f.lengths[index] = size;
+	f.data.insert(f.data.end(), p, p+size);
+
+	if(++f.received == count){
+		finish(mFrame, true);
+		mFrame = NULL;
+	}
+}
+
+void StateDeltaReceiver::finish(Frame * f, bool complete){
+	mLastSeq = f->seq;
+	mHasLast = true;
+	std::lock_guard<std::mutex> lock(mLock);
+	if(!complete){
+		++mDiscarded;
+		mFree.push_back(f);
+		return;
+	}
+	if(mReady.size() >= MAX_PENDING){
+		++mDiscarded;
+		mFree.push_back(mReady.front());
+		mReady.pop_front();
+	}
+	mReady.push_back(f);
+}
+
+StateDeltaReceiver::Frame * StateDeltaReceiver::take(){
+	std::lock_guard<std::mutex> lock(mLock);
+	if(mReady.empty()) return NULL;
+	Frame * f = mReady.front();
+	mReady.pop_front();
+	return f;
+}
+
+bool StateDeltaReceiver::decode(Frame * f){
+	bool done = false;
+	for(unsigned i=0; i<f->lengths.size(); ++i){
+		done = mDecoder.decode(&f->data[f->offsets[i]], f->lengths[i]);
+	}
+	return done;
+}
+
+void StateDeltaReceiver::recycle(Frame * f){
+	std::lock_guard<std::mutex> lock(mLock);
+	mFree.push_back(f);
+}
+
+bool StateDeltaReceiver::pop(){
+	Frame * f = take();
+	if(!f) return false;
+	bool done = decode(f);
+	recycle(f);
+	return done;
+}
+
+bool StateDeltaReceiver::poll(){
+	bool newState = false;
+	Frame * f;
+	while((f = take())){
+		if(decode(f)) newState = true;
+		recycle(f);
+	}
+	return newState;
+}
+
+unsigned StateDeltaReceiver::pending() const {
+	std::lock_guard<std::mutex> lock(mLock);
+	return mReady.size();
+}
+
+uint32_t StateDeltaReceiver::framesDiscarded() const {
+	std::lock_guard<std::mutex> lock(mLock);
+	return mDiscarded;
+}
+
+} // al::
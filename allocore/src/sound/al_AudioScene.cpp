@@ -1,5 +1,8 @@
+#include <algorithm>
 #include "allocore/sound/al_AudioScene.hpp"
 #include "allocore/math/al_Constants.hpp"
+#include "allocore/system/al_Printing.hpp"
+#include "allocore/system/al_Profiler.hpp"
 
 namespace al{
 
@@ -52,7 +55,8 @@ SoundSource::SoundSource(double nearClip, double farClip, AttenuationLaw law, Do
         double farBias, int delaySize
         )
 	:	DistAtten<double>(nearClip, farClip, law, farBias),
-      mSound(delaySize), mUseAtten(true), mDopplerType(dopplerType), mUsePerSampleProcessing(false)
+      mSound(delaySize > 0 ? delaySize : defaultDelaySize(farClip)), mUseAtten(true), mUseDistanceFilter(false), mDopplerType(dopplerType), mUsePerSampleProcessing(false),
+      mSceneSlot(-1), mSceneGeneration(0), mPooled(false)
 {
 
 	// initialize the position history to be VERY FAR AWAY so that we don't deafen ourselves...
@@ -63,17 +67,31 @@ SoundSource::SoundSource(double nearClip, double farClip, AttenuationLaw law, Do
 	presenceFilter.set(2700);
 }
 
+void SoundSource::reset(){
+	mSound.clear();
+	mPose = Pose();
+	for(int i=0; i<mPosHistory.size(); ++i){
+		mPosHistory(Vec3d(1000, 0, 0));
+	}
+}
+
 /*static*/
 int SoundSource::bufferSize(double samplerate, double speedOfSound, double distance){
 	return (int)ceil(samplerate * distance / speedOfSound);
 }
 
+/*static*/
+int SoundSource::defaultDelaySize(double distance){
+	return bufferSize(96000, 340, distance) + 4096;
+}
+
 
 
-AudioScene::AudioScene(int numFrames_)
+AudioScene::AudioScene(int numFrames_, int maxSources_)
 	:   mNumFrames(0), mSpeedOfSound(340), mPerSampleProcessing(false)
 {
 	numFrames(numFrames_);
+	maxSources(maxSources_);
 }
 
 AudioScene::~AudioScene(){
@@ -84,19 +102,130 @@ AudioScene::~AudioScene(){
 		){
 		delete (*it);
 	}
+	for(unsigned i=0; i<mPool.size(); ++i) delete mPool[i];
+}
+
+void AudioScene::maxSources(int v){
+	// Detach all active and pending sources
+	updateSources();
+	for(unsigned i=0; i<mSources.size(); ++i) mSources[i]->mSceneSlot = -1;
+	mSources.clear();
+	mSourceSlots.clear();
+
+	mSources.reserve(v);
+	mSourceSlots.reserve(v);
+	mSlots.resize(v);
+	mFreeSlots.resize(v);
+	for(unsigned i=0; i<mListeners.size(); ++i){
+		mListeners[i]->mFilterStates.assign(v, DistanceFilter::State());
+	}
+	// Each slot can have at most one pending add and one pending remove
+	mSourceCommands.resize(2*v);
+	for(int i=0; i<v; ++i){
+		mSlots[i].generation = 0;
+		mSlots[i].dense = -1;
+		mFreeSlots.push(i);
+	}
+
+	// Return all pooled sources to the pool
+	mPoolFree.resize(mPool.size());
+	for(unsigned i=0; i<mPool.size(); ++i) mPoolFree.push(mPool[i]);
 }
 
-void AudioScene::addSource(SoundSource& src){
-	mSources.push_back(&src);
+bool AudioScene::addSource(SoundSource& src){
+	if(src.inScene()) return false;
+	uint32_t slot;
+	if(!mFreeSlots.pop(slot)){
+		AL_WARN_ONCE("AudioScene: could not add source, maximum of %d reached", maxSources());
+		return false;
+	}
+	SourceCommand c = { &src, slot, mSlots[slot].generation, SOURCE_ADD };
+	src.mSceneSlot = slot;
+	src.mSceneGeneration = c.generation;
+	mSourceCommands.push(c);
+	return true;
 }
 
 void AudioScene::removeSource(SoundSource& src){
-	mSources.remove(&src);
+	if(!src.inScene()) return;
+	SourceCommand c = { &src, uint32_t(src.mSceneSlot), src.mSceneGeneration, SOURCE_REMOVE };
+	src.mSceneSlot = -1;
+	mSourceCommands.push(c);
+}
+
+void AudioScene::updateSources(){
+	SourceCommand c;
+	while(mSourceCommands.pop(c)){
+		if(c.slot >= mSlots.size()) continue;
+		SourceSlot& slot = mSlots[c.slot];
+		if(c.generation != slot.generation) continue; // stale request
+
+		if(SOURCE_ADD == c.type){
+			if(slot.dense >= 0) continue;
+			slot.dense = mSources.size();
+			mSources.push_back(c.src);
+			mSourceSlots.push_back(c.slot);
+			for(unsigned i=0; i<mListeners.size(); ++i){
+				mListeners[i]->mFilterStates[c.slot] = DistanceFilter::State();
+			}
+		}
+		else{
+			// Swap last active source into the vacated position
+			if(slot.dense >= 0){
+				int last = mSources.size()-1;
+				mSources[slot.dense] = mSources[last];
+				mSourceSlots[slot.dense] = mSourceSlots[last];
+				mSlots[mSourceSlots[slot.dense]].dense = slot.dense;
+				mSources.pop_back();
+				mSourceSlots.pop_back();
+				slot.dense = -1;
+			}
+			++slot.generation;
+			mFreeSlots.push(c.slot);
+			if(c.src->mPooled) mPoolFree.push(c.src);
+		}
+	}
+}
+
+void AudioScene::allocateSourcePool(int count, int delaySize){
+	for(unsigned i=0; i<mPool.size(); ++i) delete mPool[i];
+	mPool.resize(count);
+	mPoolFree.resize(count);
+	for(int i=0; i<count; ++i){
+		mPool[i] = new SoundSource(0.1, 20, ATTEN_INVERSE, DOPPLER_SYMMETRICAL, 0, delaySize);
+		mPool[i]->mPooled = true;
+		mPoolFree.push(mPool[i]);
+	}
+}
+
+SoundSource * AudioScene::spawnSource(){
+	SoundSource * src;
+	if(!mPoolFree.pop(src)) return NULL;
+	src->reset();
+	if(!addSource(*src)){
+		mPoolFree.push(src);
+		return NULL;
+	}
+	return src;
+}
+
+bool AudioScene::allocScratch(Scratch& s, LinearArena& arena, int numFrames){
+	const int LANES = DistanceFilter::LANES;
+	s.samples = arena.alloc<float>(LANES*numFrames);
+	s.relpos = arena.alloc<Vec3d>(LANES*numFrames);
+	s.delays = arena.alloc<double>(numFrames);
+	s.gains = arena.alloc<float>(numFrames);
+	return s.samples && s.relpos && s.delays && s.gains;
 }
 
 void AudioScene::numFrames(int v){
 	if(mNumFrames != v){
-		mBuffer.resize(v);
+		// Room for the scratch buffers and the alignment of each
+		const int LANES = DistanceFilter::LANES;
+		mScratch.resize(
+			v * (LANES*(sizeof(float) + sizeof(Vec3d)) + sizeof(double) + sizeof(float))
+			+ 4*16
+		);
 
 		Listeners::iterator it = mListeners.begin();
 		while(it != mListeners.end()){
@@ -109,6 +238,7 @@ void AudioScene::numFrames(int v){
 
 Listener * AudioScene::createListener(Spatializer* spatializer){
 	Listener * l = new Listener(mNumFrames, spatializer);
+	l->mFilterStates.resize(maxSources());
 	l->compile();
 	mListeners.push_back(l);
 	return l;
@@ -123,120 +253,200 @@ Listener * AudioScene::createListener(Spatializer* spatializer){
 */
 
 
-void AudioScene::render(AudioIOData& io) {
-	const int numFrames = io.framesPerBuffer();
-	double sampleRate = io.framesPerSecond();
-	io.zeroOut();
+double AudioScene::readSource(
+	SoundSource& src, Listener& l, int il, int numFrames, double sampleRate,
+	float * buf, Vec3d * relposBuf, const Scratch& scratch
+){
+	// scalar factor to convert distances into delayline indices
+	double distanceToSample = 0;
+	if(src.dopplerType() == DOPPLER_SYMMETRICAL)
+		distanceToSample = sampleRate / mSpeedOfSound;
 
-	// iterate through all listeners adding contribution from all sources
-	for(unsigned il=0; il<mListeners.size(); ++il){
-		Listener& l = *mListeners[il];
+	if(!src.usePerSampleProcessing()) //if our src is using per sample processing we will update this in the frame loop instead
+		src.updateHistory();
 
-		Spatializer* spatializer = l.mSpatializer;
-		spatializer->prepare();
+	double dist = 0;
 
-		// update listener history data:
-		l.updateHistory(numFrames);
-
-		// iterate through all sound sources
-		for(Sources::iterator it = mSources.begin(); it != mSources.end(); ++it){
-			SoundSource& src = *(*it);
-
-			// scalar factor to convert distances into delayline indices
-			double distanceToSample = 0;
-			if(src.dopplerType() == DOPPLER_SYMMETRICAL)
-				distanceToSample = sampleRate / mSpeedOfSound;
+	if(mPerSampleProcessing) //audioscene per sample processing
+	{
+		if(src.usePerSampleProcessing() && il == 0) //if src is using per sample processing, we can only do this for the first listener (TODO: better design for this)
+		{
+			// The source writes a sample per frame, so read it back per frame
+			for(int i=0; i < numFrames; ++i){
 
-			if(!src.usePerSampleProcessing()) //if our src is using per sample processing we will update this in the frame loop instead
 				src.updateHistory();
+				src.onProcessSample(i);
 
-			if(mPerSampleProcessing) //audioscene per sample processing
-			{
-				// iterate time samples
-				for(int i=0; i < numFrames; ++i){
+				Vec3d relpos = src.posHistory()[0] - l.posHistory()[0];
 
-					Vec3d relpos;
+				if(src.dopplerType() == DOPPLER_PHYSICAL)
+				{
+					double currentDist = relpos.mag();
+					double prevDistance = (src.posHistory()[1] - l.posHistory()[0]).mag();
+					double sourceVel = (currentDist - prevDistance)*sampleRate; //positive when moving away, negative moving toward
 
-					if(src.usePerSampleProcessing() && il == 0) //if src is using per sample processing, we can only do this for the first listener (TODO: better design for this)
-					{
-						src.updateHistory();
-						src.onProcessSample(i);
+					if(sourceVel == -mSpeedOfSound) sourceVel -= 0.001; //prevent divide by 0 / inf freq
 
-						relpos = src.posHistory()[0] - l.posHistory()[0];
+					distanceToSample = fabs(sampleRate / (mSpeedOfSound + sourceVel));
+				}
 
-						if(src.dopplerType() == DOPPLER_PHYSICAL)
-						{
-							double currentDist = relpos.mag();
-							double prevDistance = (src.posHistory()[1] - l.posHistory()[0]).mag();
-							double sourceVel = (currentDist - prevDistance)*sampleRate; //positive when moving away, negative moving toward
+				//Compute distance in world-space units
+				dist = relpos.mag();
+				relposBuf[i] = relpos;
 
-							if(sourceVel == -mSpeedOfSound) sourceVel -= 0.001; //prevent divide by 0 / inf freq
+				// Compute how many samples ago to read from buffer
+				// Start with time delay due to speed of sound
+				double samplesAgo = dist * distanceToSample;
 
-							distanceToSample = fabs(sampleRate / (mSpeedOfSound + sourceVel));
-						}
-					}
-					else
-					{
-						// compute interpolated source position relative to listener
-						// TODO: this tends to warble when moving fast
-						double alpha = double(i)/numFrames;
-
-						// moving average:
-						// cheaper & slightly less warbly than cubic,
-						// less glitchy than linear
-						relpos = (
-									(src.posHistory()[3]-l.posHistory()[3])*(1.-alpha) +
-								(src.posHistory()[2]-l.posHistory()[2]) +
-								(src.posHistory()[1]-l.posHistory()[1]) +
-								(src.posHistory()[0]-l.posHistory()[0])*(alpha)
-								)/3.0;
-					}
+				// Is our delay line big enough?
+				if(samplesAgo <= src.maxIndex()){
+					double gain = src.attenuation(dist);
 
-					//Compute distance in world-space units
-					double dist = relpos.mag();
+					//reading samplesAgo-i causes a discontinuity
+					buf[i] = src.readSample(samplesAgo-i-1) * gain;
+				}
+				else{
+					buf[i] = 0;
+				}
+			}
+		}
+		else
+		{
+			// Compute the read index of every frame first, so the
+			// delay-line is read in one pass
+			for(int i=0; i < numFrames; ++i){
+
+				// compute interpolated source position relative to listener
+				// TODO: this tends to warble when moving fast
+				double alpha = double(i)/numFrames;
+
+				// moving average:
+				// cheaper & slightly less warbly than cubic,
+				// less glitchy than linear
+				Vec3d relpos = (
+							(src.posHistory()[3]-l.posHistory()[3])*(1.-alpha) +
+						(src.posHistory()[2]-l.posHistory()[2]) +
+						(src.posHistory()[1]-l.posHistory()[1]) +
+						(src.posHistory()[0]-l.posHistory()[0])*(alpha)
+						)/3.0;
+
+				//Compute distance in world-space units
+				dist = relpos.mag();
+				relposBuf[i] = relpos;
+
+				// Compute how many samples ago to read from buffer
+				// Start with time delay due to speed of sound
+				double samplesAgo = dist * distanceToSample;
+
+				// Add on time delay (in samples) - only needed if the source is rendered per buffer
+				if(!src.usePerSampleProcessing())
+					samplesAgo += (numFrames-i);
+
+				//reading samplesAgo-i causes a discontinuity
+				scratch.delays[i] = samplesAgo-i-1;
+				scratch.gains[i] = src.attenuation(dist);
+			}
 
-					// Compute how many samples ago to read from buffer
-					// Start with time delay due to speed of sound
-					double samplesAgo = dist * distanceToSample;
+			src.readSamples(buf, scratch.delays, numFrames);
 
-					// Add on time delay (in samples) - only needed if the source is rendered per buffer
-					if(!src.usePerSampleProcessing())
-						samplesAgo += (numFrames-i);
+			for(int i=0; i < numFrames; ++i){
+				// Is our delay line big enough?
+				if(scratch.delays[i]+i+1 <= src.maxIndex()) buf[i] *= scratch.gains[i];
+				else buf[i] = 0;
+			}
+		}
+	} //end per sample processing
+
+	else //more efficient, per buffer processing for audioscene (does not work well with doppler)
+	{
+		relposBuf[0] = src.pose().pos() - l.pose().pos();
+		dist = relposBuf[0].mag();
+		double gain = src.attenuation(dist);
+
+		// The read index advances one sample per frame, so the whole
+		// buffer has the same interpolation weights
+		src.readSamples(buf, numFrames, dist * distanceToSample);
+		for(int i = 0; i < numFrames; i++) buf[i] *= gain;
+	}
 
-					// Is our delay line big enough?
-					if(samplesAgo <= src.maxIndex()){
-						double gain = src.attenuation(dist);
+	return dist;
+}
 
-						//This seemed to get the same sample per block
-						//   float s = src.readSample(samplesAgo) * gain;
+void AudioScene::render(AudioIOData& io) {
+	AL_PROFILE_SCOPE("AudioScene::render");
+	const int numFrames = io.framesPerBuffer();
+	double sampleRate = io.framesPerSecond();
+	io.zeroOut();
 
-						//reading samplesAgo-i causes a discontinuity
-						float s = src.readSample(samplesAgo-i-1) * gain;
+	updateSources();
+	mDistanceFilter.sampleRate(sampleRate);
+
+	// Take scratch buffers from the stream, or else from memory allocated
+	// by numFrames(), as when rendering outside of an audio callback
+	const int LANES = DistanceFilter::LANES;
+	Scratch scratch;
+	if(!allocScratch(scratch, io.scratch(), numFrames)){
+		mScratch.reset();
+		if(!allocScratch(scratch, mScratch, numFrames)){
+			AL_WARN_ONCE("AudioScene: not enough scratch memory for %d frames", numFrames);
+			return;
+		}
+	}
 
-						// s = src.presenceFilter(s); //TODO: causing stopband ripple here, why?
-						spatializer->perform(io, src,relpos, numFrames, i, s);
-					}
+	// iterate through all listeners adding contribution from all sources
+	for(unsigned il=0; il<mListeners.size(); ++il){
+		Listener& l = *mListeners[il];
 
-				} //end for each frame
-			} //end per sample processing
+		Spatializer* spatializer = l.mSpatializer;
+		spatializer->prepare();
 
-			else //more efficient, per buffer processing for audioscene (does not work well with doppler)
-			{
-				Vec3d relpos = src.pose().pos() - l.pose().pos();
-				double distance = relpos.mag();
-				double gain = src.attenuation(distance);
+		// update listener history data:
+		l.updateHistory(numFrames);
 
-				for(int i = 0; i < numFrames; i++)
-				{
-					double readIndex = distance * distanceToSample;
-					readIndex += (numFrames - i - 1);
-					mBuffer[i] = gain * src.readSample(readIndex);
+		// Sources are rendered in groups: each is read from its delay-line,
+		// those with distance filtering are filtered together, then each is
+		// spatialized
+		for(unsigned first=0; first<mSources.size(); first+=LANES){
+			int count = std::min(LANES, int(mSources.size() - first));
+
+			float * filterBufs[LANES];
+			DistanceFilter::State * filterStates[LANES];
+			float filterCoefs[LANES];
+			int numFiltered = 0;
+
+			for(int k=0; k<count; ++k){
+				SoundSource& src = *mSources[first+k];
+				float * buf = scratch.samples + k*numFrames;
+				double dist = readSource(src, l, il, numFrames, sampleRate, buf, scratch.relpos + k*numFrames, scratch);
+
+				if(src.useDistanceFilter()){
+					filterBufs[numFiltered] = buf;
+					filterStates[numFiltered] = &l.mFilterStates[mSourceSlots[first+k]];
+					filterCoefs[numFiltered] = mDistanceFilter.coefficient(dist);
+					++numFiltered;
 				}
+			}
 
-				spatializer->perform(io, src, relpos, numFrames, &mBuffer[0]);
+			if(numFiltered){
+				DistanceFilter::process(filterBufs, filterStates, filterCoefs, numFiltered, numFrames);
 			}
 
-		} //end for each source
+			for(int k=0; k<count; ++k){
+				SoundSource& src = *mSources[first+k];
+				float * buf = scratch.samples + k*numFrames;
+				Vec3d * relpos = scratch.relpos + k*numFrames;
+
+				if(mPerSampleProcessing){
+					for(int i=0; i < numFrames; ++i){
+						// buf[i] = src.presenceFilter(buf[i]); //TODO: causing stopband ripple here, why?
+						spatializer->perform(io, src, relpos[i], numFrames, i, buf[i]);
+					}
+				}
+				else{
+					spatializer->perform(io, src, relpos[0], numFrames, buf);
+				}
+			}
+		}
 
 		spatializer->finalize(io);
 
@@ -8,6 +8,8 @@
 #include "allocore/sound/al_Biquad.hpp"
 #include "allocore/math/al_Constants.hpp"
 #include <stdlib.h>
+#include <string.h>
+#include <algorithm>
 #include <cmath>
 
 using namespace al;
@@ -30,6 +32,12 @@ BiQuad::~BiQuad()
 }
 
 void BiQuad::set(double freq, double bandwidth, double dbGain)
+{
+    coefficients(mBD, mType, mSampleRate, freq, bandwidth, dbGain);
+}
+
+bool BiQuad::coefficients(BiquadData& bd, BIQUADTYPE type, double sampleRate,
+                          double freq, double bandwidth, double dbGain)
 {
     //TODO all the way to fs/2, range
     if(freq > 20000) freq = 20000;
@@ -40,13 +48,13 @@ void BiQuad::set(double freq, double bandwidth, double dbGain)
     
     // setup variables
     A = pow(10, dbGain /40);
-    omega = 2 * M_PI * freq / (1*mSampleRate); //1X or 2X oversampled
+    omega = 2 * M_PI * freq / (1*sampleRate); //1X or 2X oversampled
     sn = sin(omega);
     cs = cos(omega);
     alpha = sn * sinh(M_LN2 /2 * bandwidth * omega /sn);
     beta = sqrt(A + A);
     
-    switch (mType) {
+    switch (type) {
         case BIQUAD_LPF:
             b0 = (1 - cs) /2;
             b1 = 1 - cs;
@@ -104,14 +112,15 @@ void BiQuad::set(double freq, double bandwidth, double dbGain)
             a2 = (A + 1) - (A - 1) * cs - beta * sn;
             break;
         default:
-            return;
+            return false;
     }
     
-    mBD.a0 = b0 /a0;
-    mBD.a1 = b1 /a0;
-    mBD.a2 = b2 /a0;
-    mBD.a3 = a1 /a0;
-    mBD.a4 = a2 /a0;
+    bd.a0 = b0 /a0;
+    bd.a1 = b1 /a0;
+    bd.a2 = b2 /a0;
+    bd.a3 = a1 /a0;
+    bd.a4 = a2 /a0;
+    return true;
 }
 
 void BiQuad::processBuffer(float *buffer, int count)
@@ -184,8 +193,66 @@ void BiQuadNX::setSampleRate(double _rate)
 }
 void BiQuadNX::processBuffer(float *buffer, int count)
 {
-    for(int i = 0; i < numFilters; i++)
-        mFilters[i].processBuffer(buffer, count);
+    // Samples stay in double precision between filters, as with operator()
+    const int CHUNK = 64;
+    double buf[CHUNK];
+    for(int start = 0; start < count; start += CHUNK)
+    {
+        int n = std::min(CHUNK, count - start);
+        for(int i = 0; i < n; i++) buf[i] = buffer[start + i];
+        for(int first = 0; first < numFilters; first += 8)
+            processFilters(first, buf, n);
+        for(int i = 0; i < n; i++) buffer[start + i] = buf[i];
+    }
+}
+
+void BiQuadNX::processFilters(int first, double *buffer, int count)
+{
+    const int L = 8;
+    
+    // Filters are computed along a diagonal: at step t, filter k processes
+    // sample t - k, which filter k - 1 processed at step t - 1. The filters
+    // are independent within a step, so they run in parallel.
+    int num = std::min(L, numFilters - first);
+    double a0[L], a1[L], a2[L], a3[L], a4[L];
+    double x1[L], x2[L], y1[L], y2[L];
+    double in[L], out[L];
+    bool on[L];
+    for(int k = 0; k < L; k++)
+    {
+        const BiQuad& f = mFilters[first + std::min(k, num - 1)];
+        a0[k] = f.mBD.a0; a1[k] = f.mBD.a1; a2[k] = f.mBD.a2;
+        a3[k] = f.mBD.a3; a4[k] = f.mBD.a4;
+        x1[k] = f.mBD.x1; x2[k] = f.mBD.x2;
+        y1[k] = f.mBD.y1; y2[k] = f.mBD.y2;
+        on[k] = f.enabled && k < num;
+        in[k] = 0;
+    }
+    
+    for(int t = 0; t < count + num - 1; t++)
+    {
+        in[0] = t < count ? buffer[t] : 0;
+        for(int k = 0; k < L; k++)
+        {
+            double y = a0[k] * in[k] + a1[k] * x1[k] + a2[k] * x2[k] - a3[k] * y1[k] - a4[k] * y2[k];
+            // Filters before their first sample or past their last keep their state
+            bool active = on[k] && t - k >= 0 && t - k < count;
+            out[k] = on[k] ? y : in[k];
+            x2[k] = active ? x1[k] : x2[k];
+            x1[k] = active ? in[k] : x1[k];
+            y2[k] = active ? y1[k] : y2[k];
+            y1[k] = active ? y : y1[k];
+        }
+        if(t >= num - 1) buffer[t - (num - 1)] = out[num - 1];
+        for(int k = L - 1; k > 0; k--) in[k] = out[k - 1];
+    }
+    
+    for(int k = 0; k < num; k++)
+    {
+        BiquadData& bd = mFilters[first + k].mBD;
+        bd.x1 = x1[k]; bd.x2 = x2[k];
+        bd.y1 = y1[k]; bd.y2 = y2[k];
+    }
 }
 
 double BiQuadNX::operator()(double sample)
@@ -204,3 +271,159 @@ void BiQuadNX::enable(bool on)
     for(int i = 0; i < numFilters; i++)
         mFilters[i].enable(on);
 }
+
+////////////////////////////////////////////////////////////////////////////
+
+BiQuadBank::BiQuadBank(int numChannels, int numStages, BIQUADTYPE _type, double _sampleRate)
+:
+mType(_type),
+mSampleRate(_sampleRate),
+mNumChannels(0),
+mNumStages(0),
+mSmooth(false),
+mChanged(false)
+{
+    resize(numChannels, numStages);
+}
+
+void BiQuadBank::resize(int numChannels, int numStages)
+{
+    mNumChannels = std::max(numChannels, 0);
+    mNumStages = std::max(numStages, 0);
+    int groups = (mNumChannels + LANES - 1) / LANES;
+    mCoefs.assign(groups * COEFS * LANES, 0.f);
+    mTargets.assign(groups * COEFS * LANES, 0.f);
+    mState.assign(groups * mNumStages * 2 * LANES, 0.f);
+    set(10000, 1.9, 0);
+    mCoefs = mTargets;
+    mChanged = false;
+}
+
+void BiQuadBank::set(double freq, double bandwidth, double dbGain)
+{
+    for(int i = 0; i < mNumChannels; i++)
+        setChannel(i, freq, bandwidth, dbGain);
+}
+
+void BiQuadBank::setChannel(int channel, double freq, double bandwidth, double dbGain)
+{
+    if(channel < 0 || channel >= mNumChannels) return;
+    BiquadData bd;
+    if(!BiQuad::coefficients(bd, mType, mSampleRate, freq, bandwidth, dbGain)) return;
+    float *c = &mTargets[(channel / LANES) * COEFS * LANES + channel % LANES];
+    c[0 * LANES] = bd.a0;
+    c[1 * LANES] = bd.a1;
+    c[2 * LANES] = bd.a2;
+    c[3 * LANES] = bd.a3;
+    c[4 * LANES] = bd.a4;
+    mChanged = true;
+}
+
+void BiQuadBank::clear()
+{
+    std::fill(mState.begin(), mState.end(), 0.f);
+}
+
+template <bool Ramp>
+void BiQuadBank::processGroup(int group, float (*buf)[LANES], const float (*inc)[LANES], int count)
+{
+    const float (*c)[LANES] = (const float (*)[LANES]) &mCoefs[group * COEFS * LANES];
+    float (*state)[2][LANES] = (float (*)[2][LANES]) &mState[group * mNumStages * 2 * LANES];
+    
+    // Each stage runs through the chunk with its state and coefficients in
+    // locals, which the compiler can keep in registers
+    for(int s = 0; s < mNumStages; s++)
+    {
+        float b0[LANES], b1[LANES], b2[LANES], a1[LANES], a2[LANES];
+        float s1[LANES], s2[LANES];
+        memcpy(b0, c[0], sizeof(b0));
+        memcpy(b1, c[1], sizeof(b1));
+        memcpy(b2, c[2], sizeof(b2));
+        memcpy(a1, c[3], sizeof(a1));
+        memcpy(a2, c[4], sizeof(a2));
+        memcpy(s1, state[s][0], sizeof(s1));
+        memcpy(s2, state[s][1], sizeof(s2));
+        
+        for(int i = 0; i < count; i++)
+        {
+            for(int l = 0; l < LANES; l++)
+            {
+                if(Ramp)
+                {
+                    b0[l] += inc[0][l]; b1[l] += inc[1][l]; b2[l] += inc[2][l];
+                    a1[l] += inc[3][l]; a2[l] += inc[4][l];
+                }
+                float x = buf[i][l];
+                float y = b0[l] * x + s1[l];
+                s1[l] = b1[l] * x - a1[l] * y + s2[l];
+                s2[l] = b2[l] * x - a2[l] * y;
+                buf[i][l] = y;
+            }
+        }
+        
+        for(int l = 0; l < LANES; l++)
+        {
+            // flush denormals as the filters decay
+            state[s][0][l] = fabsf(s1[l]) < 1e-15f ? 0 : s1[l];
+            state[s][1][l] = fabsf(s2[l]) < 1e-15f ? 0 : s2[l];
+        }
+    }
+}
+
+void BiQuadBank::processBuffers(float * const *buffers, int count)
+{
+    if(count <= 0) return;
+    const bool ramp = mSmooth && mChanged;
+    if(!ramp) mCoefs = mTargets;
+    mChanged = false;
+    
+    float buf[CHUNK][LANES];
+    float inc[COEFS][LANES];
+    for(int first = 0; first < mNumChannels; first += LANES)
+    {
+        int group = first / LANES;
+        int lanes = std::min((int)LANES, mNumChannels - first);
+        float *c = &mCoefs[group * COEFS * LANES];
+        const float *t = &mTargets[group * COEFS * LANES];
+        for(int k = 0; k < COEFS; k++)
+        {
+            for(int l = 0; l < LANES; l++)
+                inc[k][l] = ramp ? (t[k * LANES + l] - c[k * LANES + l]) / count : 0.f;
+        }
+        
+        // Channels are transposed into lanes a chunk at a time
+        for(int start = 0; start < count; start += CHUNK)
+        {
+            int n = std::min((int)CHUNK, count - start);
+            int i, l;
+            for(l = 0; l < lanes; l++)
+            {
+                const float *in = buffers[first + l] + start;
+                for(i = 0; i < n; i++) buf[i][l] = in[i];
+            }
+            for(; l < LANES; l++)
+            {
+                for(i = 0; i < n; i++) buf[i][l] = 0;
+            }
+            
+            if(ramp)
+            {
+                processGroup<true>(group, buf, inc, n);
+                for(int k = 0; k < COEFS * LANES; k++) c[k] += inc[k / LANES][k % LANES] * n;
+            }
+            else
+            {
+                processGroup<false>(group, buf, inc, n);
+            }
+            
+            for(l = 0; l < lanes; l++)
+            {
+                float *out = buffers[first + l] + start;
+                for(i = 0; i < n; i++) out[i] = buf[i][l];
+            }
+        }
+        
+        // The interpolation ends exactly on the new settings
+        for(int k = 0; k < COEFS * LANES; k++) c[k] = t[k];
+    }
+}
@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+#include "allocore/math/al_Constants.hpp"
+#include "allocore/sound/al_DelayLine.hpp"
+
+namespace al{
+
+namespace{
+
+	// Interpolation weights of K taps, oldest first. The fraction is between
+	// tap K/2, at the integer part of the delay, and the older tap K/2-1.
+
+	void cubicWeights(float * h, float f){
+		float f2 = f*f, f3 = f2*f;
+		h[3] = 0.5f*(-f3 + 2.f*f2 - f);
+		h[2] = 0.5f*(3.f*f3 - 5.f*f2 + 2.f);
+		h[1] = 0.5f*(-3.f*f3 + 4.f*f2 + f);
+		h[0] = 0.5f*(f3 - f2);
+	}
+
+	// Nodes are at offsets 1-K/2 to K/2 from the integer part of the delay
+	template <int K>
+	void lagrangeWeights(float * h, float f){
+		const int lo = 1 - K/2;
+		float d[K];
+		for(int k=0; k<K; ++k) d[k] = f - (lo + k);
+		for(int k=0; k<K; ++k){
+			float num = 1, den = 1;
+			for(int j=0; j<K; ++j){
+				if(j != k){
+					num *= d[j];
+					den *= float(k - j);
+				}
+			}
+			h[K/2 - (lo + k)] = num * (1.f/den);
+		}
+	}
+
+	// Blackman windowed sinc tabulated at SINC_PHASES fractions, with weights
+	// interpolated linearly between adjacent fractions
+	enum{ SINC_TAPS = 8, SINC_PHASES = 256 };
+
+	struct SincTable{
+		float w[(SINC_PHASES+1) * SINC_TAPS];
+
+		SincTable(){
+			for(int p=0; p<=SINC_PHASES; ++p){
+				float * h = w + p*SINC_TAPS;
+				double f = double(p)/SINC_PHASES;
+				double sum = 0;
+				for(int k=0; k<SINC_TAPS; ++k){
+					// Offset from the interpolated point to the tap
+					double x = f - (SINC_TAPS/2 - k);
+					double t = M_PI * x;
+					double sinc = fabs(t) < 1e-9 ? 1 : sin(t)/t;
+					double c = M_PI * x / (SINC_TAPS/2);
+					double window = 0.42 + 0.5*cos(c) + 0.08*cos(2*c);
+					h[k] = sinc * window;
+					sum += h[k];
+				}
+				// Unity gain at DC
+				for(int k=0; k<SINC_TAPS; ++k) h[k] /= sum;
+			}
+		}
+	};
+
+	const SincTable sincTable;
+
+	void sincWeights(float * h, float f){
+		float x = f * SINC_PHASES;
+		int p = int(x);
+		if(p >= SINC_PHASES) p = SINC_PHASES-1; // fraction rounded up to 1
+		float t = x - p;
+		const float * h0 = sincTable.w + p*SINC_TAPS;
+		const float * h1 = h0 + SINC_TAPS;
+		for(int k=0; k<SINC_TAPS; ++k) h[k] = h0[k] + (h1[k] - h0[k])*t;
+	}
+
+	template <int K, void (*Weights)(float *, float)>
+	void readDelays(
+		float * dst, const double * delays, int n,
+		const float * buf, int size, int pos, double lo, double hi
+	){
+		for(int i=0; i<n; ++i){
+			double d = delays[i] < lo ? lo : (delays[i] > hi ? hi : delays[i]);
+			int i0 = int(d);
+			float h[K];
+			Weights(h, float(d - i0));
+			int start = pos - i0 - K/2;
+			if(start < 0) start += size;
+			const float * t = buf + start;
+			float s = 0;
+			for(int k=0; k<K; ++k) s += h[k] * t[k];
+			dst[i] = s;
+		}
+	}
+
+	// All outputs share the weights, so this is a short FIR over contiguous
+	// samples, up to the end of the buffer and then from its start
+	template <int K, void (*Weights)(float *, float)>
+	void readConsecutive(
+		float * dst, int n, double delay,
+		const float * buf, int size, int pos
+	){
+		double d = delay + n - 1;
+		int i0 = int(d);
+		float h[K];
+		Weights(h, float(d - i0));
+		int start = pos - i0 - K/2;
+		if(start < 0) start += size;
+		for(int i=0; i<n; ){
+			int m = std::min(n - i, size - start);
+			const float * t = buf + start;
+			for(int j=0; j<m; ++j){
+				float s = 0;
+				for(int k=0; k<K; ++k) s += h[k] * t[j+k];
+				dst[i+j] = s;
+			}
+			i += m;
+			start = 0;
+		}
+	}
+}
+
+
+DelayLine::DelayLine(int size, Interpolation ipl)
+:	mSize(0), mPos(0), mIpl(ipl)
+{
+	resize(size);
+}
+
+void DelayLine::resize(int size){
+	mSize = std::max(size, int(GUARD));
+	mBuf.assign(mSize + GUARD, 0.f);
+	mPos = mSize - 1;
+}
+
+void DelayLine::clear(){
+	std::fill(mBuf.begin(), mBuf.end(), 0.f);
+	mPos = mSize - 1;
+}
+
+void DelayLine::write(const float * src, int n){
+	if(n <= 0) return;
+	// Only the newest samples fit
+	if(n > mSize){
+		src += n - mSize;
+		n = mSize;
+	}
+	int pos = mPos + 1 == mSize ? 0 : mPos + 1;
+	int m = std::min(n, mSize - pos);
+	memcpy(&mBuf[pos], src, m*sizeof(float));
+	memcpy(&mBuf[0], src + m, (n - m)*sizeof(float));
+	mPos = (pos + n - 1) % mSize;
+	memcpy(&mBuf[mSize], &mBuf[0], GUARD*sizeof(float));
+}
+
+float DelayLine::read(double delay) const {
+	float v;
+	read(&v, &delay, 1);
+	return v;
+}
+
+void DelayLine::read(float * dst, const double * delays, int n) const {
+	const float * buf = &mBuf[0];
+	switch(mIpl){
+	case LAGRANGE4:
+		readDelays<4, lagrangeWeights<4> >(dst, delays, n, buf, mSize, mPos, minDelay(), maxDelay());
+		break;
+	case LAGRANGE6:
+		readDelays<6, lagrangeWeights<6> >(dst, delays, n, buf, mSize, mPos, minDelay(), maxDelay());
+		break;
+	case SINC8:
+		readDelays<SINC_TAPS, sincWeights>(dst, delays, n, buf, mSize, mPos, minDelay(), maxDelay());
+		break;
+	default:
+		readDelays<4, cubicWeights>(dst, delays, n, buf, mSize, mPos, minDelay(), maxDelay());
+	}
+}
+
+void DelayLine::readBlock(float * dst, int n, double delay) const {
+	if(n <= 0) return;
+
+	// Outputs that would be clamped are read one at a time
+	if(delay < minDelay() || delay + n - 1 > maxDelay()){
+		for(int i=0; i<n; ++i) dst[i] = read(delay + n - 1 - i);
+		return;
+	}
+
+	const float * buf = &mBuf[0];
+	switch(mIpl){
+	case LAGRANGE4:
+		readConsecutive<4, lagrangeWeights<4> >(dst, n, delay, buf, mSize, mPos);
+		break;
+	case LAGRANGE6:
+		readConsecutive<6, lagrangeWeights<6> >(dst, n, delay, buf, mSize, mPos);
+		break;
+	case SINC8:
+		readConsecutive<SINC_TAPS, sincWeights>(dst, n, delay, buf, mSize, mPos);
+		break;
+	default:
+		readConsecutive<4, cubicWeights>(dst, n, delay, buf, mSize, mPos);
+	}
+}
+
+} // al::
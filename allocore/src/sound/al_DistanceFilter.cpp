@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <math.h>
+#include "allocore/math/al_Constants.hpp"
+#include "allocore/sound/al_DistanceFilter.hpp"
+
+namespace al{
+
+namespace{
+	enum{ CHUNK = 64 };
+
+	float flushDenormal(float v){ return fabsf(v) < 1e-15f ? 0.f : v; }
+}
+
+
+DistanceFilter::DistanceFilter(double sampleRate, double absorption)
+:	mSampleRate(sampleRate), mAbsorption(absorption)
+{}
+
+double DistanceFilter::cutoff(double distance) const {
+	// Attenuation in dB is absorption * (f/10000)^2 * distance, which is 3 dB
+	// at the cutoff
+	double k = mAbsorption * distance;
+	if(k <= 0) return 1e10;
+	return 10000. * sqrt(3. / k);
+}
+
+float DistanceFilter::coefficient(double distance) const {
+	double fc = cutoff(distance);
+	if(fc >= 0.45 * mSampleRate) return 1.f;
+	if(fc < 20.) fc = 20.;
+	return 1. - exp(-M_2PI * fc / mSampleRate);
+}
+
+void DistanceFilter::process(
+	float * const * bufs, State * const * states, const float * coefs,
+	int numSources, int numFrames
+){
+	if(numFrames <= 0 || numSources <= 0) return;
+
+	// Larger batches are filtered a group of LANES at a time
+	if(numSources > LANES){
+		for(int first=0; first<numSources; first+=LANES){
+			int n = std::min(int(LANES), numSources - first);
+			process(bufs + first, states + first, coefs + first, n, numFrames);
+		}
+		return;
+	}
+
+	// Unused lanes filter silence
+	float prev[LANES], coef[LANES], inc[LANES];
+	for(int l=0; l<LANES; ++l){
+		if(l < numSources){
+			const State& s = *states[l];
+			prev[l] = s.prev;
+			coef[l] = s.coef < 0.f ? coefs[l] : s.coef;
+			inc[l] = (coefs[l] - coef[l]) / numFrames;
+		}
+		else{
+			prev[l] = coef[l] = inc[l] = 0.f;
+		}
+	}
+
+	// Sources are transposed into lanes a chunk at a time
+	float buf[CHUNK][LANES];
+	for(int start=0; start<numFrames; start+=CHUNK){
+		int n = std::min(int(CHUNK), numFrames - start);
+		int i, l;
+		for(l=0; l<numSources; ++l){
+			const float * in = bufs[l] + start;
+			for(i=0; i<n; ++i) buf[i][l] = in[i];
+		}
+		for(; l<LANES; ++l){
+			for(i=0; i<n; ++i) buf[i][l] = 0.f;
+		}
+
+		for(i=0; i<n; ++i){
+			for(l=0; l<LANES; ++l){
+				coef[l] += inc[l];
+				prev[l] += coef[l] * (buf[i][l] - prev[l]);
+				buf[i][l] = prev[l];
+			}
+		}
+
+		for(l=0; l<numSources; ++l){
+			float * out = bufs[l] + start;
+			for(i=0; i<n; ++i) out[i] = buf[i][l];
+		}
+	}
+
+	for(int l=0; l<numSources; ++l){
+		states[l]->prev = flushDenormal(prev[l]);
+		states[l]->coef = coefs[l];
+	}
+}
+
+void DistanceFilter::process(float * buf, State& state, float coef, int numFrames){
+	if(numFrames <= 0) return;
+	float prev = state.prev;
+	float c = state.coef < 0.f ? coef : state.coef;
+	float inc = (coef - c) / numFrames;
+	for(int i=0; i<numFrames; ++i){
+		c += inc;
+		prev += c * (buf[i] - prev);
+		buf[i] = prev;
+	}
+	state.prev = flushDenormal(prev);
+	state.coef = coef;
+}
+
+} // al::
@@ -0,0 +1,320 @@
+#include <atomic>
+#include "allocore/spatial/al_BVH.hpp"
+
+namespace al{
+
+namespace{
+	const int BINS = 16;
+
+	// Subtrees with more primitives than this are built as separate tasks
+	const int PARALLEL_SIZE = 4096;
+
+	// Below this depth splits follow the SAH; deeper nodes are split at the
+	// median, which bounds the depth for traversal
+	const int SAH_DEPTH = 64;
+}
+
+
+struct BVH::Builder{
+	const std::vector<Box>& boxes;
+	std::vector<Vec3f> centers;
+	std::vector<Node>& nodes;
+	std::vector<unsigned>& order;
+	std::atomic<int> numNodes;
+	ThreadPool * pool;
+	int maxLeaf;
+
+	Builder(const std::vector<Box>& b, std::vector<Node>& n, std::vector<unsigned>& o, ThreadPool * p, int m)
+	:	boxes(b), nodes(n), order(o), numNodes(1), pool(p), maxLeaf(m)
+	{
+		centers.resize(boxes.size());
+		for(unsigned i=0; i<boxes.size(); ++i) centers[i] = boxes[i].center();
+	}
+
+	void makeLeaf(Node& node, int first, int count){
+		node.first = first;
+		node.count = count;
+	}
+
+	// Find best split by SAH; returns cost of split or FLT_MAX if none
+	float findSplit(int first, int count, const Box& cbox, int& axis, float& pos){
+		float best = FLT_MAX;
+		for(int a=0; a<3; ++a){
+			float lo = cbox.min[a], hi = cbox.max[a];
+			if(!(hi > lo)) continue;
+			float scale = BINS / (hi - lo);
+
+			Box bins[BINS];
+			int counts[BINS] = {0};
+			for(int i=first; i<first+count; ++i){
+				unsigned p = order[i];
+				int b = std::min(int((centers[p][a] - lo) * scale), BINS-1);
+				bins[b].extend(boxes[p]);
+				++counts[b];
+			}
+
+			// Sweep from right to get area and count of right sides
+			float rightArea[BINS];
+			int rightCount[BINS];
+			Box r;
+			int rc = 0;
+			for(int b=BINS-1; b>0; --b){
+				r.extend(bins[b]);
+				rc += counts[b];
+				rightArea[b] = r.area();
+				rightCount[b] = rc;
+			}
+
+			Box l;
+			int lc = 0;
+			for(int b=0; b<BINS-1; ++b){
+				l.extend(bins[b]);
+				lc += counts[b];
+				if(0 == lc || 0 == rightCount[b+1]) continue;
+				float cost = l.area()*lc + rightArea[b+1]*rightCount[b+1];
+				if(cost < best){
+					best = cost;
+					axis = a;
+					pos = lo + (b+1) / scale;
+				}
+			}
+		}
+		return best;
+	}
+
+	void build(int index, int first, int count, int depth){
+		Box box, cbox;
+		for(int i=first; i<first+count; ++i){
+			box.extend(boxes[order[i]]);
+			cbox.extend(centers[order[i]]);
+		}
+		Node& node = nodes[index];
+		node.box = box;
+
+		// Leaves are tested as a whole, so smaller groups are not split
+		if(count <= maxLeaf){
+			makeLeaf(node, first, count);
+			return;
+		}
+
+		int mid = first;
+		if(depth < SAH_DEPTH){
+			int axis = 0;
+			float pos = 0;
+			if(findSplit(first, count, cbox, axis, pos) != FLT_MAX){
+				mid = std::partition(&order[0] + first, &order[0] + first + count,
+					[&](unsigned p){ return centers[p][axis] < pos; }
+				) - &order[0];
+			}
+		}
+
+		// Median split if SAH found nothing useful, e.g. all centers equal
+		if(mid == first || mid == first + count){
+			int axis = 0;
+			Vec3f ext = cbox.max - cbox.min;
+			if(ext.y > ext[axis]) axis = 1;
+			if(ext.z > ext[axis]) axis = 2;
+			mid = first + count/2;
+			std::nth_element(&order[0] + first, &order[0] + mid, &order[0] + first + count,
+				[&](unsigned a, unsigned b){ return centers[a][axis] < centers[b][axis]; }
+			);
+		}
+
+		int child = numNodes.fetch_add(2);
+		node.first = child;
+		node.count = 0;
+
+		int nl = mid - first, nr = count - nl;
+		if(pool && count > PARALLEL_SIZE){
+			pool->parallelFor(0, 2, 1, [&](int64_t i){
+				if(0 == i) build(child, first, nl, depth+1);
+				else build(child+1, mid, nr, depth+1);
+			});
+		}
+		else{
+			build(child, first, nl, depth+1);
+			build(child+1, mid, nr, depth+1);
+		}
+	}
+};
+
+
+void BVH::build(const std::vector<Box>& boxes, ThreadPool * pool, int maxLeaf){
+	clear();
+	if(boxes.empty()) return;
+
+	mOrder.resize(boxes.size());
+	for(unsigned i=0; i<mOrder.size(); ++i) mOrder[i] = i;
+	mNodes.resize(2*boxes.size() - 1);
+
+	Builder b(boxes, mNodes, mOrder, pool, maxLeaf > 0 ? maxLeaf : 1);
+	b.build(0, 0, boxes.size(), 0);
+	mNodes.resize(b.numNodes.load());
+
+	mParents.assign(mNodes.size(), -1);
+	mLeaves.resize(boxes.size());
+	for(unsigned i=0; i<mNodes.size(); ++i){
+		const Node& n = mNodes[i];
+		if(n.leaf()){
+			for(int j=n.first; j<n.first+n.count; ++j) mLeaves[mOrder[j]] = i;
+		}
+		else{
+			mParents[n.first] = mParents[n.first+1] = i;
+		}
+	}
+}
+
+void BVH::refit(const std::vector<Box>& boxes){
+	// Children always come after their parent
+	for(int i=int(mNodes.size())-1; i>=0; --i){
+		Node& n = mNodes[i];
+		n.box.reset();
+		if(n.leaf()){
+			for(int j=n.first; j<n.first+n.count; ++j) n.box.extend(boxes[mOrder[j]]);
+		}
+		else{
+			n.box.extend(mNodes[n.first].box);
+			n.box.extend(mNodes[n.first+1].box);
+		}
+	}
+}
+
+void BVH::refit(const std::vector<Box>& boxes, const std::vector<unsigned>& moved){
+	for(unsigned k=0; k<moved.size(); ++k){
+		int i = mLeaves[moved[k]];
+		Node& leaf = mNodes[i];
+		leaf.box.reset();
+		for(int j=leaf.first; j<leaf.first+leaf.count; ++j) leaf.box.extend(boxes[mOrder[j]]);
+
+		for(i = mParents[i]; i >= 0; i = mParents[i]){
+			Node& n = mNodes[i];
+			n.box = mNodes[n.first].box;
+			n.box.extend(mNodes[n.first+1].box);
+		}
+	}
+}
+
+
+
+void TriangleBVH::clear(){
+	mBVH.clear();
+	mTriangles.clear();
+	mBoxes.clear();
+	for(int i=0; i<3; ++i){
+		mV0[i].clear();
+		mE1[i].clear();
+		mE2[i].clear();
+	}
+}
+
+void TriangleBVH::build(
+	const Vec3f * vertices, unsigned numVertices,
+	const std::vector<unsigned>& triangles, ThreadPool * pool
+){
+	clear();
+	for(unsigned i=0; i+2<triangles.size(); i+=3){
+		if(triangles[i] < numVertices && triangles[i+1] < numVertices && triangles[i+2] < numVertices){
+			mTriangles.insert(mTriangles.end(), &triangles[i], &triangles[i]+3);
+		}
+	}
+
+	unsigned N = size();
+	mBoxes.resize(N);
+	for(unsigned i=0; i<N; ++i){
+		BVH::Box& b = mBoxes[i];
+		b.reset();
+		for(int k=0; k<3; ++k) b.extend(vertices[mTriangles[3*i+k]]);
+	}
+
+	mBVH.build(mBoxes, pool, LEAF_SIZE);
+	pack(vertices);
+}
+
+void TriangleBVH::refit(const Vec3f * vertices){
+	unsigned N = size();
+	for(unsigned i=0; i<N; ++i){
+		BVH::Box& b = mBoxes[i];
+		b.reset();
+		for(int k=0; k<3; ++k) b.extend(vertices[mTriangles[3*i+k]]);
+	}
+	mBVH.refit(mBoxes);
+	pack(vertices);
+}
+
+void TriangleBVH::pack(const Vec3f * vertices){
+	unsigned N = size();
+
+	// Padded, so that a leaf at the end can be read as a full one
+	for(int c=0; c<3; ++c){
+		mV0[c].assign(N + LEAF_SIZE, 0.f);
+		mE1[c].assign(N + LEAF_SIZE, 0.f);
+		mE2[c].assign(N + LEAF_SIZE, 0.f);
+	}
+
+	const std::vector<unsigned>& order = mBVH.order();
+	for(unsigned i=0; i<N; ++i){
+		const unsigned * t = &mTriangles[3*order[i]];
+		const Vec3f& v0 = vertices[t[0]];
+		Vec3f e1 = vertices[t[1]] - v0;
+		Vec3f e2 = vertices[t[2]] - v0;
+		for(int c=0; c<3; ++c){
+			mV0[c][i] = v0[c];
+			mE1[c][i] = e1[c];
+			mE2[c][i] = e2[c];
+		}
+	}
+}
+
+bool TriangleBVH::intersect(const Rayd& ray, Hit& hit, double tMax) const {
+	if(mBVH.empty()) return false;
+
+	const Vec3f o(ray.o), d(ray.d);
+	float tBest = tMax < FLT_MAX ? float(tMax) : FLT_MAX;
+	int best = -1;
+	float bestU = 0, bestV = 0;
+
+	mBVH.traverse(o, d, tBest, [&](int first, int count, float& tLimit){
+		// Moller-Trumbore test of a whole leaf; lanes past the end of the
+		// leaf are computed but ignored
+		float t[LEAF_SIZE], u[LEAF_SIZE], v[LEAF_SIZE];
+		const float * v0x = &mV0[0][first], * v0y = &mV0[1][first], * v0z = &mV0[2][first];
+		const float * e1x = &mE1[0][first], * e1y = &mE1[1][first], * e1z = &mE1[2][first];
+		const float * e2x = &mE2[0][first], * e2y = &mE2[1][first], * e2z = &mE2[2][first];
+
+		for(int k=0; k<LEAF_SIZE; ++k){
+			float px = d.y*e2z[k] - d.z*e2y[k];
+			float py = d.z*e2x[k] - d.x*e2z[k];
+			float pz = d.x*e2y[k] - d.y*e2x[k];
+			float det = e1x[k]*px + e1y[k]*py + e1z[k]*pz;
+			float inv = det != 0.f ? 1.f/det : 0.f;
+			float sx = o.x - v0x[k], sy = o.y - v0y[k], sz = o.z - v0z[k];
+			float qx = sy*e1z[k] - sz*e1y[k];
+			float qy = sz*e1x[k] - sx*e1z[k];
+			float qz = sx*e1y[k] - sy*e1x[k];
+			u[k] = (sx*px + sy*py + sz*pz) * inv;
+			v[k] = (d.x*qx + d.y*qy + d.z*qz) * inv;
+			t[k] = (e2x[k]*qx + e2y[k]*qy + e2z[k]*qz) * inv;
+			if(!(det != 0.f && u[k] >= 0.f && v[k] >= 0.f && u[k] + v[k] <= 1.f && t[k] > 0.f)){
+				t[k] = FLT_MAX;
+			}
+		}
+
+		for(int k=0; k<count; ++k){
+			if(t[k] < tLimit){
+				tLimit = tBest = t[k];
+				best = first + k;
+				bestU = u[k];
+				bestV = v[k];
+			}
+		}
+	});
+
+	if(best < 0) return false;
+	hit.t = tBest;
+	hit.triangle = mBVH.order()[best];
+	hit.u = bestU;
+	hit.v = bestV;
+	return true;
+}
+
+} // al::
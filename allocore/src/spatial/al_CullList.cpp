@@ -0,0 +1,310 @@
+#include <cmath>
+#include "allocore/spatial/al_CullList.hpp"
+
+namespace al{
+
+namespace{
+	// Planes tested per view, padded from six so loops over them vectorize
+	const int PLANES = 8;
+
+	// Items per leaf of tree
+	const int LEAF_SIZE = 8;
+
+	// Minimum number of views for which refitting a whole tree is faster
+	// than testing every item
+	const int REFIT_VIEWS = 8;
+
+	// With at least this many views, e.g. the faces of one cube map, refitting
+	// also pays off when no more than one in SPARSE_RATIO items is visible,
+	// since the tree then rejects most items in large groups
+	const int REFIT_VIEWS_SPARSE = 6;
+	const unsigned SPARSE_RATIO = 8;
+
+	// The tree is rebuilt when refitting has made it this much worse
+	const float REBUILD_COST = 1.5f;
+
+	// Cost of tracing through a tree relative to testing its root
+	float treeCost(const BVH& tree){
+		const std::vector<BVH::Node>& nodes = tree.nodes();
+		float sum = 0;
+		for(unsigned i=0; i<nodes.size(); ++i){
+			if(!nodes[i].leaf()) sum += nodes[i].box.area();
+		}
+		float root = tree.bounds().area();
+		return root > 0.f ? sum / root : 0.f;
+	}
+}
+
+CullList::CullList()
+:	mNumVisible(0), mNumMoved(0), mTreeCost(0),
+	mNumShown(unsigned(-1)),
+	mHierarchical(true), mRebuild(true), mAllMoved(true), mRefilled(true)
+{}
+
+CullList& CullList::clear(){
+	mItems.clear();
+	mMasks.clear();
+	for(int i=0; i<MAX_VIEWS; ++i) mVisible[i].clear();
+	mNumVisible = 0;
+	mAllMoved = true;
+	mRefilled = true;
+	return *this;
+}
+
+int CullList::add(const Vec3d& center, double radius, int id){
+	Item item;
+	item.center = center;
+	item.radius = radius;
+	item.id = id < 0 ? int(mItems.size()) : id;
+	mItems.push_back(item);
+	mMasks.push_back(0);
+	mAllMoved = true;
+	return mItems.size()-1;
+}
+
+CullList& CullList::set(int i, const Vec3d& center, double radius){
+	mItems[i].center = center;
+	mItems[i].radius = radius;
+	if(!mAllMoved) mMoved.push_back(i);
+	return *this;
+}
+
+CullList& CullList::clearViews(){
+	mViews.clear();
+	return *this;
+}
+
+int CullList::addView(const Frustumd& f){
+	if(numViews() >= MAX_VIEWS) return -1;
+	mViews.push_back(f);
+	return numViews()-1;
+}
+
+int CullList::addCubeFaces(const Pose& pose, double near, double far){
+	if(numViews() + 6 > MAX_VIEWS) return -1;
+
+	Vec3d ux, uy, uz;
+	pose.unitVectors(ux, uy, uz);
+	const Vec3d& pos = pose.pos();
+
+	// View direction and up vector of each face, following the cube map
+	// convention (up is -y for the side faces)
+	const Vec3d dirs[6] = { ux, -ux,  uy, -uy,  uz, -uz };
+	const Vec3d ups [6] = {-uy, -uy,  uz, -uz, -uy, -uy };
+
+	int first = numViews();
+	for(int i=0; i<6; ++i){
+		const Vec3d& d = dirs[i];
+		const Vec3d& u = ups[i];
+		Vec3d r = cross(d, u);
+
+		// 90 degree field of view, so half-width equals depth
+		Vec3d nc = pos + d*near;
+		Vec3d fc = pos + d*far;
+
+		Frustumd f;
+		f.ntl = nc + (u - r)*near;
+		f.ntr = nc + (u + r)*near;
+		f.nbl = nc - (u + r)*near;
+		f.nbr = nc - (u - r)*near;
+		f.ftl = fc + (u - r)*far;
+		f.ftr = fc + (u + r)*far;
+		f.fbl = fc - (u + r)*far;
+		f.fbr = fc - (u - r)*far;
+		f.computePlanes();
+		mViews.push_back(f);
+	}
+	return first;
+}
+
+void CullList::cull(double inflate){
+	for(int v=0; v<MAX_VIEWS; ++v) mVisible[v].clear();
+	mNumVisible = 0;
+
+	// A list refilled since the last cull has usually moved as a whole, so
+	// the tree is only worth updating when there are many views, or a few
+	// less if the last cull found most items outside all of them
+	bool refit = numViews() >= REFIT_VIEWS
+		|| (numViews() >= REFIT_VIEWS_SPARSE
+			&& mNumShown <= unsigned(size()) / SPARSE_RATIO);
+	bool tree = mHierarchical && size() >= HIERARCHY_SIZE && numViews()
+		&& (!mRefilled || refit);
+	mRefilled = false;
+
+	if(tree){
+		cullTree(inflate);
+	}
+	else{
+		// The tree is not kept up to date, so must be refit when next used
+		mMoved.clear();
+		mAllMoved = true;
+		cullLinear(inflate);
+	}
+
+	mNumShown = 0;
+	for(int i=0; i<size(); ++i) mNumShown += mMasks[i] != 0;
+}
+
+void CullList::cullLinear(double inflate){
+	const int nv = numViews();
+	for(int i=0; i<size(); ++i){
+		const Item& it = mItems[i];
+		const double r = it.radius + inflate;
+		uint32_t m = 0;
+		for(int v=0; v<nv; ++v){
+			if(mViews[v].testSphere(it.center, r) != Frustumd::OUTSIDE){
+				m |= uint32_t(1) << v;
+				mVisible[v].push_back(i);
+				++mNumVisible;
+			}
+		}
+		mMasks[i] = m;
+	}
+}
+
+void CullList::updateBox(int i){
+	const Item& it = mItems[i];
+	const Vec3d& c = it.center;
+	// Pad by the precision of floats, so that boxes stay conservative
+	double r = it.radius + 1e-5 * (std::abs(c.x) + std::abs(c.y) + std::abs(c.z) + it.radius);
+	mBoxes[i] = BVH::Box(Vec3f(c - r), Vec3f(c + r));
+}
+
+void CullList::updateTree(){
+	const int N = size();
+	bool build = mRebuild || int(mTree.order().size()) != N;
+	bool check = false;
+
+	if(build || mAllMoved){
+		mBoxes.resize(N);
+		for(int i=0; i<N; ++i) updateBox(i);
+		if(!build){
+			mTree.refit(mBoxes);
+			check = true;
+		}
+	}
+	else if(!mMoved.empty()){
+		for(unsigned k=0; k<mMoved.size(); ++k) updateBox(mMoved[k]);
+		mTree.refit(mBoxes, mMoved);
+		// Checking the tree costs about as much as a full refit
+		mNumMoved += mMoved.size();
+		if(mNumMoved > unsigned(N/4)){
+			mNumMoved = 0;
+			check = true;
+		}
+	}
+	mMoved.clear();
+	mAllMoved = false;
+
+	if(check && treeCost(mTree) > mTreeCost * REBUILD_COST) build = true;
+	if(build){
+		mTree.build(mBoxes, &ThreadPool::global(), LEAF_SIZE);
+		mTreeCost = treeCost(mTree);
+		mNumMoved = 0;
+		mRebuild = false;
+	}
+}
+
+void CullList::updatePlanes(){
+	const int nv = numViews();
+	mPlanes.assign(nv * 4*PLANES, 0.f);
+	for(int v=0; v<nv; ++v){
+		float * p = &mPlanes[v * 4*PLANES];
+		for(int k=0; k<PLANES; ++k){
+			if(k < 6){
+				const Plane<double>& pl = mViews[v].pl[k];
+				p[k          ] = pl.normal().x;
+				p[k +  PLANES] = pl.normal().y;
+				p[k + 2*PLANES] = pl.normal().z;
+				p[k + 3*PLANES] = pl.d();
+			}
+			else{
+				p[k + 3*PLANES] = 1e30f; // padding, never outside
+			}
+		}
+	}
+}
+
+void CullList::cullTree(double inflate){
+	updateTree();
+	updatePlanes();
+
+	const int nv = numViews();
+	const float infl = inflate;
+	const std::vector<BVH::Node>& nodes = mTree.nodes();
+	const std::vector<unsigned>& order = mTree.order();
+	mMasks.assign(size(), 0);
+
+	// Nodes to visit with the views that may intersect them and the views
+	// that wholly contain them
+	struct Entry{ int node; uint32_t partial, inside; };
+	Entry stack[128];
+	int top = 0;
+	stack[top].node = 0;
+	stack[top].partial = nv < 32 ? (uint32_t(1) << nv) - 1 : ~uint32_t(0);
+	stack[top++].inside = 0;
+
+	while(top){
+		Entry e = stack[--top];
+		const BVH::Node& n = nodes[e.node];
+
+		// Classify box against views not yet known to contain it, by the
+		// distance of its center to each plane relative to its extent
+		if(e.partial){
+			Vec3f c = n.box.center();
+			Vec3f ext = (n.box.max - n.box.min) * 0.5f;
+			for(int v=0; v<nv; ++v){
+				if(!((e.partial >> v) & 1)) continue;
+				const float * p = &mPlanes[v * 4*PLANES];
+				int out = 0, cross = 0;
+				for(int k=0; k<PLANES; ++k){
+					float s = p[k]*c.x + p[k+PLANES]*c.y + p[k+2*PLANES]*c.z + p[k+3*PLANES];
+					float r = std::abs(p[k])*ext.x + std::abs(p[k+PLANES])*ext.y + std::abs(p[k+2*PLANES])*ext.z + infl;
+					out |= s < -r;
+					cross |= s < r;
+				}
+				if(out) e.partial &= ~(uint32_t(1) << v);
+				else if(!cross){
+					e.partial &= ~(uint32_t(1) << v);
+					e.inside |= uint32_t(1) << v;
+				}
+			}
+			if(!(e.partial | e.inside)) continue;
+		}
+
+		if(n.leaf()){
+			for(int j=n.first; j<n.first+n.count; ++j){
+				int i = order[j];
+				const Item& it = mItems[i];
+				const double r = it.radius + inflate;
+				uint32_t m = e.inside;
+				uint32_t views = e.partial;
+				for(int v=0; views; ++v, views >>= 1){
+					if((views & 1) && mViews[v].testSphere(it.center, r) != Frustumd::OUTSIDE){
+						m |= uint32_t(1) << v;
+					}
+				}
+				mMasks[i] = m;
+			}
+		}
+		else{
+			stack[top] = e;
+			stack[top++].node = n.first+1;
+			stack[top] = e;
+			stack[top++].node = n.first;
+		}
+	}
+
+	// Lists are made from the masks so that they are in order of item
+	for(int i=0; i<size(); ++i){
+		uint32_t m = mMasks[i];
+		for(int v=0; m; ++v, m >>= 1){
+			if(m & 1){
+				mVisible[v].push_back(i);
+				++mNumVisible;
+			}
+		}
+	}
+}
+
+} // al::
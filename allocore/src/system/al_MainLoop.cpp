@@ -1,9 +1,19 @@
 #include "allocore/system/al_MainLoop.hpp"
 #include "allocore/system/al_Config.h"
 #include "allocore/system/al_Printing.hpp"
+#include "allocore/system/al_Profiler.hpp"
 
 #include <stdlib.h>		// exit
 #include <algorithm>	// std::find
+#include <climits>		// INT_MAX
+#include <cmath>		// ceil
+
+#if defined AL_LINUX
+	#include <sys/epoll.h>
+	#include <unistd.h>
+#elif !defined AL_WINDOWS
+	#include <poll.h>
+#endif
 
 // native bindings:
 
@@ -111,6 +121,123 @@ extern "C" void al_main_glut_stop(){
 namespace al {
 
 ////////////////////////////////////////////////////////////////
+// Waiting for file descriptors:
+
+static int timeoutMs(al_sec timeout){
+	if(timeout <= 0) return 0;
+	// Round up so that we never wake before a deadline
+	double ms = std::ceil(timeout * 1e3);
+	return ms < INT_MAX ? int(ms) : INT_MAX;
+}
+
+#if defined AL_LINUX
+
+class Main::Poller {
+public:
+	Poller(): mFD(epoll_create1(EPOLL_CLOEXEC)) {
+		if(mFD < 0) AL_WARN("Main: could not create epoll instance");
+	}
+
+	~Poller(){ if(mFD >= 0) ::close(mFD); }
+
+	bool add(int fd, int events){
+		struct epoll_event ev;
+		ev.events = (events & READABLE ? EPOLLIN : 0) | (events & WRITABLE ? EPOLLOUT : 0);
+		ev.data.fd = fd;
+		if(0 == epoll_ctl(mFD, EPOLL_CTL_ADD, fd, &ev)) return true;
+		return 0 == epoll_ctl(mFD, EPOLL_CTL_MOD, fd, &ev);
+	}
+
+	void remove(int fd){
+		struct epoll_event ev; // ignored, but must be non-null on old kernels
+		epoll_ctl(mFD, EPOLL_CTL_DEL, fd, &ev);
+	}
+
+	void wait(al_sec timeout, std::vector<std::pair<int,int> >& ready){
+		enum { MAX_EVENTS = 64 };
+		struct epoll_event evs[MAX_EVENTS];
+		int n = epoll_wait(mFD, evs, MAX_EVENTS, timeoutMs(timeout));
+		for(int i=0; i<n; ++i){
+			int events = 0;
+			// Errors and hang-ups are reported as readable so that the next
+			// read discovers them
+			if(evs[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) events |= READABLE;
+			if(evs[i].events & EPOLLOUT) events |= WRITABLE;
+			int fd = evs[i].data.fd;
+			ready.push_back(std::make_pair(fd, events));
+		}
+	}
+
+private:
+	int mFD;
+};
+
+#elif !defined AL_WINDOWS
+
+class Main::Poller {
+public:
+	bool add(int fd, int events){
+		short flags = (events & READABLE ? POLLIN : 0) | (events & WRITABLE ? POLLOUT : 0);
+		for(unsigned i=0; i<mFDs.size(); ++i){
+			if(mFDs[i].fd == fd){
+				mFDs[i].events = flags;
+				return true;
+			}
+		}
+		struct pollfd p = { fd, flags, 0 };
+		mFDs.push_back(p);
+		return true;
+	}
+
+	void remove(int fd){
+		for(unsigned i=0; i<mFDs.size(); ++i){
+			if(mFDs[i].fd == fd){
+				mFDs.erase(mFDs.begin() + i);
+				return;
+			}
+		}
+	}
+
+	void wait(al_sec timeout, std::vector<std::pair<int,int> >& ready){
+		if(mFDs.empty()){
+			if(timeout > 0) al_sleep(timeout);
+			return;
+		}
+		if(poll(&mFDs[0], mFDs.size(), timeoutMs(timeout)) <= 0) return;
+		for(unsigned i=0; i<mFDs.size(); ++i){
+			short r = mFDs[i].revents;
+			int events = 0;
+			if(r & (POLLIN | POLLERR | POLLHUP)) events |= READABLE;
+			if(r & POLLOUT) events |= WRITABLE;
+			if(events) ready.push_back(std::make_pair(mFDs[i].fd, events));
+		}
+	}
+
+private:
+	std::vector<struct pollfd> mFDs;
+};
+
+#else
+
+class Main::Poller {
+public:
+	bool add(int fd, int events){
+		AL_WARN("Main: watching file descriptors is not supported on this platform");
+		return false;
+	}
+	void remove(int fd){}
+	void wait(al_sec timeout, std::vector<std::pair<int,int> >& ready){
+		if(timeout > 0) al_sleep(timeout);
+	}
+};
+
+#endif
+
+////////////////////////////////////////////////////////////////
+
+Main::Handler :: Handler()
+:	mBudget(0), mTickTime(0), mTickTimeMax(0), mOverBudget(0)
+{}
 
 Main::Handler :: ~Handler() {
 	Main::get().remove(*this);
@@ -126,6 +253,7 @@ Main::Main()
 	mLogicalTime(0),
 	mCPU(0),
 	mDriver(Main::SLEEP),
+	mPoller(NULL),
 	mActive(false)
 {
 	for(unsigned i=0; i<NUM_DRIVERS; ++i){
@@ -135,6 +263,7 @@ Main::Main()
 
 Main::~Main() {
 	Main::exit();
+	delete mPoller;
 }
 
 Main& Main::driver(Driver v) {
@@ -153,29 +282,114 @@ Main& Main::driver(Driver v) {
 }
 
 void Main::tick() {
+	AL_PROFILE_SCOPE("Main::tick");
 	al_sec t1 = timeInSec();
 	mLogicalTime = t1 - mT0;
 
 	mIntervalActual = t1 - mT1;
 	mT1 = t1;
 
-	// trigger any scheduled functions:
-	mQueue.update(mLogicalTime);
+	// trigger any ready descriptors, timers and scheduled functions:
+	dispatch();
 
-	// call tick handlers...
+	// call tick handlers, measuring the time each takes...
+	al_sec t2 = timeInSec();
 	std::vector<Handler *>::iterator it = mHandlers.begin();
 	while(it != mHandlers.end()){
-		(*it)->onTick();
+		Handler& h = **it;
+		h.onTick();
+
+		al_sec t3 = timeInSec();
+		al_sec dt = t3 - t2;
+		t2 = t3;
+		h.mTickTime += 0.1 * (dt - h.mTickTime);
+		if(dt > h.mTickTimeMax) h.mTickTimeMax = dt;
+		if(h.mBudget > 0 && dt > h.mBudget){
+			if(0 == h.mOverBudget){
+				AL_WARN("Main: tick handler took %.2f ms, over its budget of %.2f ms",
+					dt*1e3, h.mBudget*1e3);
+			}
+			++h.mOverBudget;
+		}
 		++it;
 	}
 
 	// measure CPU usage:
-	al_sec t2 = timeInSec();
 	al_sec used = (t2-t1)/interval();
 	// running average:
 	mCPU += 0.1 * (used - mCPU);
 }
 
+void Main::dispatch(al_sec timeout) {
+	if(mPoller && (!mWatched.empty() || timeout > 0)){
+		mReady.clear();
+		mPoller->wait(timeout, mReady);
+
+		for(unsigned i=0; i<mReady.size(); ++i){
+			// The function may unwatch descriptors, including its own
+			std::map<int, IOCallback>::iterator w = mWatched.find(mReady[i].first);
+			if(w != mWatched.end()){
+				IOCallback func = w->second;
+				func(mReady[i].first, mReady[i].second);
+			}
+		}
+	}
+	else if(timeout > 0){
+		al_sleep(timeout);
+	}
+
+	al_sec t = timeInSec() - mT0;
+	mTimers.advance(t);
+	mQueue.update(t);
+}
+
+bool Main::watch(int fd, const IOCallback& func, int events) {
+	if(fd < 0) return false;
+	if(!mPoller) mPoller = new Poller;
+	if(!mPoller->add(fd, events)) return false;
+	mWatched[fd] = func;
+	return true;
+}
+
+Main& Main::unwatch(int fd) {
+	std::map<int, IOCallback>::iterator w = mWatched.find(fd);
+	if(w != mWatched.end()){
+		mPoller->remove(fd);
+		mWatched.erase(w);
+	}
+	return *this;
+}
+
+TimerWheel::Id Main::timer(al_sec delay, const TimerWheel::Callback& func, al_sec period) {
+	return mTimers.add(timeInSec() - mT0 + delay, func, period);
+}
+
+bool Main::cancel(TimerWheel::Id id) {
+	return mTimers.remove(id);
+}
+
+void Main::runEvents() {
+	if(!mPoller) mPoller = new Poller;
+
+	// Ticks are kept on a fixed grid to avoid drift
+	al_sec next = timeInSec();
+	while(mActive){
+		al_sec now = timeInSec();
+		if(now >= next){
+			tick();
+			next += interval();
+			// If far behind, skip ticks rather than bursting
+			if(next < now) next = now + interval();
+			continue;
+		}
+
+		// Sleep until the next tick, timer or scheduled function, unless a
+		// descriptor becomes ready before
+		al_sec wake = std::min(next, mT0 + std::min(mTimers.nextDue(), mQueue.nextTime()));
+		dispatch(wake - now);
+	}
+}
+
 Main& Main::get() {
 	// This has to be dynamically allocated,
 	// otherwise it can get destroyed at some random time
@@ -199,6 +413,7 @@ void Main::start() {
 		switch (mDriver) {
 			case Main::GLUT: al_main_glut_enter(interval()); break;
 			case Main::NATIVE: al_main_native_enter(interval()); break;
+			case Main::EVENT: runEvents(); break;
 			default:
 				// default sleep version
 				while (mActive) {
@@ -221,7 +436,7 @@ void Main::stop() {
 		switch(mDriver){
 			case GLUT: al_main_glut_stop(); break;
 			case NATIVE: al_main_native_stop(); break;
-			default:; // Here, mActive==false stops the loop
+			default:; // Here, mActive==false stops the loop (SLEEP, EVENT)
 		}
 	}
 }
@@ -1,10 +1,31 @@
 #include <algorithm>
+#include <vector>
+#include "allocore/system/al_Config.h"
 #include "allocore/system/al_PeriodicThread.hpp"
+#include "allocore/system/al_Printing.hpp"
+
+#ifdef AL_WINDOWS
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <errno.h>
+	#include <pthread.h>
+	#include <sched.h>
+	#include <sys/mman.h>
+	#include <time.h>
+	#include <unistd.h>
+#endif
+
+// Absolute sleeps need clock_nanosleep on the same clock as al_steady_time_nsec
+#if defined(AL_LINUX) && defined(_POSIX_TIMERS) && (_POSIX_TIMERS > 0) && defined(_POSIX_MONOTONIC_CLOCK)
+	#define AL_PERIODIC_ABSTIME
+#endif
 
 namespace al{
 
 PeriodicThread::PeriodicThread(double periodSec)
-:	mAutocorrect(0.1)
+:	mSpin(0), mAutocorrect(0.1), mPriority(0), mPolicy(FIFO),
+	mRun(false), mRealTime(false), mLockMemory(false)
 {
 	period(periodSec);
 }
@@ -12,9 +33,12 @@ PeriodicThread::PeriodicThread(double periodSec)
 PeriodicThread::PeriodicThread(const PeriodicThread& o)
 :	Thread(o), mPeriod(o.mPeriod), mTimeCurr(o.mTimeCurr),
 	mTimePrev(o.mTimePrev), mWait(o.mWait), mTimeBehind(o.mTimeBehind),
+	mSpin(o.mSpin),
 	mAutocorrect(o.mAutocorrect),
+	mPriority(o.mPriority), mPolicy(o.mPolicy),
 	mUserFunc(o.mUserFunc),
-	mRun(o.mRun)
+	mTiming(o.mTiming),
+	mRun(o.mRun.load()), mRealTime(o.mRealTime), mLockMemory(o.mLockMemory)
 {}
 
 
@@ -38,9 +62,30 @@ double PeriodicThread::period() const {
 	return mPeriod * 1e-9;
 }
 
+PeriodicThread& PeriodicThread::realTime(int priority, Policy policy, bool lockMemory){
+	mRealTime = true;
+	mPriority = priority < 0 ? 0 : (priority > 99 ? 99 : priority);
+	mPolicy = policy;
+	mLockMemory = lockMemory;
+	return *this;
+}
+
+PeriodicThread& PeriodicThread::noRealTime(){
+	mRealTime = false;
+	mPriority = 0;
+	mLockMemory = false;
+	return *this;
+}
+
+PeriodicThread& PeriodicThread::spin(double sec){
+	mSpin = sec > 0. ? sec * 1e9 : 0;
+	return *this;
+}
+
 void PeriodicThread::start(ThreadFunction& func){
 	mUserFunc = &func;
 	mRun = true;
+	mTiming.clear();
 	Thread::start(sPeriodicFunc, this);
 }
 
@@ -57,8 +102,16 @@ void swap(PeriodicThread& a, PeriodicThread& b){
 	SWAP_(mTimeCurr);
 	SWAP_(mTimePrev);
 	SWAP_(mWait);
+	SWAP_(mTimeBehind);
+	SWAP_(mSpin);
+	SWAP_(mAutocorrect);
+	SWAP_(mPriority);
+	SWAP_(mPolicy);
 	SWAP_(mUserFunc);
-	SWAP_(mRun);
+	SWAP_(mTiming);
+	a.mRun.store(b.mRun.exchange(a.mRun.load()));
+	SWAP_(mRealTime);
+	SWAP_(mLockMemory);
 	#undef SWAP_
 }
 
@@ -68,11 +121,18 @@ PeriodicThread& PeriodicThread::operator= (PeriodicThread other){
 }
 
 void PeriodicThread::go(){
+	if(mRealTime){
+		goRealTime();
+		return;
+	}
+
 	// Note: times are al_nsec (long long int)
 	mTimeCurr = al_steady_time_nsec();
 	mWait = 0;
 	mTimeBehind = 0;
+	al_nsec release = mTimeCurr; // when current iteration should have started
 	while(mRun){
+		al_nsec begin = al_steady_time_nsec();
 		(*mUserFunc)();
 
 		mTimePrev = mTimeCurr + mWait;
@@ -80,16 +140,20 @@ void PeriodicThread::go(){
 		al_nsec dt = mTimeCurr - mTimePrev;
 		// dt -> t_curr - (t_prev + wait)
 
+		mTiming.add(begin - release, mTimeCurr - begin, dt >= mPeriod);
+
 		// The wait amount is the ideal period minus the actual amount
 		// of time spent processing between iterations
 		if(dt<mPeriod){
 			mWait = mPeriod - dt;
+			release = mTimeCurr + mWait;
 			al_sleep_nsec(mWait);
 		}
 
 		// This means we are behind, so don't wait
 		else{
 			mWait = 0;
+			release = mTimeCurr;
 			mTimeBehind += dt - mPeriod;
 		}
 
@@ -110,4 +174,123 @@ void PeriodicThread::go(){
 	}
 }
 
+void PeriodicThread::goRealTime(){
+	#ifndef AL_WINDOWS
+	if(mLockMemory){
+		if(0 != mlockall(MCL_CURRENT | MCL_FUTURE)){
+			AL_WARN("PeriodicThread: could not lock memory");
+		}
+	}
+	if(mPriority > 0){
+		struct sched_param param;
+		param.sched_priority = mPriority;
+		int policy = RR == mPolicy ? SCHED_RR : SCHED_FIFO;
+		if(0 != pthread_setschedparam(pthread_self(), policy, &param)){
+			AL_WARN("PeriodicThread: could not set real-time priority %d", mPriority);
+		}
+	}
+	#else
+	if(mPriority > 0){
+		SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+	}
+	#endif
+
+	al_nsec deadline = al_steady_time_nsec();
+	while(mRun){
+		al_nsec begin = al_steady_time_nsec();
+		(*mUserFunc)();
+		al_nsec end = al_steady_time_nsec();
+
+		deadline += mPeriod;
+		bool overrun = end > deadline;
+		mTiming.add(begin - (deadline - mPeriod), end - begin, overrun);
+
+		// Skip missed deadlines to stay in phase rather than bursting
+		if(overrun){
+			deadline += ((end - deadline) / mPeriod + 1) * mPeriod;
+		}
+
+		sleepUntil(deadline);
+	}
+}
+
+void PeriodicThread::sleepUntil(al_nsec deadline){
+	al_nsec wake = deadline - mSpin;
+
+	#ifdef AL_PERIODIC_ABSTIME
+	struct timespec ts;
+	ts.tv_sec = wake / 1000000000;
+	ts.tv_nsec = wake % 1000000000;
+	// Restart if interrupted by a signal; the deadline stays the same
+	while(EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL)){}
+	#else
+	al_nsec dt = wake - al_steady_time_nsec();
+	if(dt > 0) al_sleep_nsec(dt);
+	#endif
+
+	if(mSpin > 0){
+		while(al_steady_time_nsec() < deadline){}
+	}
+}
+
+PeriodicThread::Timing PeriodicThread::timing() const {
+	Timing t;
+	unsigned long long count = mTiming.mCount.load(std::memory_order_acquire);
+	unsigned n = count < TIMING_SAMPLES ? unsigned(count) : TIMING_SAMPLES;
+
+	std::vector<double> latencies;
+	latencies.reserve(n);
+	t.overruns = 0;
+	for(unsigned i=0; i<n; ++i){
+		unsigned long long s = mTiming.mSamples[(count - 1 - i) % TIMING_SAMPLES].load(std::memory_order_relaxed);
+		double lat = int32_t(uint32_t(s >> 32)) * 1e-9;
+		double exe = (s & 0x7fffffff) * 1e-9;
+		t.latency(lat);
+		t.execution(exe);
+		if(s & 0x80000000) ++t.overruns;
+		latencies.push_back(lat);
+	}
+
+	t.samples = n;
+	t.totalOverruns = mTiming.mOverruns.load(std::memory_order_relaxed);
+	t.latencyP99 = 0;
+	if(n){
+		std::vector<double>::iterator p99 = latencies.begin() + (n - 1) * 99 / 100;
+		std::nth_element(latencies.begin(), p99, latencies.end());
+		t.latencyP99 = *p99;
+	}
+	return t;
+}
+
+
+PeriodicThread::TimingRing& PeriodicThread::TimingRing::operator= (const TimingRing& o){
+	for(unsigned i=0; i<TIMING_SAMPLES; ++i){
+		mSamples[i].store(o.mSamples[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+	}
+	mOverruns.store(o.mOverruns.load());
+	mCount.store(o.mCount.load());
+	return *this;
+}
+
+void PeriodicThread::TimingRing::clear(){
+	mCount.store(0);
+	mOverruns.store(0);
+}
+
+void PeriodicThread::TimingRing::add(al_nsec latency, al_nsec execution, bool overrun){
+	// Pack signed latency into high and execution time into low 31 bits
+	const al_nsec lim = 0x7fffffff;
+	latency = std::max(-lim, std::min(latency, lim));
+	execution = std::max(al_nsec(0), std::min(execution, lim));
+	unsigned long long s = (unsigned long long)(uint32_t(int32_t(latency))) << 32;
+	s |= (unsigned long long)(execution);
+	if(overrun){
+		s |= 0x80000000;
+		mOverruns.fetch_add(1, std::memory_order_relaxed);
+	}
+	unsigned long long c = mCount.load(std::memory_order_relaxed);
+	mSamples[c % TIMING_SAMPLES].store(s, std::memory_order_relaxed);
+	mCount.store(c + 1, std::memory_order_release);
+}
+
 } // al::
@@ -0,0 +1,253 @@
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include "allocore/system/al_Printing.hpp"
+#include "allocore/system/al_Profiler.hpp"
+
+namespace al{
+
+namespace{
+
+	// Ring of zones written by one thread and read by any other. Readers
+	// detect slots overwritten while reading through the index being written.
+	struct Buffer{
+		struct Slot{
+			std::atomic<const char *> name;
+			std::atomic<al_nsec> start, end;
+		};
+
+		Slot slots[Profiler::EVENTS_PER_THREAD];
+		std::atomic<unsigned long long> count;		// zones written
+		std::atomic<unsigned long long> writing;	// index+1 of zone being written
+		std::atomic<unsigned long long> cleared;	// zones before this are hidden
+		std::atomic<bool> used;						// whether owned by a thread
+		std::string name;
+
+		Buffer(): count(0), writing(0), cleared(0), used(false){}
+
+		void add(const char * n, al_nsec s, al_nsec e){
+			unsigned long long i = count.load(std::memory_order_relaxed);
+			writing.store(i+1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			Slot& slot = slots[i % Profiler::EVENTS_PER_THREAD];
+			slot.name.store(n, std::memory_order_relaxed);
+			slot.start.store(s, std::memory_order_relaxed);
+			slot.end.store(e, std::memory_order_relaxed);
+			count.store(i+1, std::memory_order_release);
+		}
+
+		void read(std::vector<Profiler::Event>& events, int thread) const {
+			const unsigned long long N = Profiler::EVENTS_PER_THREAD;
+			unsigned long long end = count.load(std::memory_order_acquire);
+			unsigned long long begin = end > N ? end - N : 0;
+			begin = std::max(begin, cleared.load(std::memory_order_relaxed));
+			if(begin >= end) return;
+			size_t first = events.size();
+			for(unsigned long long i=begin; i<end; ++i){
+				const Slot& slot = slots[i % N];
+				Profiler::Event e;
+				e.name = slot.name.load(std::memory_order_relaxed);
+				e.start = slot.start.load(std::memory_order_relaxed);
+				e.end = slot.end.load(std::memory_order_relaxed);
+				e.thread = thread;
+				events.push_back(e);
+			}
+
+			// Drop zones whose slots were reused while reading
+			std::atomic_thread_fence(std::memory_order_acquire);
+			unsigned long long w = writing.load(std::memory_order_relaxed);
+			if(w > begin + N){
+				unsigned long long drop = std::min(w - N - begin, end - begin);
+				events.erase(events.begin() + first, events.begin() + first + drop);
+			}
+		}
+	};
+
+	std::atomic<Buffer *> gBuffers[Profiler::MAX_THREADS];
+	std::mutex gMutex;					// for allocating buffers and names
+	thread_local Buffer * tBuffer = 0;
+	thread_local bool tNoBuffer = false;
+
+	// Gives the buffer of a thread back when the thread exits
+	struct Owner{
+		Buffer * buffer;
+		Owner(): buffer(0){}
+		~Owner(){ if(buffer) buffer->used.store(false, std::memory_order_release); }
+	};
+	thread_local Owner tOwner;
+
+	// Take the first buffer not owned by a thread, allocating it if needed.
+	// Zones of a thread that exited stay in its buffer after it is reused.
+	Buffer * claim(){
+		if(tNoBuffer) return 0;
+		for(int i=0; i<Profiler::MAX_THREADS; ++i){
+			Buffer * b = gBuffers[i].load(std::memory_order_acquire);
+			if(!b){
+				std::lock_guard<std::mutex> lock(gMutex);
+				b = gBuffers[i].load(std::memory_order_relaxed);
+				if(!b){
+					b = new Buffer;
+					gBuffers[i].store(b, std::memory_order_release);
+				}
+			}
+			bool used = false;
+			if(b->used.compare_exchange_strong(used, true, std::memory_order_acq_rel)){
+				if(!b->name.empty()){
+					std::lock_guard<std::mutex> lock(gMutex);
+					b->name.clear();
+				}
+				tOwner.buffer = b;
+				return tBuffer = b;
+			}
+		}
+		AL_WARN_ONCE("Profiler: more than %d threads recording, some are ignored", int(Profiler::MAX_THREADS));
+		tNoBuffer = true;
+		return 0;
+	}
+
+	void escapeJSON(std::string& out, const char * s){
+		for(; *s; ++s){
+			char c = *s;
+			if('"' == c || '\\' == c){
+				out += '\\';
+				out += c;
+			}
+			else if((unsigned char)c < 0x20){
+				char buf[8];
+				std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+				out += buf;
+			}
+			else{
+				out += c;
+			}
+		}
+	}
+}
+
+std::atomic<bool> Profiler::sEnabled(false);
+
+void Profiler::enable(bool v){
+	if(v){
+		// Allocate buffers up front, so that threads recording for the first
+		// time, such as an audio thread, need not
+		std::lock_guard<std::mutex> lock(gMutex);
+		for(int i=0; i<PREALLOCATED_THREADS; ++i){
+			if(!gBuffers[i].load(std::memory_order_relaxed)){
+				gBuffers[i].store(new Buffer, std::memory_order_release);
+			}
+		}
+	}
+	sEnabled.store(v);
+}
+
+void Profiler::threadName(const std::string& name){
+	Buffer * b = tBuffer ? tBuffer : claim();
+	if(!b) return;
+	std::lock_guard<std::mutex> lock(gMutex);
+	b->name = name;
+}
+
+void Profiler::record(const char * name, al_nsec start, al_nsec end){
+	Buffer * b = tBuffer ? tBuffer : claim();
+	if(b) b->add(name, start, end);
+}
+
+void Profiler::clear(){
+	// Zones are only written by their threads, so they are cleared by
+	// hiding those before the current counts
+	for(int i=0; i<MAX_THREADS; ++i){
+		Buffer * b = gBuffers[i].load(std::memory_order_acquire);
+		if(b) b->cleared.store(b->count.load(std::memory_order_acquire));
+	}
+}
+
+void Profiler::events(std::vector<Event>& events){
+	events.clear();
+	for(int i=0; i<MAX_THREADS; ++i){
+		const Buffer * b = gBuffers[i].load(std::memory_order_acquire);
+		if(b) b->read(events, i);
+	}
+	std::stable_sort(events.begin(), events.end(),
+		[](const Event& a, const Event& b){ return a.start < b.start; }
+	);
+}
+
+void Profiler::summary(std::vector<ZoneStats>& stats){
+	std::vector<Event> evs;
+	events(evs);
+
+	// Zones are grouped by name, since the same name may be used in
+	// several places
+	std::map<std::string, std::vector<double> > times;
+	for(unsigned i=0; i<evs.size(); ++i){
+		times[evs[i].name].push_back((evs[i].end - evs[i].start) * 1e-9);
+	}
+
+	stats.clear();
+	for(std::map<std::string, std::vector<double> >::iterator it = times.begin(); it != times.end(); ++it){
+		std::vector<double>& t = it->second;
+		ZoneStats z;
+		z.name = it->first;
+		z.count = t.size();
+		z.total = 0;
+		for(unsigned i=0; i<t.size(); ++i){
+			z.time(t[i]);
+			z.total += t[i];
+		}
+		std::vector<double>::iterator p99 = t.begin() + (t.size() - 1) * 99 / 100;
+		std::nth_element(t.begin(), p99, t.end());
+		z.p99 = *p99;
+		stats.push_back(z);
+	}
+}
+
+std::string Profiler::chromeTrace(){
+	std::vector<Event> evs;
+	events(evs);
+
+	std::string s = "{\"traceEvents\":[\n";
+	bool first = true;
+	char buf[160];
+
+	{
+		std::lock_guard<std::mutex> lock(gMutex);
+		for(int i=0; i<MAX_THREADS; ++i){
+			const Buffer * b = gBuffers[i].load(std::memory_order_acquire);
+			if(!b || b->name.empty()) continue;
+			if(!first) s += ",\n";
+			first = false;
+			std::snprintf(buf, sizeof(buf),
+				"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"", i);
+			s += buf;
+			escapeJSON(s, b->name.c_str());
+			s += "\"}}";
+		}
+	}
+
+	// Times are in microseconds from the first zone
+	al_nsec t0 = evs.empty() ? 0 : evs[0].start;
+	for(unsigned i=0; i<evs.size(); ++i){
+		const Event& e = evs[i];
+		if(!first) s += ",\n";
+		first = false;
+		s += "{\"name\":\"";
+		escapeJSON(s, e.name);
+		std::snprintf(buf, sizeof(buf),
+			"\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+			e.thread, (e.start - t0) * 1e-3, (e.end - e.start) * 1e-3);
+		s += buf;
+	}
+	s += "\n]}\n";
+	return s;
+}
+
+bool Profiler::writeChromeTrace(const std::string& path){
+	std::string s = chromeTrace();
+	FILE * fp = std::fopen(path.c_str(), "w");
+	if(!fp) return false;
+	bool ok = std::fwrite(s.data(), 1, s.size(), fp) == s.size();
+	return 0 == std::fclose(fp) && ok;
+}
+
+} // al::
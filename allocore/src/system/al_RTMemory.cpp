@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "allocore/system/al_RTMemory.hpp"
+
+namespace al{
+
+namespace{
+	enum{ ALIGN = 64 };	// alignment of memory of pools and arenas
+
+	thread_local LinearArena * tArena = 0;
+	thread_local bool tRealtime = false;
+
+	char * alignedNew(size_t size){
+		return static_cast<char *>(::operator new(size + ALIGN));
+	}
+
+	char * alignUp(char * p, size_t align){
+		return reinterpret_cast<char *>((reinterpret_cast<uintptr_t>(p) + align-1) & ~uintptr_t(align-1));
+	}
+}
+
+
+MemoryPool::MemoryPool(size_t blockSize, uint32_t numBlocks)
+:	mMem(0), mBlockSize(0), mNumBlocks(0), mFree(2)
+{
+	resize(blockSize, numBlocks);
+}
+
+MemoryPool::~MemoryPool(){
+	::operator delete(mMem);
+}
+
+void MemoryPool::resize(size_t blockSize, uint32_t numBlocks){
+	::operator delete(mMem);
+	mMem = 0;
+	mBlockSize = (blockSize + 15) & ~size_t(15);
+	mNumBlocks = mBlockSize ? numBlocks : 0;
+	mFree.resize(mNumBlocks);
+	if(mNumBlocks){
+		mMem = static_cast<char *>(::operator new(mBlockSize * mNumBlocks));
+		for(uint32_t i=0; i<mNumBlocks; ++i) mFree.push(mMem + i*mBlockSize);
+	}
+}
+
+void * MemoryPool::alloc(){
+	void * p;
+	return mFree.pop(p) ? p : 0;
+}
+
+void MemoryPool::free(void * block){
+	if(block){
+		assert(owns(block));
+		mFree.push(block);
+	}
+}
+
+
+
+LinearArena::LinearArena(size_t capacity)
+:	mMem(0), mCapacity(0), mUsed(0), mPeak(0)
+{
+	resize(capacity);
+}
+
+LinearArena::~LinearArena(){
+	::operator delete(mMem);
+}
+
+void LinearArena::resize(size_t capacity){
+	::operator delete(mMem);
+	mMem = capacity ? alignedNew(capacity) : 0;
+	mCapacity = capacity;
+	mUsed.store(0);
+	mPeak = 0;
+}
+
+size_t LinearArena::used() const {
+	return std::min(mUsed.load(std::memory_order_relaxed), mCapacity);
+}
+
+size_t LinearArena::peak() const {
+	return std::max(mPeak, mUsed.load(std::memory_order_relaxed));
+}
+
+void * LinearArena::alloc(size_t size, size_t align){
+	if(align < 16) align = 16;
+	// Reserve enough to align the start wherever it lands
+	size_t need = size + align-1;
+	size_t offset = mUsed.fetch_add(need, std::memory_order_relaxed);
+	if(offset + need > mCapacity) return 0;
+	return alignUp(alignUp(mMem, ALIGN) + offset, align);
+}
+
+void LinearArena::reset(){
+	mPeak = peak();
+	mUsed.store(0, std::memory_order_relaxed);
+}
+
+LinearArena * LinearArena::current(){ return tArena; }
+
+LinearArena::Scope::Scope(LinearArena& a)
+:	mPrev(tArena)
+{
+	tArena = &a;
+}
+
+LinearArena::Scope::~Scope(){
+	tArena = mPrev;
+}
+
+
+
+bool RTHeapCheck::enabled(){
+	#ifdef AL_RT_HEAP_CHECK
+	return true;
+	#else
+	return false;
+	#endif
+}
+
+bool RTHeapCheck::realtime(){ return tRealtime; }
+
+RTHeapCheck::Scope::Scope(bool realtime)
+:	mPrev(tRealtime)
+{
+	tRealtime = realtime;
+}
+
+RTHeapCheck::Scope::~Scope(){
+	tRealtime = mPrev;
+}
+
+} // al::
+
+
+#ifdef AL_RT_HEAP_CHECK
+
+// Replacements of the global allocation functions that catch heap use on a
+// thread marked as real-time
+
+namespace{
+	void checkHeapUse(){
+		if(al::tRealtime){
+			// Unmark while reporting, in case reporting allocates
+			al::tRealtime = false;
+			fprintf(stderr, "allocore: heap used on a real-time thread\n");
+			assert(!"heap used on a real-time thread");
+			al::tRealtime = true;
+		}
+	}
+
+	void * checkedMalloc(size_t size){
+		checkHeapUse();
+		void * p = malloc(size ? size : 1);
+		if(!p) throw std::bad_alloc();
+		return p;
+	}
+}
+
+void * operator new(size_t size){ return checkedMalloc(size); }
+void * operator new[](size_t size){ return checkedMalloc(size); }
+
+void * operator new(size_t size, const std::nothrow_t&) noexcept {
+	checkHeapUse();
+	return malloc(size ? size : 1);
+}
+
+void * operator new[](size_t size, const std::nothrow_t&) noexcept {
+	checkHeapUse();
+	return malloc(size ? size : 1);
+}
+
+void operator delete(void * p) noexcept {
+	if(p){
+		checkHeapUse();
+		free(p);
+	}
+}
+
+void operator delete[](void * p) noexcept { operator delete(p); }
+void operator delete(void * p, const std::nothrow_t&) noexcept { operator delete(p); }
+void operator delete[](void * p, const std::nothrow_t&) noexcept { operator delete(p); }
+
+#endif
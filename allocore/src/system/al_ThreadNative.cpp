@@ -7,6 +7,7 @@
 	#define USE_THREADEX
 #else
 	#define USE_PTHREAD
+	#include <sched.h>
 #endif
 
 namespace al {
@@ -65,6 +66,20 @@ struct Thread::Impl{
 		}
 	}
 
+	void affinity(int core){
+		#ifdef __linux__
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		if(core >= 0 && core < CPU_SETSIZE){
+			CPU_SET(core, &set);
+		}
+		else{
+			for(int i=0; i<CPU_SETSIZE; ++i) CPU_SET(i, &set);
+		}
+		pthread_attr_setaffinity_np(&mAttr, sizeof(set), &set);
+		#endif
+	}
+
 //	bool cancel(){
 //		return 0 == pthread_cancel(mHandle);
 //	}
@@ -104,13 +119,16 @@ void * Thread::current(){
 
 class Thread::Impl{
 public:
-	Impl(): mHandle(0){}
+	Impl(): mHandle(0), mCore(-1){}
 
 	bool start(ThreadFunction& func){
 		if(mHandle) return false;
 		unsigned thread_id;
 		mHandle = _beginthreadex(NULL, 0, cThreadFunc, &func, 0, &thread_id);
-		if(mHandle) return true;
+		if(mHandle){
+			if(mCore >= 0) SetThreadAffinityMask((HANDLE)mHandle, DWORD_PTR(1) << mCore);
+			return true;
+		}
 		return false;
 	}
 
@@ -128,6 +146,10 @@ public:
 	void priority(int v){
 	}
 
+	void affinity(int core){
+		mCore = core;
+	}
+
 //	bool cancel(){
 //		TerminateThread((HANDLE)mHandle, 0);
 //		return true;
@@ -137,6 +159,7 @@ public:
 //	}
 
 	unsigned long mHandle;
+	int mCore;
 //	ThreadFunction mRoutine;
 
 	static unsigned cThreadFunc(void * user){
@@ -211,6 +234,11 @@ Thread& Thread::priority(int v){
 	return *this;
 }
 
+Thread& Thread::affinity(int core){
+	mImpl->affinity(core);
+	return *this;
+}
+
 bool Thread::start(ThreadFunction& func){
 	return mImpl->start(func);
 }
@@ -0,0 +1,235 @@
+#include <chrono>
+#include <thread>
+#include "allocore/system/al_ThreadPool.hpp"
+
+namespace al{
+
+namespace{
+	// Pool and worker index of calling thread
+	thread_local const ThreadPool * tPool = 0;
+	thread_local int tWorker = -1;
+}
+
+
+// Fixed-capacity deque guarded by a spin lock. Critical sections are only a
+// few instructions long, so contention is resolved without syscalls.
+struct ThreadPool::Deque{
+	enum{ CAPACITY = 1024 };
+
+	Deque(): mHead(0), mTail(0){ mLock.clear(); }
+
+	// Add task to the back
+	bool push(const Task& t){
+		lock();
+		bool ok = mTail - mHead < CAPACITY;
+		if(ok) mTasks[mTail++ % CAPACITY] = t;
+		unlock();
+		return ok;
+	}
+
+	// Remove most recently pushed task
+	bool pop(Task& t){
+		lock();
+		bool ok = mTail != mHead;
+		if(ok) t = mTasks[--mTail % CAPACITY];
+		unlock();
+		return ok;
+	}
+
+	// Remove least recently pushed task
+	bool steal(Task& t){
+		lock();
+		bool ok = mTail != mHead;
+		if(ok) t = mTasks[mHead++ % CAPACITY];
+		unlock();
+		return ok;
+	}
+
+	void lock(){ while(mLock.test_and_set(std::memory_order_acquire)){} }
+	void unlock(){ mLock.clear(std::memory_order_release); }
+
+	char mPad0[64];
+	std::atomic_flag mLock;
+	uint32_t mHead, mTail;
+	Task mTasks[CAPACITY];
+	char mPad1[64];
+};
+
+
+struct ThreadPool::Worker : public ThreadFunction{
+	Worker(ThreadPool& p, int i): pool(p), index(i){}
+	void operator()(){ pool.workerLoop(index); }
+	ThreadPool& pool;
+	int index;
+	Thread thread;
+};
+
+
+ThreadPool::ThreadPool(int numThreads, bool pinThreads, int priority)
+:	mQueued(0), mSleepers(0), mRunning(true)
+{
+	int cores = std::thread::hardware_concurrency();
+	if(numThreads < 0){
+		numThreads = cores > 1 ? cores - 1 : 1;
+	}
+
+	for(int i=0; i<=numThreads; ++i) mDeques.push_back(new Deque);
+
+	for(int i=0; i<numThreads; ++i){
+		Worker * w = new Worker(*this, i);
+		mWorkers.push_back(w);
+		if(priority > 0) w->thread.priority(priority);
+		if(pinThreads && cores > 0) w->thread.affinity(i % cores);
+	}
+	for(int i=0; i<numThreads; ++i){
+		mWorkers[i]->thread.start(*mWorkers[i]);
+	}
+}
+
+ThreadPool::~ThreadPool(){
+	{
+		std::lock_guard<std::mutex> lock(mSleepMutex);
+		mRunning = false;
+	}
+	mWake.notify_all();
+	for(unsigned i=0; i<mWorkers.size(); ++i){
+		mWorkers[i]->thread.join();
+		delete mWorkers[i];
+	}
+	for(unsigned i=0; i<mDeques.size(); ++i) delete mDeques[i];
+}
+
+ThreadPool& ThreadPool::global(){
+	static ThreadPool pool;
+	return pool;
+}
+
+int ThreadPool::workerIndex() const {
+	return tPool == this ? tWorker : -1;
+}
+
+bool ThreadPool::push(const Task& t){
+	int w = workerIndex();
+	Deque& d = *mDeques[w < 0 ? size() : w];
+	if(!d.push(t)) return false;
+	++mQueued;
+
+	// Wake a sleeping worker. The lock is only tried so that this never
+	// blocks; a wakeup missed as a result is bounded by the sleep timeout.
+	if(mSleepers.load() > 0){
+		if(mSleepMutex.try_lock()){
+			mWake.notify_one();
+			mSleepMutex.unlock();
+		}
+		else{
+			mWake.notify_one();
+		}
+	}
+	return true;
+}
+
+bool ThreadPool::pop(Task& t){
+	int w = workerIndex();
+	int own = w < 0 ? size() : w;
+	int n = mDeques.size();
+
+	if(mQueued.load(std::memory_order_relaxed) == 0) return false;
+
+	// Newest task of own deque first, for locality, then steal oldest tasks
+	if(mDeques[own]->pop(t)){
+		--mQueued;
+		return true;
+	}
+	for(int i=1; i<n; ++i){
+		if(mDeques[(own + i) % n]->steal(t)){
+			--mQueued;
+			return true;
+		}
+	}
+	return false;
+}
+
+void ThreadPool::execute(Task t){
+	// Split off halves for others to steal until within grain size
+	while(t.end - t.begin > t.grain){
+		Task r = t;
+		r.begin = t.begin + (t.end - t.begin)/2;
+		t.end = r.begin;
+		++t.group->mPending;
+		if(!push(r)) execute(r);
+	}
+	t.func(t.context, t.begin, t.end);
+	t.group->mPending.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void ThreadPool::submit(const Task& t){
+	++t.group->mPending;
+	if(!push(t)) execute(t);
+}
+
+bool ThreadPool::runPending(){
+	Task t;
+	if(pop(t)){
+		execute(t);
+		return true;
+	}
+	return false;
+}
+
+void ThreadPool::workerLoop(int index){
+	tPool = this;
+	tWorker = index;
+
+	int idle = 0;
+	while(mRunning.load(std::memory_order_acquire)){
+		if(runPending()){
+			idle = 0;
+		}
+		else if(++idle < 64){
+			std::this_thread::yield();
+		}
+		else{
+			std::unique_lock<std::mutex> lock(mSleepMutex);
+			++mSleepers;
+			if(mRunning && mQueued.load() == 0){
+				mWake.wait_for(lock, std::chrono::milliseconds(10));
+			}
+			--mSleepers;
+			idle = 0;
+		}
+	}
+}
+
+
+
+TaskGroup::TaskGroup(ThreadPool& pool)
+:	mPool(pool), mPending(0)
+{}
+
+void TaskGroup::schedule(
+	void (*func)(void *, int64_t, int64_t), void * context,
+	int64_t begin, int64_t end, int64_t grain
+){
+	ThreadPool::Task t;
+	t.func = func;
+	t.context = context;
+	t.begin = begin;
+	t.end = end;
+	t.grain = grain > 0 ? grain : 1;
+	t.group = this;
+	mPool.submit(t);
+}
+
+void TaskGroup::wait(){
+	int idle = 0;
+	while(!done()){
+		if(mPool.runPending()){
+			idle = 0;
+		}
+		else if(++idle > 16){
+			std::this_thread::yield();
+		}
+	}
+}
+
+} // al::
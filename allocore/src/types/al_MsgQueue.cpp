@@ -1,5 +1,6 @@
 #include <algorithm> // std::max
 #include <assert.h>
+#include <limits>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string>
@@ -135,6 +136,10 @@ void MsgQueue :: update(al_sec until, bool defer) {
 	mNow = until;
 }
 
+al_sec MsgQueue :: nextTime() const {
+	return mHead ? mHead->t : std::numeric_limits<al_sec>::max();
+}
+
 void MsgQueue :: clear() {
 	// recycle everything:
 	Msg * m = mHead;
@@ -0,0 +1,229 @@
+#include <cmath>
+#include <limits>
+#include "allocore/types/al_TimerWheel.hpp"
+
+namespace al {
+
+namespace {
+	// Timer states other than being in a list
+	const int FREE = -1;
+	const int CALLING = -2;	// function is being called
+	const int REMOVED = -3;	// removed while function was being called
+
+	// Index of lowest set bit
+	int lowestBit(uint64_t v){
+	#if defined(__GNUC__) || defined(__clang__)
+		return __builtin_ctzll(v);
+	#else
+		int i = 0;
+		while(!(v & 1)){ v >>= 1; ++i; }
+		return i;
+	#endif
+	}
+}
+
+TimerWheel::TimerWheel(al_sec resolution)
+:	mFree(-1), mCount(0), mTick(0), mLevel0(0),
+	mResolution(resolution > 0 ? resolution : 0.001)
+{
+	for(int i=0; i<NUM_LISTS; ++i) mLists[i] = mTails[i] = -1;
+}
+
+void TimerWheel::link(int i, int list){
+	Timer& t = mTimers[i];
+	t.list = list;
+	t.prev = mTails[list];
+	t.next = -1;
+	if(t.prev >= 0) mTimers[t.prev].next = i;
+	else mLists[list] = i;
+	mTails[list] = i;
+	if(list < SLOTS) mLevel0 |= uint64_t(1) << list;
+}
+
+void TimerWheel::unlink(int i){
+	Timer& t = mTimers[i];
+	if(t.prev >= 0) mTimers[t.prev].next = t.next;
+	else mLists[t.list] = t.next;
+	if(t.next >= 0) mTimers[t.next].prev = t.prev;
+	else mTails[t.list] = t.prev;
+	if(t.list < SLOTS && mLists[t.list] < 0) mLevel0 &= ~(uint64_t(1) << t.list);
+	t.list = FREE;
+}
+
+void TimerWheel::insert(int i){
+	Timer& t = mTimers[i];
+	if(t.due < mTick) t.due = mTick;
+	uint64_t delta = t.due - mTick;
+
+	for(int level=0; level<LEVELS; ++level){
+		if(delta < (uint64_t(1) << (SLOT_BITS*(level+1)))){
+			link(i, level*SLOTS + int((t.due >> (SLOT_BITS*level)) & (SLOTS-1)));
+			return;
+		}
+	}
+	link(i, OVERFLOW_LIST);
+}
+
+void TimerWheel::cascade(int list){
+	// Timers are re-inserted relative to the current tick, which moves them
+	// into finer wheels
+	int i = mLists[list];
+	mLists[list] = mTails[list] = -1;
+	while(i >= 0){
+		int next = mTimers[i].next;
+		insert(i);
+		i = next;
+	}
+}
+
+void TimerWheel::release(int i){
+	Timer& t = mTimers[i];
+	t.func = Callback();
+	t.list = FREE;
+	++t.gen;
+	t.next = mFree;
+	mFree = i;
+	--mCount;
+}
+
+TimerWheel::Id TimerWheel::add(al_sec at, const Callback& func, al_sec period){
+	int i;
+	if(mFree >= 0){
+		i = mFree;
+		mFree = mTimers[i].next;
+	}
+	else{
+		i = mTimers.size();
+		mTimers.push_back(Timer());
+		mTimers[i].gen = 1;
+	}
+
+	// Round up so that a timer is never called before its time
+	Timer& t = mTimers[i];
+	double due = std::ceil(at/mResolution - 1e-6);
+	t.due = due > 0. ? uint64_t(due) : 0;
+	t.period = 0;
+	if(period > 0.){
+		double p = std::floor(period/mResolution + 0.5);
+		t.period = p >= 1. ? uint64_t(p) : 1;
+	}
+	t.func = func;
+	++mCount;
+	insert(i);
+	return makeId(i);
+}
+
+bool TimerWheel::remove(Id id){
+	int i = int(id & 0xffffffff) - 1;
+	if(i < 0 || i >= int(mTimers.size())) return false;
+	Timer& t = mTimers[i];
+	if(t.gen != uint32_t(id >> 32) || FREE == t.list || REMOVED == t.list) return false;
+
+	if(CALLING == t.list){
+		t.list = REMOVED;
+	}
+	else{
+		unlink(i);
+		release(i);
+	}
+	return true;
+}
+
+void TimerWheel::clear(){
+	for(unsigned i=0; i<mTimers.size(); ++i){
+		int list = mTimers[i].list;
+		if(list >= 0){
+			unlink(i);
+			release(i);
+		}
+		else if(CALLING == list){
+			mTimers[i].list = REMOVED;
+		}
+	}
+}
+
+void TimerWheel::advance(al_sec until){
+	if(until < 0.) return;
+	uint64_t last = uint64_t(until/mResolution + 1e-6);
+
+	while(mTick <= last){
+		if(0 == mCount){
+			mTick = last + 1;
+			break;
+		}
+
+		uint64_t t = mTick;
+		uint64_t slot = t & (SLOTS-1);
+
+		// Move timers down from coarser wheels at their slot boundaries
+		if(0 == slot){
+			for(int level=1; level<LEVELS; ++level){
+				uint64_t s = (t >> (SLOT_BITS*level)) & (SLOTS-1);
+				cascade(level*SLOTS + int(s));
+				if(s) break;
+				if(LEVELS-1 == level) cascade(OVERFLOW_LIST);
+			}
+		}
+
+		// Skip ahead to the next boundary if no timers are due before it
+		if(!(mLevel0 >> slot)){
+			mTick = ((t >> SLOT_BITS) + 1) << SLOT_BITS;
+			if(mTick > last + 1) mTick = last + 1;
+			continue;
+		}
+
+		int list = int(slot);
+		if(mLists[list] < 0){
+			++mTick;
+			continue;
+		}
+
+		// Detach the slot so that timers added while calling go to later ticks
+		int i = mLists[list];
+		mLists[FIRING_LIST] = i;
+		mTails[FIRING_LIST] = mTails[list];
+		mLists[list] = mTails[list] = -1;
+		mLevel0 &= ~(uint64_t(1) << list);
+		for(int j=i; j>=0; j=mTimers[j].next) mTimers[j].list = FIRING_LIST;
+		mTick = t + 1;
+
+		while(mLists[FIRING_LIST] >= 0){
+			i = mLists[FIRING_LIST];
+			unlink(i);
+			mTimers[i].list = CALLING;
+
+			// The timer array may grow during the call, so hold the function
+			// outside of it
+			Callback func;
+			func.swap(mTimers[i].func);
+			func(mTimers[i].due * mResolution);
+
+			Timer& tm = mTimers[i];
+			if(CALLING == tm.list && tm.period){
+				tm.func.swap(func);
+				tm.due += tm.period;
+				if(tm.due < mTick){	// skip missed periods
+					tm.due += (mTick - tm.due + tm.period - 1) / tm.period * tm.period;
+				}
+				insert(i);
+			}
+			else{
+				release(i);
+			}
+		}
+	}
+}
+
+al_sec TimerWheel::nextDue() const {
+	if(0 == mCount) return std::numeric_limits<al_sec>::max();
+
+	uint64_t slot = mTick & (SLOTS-1);
+	uint64_t mask = mLevel0 >> slot;
+	if(mask) return (mTick + lowestBit(mask)) * mResolution;
+
+	// Nothing in the finest wheel before its next boundary, where timers
+	// from coarser wheels may move in
+	return (((mTick >> SLOT_BITS) + 1) << SLOT_BITS) * mResolution;
+}
+
+} // al::
@@ -2,6 +2,7 @@
 #include <algorithm> // min,max
 #include "allocore/types/al_Voxels.hpp"
 #include "allocore/io/al_File.hpp"
+#include "allocore/io/al_MappedFile.hpp"
 #include "allocore/system/al_Printing.hpp"
 #include "allocore/graphics/al_Image.hpp"
 
@@ -109,18 +110,20 @@ MRCHeader& Voxels::parseMRC(const char * mrcData) {
 bool Voxels::loadFromMRC(std::string filename, bool update) {
   zero();
 
-  File data_file(filename, "rb", true);
+  File data_file(filename, "rb");
 
   printf("Reading Data File: %s\n", data_file.path().c_str());
 
-  if(!data_file.opened()) {
+  // map rather than copy the file; private since the header may be byte swapped
+  MappedFile mrc;
+  if(!data_file.readAll(mrc, MappedFile::PRIVATE) || mrc.size() < 1024) {
     AL_WARN("Cannot open MRC file");
     exit(EXIT_FAILURE);
   }
 
-  MRCHeader header = parseMRC(data_file.readAll());
+  MRCHeader header = parseMRC(mrc.data());
 
-  data_file.close();
+  mrc.close();
 
   if (update) {
     // convert into angstrom
@@ -1,4 +1,6 @@
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -40,9 +42,15 @@ void Parameter::setNoCalls(float value, void *blockReceiver)
 	}
 
 	mFloatValue = value;
+	notifyReaders(value, -1);
 }
 
 void Parameter::set(float value)
+{
+	rampTo(value, -1);
+}
+
+void Parameter::rampTo(float value, float seconds)
 {
 	if (value > mMax) value = mMax;
 	if (value < mMin) value = mMin;
@@ -50,6 +58,7 @@ void Parameter::set(float value)
 		value = mProcessCallback(value, mProcessUdata);
 	}
 	mFloatValue = value;
+	notifyReaders(value, seconds);
 	for(int i = 0; i < mCallbacks.size(); ++i) {
 		if (mCallbacks[i]) {
 			mCallbacks[i](value, this, mCallbackUdata[i], NULL);
@@ -57,6 +66,113 @@ void Parameter::set(float value)
 	}
 }
 
+void Parameter::notifyReaders(float value, float rampTime)
+{
+	std::lock_guard<std::mutex> lk(mReadersLock);
+	for (ParameterReader *reader: mReaders) {
+		reader->push(value, rampTime);
+	}
+}
+
+// ParameterReader ------------------------------------------------------------
+ParameterReader::ParameterReader(Parameter &parameter, double sampleRate,
+                                 float smoothTime, Mode mode) :
+    mParameter(parameter), mEvents(64), mDropped(false),
+    mSampleRate(sampleRate), mSmoothTime(smoothTime), mMode(mode),
+    mInc(0), mRatio(1), mExponential(false), mRemain(0), mBlockTime(0)
+{
+	mValue = mTarget = parameter.get();
+	mLatest = mValue;
+	std::lock_guard<std::mutex> lk(parameter.mReadersLock);
+	parameter.mReaders.push_back(this);
+}
+
+ParameterReader::~ParameterReader()
+{
+	std::lock_guard<std::mutex> lk(mParameter.mReadersLock);
+	std::vector<ParameterReader *> &readers = mParameter.mReaders;
+	readers.erase(std::remove(readers.begin(), readers.end(), this), readers.end());
+}
+
+void ParameterReader::push(float value, float rampTime)
+{
+	mLatest = value;
+	Event e = {value, rampTime, al_steady_time()};
+	if (!mEvents.push(e)) {
+		mDropped = true; // Catch up to the latest value instead
+	}
+}
+
+void ParameterReader::start(float target, float rampTime)
+{
+	bool smooth = rampTime < 0;
+	int samples = int((smooth ? mSmoothTime : rampTime) * mSampleRate + 0.5);
+	mTarget = target;
+	if (samples <= 0 || (smooth && mMode == STEP) || target == mValue) {
+		mValue = target;
+		mRemain = 0;
+		return;
+	}
+	// Ramps of an explicit duration are linear in STEP mode
+	mExponential = mMode == EXPONENTIAL;
+	mInc = (target - mValue) / samples;
+	mRatio = std::exp(-std::log(1000.0) / samples);
+	mRemain = samples;
+}
+
+void ParameterReader::render(float *out, int numFrames)
+{
+	int i = 0;
+	if (mRemain > 0) {
+		int n = std::min(numFrames, mRemain);
+		if (mExponential) {
+			float diff = mValue - mTarget;
+			for (; i < n; i++) {
+				diff *= mRatio;
+				out[i] = mTarget + diff;
+			}
+			mValue = mTarget + diff;
+		} else {
+			float start = mValue;
+			for (; i < n; i++) {
+				out[i] = start + mInc * (i + 1);
+			}
+			mValue = start + mInc * n;
+		}
+		mRemain -= n;
+		if (mRemain == 0) { // Land exactly on the target
+			mValue = out[n - 1] = mTarget;
+		}
+	}
+	for (; i < numFrames; i++) {
+		out[i] = mValue;
+	}
+}
+
+void ParameterReader::fillBlock(float *out, int numFrames)
+{
+	if (numFrames <= 0) return;
+	al_sec now = al_steady_time();
+	al_sec period = now - mBlockTime;
+	int pos = 0;
+	Event e;
+	while (mEvents.pop(e)) {
+		int offset = 0;
+		if (mBlockTime > 0 && period > 0) {
+			offset = int((e.time - mBlockTime) / period * numFrames);
+		}
+		offset = std::max(pos, std::min(offset, numFrames - 1));
+		render(out + pos, offset - pos);
+		pos = offset;
+		start(e.value, e.rampTime);
+	}
+	if (mDropped.exchange(false)) {
+		start(mLatest, -1);
+	}
+	render(out + pos, numFrames - pos);
+	mBlockTime = now;
+}
+
 // ParameterBool ------------------------------------------------------------------
 ParameterBool::ParameterBool(std::string parameterName, std::string Group,
                      float defaultValue,
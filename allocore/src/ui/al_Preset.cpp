@@ -14,7 +14,8 @@ using namespace al;
 
 PresetHandler::PresetHandler(std::string rootDirectory, bool verbose) :
     mRootDir(rootDirectory), mVerbose(verbose),
-    mRunning(true), mMorphingThread(PresetHandler::morphingFunction, this),
+    mRunning(true), mMorphOnAudioClock(false),
+    mMorphingThread(PresetHandler::morphingFunction, this),
     mMorphInterval(0.05), mMorphTime("morphTime", "", 0.0, "", 0.0, 20.0)
 {
 	if (!File::exists(rootDirectory)) {
@@ -129,12 +130,24 @@ void PresetHandler::storePreset(int index, std::string name)
 
 void PresetHandler::recallPreset(std::string name)
 {
-	{
+	if (mMorphOnAudioClock) {
 		std::lock_guard<std::mutex> lk(mTargetLock);
 		mTargetValues = loadPresetValues(name);
-		mMorphRemainingSteps =  1 + mMorphTime.get() / mMorphInterval;
+		mMorphRemainingSteps = 0; // Stop any morph in progress
+		for (Parameter *param: mParameters) {
+			auto target = mTargetValues.find(param->getFullAddress());
+			if (target != mTargetValues.end()) {
+				param->rampTo(target->second, mMorphTime.get());
+			}
+		}
+	} else {
+		{
+			std::lock_guard<std::mutex> lk(mTargetLock);
+			mTargetValues = loadPresetValues(name);
+			mMorphRemainingSteps =  1 + mMorphTime.get() / mMorphInterval;
+		}
+		mMorphConditionVar.notify_one();
 	}
-	mMorphConditionVar.notify_one();
 
 	int index = -1;
 	for (auto preset: mPresetsMap) {
@@ -35,17 +35,23 @@ int main (int argc, char * const argv[]) {
 	RUNTEST(ProtocolSerialize);
 
 	RUNTEST(IOSocket);
+	RUNTEST(ProtocolStateDelta);
 	RUNTEST(File);
 	RUNTEST(Thread);
+	RUNTEST(RTMemory);
+	RUNTEST(Parameter);
 
 	RUNTEST(GraphicsMesh);
 
 #ifndef ALLOCORE_TESTS_NO_AUDIO
 	RUNTEST(IOAudioIO);
 	RUNTEST(AudioScene);
+	RUNTEST(DistanceFilter);
 #endif
 
 	RUNTEST(Ambisonics);
+	RUNTEST(Biquad);
+	RUNTEST(DelayLine);
 	
 #ifndef ALLOCORE_TESTS_NO_GUI
 	// This test should always be run last since it calls exit()
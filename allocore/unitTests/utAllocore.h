@@ -26,6 +26,7 @@ int utGraphicsDraw();
 int utGraphicsMesh();
 int utProtocolOSC();
 int utProtocolSerialize();
+int utProtocolStateDelta();
 int utSpatial();
 int utSystem();
 int utTypes();
@@ -34,6 +35,11 @@ int utThread();
 int utFile();
 int utAsset();
 int utAmbisonics();
+int utBiquad();
+int utDelayLine();
+int utDistanceFilter();
+int utRTMemory();
+int utParameter();
 
 SearchPaths& getSearchPaths();
 
@@ -274,6 +274,99 @@ void testAmbisonicsFirstOrder2D(int bufferSize) {
 	delete panner;
 }
 
+struct SpawnThreadFunc : public ThreadFunction{
+	SpawnThreadFunc(AudioScene& s): scene(s), spawned(0), done(false){}
+	void operator()(){
+		SoundSource * live[4] = {0,0,0,0};
+		for (int i = 0; i < 20000; i++) {
+			SoundSource *& src = live[i & 3];
+			if (src) {
+				scene.removeSource(*src);
+				src = 0;
+			}
+			else if ((src = scene.spawnSource())) {
+				++spawned;
+			}
+		}
+		for (int i = 0; i < 4; i++) {
+			if (live[i]) scene.removeSource(*live[i]);
+		}
+		done = true;
+	}
+	AudioScene& scene;
+	int spawned;
+	std::atomic<bool> done;
+};
+
+void testSourceRegistry() {
+	AudioScene scene(8, 4);
+	SoundSource src[6];
+
+	for (int i = 0; i < 4; i++) {
+		assert(scene.addSource(src[i]));
+	}
+	assert(!scene.addSource(src[4])); // full
+	assert(!scene.addSource(src[0])); // already added
+	assert(scene.sources().size() == 0); // not applied yet
+	scene.updateSources();
+	assert(scene.sources().size() == 4);
+
+	scene.removeSource(src[1]);
+	scene.removeSource(src[1]); // ignored
+	assert(!src[1].inScene());
+	assert(!scene.addSource(src[4])); // slot is freed at next block
+	scene.updateSources();
+	assert(scene.sources().size() == 3);
+	assert(scene.addSource(src[4]));
+	scene.updateSources();
+	assert(scene.sources().size() == 4);
+	for (unsigned i = 0; i < scene.sources().size(); i++) {
+		assert(scene.sources()[i] != &src[1]);
+	}
+
+	// Add and remove within the same block
+	scene.removeSource(src[0]);
+	scene.updateSources();
+	assert(scene.addSource(src[5]));
+	scene.removeSource(src[5]);
+	scene.updateSources();
+	assert(scene.sources().size() == 3);
+
+	// Pooled sources are recycled at block boundaries
+	scene.allocateSourcePool(2, 1000);
+	SoundSource * a = scene.spawnSource();
+	assert(a && a->delaySize() == 1000);
+	assert(!scene.spawnSource()); // scene full
+	scene.removeSource(src[2]);
+	scene.removeSource(src[3]);
+	scene.removeSource(src[4]);
+	scene.updateSources();
+	SoundSource * b = scene.spawnSource();
+	assert(b && b != a);
+	assert(!scene.spawnSource()); // pool empty
+	scene.removeSource(*a);
+	assert(!scene.spawnSource()); // not yet returned to pool
+	scene.updateSources();
+	assert(scene.spawnSource() == a);
+
+	// Concurrent spawning while the audio thread applies changes
+	{
+		AudioScene scene(8, 64);
+		scene.allocateSourcePool(32, 1000);
+		SpawnThreadFunc f1(scene), f2(scene);
+		Thread t1(f1), t2(f2);
+		while (!(f1.done && f2.done)) {
+			scene.updateSources();
+			assert(scene.sources().size() <= 8);
+		}
+		t1.join();
+		t2.join();
+		scene.updateSources();
+		assert(scene.sources().size() == 0);
+		assert(f1.spawned + f2.spawned >= 32);
+	}
+}
+
 int utAudioScene() {
 	testStereo(8);
 	testStereo(4096);
@@ -284,5 +377,7 @@ int utAudioScene() {
 
 	testAmbisonicsFirstOrder2D(8);
 
+	testSourceRegistry();
+
 	return 0;
 }
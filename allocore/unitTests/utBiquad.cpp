@@ -0,0 +1,91 @@
+#include <cstdlib>
+#include <vector>
+
+#include "utAllocore.h"
+#include "allocore/sound/al_Biquad.hpp"
+
+static float noise(){
+	return rand() / float(RAND_MAX) * 2.f - 1.f;
+}
+
+// Parallel cascade matches filtering sample by sample through each stage
+static void testBiQuadNX(int numFilters){
+	BiQuadNX parallel(numFilters, BIQUAD_LPF, 48000);
+	BiQuadNX serial(numFilters, BIQUAD_LPF, 48000);
+	parallel.set(3000, 0.5);
+	serial.set(3000, 0.5);
+
+	int counts[] = {64, 1, 3, 100};
+	for(int j=0; j<4; ++j){
+		std::vector<float> buf(counts[j]);
+		for(unsigned i=0; i<buf.size(); ++i) buf[i] = noise();
+		std::vector<float> expected(buf);
+		for(unsigned i=0; i<buf.size(); ++i) expected[i] = serial(expected[i]);
+		parallel.processBuffer(&buf[0], buf.size());
+		for(unsigned i=0; i<buf.size(); ++i) assert(fabs(buf[i] - expected[i]) <= 1e-6 * (1 + fabs(expected[i])));
+	}
+}
+
+static void testBiQuadBank(){
+	const int N = 11, S = 2, count = 100;
+	BiQuadBank bank(N, S, BIQUAD_HPF, 48000);
+	std::vector<BiQuadNX *> ref;
+	for(int c=0; c<N; ++c){
+		bank.setChannel(c, 200 + 300*c, 1.5);
+		ref.push_back(new BiQuadNX(S, BIQUAD_HPF, 48000));
+		ref[c]->set(200 + 300*c, 1.5);
+	}
+	assert(bank.channels() == N && bank.stages() == S);
+
+	std::vector<std::vector<float> > bufs(N, std::vector<float>(count));
+	std::vector<float *> ptrs(N);
+	for(int b=0; b<3; ++b){
+		for(int c=0; c<N; ++c){
+			for(int i=0; i<count; ++i) bufs[c][i] = noise();
+			ptrs[c] = &bufs[c][0];
+		}
+		std::vector<std::vector<float> > expected(bufs);
+		bank.processBuffers(&ptrs[0], count);
+		for(int c=0; c<N; ++c){
+			for(int i=0; i<count; ++i){
+				assert(fabs(bufs[c][i] - (*ref[c])(expected[c][i])) < 1e-4);
+			}
+		}
+	}
+	for(int c=0; c<N; ++c) delete ref[c];
+
+	// Smoothing interpolates coefficients across the block after a change
+	BiquadData from, to;
+	BiQuad::coefficients(from, BIQUAD_PEQ, 48000, 1000, 1, 6);
+	BiQuad::coefficients(to, BIQUAD_PEQ, 48000, 4000, 1, -6);
+	BiQuadBank smooth(1, 1, BIQUAD_PEQ, 48000);
+	smooth.set(1000, 1, 6);
+	smooth.smooth(true);
+	std::vector<float> x(count, 0.f), y(count);
+	float * px = &x[0];
+	smooth.processBuffers(&px, count);
+	smooth.set(4000, 1, -6);
+	for(int i=0; i<count; ++i) x[i] = y[i] = noise();
+	smooth.processBuffers(&px, count);
+	double s1 = 0, s2 = 0;
+	for(int i=0; i<count; ++i){
+		double f = double(i+1) / count;
+		double b0 = from.a0 + (to.a0 - from.a0)*f;
+		double b1 = from.a1 + (to.a1 - from.a1)*f;
+		double b2 = from.a2 + (to.a2 - from.a2)*f;
+		double a1 = from.a3 + (to.a3 - from.a3)*f;
+		double a2 = from.a4 + (to.a4 - from.a4)*f;
+		double out = b0*y[i] + s1;
+		s1 = b1*y[i] - a1*out + s2;
+		s2 = b2*y[i] - a2*out;
+		assert(fabs(x[i] - out) < 1e-4);
+	}
+}
+
+int utBiquad(){
+	testBiQuadNX(8);
+	testBiQuadNX(3);
+	testBiQuadNX(11);
+	testBiQuadBank();
+	return 0;
+}
@@ -0,0 +1,116 @@
+#include <cstdlib>
+#include <vector>
+
+#include "utAllocore.h"
+#include "allocore/sound/al_DelayLine.hpp"
+
+// Sample of a cubic polynomial at a delay, which 4 and 6 point Lagrange
+// interpolation reproduce exactly
+static double poly(double delay){
+	double t = delay * 0.01;
+	return 0.5 + t*(0.3 + t*(-0.2 + t*0.1));
+}
+
+static void testAgainstRingBuffer(){
+	const int N = 100;
+	DelayLine dl(N);
+	RingBuffer<float> rb(N);
+	for(int i=0; i<3*N+7; ++i){
+		float v = rand() / float(RAND_MAX) * 2.f - 1.f;
+		dl.write(v);
+		rb.write(v);
+
+		// Cubic reads match the interpolation SoundSource used with a RingBuffer
+		for(int j=0; j<10; ++j){
+			double d = dl.minDelay() + (dl.maxDelay() - dl.minDelay()) * j / 9.;
+			int i0 = d;
+			float f = d - i0;
+			float expected = ipl::cubic(f, rb.read(i0-1), rb.read(i0), rb.read(i0+1), rb.read(i0+2));
+			assert(fabs(dl.read(d) - expected) < 1e-5);
+		}
+	}
+
+	// Integer delays read samples exactly
+	for(int d=0; d<N-2; ++d) assert(dl.read(d) == rb.read(d));
+
+	// A block at no delay reads the newest samples, as a source without doppler
+	float out[10];
+	dl.readBlock(out, 10, 0);
+	for(int i=0; i<10; ++i) assert(out[i] == rb.read(9-i));
+}
+
+static void testLagrange(DelayLine::Interpolation ipl){
+	const int N = 50;
+	DelayLine dl(N, ipl);
+	assert(dl.interpolation() == ipl);
+
+	// Write past the end of the buffer in blocks and single samples, so reads
+	// use the mirrored samples
+	std::vector<float> src(N);
+	for(int i=0; i<N; ++i) src[i] = poly(N + 26 - 1 - i);
+	dl.write(&src[0], 30);
+	for(int i=30; i<N; ++i) dl.write(src[i]);
+	for(int i=0; i<26; ++i) dl.write(poly(25 - i));
+
+	for(double d=2; d<=dl.maxDelay(); d+=0.37){
+		assert(fabs(dl.read(d) - poly(d)) < 1e-5);
+	}
+
+	// Reads are clamped
+	assert(dl.read(dl.maxDelay() + 100) == dl.read(dl.maxDelay()));
+	assert(dl.read(-5) == dl.read(dl.minDelay()));
+}
+
+static void testBlockReads(DelayLine::Interpolation ipl){
+	const int N = 64, n = 40;
+	DelayLine dl(N, ipl);
+	std::vector<float> out(n), expected(n);
+	std::vector<double> delays(n);
+	for(int k=0; k<5; ++k){
+		for(int i=0; i<17; ++i) dl.write(rand() / float(RAND_MAX));
+
+		for(int i=0; i<n; ++i) delays[i] = 3 + i*0.61 + k*0.1;
+		dl.read(&out[0], &delays[0], n);
+		for(int i=0; i<n; ++i) assert(out[i] == dl.read(delays[i]));
+
+		// Consecutive reads cross the end of the buffer
+		double d = 5.3 + k;
+		dl.readBlock(&out[0], n, d);
+		for(int i=0; i<n; ++i) assert(fabs(out[i] - dl.read(d + n-1-i)) < 1e-6);
+
+		// Some reads clamped
+		dl.readBlock(&out[0], n, 30.5);
+		for(int i=0; i<n; ++i) assert(fabs(out[i] - dl.read(30.5 + n-1-i)) < 1e-6);
+	}
+}
+
+int utDelayLine(){
+	testAgainstRingBuffer();
+	testLagrange(DelayLine::LAGRANGE4);
+	testLagrange(DelayLine::LAGRANGE6);
+
+	DelayLine::Interpolation ipls[] = {
+		DelayLine::CUBIC, DelayLine::LAGRANGE4, DelayLine::LAGRANGE6, DelayLine::SINC8
+	};
+	for(int i=0; i<4; ++i) testBlockReads(ipls[i]);
+
+	// Windowed sinc passes low frequencies with little error
+	{
+		DelayLine dl(1000, DelayLine::SINC8);
+		for(int i=0; i<1000; ++i) dl.write(sin(M_2PI * 0.02 * i));
+		for(double d=10; d<900; d+=3.3){
+			assert(fabs(dl.read(d) - sin(M_2PI * 0.02 * (999 - d))) < 2e-3);
+		}
+	}
+
+	// Source delay-lines are sized from their far clip
+	{
+		SoundSource src(0.1, 100);
+		assert(src.delaySize() == SoundSource::defaultDelaySize(100));
+		assert(src.delaySize() >= SoundSource::bufferSize(96000, 340, 100));
+		src.delaySize(500);
+		assert(src.delaySize() == 500);
+		assert(src.maxIndex() < 500);
+	}
+	return 0;
+}
@@ -0,0 +1,114 @@
+#include <cstdlib>
+#include <vector>
+
+#include "utAllocore.h"
+
+static float noise(){
+	return rand() / float(RAND_MAX) * 2.f - 1.f;
+}
+
+// Batches of sources match filtering each source on its own
+static void testBatches(int numSources, int numFrames){
+	DistanceFilter filter(48000, 0.1);
+	std::vector<std::vector<float> > bufs(numSources, std::vector<float>(numFrames));
+	std::vector<std::vector<float> > expected(bufs);
+	std::vector<DistanceFilter::State> states(numSources), refStates(numSources);
+	std::vector<float *> bufPtrs(numSources);
+	std::vector<DistanceFilter::State *> statePtrs(numSources);
+	std::vector<float> coefs(numSources);
+
+	for(int b=0; b<4; ++b){
+		for(int s=0; s<numSources; ++s){
+			for(int i=0; i<numFrames; ++i) bufs[s][i] = expected[s][i] = noise();
+			coefs[s] = filter.coefficient(10 + 300*s + 100*b);
+			bufPtrs[s] = &bufs[s][0];
+			statePtrs[s] = &states[s];
+			DistanceFilter::process(&expected[s][0], refStates[s], coefs[s], numFrames);
+		}
+		DistanceFilter::process(&bufPtrs[0], &statePtrs[0], &coefs[0], numSources, numFrames);
+		for(int s=0; s<numSources; ++s){
+			for(int i=0; i<numFrames; ++i) assert(fabs(bufs[s][i] - expected[s][i]) < 1e-6);
+			assert(states[s].coef == coefs[s]);
+		}
+	}
+}
+
+// Compare to a one-pole lowpass with coefficients interpolated in double
+static void testReference(){
+	DistanceFilter filter(44100, 0.1);
+	const int N = 100;
+	DistanceFilter::State state;
+	std::vector<float> buf(N);
+	double prev = 0, coef = filter.coefficient(500);
+	double distances[] = {500, 2000, 100};
+	for(int b=0; b<3; ++b){
+		double target = filter.coefficient(distances[b]);
+		double start = coef;
+		for(int i=0; i<N; ++i) buf[i] = noise();
+		std::vector<float> in(buf);
+		DistanceFilter::process(&buf[0], state, target, N);
+		for(int i=0; i<N; ++i){
+			coef = start + (target - start) * (i+1) / N;
+			prev += coef * (in[i] - prev);
+			assert(fabs(buf[i] - prev) < 1e-5);
+		}
+	}
+}
+
+static void testScene(){
+	const int bufferSize = 64;
+	SpeakerLayout speakerLayout = HeadsetSpeakerLayout();
+	StereoPanner panner(speakerLayout);
+	AudioScene scene(bufferSize);
+	scene.createListener(&panner);
+	scene.distanceFilter().absorption(100);
+	AudioIO audioIO(bufferSize, 44100, NULL, NULL, speakerLayout.numSpeakers(), 0, AudioIOData::DUMMY);
+
+	SoundSource src;
+	src.dopplerType(DOPPLER_NONE);
+	src.useAttenuation(false);
+	src.useDistanceFilter(true);
+	scene.addSource(src);
+
+	DistanceFilter::State state;
+	double distances[] = {1, 3, 2};
+	for(int b=0; b<3; ++b){
+		std::vector<float> expected(bufferSize);
+		for(int i=0; i<bufferSize; ++i){
+			expected[i] = noise();
+			src.writeSample(expected[i]);
+		}
+		DistanceFilter::process(&expected[0], state, scene.distanceFilter().coefficient(distances[b]), bufferSize);
+
+		// Full right
+		src.pos(distances[b], 0, 0);
+		scene.render(audioIO);
+		for(int i=0; i<bufferSize; ++i){
+			assert(almostEqual(audioIO.out(0, i), 0));
+			assert(fabs(audioIO.out(1, i) - expected[i]) < 1e-5);
+		}
+	}
+
+	// Filter history starts over when a source is added again
+	scene.removeSource(src);
+	scene.render(audioIO);
+	scene.addSource(src);
+	for(int i=0; i<bufferSize; ++i) src.writeSample(i ? 0 : 1);
+	scene.render(audioIO);
+	assert(almostEqual(audioIO.out(1, 0), scene.distanceFilter().coefficient(2)));
+}
+
+int utDistanceFilter(){
+	testBatches(1, 64);
+	testBatches(8, 100);
+	testBatches(11, 33);
+	testReference();
+	testScene();
+
+	// Cutoff falls with distance and the filter is bypassed up close
+	DistanceFilter filter(44100);
+	assert(filter.cutoff(10) > filter.cutoff(100));
+	assert(filter.coefficient(100) > filter.coefficient(1000));
+	assert(filter.coefficient(0) == 1.f);
+	return 0;
+}
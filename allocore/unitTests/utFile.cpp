@@ -102,6 +102,55 @@ int utFile() {
 	}
 
 
+	{
+		const char * path = "utFileMapped.txt";
+		const std::string text = "Mapped file contents";
+		File::write(path, text);
+
+		MappedFile m(path);
+		assert(m.opened());
+		assert(m.size() == text.size());
+		assert(m.str() == text);
+		m.advise(MappedFile::SEQUENTIAL).willNeed();
+
+		// private writes do not reach the file
+		File f(path);
+		MappedFile p;
+		assert(f.readAll(p, MappedFile::PRIVATE));
+		p.data()[0] = 'm';
+		assert(p.str() != text);
+		assert(m.str() == text);
+		assert(File::read(path) == text);
+
+		// shared writes do
+		MappedFile s(path, MappedFile::SHARED);
+		s.data()[0] = 'm';
+		assert(s.flush());
+		assert(File::read(path)[0] == 'm');
+		assert(m.data()[0] == 'm');
+
+		// moving transfers the mapping
+		MappedFile moved(std::move(m));
+		assert(!m.opened());
+		assert(moved.size() == text.size());
+
+		assert(!MappedFile("thisfiledoesnotexist.ext").opened());
+
+		File::write(path, "");
+		MappedFile empty(path);
+		assert(empty.opened() && empty.size() == 0 && empty.data());
+
+		FilePrefetcher pf;
+		pf.start(std::vector<std::string>(3, "utFile.txt"));
+		pf.start("thisfiledoesnotexist.ext");
+		pf.wait();
+		assert(pf.done());
+		assert(pf.files() == 3);
+		assert(pf.bytes() == 3*File::read("utFile.txt").size());
+
+		::remove(path);
+	}
+
 	{
 		assert(Dir::make("utFileTestDir"));
 		assert(Dir::remove("utFileTestDir"));
@@ -124,6 +173,77 @@ int utFile() {
 		//printf("%s\n", sp.appPath().c_str());
 	}
 
+	{
+		const std::string root = "utFileIndexDir" DELIM;
+		const std::string sub = root + "a" DELIM;
+		const std::string deep = sub + "b" DELIM;
+		const std::string cache = "utFileIndex.cache";
+		assert(Dir::make(deep));
+		File::write(root + "both.txt", "root");
+		File::write(sub + "both.txt", "a");
+		File::write(deep + "deep.txt", "b");
+
+		FileIndex index;
+		FilePath fp;
+
+		// directories are crawled on first lookup
+		assert(index.find("deep.txt", root, true, fp));
+		assert(fp.filepath() == deep + "deep.txt");
+		assert(!index.find("deep.txt", root, false, fp));
+		assert(index.find("deep.txt", deep, false, fp));
+		assert(index.numDirs() == 3);
+		assert(index.numFiles() == 3);
+
+		// shallowest match wins
+		assert(index.find("both.txt", root, true, fp));
+		assert(fp.path() == root);
+		assert(index.find("both.txt", sub, true, fp));
+		assert(fp.path() == sub);
+
+		// changes are seen after invalidating a directory
+		assert(!index.find("new.txt", root, true, fp));
+		File::write(deep + "new.txt", "new");
+		index.invalidate(deep);
+		assert(index.find("new.txt", root, true, fp));
+		assert(fp.path() == deep);
+
+		// cache file round trip
+		assert(index.save(cache));
+		assert(!index.dirty());
+		FileIndex loaded;
+		assert(loaded.load(cache));
+		assert(loaded.numDirs() == index.numDirs());
+		assert(loaded.numFiles() == index.numFiles());
+		assert(loaded.find("new.txt", root, true, fp));
+		assert(fp.path() == deep);
+
+		::remove((deep + "new.txt").c_str());
+		loaded.invalidate(deep);
+		assert(!loaded.find("new.txt", root, true, fp));
+		assert(loaded.find("deep.txt", root, true, fp));
+
+		// removed subtrees are dropped
+		::remove((deep + "deep.txt").c_str());
+		assert(Dir::remove(deep));
+		loaded.invalidate(sub);
+		assert(!loaded.find("deep.txt", root, true, fp));
+		assert(loaded.numDirs() == 2);
+
+		// search paths using the index
+		SearchPaths sp;
+		sp.addSearchPath(root);
+		sp.useIndex();
+		assert(sp.index());
+		assert(sp.find("both.txt").path() == root);
+		assert(!sp.find("deep.txt").valid());
+
+		::remove(cache.c_str());
+		::remove((sub + "both.txt").c_str());
+		::remove((root + "both.txt").c_str());
+		assert(Dir::remove(sub));
+		assert(Dir::remove(root));
+	}
+
 	{
 		// TODO:
 		FilePath fp("file.txt", "path");
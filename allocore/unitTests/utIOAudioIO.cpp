@@ -37,9 +37,237 @@ void audioCB(AudioIOData& io){
 }
 
 
+// Clock advanced by the callback, so that each block takes a chosen time
+al_nsec fakeTime = 0;
+al_nsec blockTime = 0;
+al_nsec fakeClock(){ return fakeTime; }
+
+void timedCB(AudioIOData& io){
+	fakeTime += blockTime;
+	io.out(0,0) = 2;
+}
+
+int numOverloaded = 0, numRecovered = 0;
+void loadCB(AudioIO& io, double load, bool overloaded){
+	overloaded ? ++numOverloaded : ++numRecovered;
+}
+
+// Nodes of an audio graph
+struct BusSource : public AudioCallback{
+	BusSource(int b, float v): bus(b), value(v){}
+	void onAudioCB(AudioIOData& io){
+		while(io()) io.bus(bus) = value * (io.frame()+1);
+	}
+	int bus;
+	float value;
+};
+
+struct BusMixer : public AudioCallback{
+	void onAudioCB(AudioIOData& io){
+		while(io()) io.out(0) = io.bus(0) + io.bus(1);
+	}
+};
+
+struct OutGain : public AudioCallback{
+	void onAudioCB(AudioIOData& io){
+		while(io()) io.out(0) *= 0.5f;
+	}
+};
+
+struct OutMeter : public AudioCallback{
+	OutMeter(): peak(0){}
+	void onAudioCB(AudioIOData& io){
+		peak = 0;
+		while(io()) peak = std::max(peak, std::abs(io.out(0)));
+	}
+	float peak;
+};
+
+// Input of offline stream: a ramp on channel 0 and its negative on channel 1
+void rampGen(float * buf, int chans, int frames, unsigned long long frame, void * user){
+	for(int i=0; i<frames; ++i){
+		float v = float((frame + i) % 1000) * 0.001f;
+		buf[i] = v;
+		if(chans > 1) buf[frames + i] = -v;
+	}
+}
+
+void passCB(AudioIOData& io){
+	while(io()){
+		for(int c=0; c<io.channelsOut(); ++c) io.out(c) = io.in(c < io.channelsIn() ? c : 0);
+	}
+}
+
+// Checks that input matches the ramp
+int rampErrors = 0;
+unsigned long long rampFrames = 0;
+void checkCB(AudioIOData& io){
+	while(io()){
+		float v = float(rampFrames % 1000) * 0.001f;
+		if(rampFrames < 4000 && !(almostEqual(io.in(0), v) && almostEqual(io.in(1), -v))) ++rampErrors;
+		++rampFrames;
+	}
+}
+
 
 int utIOAudioIO(){
 
+	// Load monitoring, with blocks of 0.1 seconds
+	{
+		AudioIO io(100, 1000, timedCB, 0, 1, 0, AudioIOData::DUMMY);
+		io.clock(fakeClock).onLoad(loadCB, 0.8, 0.5);
+		assert(io.start());
+
+		blockTime = 25000000;
+		for(int i=0; i<90; ++i) io.processBlock();
+		assert(io.out(0,0) == 1); // clipped after callback
+
+		blockTime = 150000000;
+		io.processBlock(AudioIO::OUTPUT_UNDERFLOW);
+		assert(1 == numOverloaded && 0 == numRecovered);
+
+		// Above the low threshold, so still overloaded
+		blockTime = 60000000;
+		for(int i=0; i<9; ++i) io.processBlock(AudioIO::INPUT_OVERFLOW | AudioIO::OUTPUT_UNDERFLOW);
+		assert(1 == numOverloaded && 0 == numRecovered);
+
+		blockTime = 25000000;
+		io.processBlock();
+		assert(1 == numOverloaded && 1 == numRecovered);
+
+		AudioIO::Load l = io.load();
+		assert(101 == l.blocks && 101 == l.samples);
+		assert(1 == l.overloads);
+		assert(almostEqual(l.load.min(), 0.25) && almostEqual(l.load.max(), 1.5));
+		assert(almostEqual(l.percentile(0.5), 0.25));
+		assert(almostEqual(l.percentile(0.95), 0.6));
+		assert(almostEqual(l.percentile(1), 1.5));
+		assert(0 == l.inputUnderflows && 9 == l.inputOverflows);
+		assert(10 == l.outputUnderflows && 0 == l.outputOverflows);
+		assert(19 == l.xruns());
+
+		// Only the most recent blocks are analyzed
+		for(unsigned i=0; i<AudioIO::LOAD_SAMPLES; ++i) io.processBlock();
+		l = io.load();
+		assert(AudioIO::LOAD_SAMPLES == l.samples);
+		assert(almostEqual(l.load.max(), 0.25));
+		assert(1 == l.overloads && 19 == l.xruns());
+
+		// Restarting clears the statistics
+		io.stop();
+		io.start();
+		l = io.load();
+		assert(0 == l.blocks && 0 == l.samples && 0 == l.xruns());
+		assert(0 == l.percentile(0.5));
+	}
+
+	// Offline rendering to a file and back
+	{
+		const char * wavPath = "utIOAudioIO_offline.wav";
+		{
+			AudioIO io(64, 8000, passCB, 0, 3, 2, AudioIOData::OFFLINE);
+			io.offlineInput(rampGen).offlineOutput(wavPath).offlineDuration(0.5);
+			assert(io.start());
+			while(io.isRunning()) al_sleep(0.001);
+			assert(almostEqual(io.time(), 4032./8000)); // whole blocks
+			assert(io.blocksPerSecond() > 0);
+			assert(io.load().blocks == 63);
+		}
+		{
+			AudioIO io(50, 8000, checkCB, 0, 0, 2, AudioIOData::OFFLINE);
+			io.offlineInput(wavPath);
+			assert(io.start());
+			while(io.isRunning()) al_sleep(0.001);
+			assert(0 == rampErrors);
+			assert(4000 == rampFrames); // stopped at end of file
+		}
+		remove(wavPath);
+
+		// CAF output at a multiple of real time
+		const char * cafPath = "utIOAudioIO_offline.caf";
+		{
+			AudioIO io(100, 8000, passCB, 0, 2, 1, AudioIOData::OFFLINE);
+			io.offlineInput(rampGen).offlineOutput(cafPath).offlineDuration(0.2).offlineSpeed(8);
+			al_sec t0 = al_steady_time();
+			assert(io.start());
+			while(io.isRunning()) al_sleep(0.001);
+			assert(al_steady_time() - t0 >= 0.02);
+		}
+		FILE * fp = fopen(cafPath, "rb");
+		assert(fp);
+		fseek(fp, 0, SEEK_END);
+		assert(ftell(fp) == 68 + 1600*2*4);
+		fclose(fp);
+		remove(cafPath);
+	}
+
+	// Audio graph
+	{
+		BusSource src0(0, 0.001f), src1(1, 0.002f);
+		BusMixer mixer;
+		OutGain gain;
+		OutMeter meter;
+		ThreadPool pool(3);
+
+		for(int parallel=0; parallel<2; ++parallel){
+			AudioIO io(64, 44100, 0, 0, 1, 0, AudioIOData::DUMMY);
+			io.channelsBus(2);
+			AudioGraph graph(parallel ? &pool : 0);
+
+			// Added out of order to be sorted
+			graph.add(meter).reads(AudioGraph::OUTPUT, 0).name("meter");
+			graph.add(gain).reads(AudioGraph::OUTPUT, 0).writes(AudioGraph::OUTPUT, 0);
+			graph.add(mixer).reads(AudioGraph::BUS, 0, 2).writes(AudioGraph::OUTPUT, 0);
+			graph.add(src0).writes(AudioGraph::BUS, 0);
+			graph.add(src1).writes(AudioGraph::BUS, 1);
+			assert(graph.sort());
+
+			const int order[] = {3, 4, 2, 1, 0};
+			for(int i=0; i<5; ++i) assert(graph.order()[i] == order[i]);
+			assert(graph.precedes(3, 2) && graph.precedes(4, 2));
+			assert(!graph.precedes(3, 4) && !graph.precedes(4, 3));
+			assert(graph.precedes(2, 1) && graph.precedes(1, 0) && graph.precedes(3, 0));
+			assert(!graph.precedes(0, 3));
+
+			io.append(graph);
+			io.start();
+			for(int k=0; k<100; ++k){
+				io.processBlock();
+				for(int i=0; i<64; ++i){
+					assert(almostEqual(io.out(0,i), 0.5f * (0.001f*(i+1) + 0.002f*(i+1))));
+				}
+				assert(almostEqual(meter.peak, 0.5f * 0.003f * 64));
+			}
+
+			assert(graph.node(0).name() == "meter");
+			for(int i=0; i<graph.size(); ++i){
+				AudioGraph::Timing t = graph.node(i).timing();
+				assert(100 == t.blocks);
+				assert(t.max >= t.mean && t.mean >= 0);
+			}
+		}
+
+		// Cycles are run in the order added
+		AudioGraph graph;
+		graph.add(mixer).reads(AudioGraph::BUS, 0).writes(AudioGraph::BUS, 1);
+		graph.add(gain).reads(AudioGraph::BUS, 1).writes(AudioGraph::BUS, 0);
+		assert(!graph.sort());
+		assert(0 == graph.order()[0] && 1 == graph.order()[1]);
+
+		// Nodes without channels are ordered as added
+		graph.clear();
+		graph.add(src0).writes(AudioGraph::BUS, 0);
+		graph.add(mixer);
+		graph.add(src1).writes(AudioGraph::BUS, 1);
+		assert(graph.sort());
+		assert(graph.precedes(0, 1) && graph.precedes(1, 2));
+
+		graph.remove(mixer);
+		assert(2 == graph.size());
+		assert(!graph.precedes(0, 1));
+	}
+
+
 	//AudioDevice::printAll();
 	AudioIO audioIO(256, 44100, audioCB, 0, 1, 1, AudioIOData::PORTAUDIO);
 
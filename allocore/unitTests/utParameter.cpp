@@ -0,0 +1,100 @@
+#include "utAllocore.h"
+#include "allocore/ui/al_Parameter.hpp"
+
+int utParameter(){
+
+	const int N = 16;
+	float block[N];
+
+	// Steps
+	{
+		Parameter p("step", "", 0.f);
+		ParameterReader r(p, 1000, 0.01, ParameterReader::STEP);
+		r.fillBlock(block, N);
+		for(int i=0; i<N; ++i) assert(block[i] == 0.f);
+		p.set(0.5f);
+		r.fillBlock(block, N);
+		for(int i=0; i<N; ++i) assert(block[i] == 0.f || block[i] == 0.5f);
+		assert(block[N-1] == 0.5f);
+		assert(r.value() == 0.5f && !r.ramping());
+	}
+
+	// Linear ramps over the smoothing time of 10 samples
+	{
+		Parameter p("linear", "", 0.f);
+		ParameterReader r(p, 1000, 0.01, ParameterReader::LINEAR);
+		p.set(1.f);
+		r.fillBlock(block, N);
+		for(int i=0; i<10; ++i) assert(almostEqual(block[i], 0.1f*(i+1)));
+		for(int i=10; i<N; ++i) assert(block[i] == 1.f);
+
+		// Values are clamped before reaching readers
+		p.min(-1.f);
+		p.set(-2.f);
+		assert(p.get() == -1.f);
+		ParameterReader clamped(p, 1000);
+		assert(clamped.value() == -1.f);
+	}
+
+	// Ramp of an explicit duration across blocks
+	{
+		Parameter p("ramp", "", 1.f);
+		ParameterReader r(p, 1000, 0.01, ParameterReader::LINEAR);
+		p.rampTo(0.f, 0.032);
+		assert(p.get() == 0.f);
+		r.fillBlock(block, N);
+		assert(r.ramping());
+		assert(almostEqual(block[N-1], 0.5f));
+		for(int i=1; i<N; ++i) assert(block[i] < block[i-1]);
+		r.fillBlock(block, N);
+		assert(!r.ramping());
+		assert(block[N-1] == 0.f);
+	}
+
+	// Changes start where they were set within the previous block period
+	{
+		Parameter p("timing", "", 0.f);
+		ParameterReader r(p, 1000, 0.01, ParameterReader::STEP);
+		r.fillBlock(block, N);
+		al_sleep(0.05);
+		p.set(1.f);
+		al_sleep(0.05);
+		r.fillBlock(block, N);
+		int offset = 0;
+		while(block[offset] == 0.f) ++offset;
+		assert(offset > 1 && offset < N-2);
+		for(int i=offset; i<N; ++i) assert(block[i] == 1.f);
+	}
+
+	// Exponential approach
+	{
+		Parameter p("exp", "", 0.f);
+		ParameterReader r(p, 1000, 0.01, ParameterReader::EXPONENTIAL);
+		p.set(1.f);
+		r.fillBlock(block, N);
+		for(int i=1; i<9; ++i) assert(block[i] > block[i-1] && block[i] < 1.f);
+		assert(block[8] > 0.99f);
+		for(int i=9; i<N; ++i) assert(block[i] == 1.f);
+	}
+
+	// More changes than the queue holds end at the latest value
+	{
+		Parameter p("burst", "", 0.f);
+		ParameterReader r(p, 1000, 0, ParameterReader::LINEAR);
+		for(int i=1; i<=200; ++i) p.set(i);
+		r.fillBlock(block, N);
+		assert(block[N-1] == 200.f);
+	}
+
+	// Readers detach when destroyed
+	{
+		Parameter p("detach", "", 0.f);
+		{
+			ParameterReader r1(p, 1000), r2(p, 1000);
+		}
+		p.set(1.f);
+		assert(p.get() == 1.f);
+	}
+
+	return 0;
+}
@@ -1,3 +1,4 @@
+#include <stddef.h>
 #include "utAllocore.h"
 
 int utProtocolSerialize(){
@@ -91,5 +92,111 @@ int utProtocolSerialize(){
 		}
 	}
 
+	// Schema-based serialization
+	{
+		struct Particle{
+			float pos[3];
+			double mass;
+			uint16_t flags;
+			int32_t id;
+		};
+
+		ser::Schema schema(sizeof(Particle));
+		schema	.add<float>(offsetof(Particle, pos), 3)
+				.add<double>(offsetof(Particle, mass))
+				.add<uint16_t>(offsetof(Particle, flags))
+				.add<int32_t>(offsetof(Particle, id));
+
+		const int N = 17;
+		Particle in[N];
+		memset(in, 0, sizeof(in));
+		for(int i=0; i<N; ++i){
+			in[i].pos[0] = i; in[i].pos[1] = -i; in[i].pos[2] = 0.5f*i;
+			in[i].mass = 1./(i+1);
+			in[i].flags = 0x0102 + i;
+			in[i].id = 1000000 + i;
+		}
+
+		SchemaSerializer s(schema);
+		s.add(in, N).add(in, 3);
+		assert(s.buf().size() == s.blockSize(N) + s.blockSize(3));
+
+		std::vector<char> buf = s.buf();
+
+		// Zero-copy views
+		{
+			SchemaDeserializer d(schema, buf);
+			ser::SchemaView<Particle> v;
+			assert(d.read(v));
+			assert(v.size() == N);
+			assert((const char *)v.data() > &buf[0]);
+			assert((const char *)v.data() < &buf[0] + buf.size());
+			assert(0 == memcmp(v.data(), in, sizeof(in)));
+			assert(d.read(v));
+			assert(v.size() == 3);
+			assert(v[2].id == in[2].id);
+			assert(!d.read(v));
+			assert(d.good() && d.atEnd());
+		}
+
+		// Copy out
+		{
+			SchemaDeserializer d(schema, buf);
+			Particle out[N];
+			assert(d.read(out, N) == N);
+			assert(0 == memcmp(out, in, sizeof(in)));
+		}
+
+		// Foreign byte order: swap header words and payload, flip flag
+		{
+			std::vector<char> foreign = s.buf();
+			char * b = &foreign[0];
+			b[1] = !b[1];
+			for(int i=0; i<3; ++i) serSwapBytes4(b + 4 + i*4);
+			schema.swapBytes(b + SchemaSerializer::headerSize(), N);
+
+			SchemaDeserializer d(schema, &foreign[0], s.blockSize(N));
+			ser::SchemaView<Particle> v;
+			assert(d.read(v));
+			assert(v.size() == N);
+			for(int i=0; i<N; ++i){
+				assert(v[i].pos[1] == in[i].pos[1]);
+				assert(v[i].mass == in[i].mass);
+				assert(v[i].flags == in[i].flags);
+				assert(v[i].id == in[i].id);
+			}
+
+			// Block was converted in place, so it reads the same again
+			d.rewind();
+			assert(d.read(v));
+			assert(v[N-1].id == in[N-1].id);
+		}
+
+		// Count whose size in bytes wraps around 32 bits is rejected
+		{
+			std::vector<char> bad = s.buf();
+			uint32_t count = uint32_t(0xFFFFFFFFu / sizeof(Particle)) + 2;
+			assert(uint32_t(count * sizeof(Particle)) < bad.size());
+			memcpy(&bad[12], &count, 4);
+			SchemaDeserializer d(schema, bad);
+			ser::SchemaView<Particle> v;
+			assert(!d.read(v));
+			assert(!d.good());
+			uint32_t num = 1;
+			assert(NULL == d.next(num, sizeof(Particle)));
+			assert(0 == num);
+		}
+
+		// Mismatched schema is rejected
+		{
+			ser::Schema other(sizeof(Particle));
+			other.add<float>(offsetof(Particle, pos), 3);
+			SchemaDeserializer d(other, buf);
+			ser::SchemaView<Particle> v;
+			assert(!d.read(v));
+			assert(!d.good());
+		}
+	}
+
 	return 0;
 }
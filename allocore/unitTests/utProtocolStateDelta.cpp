@@ -0,0 +1,205 @@
+#include <vector>
+#include "utAllocore.h"
+
+namespace{
+
+struct State{
+	float pos[8192][3];
+	int frame;
+};
+
+// Move a few particles; most of the state stays the same
+void step(State& s, rnd::Random<>& rng){
+	++s.frame;
+	for(int k=0; k<64; ++k){
+		int i = rng.uniform(8192);
+		s.pos[i][0] += 0.1f;
+		s.pos[i][2] = rng.uniform();
+	}
+}
+
+// Feed all packets of last encode through a channel dropping packets with
+// probability 'loss'. Checks any completed state against the source.
+void transmit(
+	StateDeltaEncoder& enc, StateDeltaDecoder& dec, const State& src,
+	rnd::Random<>& rng, float loss
+){
+	for(unsigned i=0; i<enc.numPackets(); ++i){
+		if(rng.prob(loss)) continue;
+		assert(enc.packetLength(i) <= enc.packetSize());
+		if(dec.decode(enc.packet(i), enc.packetLength(i))){
+			assert(dec.sequence() == enc.sequence());
+			assert(0 == memcmp(dec.state(), &src, sizeof(State)));
+		}
+	}
+}
+
+} // ::
+
+int utProtocolStateDelta(){
+
+	static State src;
+	memset(&src, 0, sizeof(src));
+	rnd::Random<> rng(12345);
+
+	// Lossless channel at cache-line and page granularity
+	for(int bs=64; bs<=4096; bs*=64){
+		StateDeltaEncoder enc(sizeof(State), bs);
+		StateDeltaDecoder dec(sizeof(State));
+		enc.keyframeInterval(30);
+
+		for(int f=0; f<100; ++f){
+			step(src, rng);
+			enc.encode(&src);
+			if(f > 0 && !enc.keyframe()){
+				assert(enc.bytesEncoded() < sizeof(State)/8);
+			}
+			transmit(enc, dec, src, rng, 0);
+			assert(dec.valid());
+			assert(dec.sequence() == enc.sequence());
+		}
+		assert(dec.framesCompleted() == 100);
+		assert(dec.framesDropped() == 0);
+	}
+
+	// Unchanged state still advances the sequence
+	{
+		StateDeltaEncoder enc(sizeof(State));
+		StateDeltaDecoder dec(sizeof(State));
+		enc.encode(&src);
+		transmit(enc, dec, src, rng, 0);
+		assert(enc.encode(&src) == 1);
+		assert(enc.blocksChanged() == 0);
+		transmit(enc, dec, src, rng, 0);
+		assert(dec.sequence() == 2);
+	}
+
+	// Lossy channel recovers at keyframes
+	{
+		StateDeltaEncoder enc(sizeof(State));
+		StateDeltaDecoder dec(sizeof(State));
+		enc.keyframeInterval(10);
+
+		for(int f=0; f<300; ++f){
+			step(src, rng);
+			enc.encode(&src);
+			transmit(enc, dec, src, rng, 0.05);
+		}
+		assert(dec.framesDropped() > 0);
+		assert(dec.framesCompleted() > 0);
+
+		// A clean keyframe restores the exact state
+		enc.forceKeyframe();
+		step(src, rng);
+		enc.encode(&src);
+		transmit(enc, dec, src, rng, 0);
+		assert(dec.sequence() == enc.sequence());
+		assert(0 == memcmp(dec.state(), &src, sizeof(State)));
+	}
+
+	// Duplicate and malformed packets are ignored
+	{
+		StateDeltaEncoder enc(sizeof(State));
+		StateDeltaDecoder dec(sizeof(State));
+		step(src, rng);
+		enc.encode(&src);
+		transmit(enc, dec, src, rng, 0);
+		step(src, rng);
+		enc.encode(&src);
+		for(unsigned i=0; i<enc.numPackets(); ++i){
+			dec.decode(enc.packet(i), enc.packetLength(i));
+			dec.decode(enc.packet(i), enc.packetLength(i));
+		}
+		assert(0 == memcmp(dec.state(), &src, sizeof(State)));
+
+		char junk[64] = "not a packet";
+		assert(!dec.decode(junk, sizeof(junk)));
+		assert(dec.packetsRejected() == 1);
+	}
+
+	// Frames of more than 65535 packets
+	{
+		std::vector<char> big(1<<21);
+		for(unsigned i=0; i<big.size(); ++i) big[i] = rng.uniform(256);
+		StateDeltaEncoder enc(big.size(), 64, 0);
+		StateDeltaDecoder dec(big.size());
+		assert(enc.encode(&big[0]) > 65536);
+		bool done = false;
+		for(unsigned i=0; i<enc.numPackets(); ++i){
+			assert(!done);
+			done = dec.decode(enc.packet(i), enc.packetLength(i));
+		}
+		assert(done);
+		assert(dec.packetsRejected() == 0);
+		assert(0 == memcmp(dec.state(), &big[0], big.size()));
+	}
+
+	// Loopback UDP with simulated packet loss
+	{
+		unsigned port = 4111;
+		SocketClient c(port, "localhost");
+		SocketServer s(port, "", 0.1);
+
+		StateDeltaEncoder enc(sizeof(State));
+		StateDeltaDecoder dec(sizeof(State));
+		enc.keyframeInterval(8);
+		std::vector<char> pkt(enc.packetSize());
+
+		for(int f=0; f<40; ++f){
+			step(src, rng);
+			enc.encode(&src);
+			bool lossy = f < 30;
+			for(unsigned i=0; i<enc.numPackets(); ++i){
+				if(lossy && rng.prob(0.05)) continue;
+				c.send(enc.packet(i), enc.packetLength(i));
+				size_t n = s.recv(&pkt[0], pkt.size());
+				if(n && dec.decode(&pkt[0], n)){
+					assert(0 == memcmp(dec.state(), &src, sizeof(State)));
+				}
+			}
+		}
+		assert(dec.valid());
+		assert(dec.sequence() == enc.sequence());
+		assert(0 == memcmp(dec.state(), &src, sizeof(State)));
+	}
+
+	// Background receiver keeps up with a multi-megabyte keyframe sent in one
+	// burst before anything is decoded
+	{
+		unsigned port = 4112;
+		std::vector<char> big(4<<20);
+		for(unsigned i=0; i<big.size(); ++i) big[i] = rng.uniform(256);
+
+		StateDeltaReceiver recv(big.size());
+		assert(recv.start(port));
+		SocketClient c(port, "localhost", -1);
+		StateDeltaEncoder enc(big.size());
+
+		for(int f=0; f<2; ++f){
+			big[f*1000] ^= 1;
+			enc.encode(&big[0]);
+			// Pace packets at about the rate of a gigabit link, which on one
+			// host gives the receiving thread a chance to run
+			for(unsigned i=0; i<enc.numPackets(); ++i){
+				assert(c.send(enc.packet(i), enc.packetLength(i)) == enc.packetLength(i));
+				if(i % 16 == 15) al_sleep(0.0002);
+			}
+			// The keyframe is far more than fits in the socket's receive buffer
+			if(0 == f){
+				assert(enc.bytesEncoded() > 4000000);
+				assert(!recv.valid());
+			}
+
+			al_sec end = al_steady_time() + 2;
+			while(recv.pending() <= 0 && al_steady_time() < end) al_sleep(0.001);
+			assert(recv.pending() == 1);
+			assert(recv.poll());
+			assert(recv.decoder().sequence() == enc.sequence());
+			assert(0 == memcmp(recv.state(), &big[0], big.size()));
+		}
+		assert(!recv.pop());
+		assert(recv.framesDiscarded() == 0);
+	}
+
+	return 0;
+}
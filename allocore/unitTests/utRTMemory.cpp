@@ -0,0 +1,224 @@
+#include <stdint.h>
+#include <vector>
+
+#include "utAllocore.h"
+#include "allocore/system/al_RTMemory.hpp"
+#include "allocore/types/al_MsgTube.hpp"
+
+struct PoolItem{
+	PoolItem(int v_): v(v_){ ++count; }
+	~PoolItem(){ --count; }
+	int v;
+	static int count;
+};
+
+int PoolItem::count = 0;
+
+struct BigPoolItem{
+	char data[64];
+};
+
+struct ArenaFunc : public ThreadFunction{
+	ArenaFunc(LinearArena& a): arena(a){}
+	void operator()(){
+		for(int i=0; i<100; ++i){
+			char * p = (char *)arena.alloc(24);
+			if(p) ptrs.push_back(p);
+		}
+	}
+	LinearArena& arena;
+	std::vector<char *> ptrs;
+};
+
+static std::vector<int> received;
+static void receive(al_sec t, int v){ received.push_back(v); }
+static void receiveData(al_sec t, char * data){ received.push_back(data[0] + data[511]); }
+
+int utRTMemory(){
+
+	// Pool
+	{
+		MemoryPool pool(20, 4);
+		assert(pool.blockSize() == 32);
+		assert(pool.numBlocks() == 4);
+		assert(pool.available() == 4);
+
+		void * blocks[4];
+		for(int i=0; i<4; ++i){
+			blocks[i] = pool.alloc();
+			assert(blocks[i] && pool.owns(blocks[i]));
+			assert(uintptr_t(blocks[i]) % 16 == 0);
+			for(int j=0; j<i; ++j) assert(blocks[i] != blocks[j]);
+		}
+		assert(pool.alloc() == NULL);
+		int notOwned;
+		assert(!pool.owns(&notOwned));
+
+		pool.free(blocks[2]);
+		assert(pool.available() == 1);
+		assert(pool.alloc() == blocks[2]);
+		for(int i=0; i<4; ++i) pool.free(blocks[i]);
+		assert(pool.available() == 4);
+
+		PoolItem * item = pool.construct<PoolItem>(7);
+		assert(item && item->v == 7 && PoolItem::count == 1);
+		pool.destroy(item);
+		assert(PoolItem::count == 0);
+		assert(pool.available() == 4);
+		assert(pool.construct<BigPoolItem>() == NULL);
+	}
+
+	// Arena
+	{
+		LinearArena arena(1024);
+		assert(arena.capacity() == 1024);
+		char * a = (char *)arena.alloc(1);
+		double * b = arena.alloc<double>(3);
+		char * c = (char *)arena.alloc(8, 64);
+		assert(a && b && c);
+		assert(uintptr_t(a) % 16 == 0 && uintptr_t(b) % 16 == 0 && uintptr_t(c) % 64 == 0);
+		assert(a + 1 <= (char *)b && (char *)(b+3) <= c);
+		assert(arena.used() > 0);
+		assert(arena.alloc(2048) == NULL);
+
+		size_t used = arena.used();
+		arena.reset();
+		assert(arena.used() == 0);
+		assert(arena.peak() >= used);
+		assert(arena.alloc(1) == a);
+		arena.reset();
+
+		// Concurrent allocations never overlap
+		ArenaFunc f1(arena), f2(arena);
+		Thread t1(f1), t2(f2);
+		t1.join(); t2.join();
+		std::vector<char *> ptrs(f1.ptrs);
+		ptrs.insert(ptrs.end(), f2.ptrs.begin(), f2.ptrs.end());
+		assert(!ptrs.empty() && ptrs.size() < 200);
+		for(unsigned i=0; i<ptrs.size(); ++i){
+			assert(ptrs[i] >= a && ptrs[i] + 24 <= a + 1024 + 64);
+			for(unsigned j=0; j<i; ++j) assert(ptrs[i] + 24 <= ptrs[j] || ptrs[j] + 24 <= ptrs[i]);
+		}
+	}
+
+	// Allocator
+	{
+		LinearArena arena(4096);
+		assert(LinearArena::current() == NULL);
+		{
+			LinearArena::Scope scope(arena);
+			assert(LinearArena::current() == &arena);
+
+			Buffer<float, ArenaAllocator<float> > buf(64);
+			assert(arena.used() >= 64*sizeof(float));
+			buf[63] = 1.f;
+
+			RingBuffer<int, ArenaAllocator<int> > ring(8);
+			for(int i=0; i<10; ++i) ring.write(i);
+			assert(ring.read(0) == 9);
+
+			size_t used = arena.used();
+			std::vector<int, ArenaAllocator<int> > v;
+			v.push_back(1);
+			assert(arena.used() > used);
+		}
+		assert(LinearArena::current() == NULL);
+
+		// Allocates from the heap without a current arena
+		std::vector<int, ArenaAllocator<int> > v(16, 1);
+		assert(v.get_allocator().arena() == NULL);
+
+		LinearArena small(64);
+		bool threw = false;
+		try{
+			std::vector<int, ArenaAllocator<int> > w(1000, 0, ArenaAllocator<int>(small));
+		}
+		catch(std::bad_alloc&){
+			threw = true;
+		}
+		assert(threw);
+	}
+
+	// Heap check
+	{
+		assert(!RTHeapCheck::realtime());
+		{
+			RTHeapCheck::Scope rt;
+			assert(RTHeapCheck::realtime());
+			{
+				RTHeapCheck::Scope notRT(false);
+				assert(!RTHeapCheck::realtime());
+			}
+			assert(RTHeapCheck::realtime());
+		}
+		assert(!RTHeapCheck::realtime());
+	}
+
+	// Message tube caching
+	{
+		// Ringbuffer of 1024 bytes holds 25 messages of 40 bytes, cache of 4
+		MsgTube tube(10, 4);
+		assert(tube.cachePool.available() == 4);
+
+		// Overflowing messages go into pool blocks, then onto the heap
+		for(int i=0; i<35; ++i) tube.send(receive, i);
+		assert(tube.cachePool.available() == 0);
+		assert(!tube.overflowq.empty());
+
+		// Delivered in order as the ringbuffer drains and sends flush the cache
+		int next = 35;
+		for(int k=0; k<4; ++k){
+			tube.executeUntil(1);
+			tube.send(receive, next++);
+		}
+		tube.executeUntil(1);
+		assert(int(received.size()) == next);
+		for(int i=0; i<next; ++i) assert(received[i] == i);
+		assert(tube.overflowq.empty() && tube.cachePool.available() == 4);
+		assert(tube.numDropped() == 0);
+		received.clear();
+
+		// Messages larger than a block are cached on the heap
+		char big[512] = {0};
+		big[0] = 1; big[511] = 2;
+		for(int i=0; i<25; ++i) tube.send(receive, i);
+		tube.send_data(receiveData, big, sizeof(big));
+		assert(tube.cachePool.available() == 4);
+		tube.executeUntil(1);
+		tube.send(receive, 25);
+		tube.executeUntil(1);
+		assert(received.size() == 27 && received[25] == 3 && received[26] == 25);
+		received.clear();
+
+		// A real-time sender drops messages once the cache is full
+		{
+			RTHeapCheck::Scope rt;
+			for(int i=0; i<40; ++i) tube.send(receive, i);
+		}
+		assert(tube.numDropped() == 40 - 25 - 4);
+		assert(tube.overflowq.empty());
+		tube.executeUntil(1);
+		tube.send(receive, 29);
+		tube.executeUntil(1);
+		assert(received.size() == 30);
+		for(int i=0; i<30; ++i) assert(received[i] == i);
+		received.clear();
+
+		// As are messages larger than a block, even with room in the cache
+		{
+			RTHeapCheck::Scope rt;
+			for(int i=0; i<25; ++i) tube.send(receive, i);
+			tube.send_data(receiveData, big, sizeof(big));
+			tube.send(receive, 25);
+		}
+		assert(tube.numDropped() == 40 - 25 - 4 + 1);
+		assert(tube.overflowq.empty() && tube.cachePool.available() == 3);
+		tube.executeUntil(1);
+		tube.send(receive, 26);
+		tube.executeUntil(1);
+		assert(received.size() == 27);
+		for(int i=0; i<27; ++i) assert(received[i] == i);
+	}
+
+	return 0;
+}
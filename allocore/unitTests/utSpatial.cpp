@@ -17,5 +17,187 @@ int utSpatial(){
 		a.step(0.5);	assert(a.vec() == Vec3d(2.5,0,0));
 	}
 
+	// Culling against cube map faces
+	{
+		CullList cl;
+		Pose pose(Vec3d(1,2,3));
+		assert(cl.addCubeFaces(pose, 0.1, 100) == 0);
+		assert(cl.numViews() == 6);
+
+		// One item straight along each face direction
+		const Vec3d dirs[6] = {
+			Vec3d(1,0,0), Vec3d(-1,0,0), Vec3d(0,1,0),
+			Vec3d(0,-1,0), Vec3d(0,0,1), Vec3d(0,0,-1)
+		};
+		for(int i=0; i<6; ++i) cl.add(pose.pos() + dirs[i]*10, 0.5);
+
+		// Item beyond far plane, item straddling two faces
+		cl.add(pose.pos() + Vec3d(0,0,-200), 1);
+		cl.add(pose.pos() + Vec3d(10,0,-10), 0.5);
+
+		cl.cull();
+		for(int i=0; i<6; ++i){
+			assert(cl.mask(i) == (uint32_t(1) << i));
+			assert(cl.visibleItems(i).size() == 2 || cl.visibleItems(i).size() == 1);
+		}
+		assert(cl.mask(6) == 0);
+		assert(cl.visible(7, 0) && cl.visible(7, 5));
+		assert(cl.numVisible() == 8);
+		assert(cl.numCulled() == 8*6 - 8);
+
+		// Inflating radii makes the side items visible in neighboring faces
+		cl.cull(20);
+		assert(cl.mask(5) != (uint32_t(1) << 5));
+
+		// Rotated pose rotates faces
+		Pose turned;
+		turned.faceToward(Vec3d(1,0,0));
+		cl.clearViews().addCubeFaces(turned, 0.1, 100);
+		cl.clear().add(Vec3d(10,0,0), 0.5);
+		cl.cull();
+		assert(cl.mask(0) == (uint32_t(1) << 5));
+	}
+
+	// Ray casting against triangles
+	{
+		// Grid of 2*N*N triangles on z=0 plane spanning [0,N]
+		const int N = 64;
+		std::vector<Vec3f> verts;
+		std::vector<unsigned> tris;
+		for(int j=0; j<=N; ++j){
+		for(int i=0; i<=N; ++i){
+			verts.push_back(Vec3f(i,j,0));
+		}}
+		for(int j=0; j<N; ++j){
+		for(int i=0; i<N; ++i){
+			unsigned v = j*(N+1) + i;
+			unsigned q[6] = {v, v+1, v+N+1, v+1, v+N+2, v+N+1};
+			tris.insert(tris.end(), q, q+6);
+		}}
+
+		TriangleBVH bvh;
+		bvh.build(&verts[0], verts.size(), tris);
+		assert(bvh.size() == 2*N*N);
+
+		TriangleBVH::Hit hit;
+		for(int k=0; k<100; ++k){
+			double x = (k*0.37 + 0.11) - int((k*0.37 + 0.11)/N)*N;
+			double y = (k*1.73 + 0.29) - int((k*1.73 + 0.29)/N)*N;
+			assert(bvh.intersect(Rayd(Vec3d(x,y,5), Vec3d(0,0,-1)), hit));
+			assert(std::abs(hit.t - 5) < 1e-4);
+
+			// Hit point from barycentric coordinates matches ray
+			const unsigned * t = &tris[3*hit.triangle];
+			Vec3f p = verts[t[0]]*(1-hit.u-hit.v) + verts[t[1]]*hit.u + verts[t[2]]*hit.v;
+			assert(std::abs(p.x - x) < 1e-4 && std::abs(p.y - y) < 1e-4);
+		}
+
+		// Misses outside of grid, beyond maximum distance and facing away
+		assert(!bvh.intersect(Rayd(Vec3d(-1,-1,5), Vec3d(0,0,-1)), hit));
+		assert(!bvh.intersect(Rayd(Vec3d(1.5,1.5,5), Vec3d(0,0,-1)), hit, 4));
+		assert(!bvh.intersect(Rayd(Vec3d(1.5,1.5,5), Vec3d(0,0,1)), hit));
+
+		// Oblique ray; its direction is normalized
+		Rayd r(Vec3d(-10,30.5,20), Vec3d(1,0,-1));
+		assert(bvh.intersect(r, hit) && std::abs(hit.t - 20*std::sqrt(2.)) < 1e-4);
+
+		// Refit after moving plane up
+		for(unsigned i=0; i<verts.size(); ++i) verts[i].z = 1;
+		bvh.refit(&verts[0]);
+		assert(bvh.intersect(Rayd(Vec3d(10.5,20.25,5), Vec3d(0,0,-1)), hit));
+		assert(std::abs(hit.t - 4) < 1e-4);
+
+		// Boxes visited by traversal include all hit
+		std::vector<BVH::Box> boxes;
+		for(int i=0; i<10; ++i) boxes.push_back(BVH::Box(Vec3f(i,0,0), Vec3f(i+0.5,1,1)));
+		BVH tree;
+		tree.build(boxes, 0, 1);
+		std::vector<unsigned> visited;
+		tree.traverse(Vec3f(-1,0.5,0.5), Vec3f(1,0,0), FLT_MAX, [&](int first, int count, float&){
+			for(int i=first; i<first+count; ++i) visited.push_back(tree.order()[i]);
+		});
+		assert(visited.size() == 10);
+		assert(visited[0] == 0 && visited[9] == 9);
+		visited.clear();
+		tree.traverse(Vec3f(3.25,5,0.5), Vec3f(0,-1,0), FLT_MAX, [&](int first, int count, float&){
+			for(int i=first; i<first+count; ++i) visited.push_back(tree.order()[i]);
+		});
+		assert(visited.size() == 1 && visited[0] == 3);
+	}
+
+	// Hierarchical culling agrees with testing every item
+	{
+		CullList tree, flat;
+		flat.hierarchical(false);
+
+		// Cube maps of two eyes
+		for(int e=-1; e<=1; e+=2){
+			Pose pose(Vec3d(0.5 + e*0.1, 0.25, 0));
+			tree.addCubeFaces(pose, 0.1, 50);
+			flat.addCubeFaces(pose, 0.1, 50);
+		}
+
+		const int N = 4*CullList::HIERARCHY_SIZE;
+		for(int frame=0; frame<6; ++frame){
+			// Refill lists in the first frames, then move items in place
+			if(frame < 3){
+				tree.clear();
+				flat.clear();
+			}
+			for(int i=0; i<N; ++i){
+				// Spiral of items with various radii, moving each frame
+				double a = i*0.1 + frame*0.3;
+				Vec3d c(cos(a)*i*0.06, sin(a)*i*0.06, (i%17 - 8)*3.);
+				double r = 0.05 + (i%5)*0.3;
+				if(frame < 3){
+					tree.add(c, r);
+					flat.add(c, r);
+				}
+				else if(i % frame == 0){
+					tree.set(i, c, r);
+					flat.set(i, c, r);
+				}
+			}
+			tree.cull(0.1);
+			flat.cull(0.1);
+			for(int i=0; i<N; ++i) assert(tree.mask(i) == flat.mask(i));
+			for(int v=0; v<tree.numViews(); ++v) assert(tree.visibleItems(v) == flat.visibleItems(v));
+			assert(tree.numVisible() == flat.numVisible());
+			assert(tree.numCulled() > 0);
+		}
+
+		// Moving a single item out of view
+		tree.set(7, Vec3d(100,0,0), 1);
+		tree.cull();
+		assert(tree.mask(7) == 0);
+	}
+
+	// Refilled cube map with most items beyond the far plane
+	{
+		CullList tree, flat;
+		flat.hierarchical(false);
+		Pose pose(Vec3d(0.5, 0.25, 0));
+		tree.addCubeFaces(pose, 0.1, 20);
+		flat.addCubeFaces(pose, 0.1, 20);
+
+		const int N = 4*CullList::HIERARCHY_SIZE;
+		for(int frame=0; frame<4; ++frame){
+			tree.clear();
+			flat.clear();
+			for(int i=0; i<N; ++i){
+				double a = i*0.1 + frame*0.3;
+				Vec3d c(cos(a)*i*0.2, sin(a)*i*0.2, (i%17 - 8)*10.);
+				double r = 0.05 + (i%5)*0.3;
+				tree.add(c, r);
+				flat.add(c, r);
+			}
+			tree.cull(0.1);
+			flat.cull(0.1);
+			for(int i=0; i<N; ++i) assert(tree.mask(i) == flat.mask(i));
+			for(int v=0; v<tree.numViews(); ++v) assert(tree.visibleItems(v) == flat.visibleItems(v));
+			assert(tree.numVisible() > 0 && tree.numVisible()*8 < unsigned(N));
+		}
+	}
+
 	return 0;
 }
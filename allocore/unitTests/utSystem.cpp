@@ -3,6 +3,17 @@
 template <class T>
 bool aboutEqual(T v, T to, T r){ return v<(to+r) && v>(to-r); }
 
+// Counts messages in place of an osc::Send
+struct ProfileSender{
+	int sent;
+	ProfileSender(): sent(0){}
+	template <class A, class B, class C, class D, class E, class F>
+	int send(const std::string& addr, const A&, const B&, const C&, const D&, const E&, const F&){
+		assert(addr == "/profile");
+		return ++sent;
+	}
+};
+
 int utSystem(){
 
 	// Timing
@@ -50,5 +61,76 @@ int utSystem(){
 		assert(al_time_ns2s * tm.elapsed() == tm.elapsedSec());
 	}
 
+	// Profiling
+	{
+		Profiler::clear();
+		{ AL_PROFILE_SCOPE("disabled"); }
+
+		Profiler::enable();
+		Profiler::threadName("main \"thread\"");
+		for(int i=0; i<10; ++i){
+			AL_PROFILE_SCOPE("outer");
+			AL_PROFILE_SCOPE("inner");
+			al_sleep_nsec(1e5);
+		}
+		Profiler::record("manual", 1000, 3000);
+
+		// Zones from several threads
+		struct Worker{
+			static void * func(void *){
+				for(int j=0; j<100; ++j){ AL_PROFILE_SCOPE("worker"); }
+				return 0;
+			}
+		};
+		Thread threads[4];
+		for(int i=0; i<4; ++i) threads[i].start(Worker::func, 0);
+		for(int i=0; i<4; ++i) threads[i].join();
+		Profiler::enable(false);
+		{ AL_PROFILE_SCOPE("disabled"); }
+
+		std::vector<Profiler::Event> events;
+		Profiler::events(events);
+		assert(events.size() == 10 + 10 + 1 + 400);
+		for(unsigned i=1; i<events.size(); ++i) assert(events[i-1].start <= events[i].start);
+
+		std::vector<Profiler::ZoneStats> stats;
+		Profiler::summary(stats);
+		assert(stats.size() == 4);
+		assert(stats[0].name == "inner" && stats[0].count == 10);
+		assert(stats[0].time.min() >= 1e-4 && stats[0].p99 <= stats[0].time.max());
+		assert(stats[1].name == "manual" && stats[1].count == 1 && std::abs(stats[1].total - 2e-6) < 1e-12);
+		assert(stats[2].name == "outer" && stats[2].time.mean() >= stats[0].time.mean());
+		assert(stats[3].name == "worker" && stats[3].count == 400);
+
+		std::string trace = Profiler::chromeTrace();
+		assert(trace.find("\"traceEvents\"") != std::string::npos);
+		assert(trace.find("main \\\"thread\\\"") != std::string::npos);
+		assert(trace.find("\"name\":\"worker\",\"ph\":\"X\"") != std::string::npos);
+
+		ProfileSender s;
+		assert(Profiler::sendSummary(s) == 4 && s.sent == 4);
+
+		Profiler::clear();
+		Profiler::events(events);
+		assert(events.empty());
+
+		// Threads that exit pass their buffers on, so any number can record
+		struct ShortWorker{
+			static void * func(void *){
+				AL_PROFILE_SCOPE("short");
+				return 0;
+			}
+		};
+		Profiler::enable();
+		for(int i=0; i<2*Profiler::MAX_THREADS; ++i){
+			Thread thread(ShortWorker::func, 0);
+			thread.join();
+		}
+		Profiler::enable(false);
+		Profiler::events(events);
+		assert(events.size() == 2*Profiler::MAX_THREADS);
+		Profiler::clear();
+	}
+
 	return 0;
 }
@@ -4,6 +4,18 @@ void * threadFunc(void * user){
 	*(int *)user = 1; return NULL;
 }
 
+struct CountFunc{
+	CountFunc(): count(0){}
+	void operator()(){ ++count; }
+	std::atomic<int> count;
+};
+
+struct CountThreadFunc : public ThreadFunction{
+	CountThreadFunc(): count(0){}
+	void operator()(){ ++count; }
+	std::atomic<int> count;
+};
+
 struct MyThreadFunc : public ThreadFunction{
 	MyThreadFunc(int& x_): x(x_){}
 	void operator()(){
@@ -54,5 +66,65 @@ int utThread() {
 		assert(1 == x);
 	}
 
+	// Thread pool
+	for(int n=0; n<4; n+=3){
+		ThreadPool pool(n, n>0);
+		assert(pool.size() == n);
+		assert(pool.workerIndex() == -1);
+
+		// Each index visited exactly once
+		const int N = 100000;
+		std::vector<int> data(N, 0);
+		pool.parallelFor(0, N, 64, [&](int64_t i){ data[i] += int(i) & 255; });
+		for(int i=0; i<N; ++i) assert(data[i] == (i & 255));
+
+		// Ranges respect grain size
+		std::atomic<int64_t> sum(0);
+		pool.parallelForRange(10, N, 1000, [&](int64_t b, int64_t e){
+			assert(e - b <= 1000);
+			int64_t s = 0;
+			for(int64_t i=b; i<e; ++i) s += i;
+			sum += s;
+		});
+		assert(sum == int64_t(N-1)*N/2 - 45);
+
+		// Task groups
+		CountFunc f;
+		{
+			TaskGroup group(pool);
+			for(int i=0; i<2000; ++i) group.run(f);
+			group.wait();
+			assert(group.done());
+		}
+		assert(f.count == 2000);
+
+		// Nested loops
+		std::atomic<int> inner(0);
+		pool.parallelFor(0, 16, 1, [&](int64_t){
+			pool.parallelFor(0, 100, 10, [&](int64_t){ ++inner; });
+		});
+		assert(inner == 1600);
+	}
+
+	// Periodic thread timing, with relative and deadline sleeps
+	for(int rt=0; rt<2; ++rt){
+		CountThreadFunc f;
+		PeriodicThread t(0.001);
+		if(rt) t.realTime(0, PeriodicThread::FIFO, false).spin(0.0001);
+		t.start(f);
+		al_sleep(0.05);
+		PeriodicThread::Timing tm = t.timing();
+		t.stop();
+		t.join();
+
+		assert(tm.samples > 0 && tm.samples <= PeriodicThread::TIMING_SAMPLES);
+		assert(tm.samples <= unsigned(f.count));
+		assert(tm.latency.min() <= tm.latency.mean());
+		assert(tm.latency.mean() <= tm.latency.max());
+		assert(tm.latencyP99 >= tm.latency.min() && tm.latencyP99 <= tm.latency.max());
+		assert(tm.execution.min() >= 0 && tm.execution.max() < 0.05);
+		assert(tm.overruns <= tm.totalOverruns);
+	}
+
 	return 0;
 }
@@ -286,6 +286,52 @@ int utTypes(){
 		assert(a.read(3) == 2);
 	}
 
+	// Timer wheel
+	{
+		TimerWheel w(0.001);
+		std::vector<int> order;
+		std::vector<al_sec> times;
+
+		// Timers across all wheel levels and beyond
+		const al_sec ats[] = {0.0005, 0.003, 0.003, 0.07, 5.2, 300.0, 20000.0};
+		const int N = sizeof(ats)/sizeof(ats[0]);
+		for(int i=0; i<N; ++i){
+			w.add(ats[i], [&order, &times, i](al_sec t){ order.push_back(i); times.push_back(t); });
+		}
+		assert(w.size() == unsigned(N));
+		assert(w.nextDue() == 0.001);
+
+		// Removed timers are not called
+		TimerWheel::Id id = w.add(0.002, [&order](al_sec){ order.push_back(-1); });
+		assert(w.remove(id));
+		assert(!w.remove(id));
+
+		w.advance(0.0029);
+		assert(order.size() == 1 && order[0] == 0);
+		w.advance(0.003);
+		assert(order.size() == 3);
+
+		w.advance(30000);
+		assert(order.size() == unsigned(N));
+		for(int i=0; i<N; ++i){
+			int j = order[i];
+			assert(times[i] >= ats[j] && times[i] < ats[j] + 0.001 + 1e-9);
+			if(i) assert(times[i] >= times[i-1]);
+		}
+		assert(w.empty());
+
+		// Periodic timer removing itself, and timer added from a call
+		int count = 0, other = 0;
+		TimerWheel::Id pid = 0;
+		pid = w.add(w.now() + 0.01, [&](al_sec){
+			if(++count == 5) w.remove(pid);
+			if(1 == count) w.add(w.now(), [&other](al_sec){ ++other; });
+		}, 0.01);
+		w.advance(w.now() + 1);
+		assert(count == 5 && other == 1);
+		assert(w.empty());
+	}
+
 	return 0;
 }
 
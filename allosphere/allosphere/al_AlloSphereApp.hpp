@@ -6,6 +6,8 @@
 #include "allocore/io/al_App.hpp"
 #include "allocore/io/al_AudioIO.hpp"
 #include "allocore/graphics/al_Font.hpp"
+#include "allocore/io/al_Socket.hpp"
+#include "allocore/protocol/al_StateDelta.hpp"
 #include "Cuttlebone/Cuttlebone.hpp"
 
 #include <iostream>
@@ -35,6 +37,103 @@ namespace al {
 
 class DummyState {};
 
+// Delta-compressed state transport ----------------------------------------
+// Define ALLOAPP_DELTA_STATE to replace the cuttlebone Maker/Taker used by
+// the base classes below with these. Only the parts of the state that changed
+// since the previous frame are sent, with a full keyframe every 60 frames.
+// Renderers reconstruct the state in place and read it through a const
+// reference, so the state is not copied on every update.
+//
+// The simulator sends to a single address. To reach several renderer
+// machines, use the broadcast address of their subnet (e.g., 192.168.0.255
+// for 192.168.0.0/24); the default of 127.0.0.1 only reaches renderers on the
+// same machine.
+
+/// Sends state as delta-compressed UDP packets
+template<typename State, unsigned PORT>
+class DeltaStateMaker {
+public:
+	/// @param[in] address		Renderer IP address, or broadcast address of
+	///							the renderers' subnet
+	/// @param[in] packetSize	Maximum size of a packet in bytes
+	DeltaStateMaker(const char *address = "127.0.0.1",
+	                unsigned packetSize = PACKET_SIZE) :
+	    mEncoder(sizeof(State), 64, packetSize), mAddress(address)
+	{}
+
+	void start() {
+		// Blocking, so that a keyframe burst waits for room in the send
+		// buffer rather than being dropped locally
+		mSocket.open(PORT, mAddress.c_str(), -1,
+		             Socket::UDP | Socket::DGRAM | Socket::BROADCAST);
+	}
+
+	/// Encode the state and send the packets
+	void set(const State &state) {
+		unsigned n = mEncoder.encode(&state);
+		for (unsigned i = 0; i < n; i++) {
+			mSocket.send(mEncoder.packet(i), mEncoder.packetLength(i));
+		}
+	}
+
+	StateDeltaEncoder &encoder() { return mEncoder; }
+
+private:
+	StateDeltaEncoder mEncoder;
+	std::string mAddress;
+	SocketClient mSocket;
+};
+
+/// Receives state sent by a DeltaStateMaker
+
+/// Packets are received on a background thread, so that a large keyframe
+/// does not overflow the socket while the frame thread is busy. Complete
+/// frames are decoded on the thread calling poll() or pop().
+template<typename State, unsigned PORT>
+class DeltaStateTaker {
+public:
+	DeltaStateTaker(unsigned packetSize = 65535) :
+	    mReceiver(sizeof(State), packetSize)
+	{}
+
+	void start() {
+		mReceiver.start(PORT);
+	}
+
+	///
+	/// \brief poll decodes all frames received so far
+	/// \return true if a new state was completed
+	///
+	bool poll() { return mReceiver.poll(); }
+
+	///
+	/// \brief pop decodes the oldest frame received
+	/// \return true if a new state was completed
+	///
+	bool pop() { return mReceiver.pop(); }
+
+	///
+	/// \brief state the most recent complete state
+	/// \return NULL if no state has been received yet
+	///
+	const State *state() const {
+		return mReceiver.valid() ? (const State *) mReceiver.state() : NULL;
+	}
+
+	/// Copy the most recent state if a new one arrived (cuttlebone interface)
+	int get(State &state) {
+		if (!poll()) { return 0; }
+		state = *this->state();
+		return 1;
+	}
+
+	StateDeltaDecoder &decoder() { return mReceiver.decoder(); }
+	StateDeltaReceiver &receiver() { return mReceiver; }
+
+private:
+	StateDeltaReceiver mReceiver;
+};
+
 // Audio Renderers ----------------------------------------
 
 /// Base class for audio renderer (no state)
@@ -97,9 +196,13 @@ public:
 	/// \return true if a new state was received
 	///
 	bool updateAudioState() {
+#ifdef ALLOAPP_DELTA_STATE
+		return mTaker.poll();
+#else
 		bool newState = false;
 		while (mTaker.get(mState) > 0) { newState = true;} // Pop all states in queue
 		return newState;
+#endif
 	}
 
 	///
@@ -108,17 +211,33 @@ public:
 	/// \return Returns the number of states still pending in the buffer
 	///
 	int popAudioState() {
+#ifdef ALLOAPP_DELTA_STATE
+		return mTaker.pop() ? 1 : 0;
+#else
 		return mTaker.get(mState);
+#endif
 	}
 
 	///
 	/// \brief state a reference to the shared state
 	/// \return
 	///
+#ifdef ALLOAPP_DELTA_STATE
+	/// The state is reconstructed in place and must not be modified.
+	const AudioState &audioState() const {
+		const AudioState *s = mTaker.state();
+		return s ? *s : mState;
+	}
+#else
 	AudioState &audioState() { return mState;}
+#endif
 
 private:
+#ifdef ALLOAPP_DELTA_STATE
+	DeltaStateTaker<AudioState, PORT> mTaker;
+#else
 	cuttlebone::Taker<AudioState, 1400, PORT> mTaker;
+#endif
 	AudioState mState;
 };
 
@@ -197,9 +316,14 @@ private:
 	int mFlags;
 
 	State mState;
-	cuttlebone::Maker<State, 1400, GRAPHICSPORT> mMakerGraphics;
 	AudioState mAudioState;
+#ifdef ALLOAPP_DELTA_STATE
+	DeltaStateMaker<AudioState, AUDIOPORT> mMakerAudio;
+	DeltaStateMaker<State, GRAPHICSPORT> mMakerGraphics;
+#else
 	cuttlebone::Maker<AudioState, 1400, AUDIOPORT> mMakerAudio;
+	cuttlebone::Maker<State, 1400, GRAPHICSPORT> mMakerGraphics;
+#endif
 };
 
 // Graphics Renderer
@@ -225,9 +349,13 @@ public:
 	/// \return true if a new state was received
 	///
 	bool updateState() {
+#ifdef ALLOAPP_DELTA_STATE
+		return mTaker.poll();
+#else
 		bool newState = false;
 		while (mTaker.get(mState) > 0) { newState = true;} // Pop all states in queue
 		return newState;
+#endif
 	}
 
 	///
@@ -236,15 +364,31 @@ public:
 	/// \return true if a new state was in the state buffer
 	///
 	bool popState() {
+#ifdef ALLOAPP_DELTA_STATE
+		return mTaker.pop();
+#else
 		return mTaker.get(mState) > 0;
+#endif
 	}
 
+#ifdef ALLOAPP_DELTA_STATE
+	/// The state is reconstructed in place and must not be modified.
+	const State &state() const {
+		const State *s = mTaker.state();
+		return s ? *s : mState;
+	}
+#else
 	State &state() { return mState;}
+#endif
 
 private:
 
 	State mState;
+#ifdef ALLOAPP_DELTA_STATE
+	DeltaStateTaker<State, PORT> mTaker;
+#else
 	cuttlebone::Taker<State, 1400, PORT> mTaker;
+#endif
 };
 
 
@@ -0,0 +1,206 @@
+#ifndef INCLUDE_AL_FILE_MONITOR_HPP
+#define INCLUDE_AL_FILE_MONITOR_HPP
+
+/*	Allocore --
+	Multimedia / virtual environment application class library
+
+	Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology, UCSB.
+	Copyright (C) 2012. The Regents of the University of California.
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+		Redistributions in binary form must reproduce the above copyright
+		notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+		Neither the name of the University of California nor the names of its
+		contributors may be used to endorse or promote products derived from
+		this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+
+	File description:
+	Detection of changes to files and asynchronous reading of files
+*/
+
+#include <atomic>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+#include "allocore/system/al_ThreadPool.hpp"
+#include "allocore/system/al_Time.hpp"
+
+namespace al {
+
+/// Detects changes to a set of files
+
+/// Where the operating system supports it (inotify on Linux), the directories
+/// containing the files are watched and the monitor is told about changes, so
+/// no files are touched until one changes. Otherwise, and for files whose
+/// directory cannot be watched, the modification time of each file is checked
+/// at most once per polling period.
+///
+/// Changes are debounced: a file is only reported once no further change has
+/// been seen for the debounce window. Editors that save a file in several
+/// steps (truncate, write, rename) therefore cause one report, and all files
+/// saved together are reported in the same batch.
+class FileMonitor {
+public:
+
+	/// Method used to detect changes
+	enum Backend {
+		POLL = 0,	///< Check modification times periodically
+		NOTIFY		///< Receive change events from the operating system
+	};
+
+	/// @param[in] backend	preferred backend; falls back to POLL if NOTIFY
+	///						is not available
+	FileMonitor(Backend backend = NOTIFY);
+
+	~FileMonitor();
+
+
+	/// Get backend in use
+	Backend backend() const { return mFD >= 0 ? NOTIFY : POLL; }
+
+	/// Set debounce window, in seconds
+	FileMonitor& debounce(al_sec v){ mDebounce=v; return *this; }
+
+	/// Get debounce window, in seconds
+	al_sec debounce() const { return mDebounce; }
+
+	/// Set minimum time between checks of polled files, in seconds
+	FileMonitor& pollPeriod(al_sec v){ mPollPeriod=v; return *this; }
+
+	/// Get descriptor that becomes readable when changes are pending
+
+	/// This is -1 with the POLL backend.
+	///
+	int descriptor() const { return mFD; }
+
+
+	/// Start monitoring a file
+
+	/// The file need not exist yet; its creation is reported as a change.
+	/// \returns whether the file was not already monitored
+	bool add(const std::string& path);
+
+	/// Stop monitoring a file
+	void remove(const std::string& path);
+
+	/// Whether a file is monitored
+	bool contains(const std::string& path) const { return mFiles.count(path) > 0; }
+
+	/// Get number of monitored files
+	unsigned size() const { return mFiles.size(); }
+
+
+	/// Get files whose changes have settled
+
+	/// This does not block. Each changed file is reported once, however
+	/// many times it changed within the debounce window.
+	/// @param[out] changed		paths of changed files are appended to this
+	/// \returns number of paths appended
+	unsigned changes(std::vector<std::string>& changed);
+
+	/// Whether changes are waiting for their debounce window to pass
+	bool pending() const { return !mPending.empty(); }
+
+private:
+	struct FileEntry{
+		int wd;				// watch of directory or -1 if polled
+		al_sec modified;	// last seen modification time, if polled
+	};
+
+	struct Dir{
+		std::string path;
+		std::multimap<std::string, std::string> files; // name -> monitored paths
+	};
+
+	std::map<std::string, FileEntry> mFiles;
+	std::map<int, Dir> mDirs;						// watch -> directory
+	std::map<std::string, al_sec> mPending;			// path -> time of last change
+	al_sec mDebounce, mPollPeriod, mLastPoll;
+	int mFD;
+
+	void readEvents(al_sec now);
+	void pollFiles(al_sec now);
+
+	FileMonitor(const FileMonitor&);
+	FileMonitor& operator=(const FileMonitor&);
+};
+
+
+
+/// Reads files on worker threads
+
+/// Files are read on a thread pool so that loading large or many changed
+/// files does not stall the calling (usually main) thread. Completed reads
+/// are collected on the calling thread with completed().
+class AsyncFileReader {
+public:
+
+	/// Result of a read
+	struct Result{
+		std::string path;
+		std::string data;
+		void * tag;		///< Tag passed to read()
+		bool ok;		///< Whether the file could be opened
+	};
+
+	/// @param[in] pool		pool to read on
+	AsyncFileReader(ThreadPool& pool = ThreadPool::global());
+
+	/// Waits for reads in progress
+	~AsyncFileReader();
+
+
+	/// Start reading a file
+	/// @param[in] path		path of file
+	/// @param[in] tag		user data identifying the request
+	void read(const std::string& path, void * tag = 0);
+
+	/// Get a completed read, in order of request
+
+	/// \returns false if the oldest request is still being read
+	///
+	bool completed(Result& result);
+
+	/// Discard results of all requests with a tag
+	void cancel(void * tag);
+
+	/// Get number of requests not yet collected
+	unsigned size() const { return mJobs.size(); }
+
+private:
+	struct Job{
+		Result result;
+		std::atomic<bool> done;
+		bool cancelled;
+		Job(): done(false), cancelled(false){}
+		void operator()();
+	};
+
+	TaskGroup mGroup;
+	std::list<Job> mJobs;
+};
+
+} // al::
+
+#endif
@@ -53,6 +53,10 @@
 
 	Sub-class FileWatcher and implement the onFileWatch() method.
 	Register for notifications of files using the watch() method(s)
+
+	Changes are detected with a FileMonitor, so on Linux files are not
+	touched until they change. Changes made within the debounce window are
+	coalesced and all settled changes are delivered together on the next poll.
 */
 
 namespace al {
@@ -60,13 +64,13 @@ namespace al {
 /// Interface to implement for objects notified by file updates
 class FileWatcher {
 public:
-	FileWatcher() {}
+	FileWatcher() : mAsyncRead(false) {}
 
 	/// begin filewatching:
 	/// param[in] filepath: the file to watch
 	/// param[in] immediate: triggers the handler immediately (if the file exists)
 	template<typename T>
-	FileWatcher(T f, bool immediate=true) { watch( f, immediate); }
+	FileWatcher(T f, bool immediate=true) : mAsyncRead(false) { watch( f, immediate); }
 
 	virtual ~FileWatcher();
 
@@ -80,6 +84,15 @@ public:
 	/// callback when the file is modified:
 	virtual void onFileWatch(File& file) = 0;
 
+	/// callback with the contents of a modified file read asynchronously:
+	/// the file is not opened; the default calls onFileWatch()
+	virtual void onFileRead(File& file, const std::string& contents) { onFileWatch(file); }
+
+	/// set whether modified files are read on a worker thread
+	/// before onFileRead() is called on the polling thread:
+	FileWatcher& asyncRead(bool v) { mAsyncRead = v; return *this; }
+	bool asyncRead() const { return mAsyncRead; }
+
 	/// trigger notifications from modified files:
 	/// (affects only this FileWatcher):
 	void poll();
@@ -89,9 +102,17 @@ public:
 	static void pollAll();
 
 	/// start/stop automatic background polling (using MainLoop):
+	/// files are checked every tick; period is the minimum time between
+	/// checks of files that cannot be monitored by the operating system.
 	/// use period <= 0 to stop polling
 	static void autoPoll(al_sec period);
+
+	/// set time, in seconds, a file must be unchanged before notification:
+	static void debounce(al_sec period);
+
+private:
+	bool mAsyncRead;
 };
 
 }; // al
-#endif
\ No newline at end of file
+#endif
@@ -5,6 +5,8 @@
 #include "allocore/graphics/al_Lens.hpp"
 #include "allocore/graphics/al_Shader.hpp"
 #include "allocore/graphics/al_Texture.hpp"
+#include "allocore/spatial/al_CullList.hpp"
+#include "alloutil/al_WarpBlendCache.hpp"
 
 namespace al {
 
@@ -100,6 +102,15 @@ class OmniStereo {
     /// Place drawing code here
     virtual void onDrawOmni(OmniStereo& omni) = 0;
 
+    /// Optionally fill a retained draw list with bounded items
+    /// This is called once per capture. Return true to have each cube face
+    /// draw only the items visible in it through onDrawOmniItem, instead of
+    /// calling onDrawOmni for every face.
+    virtual bool onDrawList(CullList& list) { return false; }
+
+    /// Draw a single item of the draw list, identified by its id
+    virtual void onDrawOmniItem(OmniStereo& omni, int id) {}
+
     virtual ~Drawable() {}
   };
 
@@ -130,6 +141,9 @@ class OmniStereo {
     Texture& warp() { return mWarp; }
     Viewport& viewport() { return mViewport; }
 
+    // binary cache of processed warp/blend maps used by readWarp/readBlend
+    WarpBlendCache& cache() { return mCache; }
+
     void updatedWarp();
 
     Parameters params;
@@ -146,11 +160,12 @@ class OmniStereo {
    protected:
     Texture mBlend, mWarp;
     Viewport mViewport;
+    WarpBlendCache mCache;
 
     // the position/orientation of the raw map data relative to the real world
     Pose mRegistration;
 
-    // the raw warp data:
+    // the raw warp data (read back from the texture if it came from the cache):
     float* t;
     float* u;
     float* v;
@@ -272,6 +287,13 @@ class OmniStereo {
   float sphereRadius(float value) { return mSphereRadius = value; }
   float near() const { return mNear; }
   float far() const { return mFar; }
+
+  // the draw list filled by the drawable in the last capture:
+  const CullList& drawList() const { return mDrawList; }
+  // number of draw list items submitted/culled over all faces and eyes in the
+  // last capture:
+  unsigned itemsSubmitted() const { return mItemsSubmitted; }
+  unsigned itemsCulled() const { return mItemsCulled; }
   
   // create GPU resources:
   void onCreate();
@@ -325,6 +347,9 @@ class OmniStereo {
   float mSphereRadius; // The radius of the sphere in OpenGL units.
   float mEyeParallax, mNear, mFar;
 
+  CullList mDrawList;
+  unsigned mItemsSubmitted, mItemsCulled;
+
   unsigned mResolution;
   unsigned mNumProjections;
   int mFrame;
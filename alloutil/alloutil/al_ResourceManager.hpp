@@ -48,6 +48,7 @@
 #include "allocore/io/al_File.hpp"
 #include "allocore/system/al_Watcher.hpp"
 #include "allocore/graphics/al_Shader.hpp"
+#include "alloutil/al_FileMonitor.hpp"
 //#include "alloutil/al_Lua.hpp" // removed lua dependency
 
 #include <map>
@@ -66,10 +67,13 @@ public:
 		al_sec modified;
 		bool loaded;	// flag signals when file has been read
 
-		FileInfo() : modified(0) {}
-		FileInfo(const FileInfo& cpy) : path(cpy.path), modified(cpy.modified) {}
+		FileInfo() : modified(0), loaded(false) {}
+		FileInfo(const FileInfo& cpy) : path(cpy.path), modified(cpy.modified), loaded(false) {}
 	};
 
+	ResourceManager();
+	~ResourceManager();
+
 	///! returns "" if the file cannot be found
 	std::string find(std::string filename);
 
@@ -88,18 +92,44 @@ public:
 
 	///! updates the modified/changed flags of all files in the filemap:
 	/// returns true if any of them changed
+	/// Changes are detected with a FileMonitor and are debounced, so all
+	/// files saved together are reloaded by the same call.
 	bool poll();
 
+	///! sets whether changed files are read on a worker thread:
+	/// their data is then installed by a later call to poll().
+	/// Files are always read immediately when first added.
+	ResourceManager& asyncRead(bool v);
+
+	///! the monitor detecting changes, e.g. to set its debounce window
+	FileMonitor& monitor() { return mMonitor; }
+
 
 	///! list of paths to search for files:
 	SearchPaths paths;
 
 protected:
-	bool read(std::string filename);
+	///! reads a file if it was modified (or if force==true):
+	/// returns true if its data was installed.
+	/// With async==true and asyncRead() enabled, the file is read on a worker
+	/// thread instead and false is returned; its data is installed, and
+	/// loaded set, by a later call to poll(), which then returns true.
+	bool read(std::string filename, bool force=false, bool async=false);
 
 	///! map of filenames to FileInfo structures:
 	typedef std::map<std::string, FileInfo> FileMap;
 	FileMap mFileMap;
+
+	///! map of found paths to filenames:
+	std::map<std::string, std::string> mNames;
+
+	FileMonitor mMonitor;
+	AsyncFileReader * mReader;
+	std::vector<std::string> mChanged;
+
+private:
+	ResourceManager(const ResourceManager&);
+	ResourceManager& operator=(const ResourceManager&);
 };
 
 
@@ -50,6 +50,7 @@ class Simulator : public InterfaceServerClient, public Main::Handler {
 
  protected:
   bool started;
+  bool oscWatched;
   double time, lastTime;
 
   Nav mNav;
@@ -66,7 +67,10 @@ inline void Simulator::onTick() {
     init();
   }
 
-  while (oscRecv().recv()) {
+  // Messages are received as they arrive when the socket is watched
+  if (!oscWatched) {
+    while (oscRecv().recv()) {
+    }
   }
 
   lastTime = time;
@@ -103,12 +107,23 @@ inline void Simulator::onExit() { exit(); }
 
 inline void Simulator::start() {
   InterfaceServerClient::connect();
-  Main::get().interval(1 / 60.0).add(*this).start();
+
+  // Without a window, sleep until OSC messages, timers or the next tick are
+  // due instead of polling
+  Main& m = Main::get();
+  if (m.driver() == Main::SLEEP) m.driver(Main::EVENT);
+  oscWatched = m.watch(oscRecv().descriptor(), [this](int, int) {
+    while (oscRecv().recv()) {
+    }
+  });
+
+  m.interval(1 / 60.0).add(*this).start();
 }
 
 inline void Simulator::stop() { cout << "Simulator stopped." <<endl; Main::get().stop(); }
 
 inline Simulator::~Simulator() {
+  if (oscWatched) Main::get().unwatch(oscRecv().descriptor());
   InterfaceServerClient::disconnect();
   // oscSend().send("/interface/disconnectApplication", name());
 }
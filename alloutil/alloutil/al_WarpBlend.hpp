@@ -4,6 +4,7 @@
 #include "allocore/graphics/al_Texture.hpp"
 #include "allocore/graphics/al_Shader.hpp"
 #include "allocore/spatial/al_Pose.hpp"
+#include "alloutil/al_WarpBlendCache.hpp"
 
 namespace al {
 
@@ -35,6 +36,7 @@ public:
 	void readBlend(std::string path);
 	void readWarp(std::string path);
 	void read3D(std::string path);
+	void buildPixelMesh();	// fill pixelMesh from pixelMap
 	void readModelView(std::string path);
 	void readPerspective(std::string path, double near = 0.1, double far = 100);
 	void readProj(std::string path);
@@ -78,6 +80,7 @@ public:
 	Shader alphaV, alphaF;
 	ShaderProgram alphaP;
 	std::string imgpath;
+	WarpBlendCache cache;	// processed maps used by readBlend/readWarp/read3D
 	bool loaded;
 };
 
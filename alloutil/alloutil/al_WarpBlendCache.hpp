@@ -0,0 +1,137 @@
+#ifndef INCLUDE_AL_WARPBLEND_CACHE_HPP
+#define INCLUDE_AL_WARPBLEND_CACHE_HPP
+
+/*	Allocore --
+	Multimedia / virtual environment application class library
+
+	Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology, UCSB.
+	Copyright (C) 2012. The Regents of the University of California.
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+		Redistributions in binary form must reproduce the above copyright
+		notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+		Neither the name of the University of California nor the names of its
+		contributors may be used to endorse or promote products derived from
+		this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+
+	File description:
+	Binary cache of processed warp and blend maps for fast startup
+*/
+
+#include <string>
+#include "allocore/graphics/al_Texture.hpp"
+
+namespace al {
+
+/// Binary cache of processed warp and blend maps
+
+/// Calibration maps are stored on disk in formats that must be parsed,
+/// decoded and rearranged before they can be uploaded as textures. This class
+/// stores the final client-side array of a texture in a flat binary file so
+/// that later launches can map the file and copy it straight into the
+/// texture's upload buffer.
+///
+/// Each cache file is keyed by a tag, naming the processing applied, and by
+/// the size, modification time and content hash of its source file. If the
+/// size or time of the source differ, its hash is recomputed and the cache is
+/// only rejected if the contents really changed. Loaders call load() first
+/// and, if it fails, process the source as usual and then call store().
+///
+/// Float arrays can optionally be stored as half-floats to halve the size of
+/// the cache files; they are expanded back to floats on load.
+class WarpBlendCache {
+public:
+
+	/// Storage format of float arrays
+	enum Storage {
+		FLOAT32 = 0,	///< Full precision floats
+		FLOAT16			///< Half-precision floats
+	};
+
+	WarpBlendCache();
+
+
+	/// Enable or disable the cache
+	WarpBlendCache& enabled(bool v){ mEnabled=v; return *this; }
+
+	/// Set directory of cache files
+
+	/// If empty (the default), each cache file is placed next to its source.
+	///
+	WarpBlendCache& directory(const std::string& v);
+
+	/// Set storage format of float arrays written by store()
+	WarpBlendCache& storage(Storage v){ mStorage=v; return *this; }
+
+	bool enabled() const { return mEnabled; }
+	const std::string& directory() const { return mDirectory; }
+	Storage storage() const { return mStorage; }
+
+
+	/// Load a cached array into a texture
+
+	/// On success, the texture is reshaped to match the cached array and the
+	/// cached data is copied into its client-side array.
+	/// @param[in] source	path of source file
+	/// @param[in] tag		name of processing applied to source
+	/// @param[out] dst		texture to load into
+	/// \returns whether a valid cache was found
+	bool load(const std::string& source, const std::string& tag, Texture& dst);
+
+	/// Store a processed array in the cache
+
+	/// @param[in] source	path of source file
+	/// @param[in] tag		name of processing applied to source
+	/// @param[in] src		processed array
+	/// \returns whether the cache file was written
+	bool store(const std::string& source, const std::string& tag, const Array& src);
+
+	/// Get path of cache file for a source file and tag
+	std::string path(const std::string& source, const std::string& tag) const;
+
+
+	/// Compute 64-bit content hash of a file
+
+	/// \returns whether the file could be read
+	///
+	static bool hashFile(const std::string& path, uint64_t& hash);
+
+	/// Convert a float to a half-float
+	static uint16_t toHalf(float v);
+
+	/// Convert a half-float to a float
+	static float fromHalf(uint16_t v);
+
+private:
+	std::string mDirectory;
+	Storage mStorage;
+	bool mEnabled;
+
+	// Source info from last failed load, saves hashing twice on a rebuild
+	std::string mLastSource;
+	uint64_t mLastHash;
+};
+
+} // al::
+
+#endif
@@ -0,0 +1,223 @@
+#include <utility>
+#include "allocore/io/al_File.hpp"
+#include "allocore/system/al_Config.h"
+#include "allocore/system/al_Printing.hpp"
+#include "alloutil/al_FileMonitor.hpp"
+
+#ifdef AL_LINUX
+	#include <sys/inotify.h>
+	#include <unistd.h>
+#endif
+
+using namespace al;
+
+namespace {
+
+	al_sec modifiedTime(const std::string& path){
+		return File::exists(path) ? File::modified(path) : 0;
+	}
+
+	#ifdef AL_LINUX
+	const uint32_t WATCH_MASK =
+		IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB | IN_CREATE | IN_DELETE
+		| IN_MOVED_FROM | IN_MOVED_TO;
+	#endif
+}
+
+
+FileMonitor::FileMonitor(Backend backend)
+:	mDebounce(0.05), mPollPeriod(0), mLastPoll(0), mFD(-1)
+{
+	#ifdef AL_LINUX
+	if(NOTIFY == backend){
+		mFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if(mFD < 0) AL_WARN("FileMonitor: inotify not available, polling files instead");
+	}
+	#endif
+}
+
+FileMonitor::~FileMonitor(){
+	#ifdef AL_LINUX
+	if(mFD >= 0) ::close(mFD);
+	#endif
+}
+
+bool FileMonitor::add(const std::string& path){
+	if(contains(path)) return false;
+
+	FileEntry& e = mFiles[path];
+	e.wd = -1;
+	e.modified = modifiedTime(path);
+
+	#ifdef AL_LINUX
+	if(mFD >= 0){
+		// Watch the directory rather than the file, since editors often save
+		// by replacing the file, which would end a watch on the file itself
+		size_t pos = path.find_last_of('/');
+		std::string dir = std::string::npos == pos ? "." : path.substr(0, pos+1);
+		std::string name = std::string::npos == pos ? path : path.substr(pos+1);
+		int wd = inotify_add_watch(mFD, dir.c_str(), WATCH_MASK);
+		if(wd >= 0){
+			Dir& d = mDirs[wd];
+			if(d.path.empty()) d.path = dir;
+			d.files.insert(std::make_pair(name, path));
+			e.wd = wd;
+		}
+	}
+	#endif
+	return true;
+}
+
+void FileMonitor::remove(const std::string& path){
+	std::map<std::string, FileEntry>::iterator it = mFiles.find(path);
+	if(it == mFiles.end()) return;
+
+	#ifdef AL_LINUX
+	std::map<int, Dir>::iterator d = mDirs.find(it->second.wd);
+	if(d != mDirs.end()){
+		std::multimap<std::string, std::string>& files = d->second.files;
+		for(std::multimap<std::string, std::string>::iterator f = files.begin(); f != files.end(); ++f){
+			if(f->second == path){
+				files.erase(f);
+				break;
+			}
+		}
+		if(files.empty()){
+			inotify_rm_watch(mFD, d->first);
+			mDirs.erase(d);
+		}
+	}
+	#endif
+
+	mFiles.erase(it);
+	mPending.erase(path);
+}
+
+void FileMonitor::readEvents(al_sec now){
+	#ifdef AL_LINUX
+	// Buffer aligned for inotify_event, large enough for many events
+	union{ struct inotify_event ev; char bytes[8192]; } buf;
+
+	for(;;){
+		ssize_t n = ::read(mFD, buf.bytes, sizeof(buf));
+		if(n <= 0) break;
+
+		for(char * p = buf.bytes; p < buf.bytes + n; ){
+			const struct inotify_event * ev = (const struct inotify_event *)p;
+			p += sizeof(struct inotify_event) + ev->len;
+
+			// Events were lost, so assume everything changed
+			if(ev->mask & IN_Q_OVERFLOW){
+				for(std::map<std::string, FileEntry>::iterator it = mFiles.begin(); it != mFiles.end(); ++it){
+					mPending[it->first] = now;
+				}
+				continue;
+			}
+
+			std::map<int, Dir>::iterator d = mDirs.find(ev->wd);
+			if(d == mDirs.end()) continue;
+			std::multimap<std::string, std::string>& files = d->second.files;
+
+			// Directory went away; poll its files from now on
+			if(ev->mask & IN_IGNORED){
+				for(std::multimap<std::string, std::string>::iterator f = files.begin(); f != files.end(); ++f){
+					FileEntry& e = mFiles[f->second];
+					e.wd = -1;
+					e.modified = 0;
+					mPending[f->second] = now;
+				}
+				mDirs.erase(d);
+				continue;
+			}
+
+			if(ev->len){
+				typedef std::multimap<std::string, std::string>::iterator It;
+				std::pair<It, It> r = files.equal_range(ev->name);
+				for(It f = r.first; f != r.second; ++f) mPending[f->second] = now;
+			}
+		}
+	}
+	#endif
+}
+
+void FileMonitor::pollFiles(al_sec now){
+	if(now - mLastPoll < mPollPeriod) return;
+	mLastPoll = now;
+
+	for(std::map<std::string, FileEntry>::iterator it = mFiles.begin(); it != mFiles.end(); ++it){
+		FileEntry& e = it->second;
+		if(e.wd >= 0) continue;
+		al_sec m = modifiedTime(it->first);
+		if(m != e.modified){
+			e.modified = m;
+			mPending[it->first] = now;
+		}
+	}
+}
+
+unsigned FileMonitor::changes(std::vector<std::string>& changed){
+	al_sec now = al_steady_time();
+	if(mFD >= 0) readEvents(now);
+	pollFiles(now);
+
+	unsigned count = 0;
+	std::map<std::string, al_sec>::iterator it = mPending.begin();
+	while(it != mPending.end()){
+		if(now - it->second >= mDebounce){
+			changed.push_back(it->first);
+			++count;
+			mPending.erase(it++);
+		}
+		else{
+			++it;
+		}
+	}
+	return count;
+}
+
+
+
+void AsyncFileReader::Job::operator()(){
+	File f(result.path, "rb");
+	result.ok = f.open();
+	if(result.ok){
+		const char * data = f.readAll();
+		if(data) result.data.assign(data, f.size());
+		f.close();
+	}
+	done.store(true, std::memory_order_release);
+}
+
+AsyncFileReader::AsyncFileReader(ThreadPool& pool)
+:	mGroup(pool)
+{}
+
+AsyncFileReader::~AsyncFileReader(){
+	mGroup.wait();
+}
+
+void AsyncFileReader::read(const std::string& path, void * tag){
+	mJobs.emplace_back();
+	Job& job = mJobs.back();
+	job.result.path = path;
+	job.result.tag = tag;
+	job.result.ok = false;
+	mGroup.run(job);
+}
+
+bool AsyncFileReader::completed(Result& result){
+	while(!mJobs.empty() && mJobs.front().done.load(std::memory_order_acquire)){
+		Job& job = mJobs.front();
+		bool cancelled = job.cancelled;
+		if(!cancelled) result = std::move(job.result);
+		mJobs.pop_front();
+		if(!cancelled) return true;
+	}
+	return false;
+}
+
+void AsyncFileReader::cancel(void * tag){
+	for(std::list<Job>::iterator it = mJobs.begin(); it != mJobs.end(); ++it){
+		if(it->result.tag == tag) it->cancelled = true;
+	}
+}
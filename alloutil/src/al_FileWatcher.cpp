@@ -1,127 +1,166 @@
 #include "alloutil/al_FileWatcher.hpp"
+#include "alloutil/al_FileMonitor.hpp"
 
+#include <algorithm>
 #include <vector>
 #include <map>
-#include <limits>
 
 using namespace al;
 
 typedef std::vector<FileWatcher *> WatcherList;
 
-struct WatchedFile {
-	WatchedFile() : mModified(-std::numeric_limits<double>::max()) {}
-	WatchedFile(const WatchedFile& cpy) : mModified(cpy.mModified) {}
+static void removeWatcher(WatcherList& list, FileWatcher * watcher) {
+	list.erase(std::remove(list.begin(), list.end(), watcher), list.end());
+}
 
+struct WatchedFile {
 	void add(FileWatcher * watcher) {
 		mWatchers.push_back(watcher);
 	}
 
 	void remove(FileWatcher * watcher) {
-		WatcherList::iterator iter = mWatchers.begin();
-		while (iter != mWatchers.end()) {
-			if (*iter == watcher) {
-				iter = mWatchers.erase(iter);
-			} else {
-				iter++;
-			}
-		}
-	}
-
-	void test(FileWatcher * w) {
-		if (File::exists(mPath)) {
-			File f(mPath, "r", false);
-			al_sec mod = f.modified();
-			if(mod > mModified) {
-				f.open();
-				WatcherList::iterator iter = mWatchers.begin();
-				while (iter != mWatchers.end()) {
-					FileWatcher * fw = *iter++;
-					if (w == fw)
-						w->onFileWatch(f);
-				}
-				f.close();
-				mModified = f.modified();
-			}
-		}
+		removeWatcher(mWatchers, watcher);
+		removeWatcher(mPending, watcher);
 	}
 
-	void test() {
-		if (File::exists(mPath)) {
-			File f(mPath, "r", false);
-			al_sec mod = f.modified();
-			if(mod > mModified) {
-				notify(f);
+	// mark all watchers as needing notification:
+	void changed() {
+		for (unsigned i=0; i<mWatchers.size(); ++i) {
+			if (std::find(mPending.begin(), mPending.end(), mWatchers[i]) == mPending.end()) {
+				mPending.push_back(mWatchers[i]);
 			}
 		}
 	}
 
-	void notify(File& f) {
-		f.open();
-		WatcherList::iterator iter = mWatchers.begin();
-		while (iter != mWatchers.end()) {
-			(*iter++)->onFileWatch(f);
-		}
-		f.close();
-		mModified = f.modified();
-	}
+	// notify pending watchers (or only w, if not NULL):
+	void notify(FileWatcher * w = NULL);
 
 	std::string mPath;
-	al_sec mModified;
 	WatcherList mWatchers;
+	WatcherList mPending;	// watchers yet to be notified of a change
 };
 
 typedef std::map<std::string, WatchedFile > WatcherMap;
 
 WatcherMap gWatchedFiles;
-al_sec gPollPeriod;
+
+// These are dynamically allocated, since watchers may be destroyed at any
+// time during static destruction
+static FileMonitor& monitor() {
+	static FileMonitor * m = new FileMonitor;
+	return *m;
+}
+
+static AsyncFileReader& reader() {
+	static AsyncFileReader * r = new AsyncFileReader;
+	return *r;
+}
+
+static void notifyWatcher(const std::string& path, FileWatcher * w) {
+	if (w->asyncRead()) {
+		reader().read(path, w);
+	} else {
+		File f(path, "r", false);
+		f.open();
+		w->onFileWatch(f);
+		f.close();
+	}
+}
+
+void WatchedFile::notify(FileWatcher * w) {
+	if (!File::exists(mPath)) return;
+	// copy, since handlers may add or remove watchers:
+	WatcherList pending;
+	if (w) {
+		if (std::find(mPending.begin(), mPending.end(), w) == mPending.end()) return;
+		removeWatcher(mPending, w);
+		pending.push_back(w);
+	} else {
+		pending.swap(mPending);
+	}
+	for (unsigned i=0; i<pending.size(); ++i) {
+		notifyWatcher(mPath, pending[i]);
+	}
+}
+
+// gather settled changes from the monitor as one batch:
+static void collectChanges() {
+	static std::vector<std::string> changed;
+	changed.clear();
+	monitor().changes(changed);
+	for (unsigned i=0; i<changed.size(); ++i) {
+		WatcherMap::iterator it = gWatchedFiles.find(changed[i]);
+		if (it != gWatchedFiles.end()) it->second.changed();
+	}
+}
+
+// deliver contents of files read in the background:
+static void deliverReads() {
+	AsyncFileReader::Result r;
+	while (reader().completed(r)) {
+		File f(r.path, "r", false);
+		((FileWatcher *)r.tag)->onFileRead(f, r.data);
+	}
+}
 
 void FileWatcher::poll() {
-	// check each file:
+	collectChanges();
 	WatcherMap::iterator it = gWatchedFiles.begin();
 	while (it != gWatchedFiles.end()) {
-		it->second.test(this);
+		it->second.notify(this);
 		it++;
 	}
+	deliverReads();
 }
 
 void FileWatcher::pollAll() {
-	// check each file:
+	collectChanges();
 	WatcherMap::iterator it = gWatchedFiles.begin();
 	while (it != gWatchedFiles.end()) {
-		it->second.test();
+		it->second.notify();
 		it++;
 	}
+	deliverReads();
 }
 
-static void autopoll(al_sec t) {
-	FileWatcher::pollAll();
-	if (gPollPeriod > 0.) MainLoop::queue().send(t+gPollPeriod, autopoll);
-}
+// polls once per mainloop tick, so that changes arrive as one batch per frame:
+struct AutoPoller : public Main::Handler {
+	virtual void onTick() { FileWatcher::pollAll(); }
+};
 
+static AutoPoller& autoPoller() {
+	static AutoPoller * p = new AutoPoller;
+	return *p;
+}
 
 void FileWatcher::autoPoll(al_sec t) {
 	if (t > 0.) {
-		if (gPollPeriod == 0.) {
-			gPollPeriod = t;
-			// start the task:
-			autopoll(Main::get().now());
-		} else {
-			gPollPeriod = t;
-		}
+		monitor().pollPeriod(t);
+		Main::get().add(autoPoller());
 	} else {
 		// turn it off:
-		gPollPeriod = 0.;
+		Main::get().remove(autoPoller());
 	}
 }
 
+void FileWatcher::debounce(al_sec t) {
+	monitor().debounce(t);
+}
+
 
 
 FileWatcher::~FileWatcher(){
+	reader().cancel(this);
 	// check each file:
 	WatcherMap::iterator it = gWatchedFiles.begin();
 	while (it != gWatchedFiles.end()) {
 		it->second.remove(this);
-		it++;
+		if (it->second.mWatchers.empty()) {
+			monitor().remove(it->first);
+			gWatchedFiles.erase(it++);
+		} else {
+			it++;
+		}
 	}
 }
 
@@ -130,7 +169,11 @@ void FileWatcher::watch(std::string filepath, bool immediate) {
 	WatchedFile& wf = gWatchedFiles[filepath];
 	wf.mPath = filepath;
 	wf.add(this);
-	if (immediate) wf.test();
+	monitor().add(filepath);
+	if (immediate) {
+		wf.changed();
+		wf.notify();
+	}
 }
 
 
@@ -5,6 +5,7 @@
 #include "allocore/graphics/al_Image.hpp"
 #include "allocore/graphics/al_Shader.hpp"
 #include "allocore/io/al_File.hpp"
+#include "allocore/system/al_Profiler.hpp"
 #include "alloutil/al_OmniStereo.hpp"
 
 using namespace al;
@@ -449,12 +450,44 @@ void OmniStereo::Projection::initParameters(bool verbose) {
 }
 
 void OmniStereo::Projection::readBlend(std::string path) {
+	if (mCache.load(path, "blend", mBlend)) {
+		printf("read & allocated %s (cached)\n", path.c_str());
+		return;
+	}
 	Image img(path);
 	mBlend.allocate(img.array(), true);
+	mCache.store(path, "blend", mBlend.array());
 	printf("read & allocated %s\n", path.c_str());
 }
 
 void OmniStereo::Projection::readWarp(std::string path) {
+	mWarp.filterMin(Texture::LINEAR);
+	if (mCache.load(path, "omniwarp", mWarp)) {
+		// recover the raw data from the texture, so that it can still be
+		// edited and passed to updatedWarp()
+		if (t) free(t);
+		if (u) free(u);
+		if (v) free(v);
+
+		Array& arr = mWarp.array();
+		int w = arr.width();
+		int h = arr.height();
+		t = (float *)malloc(sizeof(float) * w*h);
+		u = (float *)malloc(sizeof(float) * w*h);
+		v = (float *)malloc(sizeof(float) * w*h);
+		for (int y=0; y<h; y++) {
+			for (int x=0; x<w; x++) {
+				int32_t idx = (h-y-1)*w+x;
+				const float * cell = arr.cell<float>(x, y);
+				t[idx] = cell[0];
+				u[idx] = cell[1];
+				v[idx] = cell[2];
+			}
+		}
+		printf("read %s (cached)\n", path.c_str());
+		return;
+	}
+
 	File f(path, "rb");
 	if (!f.open()) {
 		printf("failed to open file %s\n", path.c_str());
@@ -492,6 +525,7 @@ void OmniStereo::Projection::readWarp(std::string path) {
 		.allocate();
 
 	updatedWarp();
+	mCache.store(path, "omniwarp", mWarp.array());
 
 	printf("read %s\n", path.c_str());
 }
@@ -552,6 +586,8 @@ OmniStereo::OmniStereo(unsigned resolution, bool useMipMaps)
 	mSphereRadius(1e10),
 	mNear(0.1),
 	mFar(100),
+	mItemsSubmitted(0),
+	mItemsCulled(0),
 	mResolution(resolution),
 	mNumProjections(1),
 	mFrame(0),
@@ -689,10 +725,27 @@ OmniStereo& OmniStereo::configure(std::string configpath, std::string configname
 	mNumProjections = config["projections"].size();
 	printf("Found %d viewports.\n", mNumProjections);
 
+	// optional warp/blend cache settings, e.g.
+	// "cache" : { "enable" : true, "directory" : "/tmp/alwb", "half" : false }
+	Json::Value& cache = config["cache"];
+
 	for (unsigned i=0; i<mNumProjections; i++) {
 		Json::Value& projection = config["projections"][i];
 		Projection& mprojection = mProjections[i];
 
+		if ( ! cache.isNull() ) {
+			if ( cache["enable"].isBool() ) {
+				mprojection.cache().enabled(cache["enable"].asBool());
+			}
+			if ( cache["directory"].isString() ) {
+				mprojection.cache().directory(cache["directory"].asString());
+			}
+			if ( cache["half"].isBool() ) {
+				mprojection.cache().storage(
+					cache["half"].asBool() ? WarpBlendCache::FLOAT16 : WarpBlendCache::FLOAT32);
+			}
+		}
+
 		Json::Value& viewport = projection["viewport"];
 			if ( ! viewport.isNull() ) {
 				mprojection.viewport().l = viewport["l"].asFloat();
@@ -902,6 +955,7 @@ void OmniStereo::onDestroy() {
 }
 
 void OmniStereo::capture(OmniStereo::Drawable& drawable, const Lens& lens, const Pose& pose) {
+	AL_PROFILE_SCOPE("OmniStereo::capture");
 	if (mCubeProgram.id() == 0) onCreate();
 	gl.error("OmniStereo capture begin");
 
@@ -914,6 +968,18 @@ void OmniStereo::capture(OmniStereo::Drawable& drawable, const Lens& lens, const
 	mFar = lens.far();
 	const double eyeSep = mStereo ? lens.eyeSep() : 0.;
 
+	// Let the drawable fill the draw list once and cull it against all faces.
+	// Both eyes share the same face visibility, so items are widened by the
+	// largest vertex displacement due to eye parallax.
+	mDrawList.clear();
+	const bool useList = drawable.onDrawList(mDrawList);
+	if (useList) {
+		mDrawList.clearViews();
+		mDrawList.addCubeFaces(pose, mNear, mFar);
+		mDrawList.cull(0.5 * eyeSep);
+	}
+	mItemsSubmitted = mItemsCulled = 0;
+
 	gl.projection(Matrix4d::identity());
 
 	// apply camera transform:
@@ -938,7 +1004,16 @@ void OmniStereo::capture(OmniStereo::Drawable& drawable, const Lens& lens, const
 			gl.depthTesting(1);
 			gl.depthMask(1);
 			gl.clear(gl.COLOR_BUFFER_BIT | gl.DEPTH_BUFFER_BIT);
-			drawable.onDrawOmni(*this);
+			if (useList) {
+				const std::vector<int>& visible = mDrawList.visibleItems(mFace);
+				for (unsigned i=0; i<visible.size(); i++) {
+					drawable.onDrawOmniItem(*this, mDrawList.item(visible[i]).id);
+				}
+				mItemsSubmitted += visible.size();
+				mItemsCulled += mDrawList.size() - visible.size();
+			} else {
+				drawable.onDrawOmni(*this);
+			}
 		}
 	}
 
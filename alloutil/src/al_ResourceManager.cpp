@@ -3,6 +3,23 @@
 
 using namespace al;
 
+ResourceManager::ResourceManager()
+:	mReader(NULL)
+{}
+
+ResourceManager::~ResourceManager() {
+	delete mReader;
+}
+
+ResourceManager& ResourceManager::asyncRead(bool v) {
+	if (v && !mReader) {
+		mReader = new AsyncFileReader;
+	} else if (!v && mReader) {
+		delete mReader;
+		mReader = NULL;
+	}
+	return *this;
+}
 
 std::string ResourceManager::find(std::string filename) {
 	FilePath fp = paths.find(filename);
@@ -37,15 +54,24 @@ bool ResourceManager::add(std::string filename, bool immediate) {
 	return false;
 }
 
-bool ResourceManager::read(std::string filename) {
+bool ResourceManager::read(std::string filename, bool force, bool async) {
 	FileInfo& info = mFileMap[filename];
 	if (info.path == "") {
 		info.path = find(filename);
+		if (info.path != "") {
+			mMonitor.add(info.path);
+			mNames[info.path] = filename;
+		}
 	}
 	if (info.path != "" && File::exists(info.path)) {
 		al_sec modified = File::modified(info.path);
-		if (modified > info.modified) {
+		if (force || modified > info.modified) {
 			info.modified = modified;
+			if (async && mReader) {
+				// installed by poll() once read
+				mReader->read(info.path);
+				return false;
+			}
 			printf("loaded %s\n", info.path.c_str());
 			File f(info.path, "r", true);
 			info.data = f.readAll();
@@ -59,9 +85,37 @@ bool ResourceManager::read(std::string filename) {
 
 bool ResourceManager::poll() {
 	bool changed = 0;
+
+	// files not found yet may have appeared:
 	for (FileMap::iterator it=mFileMap.begin(); it!=mFileMap.end(); it++) {
-		std::string name = it->first;
-		changed = read(name) || changed;
+		if (it->second.path == "") {
+			changed = read(it->first) || changed;
+		}
+	}
+
+	// reload files whose changes have settled:
+	mChanged.clear();
+	mMonitor.changes(mChanged);
+	for (unsigned i=0; i<mChanged.size(); i++) {
+		std::map<std::string, std::string>::iterator n = mNames.find(mChanged[i]);
+		if (n != mNames.end()) {
+			changed = read(n->second, true, true) || changed;
+		}
+	}
+
+	// install files read in the background:
+	if (mReader) {
+		AsyncFileReader::Result r;
+		while (mReader->completed(r)) {
+			std::map<std::string, std::string>::iterator n = mNames.find(r.path);
+			if (r.ok && n != mNames.end()) {
+				FileInfo& info = mFileMap[n->second];
+				printf("loaded %s\n", info.path.c_str());
+				info.data.swap(r.data);
+				info.loaded = true;
+				changed = true;
+			}
+		}
 	}
 	return changed;
 }
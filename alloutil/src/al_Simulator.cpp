@@ -8,6 +8,7 @@ Simulator::Simulator(const char* deviceServerAddress, int port,
       InterfaceServerClient(deviceServerAddress,port,deviceServerPort) {
 
   started = false;
+  oscWatched = false;
   nav().smooth(0.8);
   InterfaceServerClient::setNav(nav());
   InterfaceServerClient::setLens(lens());
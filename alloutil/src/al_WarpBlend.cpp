@@ -864,13 +864,24 @@ void WarpnBlend::readID(std::string id) {
 void WarpnBlend::readBlend(std::string path) {
 	printf("blend:\n");
 
-	Image img(path);
-	img.array().print();
-	alphaMap.allocate(img.array(), true);
+	if (!cache.load(path, "blend", alphaMap)) {
+		Image img(path);
+		img.array().print();
+		alphaMap.allocate(img.array(), true);
+		cache.store(path, "blend", alphaMap.array());
+	}
 	alphaMap.print();
 }
 
 void WarpnBlend::read3D(std::string path) {
+	pixelMap.filterMin(Texture::LINEAR);
+	if (cache.load(path, "map3D", pixelMap)) {
+		printf("reading map %s (cached)\n", path.c_str());
+		pixelMap.print();
+		buildPixelMesh();
+		return;
+	}
+
 	File f(path, "rb");
 	if (!f.open()) {
 		printf("failed to open file %s\n", path.c_str());
@@ -980,8 +991,18 @@ void WarpnBlend::read3D(std::string path) {
 	float avg = sum / total;
 	printf("average radius %f\n", avg);
 
+	cache.store(path, "map3D", pixelMap.array());
+
 	// also write this data into a mesh:
-	arr = pixelMap.array();
+	buildPixelMesh();
+
+	free(t);
+	free(u);
+	free(v);
+}
+
+void WarpnBlend::buildPixelMesh() {
+	const Array& arr = pixelMap.array();
 	for (unsigned y=0; y<arr.height(); y++) {
 	for (unsigned x=0; x<arr.width(); x++) {
 		Vec3f v(arr.cell<float>(x, y));
@@ -989,10 +1010,6 @@ void WarpnBlend::read3D(std::string path) {
 		pixelMesh.color(x/float(arr.width()), y/float(arr.height()), 0.);
 		pixelMesh.texCoord(x/float(arr.width()), y/float(arr.height()));
 	}}
-
-	free(t);
-	free(u);
-	free(v);
 }
 
 void WarpnBlend::readProj(std::string path) {
@@ -1011,6 +1028,13 @@ void WarpnBlend::readProj(std::string path) {
 }
 
 void WarpnBlend::readWarp(std::string path) {
+	geometryMap.filterMin(Texture::LINEAR_MIPMAP_LINEAR);
+	if (cache.load(path, "uv", geometryMap)) {
+		printf("reading map %s (cached)\n", path.c_str());
+		geometryMap.print();
+		return;
+	}
+
 	File f(path, "rb");
 	if (!f.open()) {
 		printf("failed to open file %s\n", path.c_str());
@@ -1067,6 +1091,8 @@ void WarpnBlend::readWarp(std::string path) {
 		}
 	}
 
+	cache.store(path, "uv", geometryMap.array());
+
 	free(u);
 	free(v);
 }
@@ -0,0 +1,346 @@
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "allocore/io/al_File.hpp"
+#include "allocore/system/al_Printing.hpp"
+#include "alloutil/al_WarpBlendCache.hpp"
+
+#ifndef AL_WINDOWS
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+using namespace al;
+
+namespace {
+
+const uint32_t CACHE_VERSION = 1;
+
+// Cache file header, followed by the array data
+struct CacheHeader{
+	char magic[4];			// "ALWB"
+	uint32_t version;		// also detects a foreign byte order
+	uint32_t tag;			// hash of processing tag
+	AlloTy type;			// array type
+	uint8_t components;		// array components
+	uint8_t dimcount;		// array dimensions (1 to 3)
+	uint32_t storage;		// WarpBlendCache::Storage
+	uint32_t dim[3];		// array dimensions
+	uint32_t stride[3];		// array strides, in bytes
+	uint32_t reserved;
+	uint64_t srcSize;		// size of source file
+	double srcTime;			// modification time of source file
+	uint64_t srcHash;		// content hash of source file
+};
+
+static_assert(sizeof(CacheHeader) == 72, "unexpected cache header size");
+
+uint32_t hashString(const std::string& s){
+	uint32_t h = 2166136261u;
+	for(unsigned i=0; i<s.size(); ++i){
+		h = (h ^ uint8_t(s[i])) * 16777619u;
+	}
+	return h;
+}
+
+// Read-only view of an entire file; memory mapped where available
+class FileView{
+public:
+	FileView(const std::string& path)
+	:	mData(0), mSize(0)
+	{
+	#ifndef AL_WINDOWS
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if(fd < 0) return;
+		struct stat st;
+		if(0 == fstat(fd, &st) && st.st_size > 0){
+			void * p = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if(MAP_FAILED != p){
+				mData = (const char *)p;
+				mSize = st.st_size;
+			}
+		}
+		::close(fd);
+	#else
+		File f(path, "rb");
+		if(f.open()){
+			mBuf.resize(f.size());
+			if(!mBuf.empty() && f.read(&mBuf[0], 1, mBuf.size()) == int(mBuf.size())){
+				mData = &mBuf[0];
+				mSize = mBuf.size();
+			}
+			f.close();
+		}
+	#endif
+	}
+
+	~FileView(){
+	#ifndef AL_WINDOWS
+		if(mData) munmap((void *)mData, mSize);
+	#endif
+	}
+
+	const char * data() const { return mData; }
+	size_t size() const { return mSize; }
+
+private:
+	const char * mData;
+	size_t mSize;
+	#ifdef AL_WINDOWS
+	std::vector<char> mBuf;
+	#endif
+};
+
+} // ::
+
+
+WarpBlendCache::WarpBlendCache()
+:	mStorage(FLOAT32), mEnabled(true), mLastHash(0)
+{}
+
+WarpBlendCache& WarpBlendCache::directory(const std::string& v){
+	mDirectory = v.empty() ? v : File::conformDirectory(v);
+	return *this;
+}
+
+std::string WarpBlendCache::path(const std::string& source, const std::string& tag) const {
+	if(mDirectory.empty()) return source + "." + tag + ".alwb";
+	// Different sources may share a base name, so add a hash of the full path
+	char id[16];
+	snprintf(id, sizeof(id), "%08x", hashString(File::absolutePath(source)));
+	return mDirectory + File::baseName(source) + "." + id + "." + tag + ".alwb";
+}
+
+bool WarpBlendCache::load(const std::string& source, const std::string& tag, Texture& dst){
+	mLastSource.clear();
+	if(!mEnabled || !File::exists(source)) return false;
+
+	std::string cpath = path(source, tag);
+	FileView view(cpath);
+	if(view.size() < sizeof(CacheHeader)) return false;
+
+	CacheHeader ch;
+	memcpy(&ch, view.data(), sizeof(ch));
+	if(	memcmp(ch.magic, "ALWB", 4) || ch.version != CACHE_VERSION
+		|| ch.tag != hashString(tag)
+		|| ch.dimcount < 1 || ch.dimcount > 3
+		|| ch.storage > FLOAT16
+	) return false;
+
+	AlloArrayHeader h;
+	memset(&h, 0, sizeof(h));
+	h.type = ch.type;
+	h.components = ch.components;
+	h.dimcount = ch.dimcount;
+	for(int i=0; i<ch.dimcount; ++i){
+		h.dim[i] = ch.dim[i];
+		h.stride[i] = ch.stride[i];
+	}
+
+	size_t arrSize = allo_array_size_from_header(&h);
+	size_t dataSize = arrSize;
+	if(FLOAT16 == ch.storage){
+		if(AlloFloat32Ty != h.type || arrSize % 4) return false;
+		dataSize = arrSize / 2;
+	}
+	if(0 == arrSize || view.size() < sizeof(CacheHeader) + dataSize) return false;
+
+	// Validate against source; hash its contents only if it looks modified.
+	// A source modified within the time stamp resolution of the cache write
+	// could have changed without its time changing, so it is hashed as well.
+	uint64_t srcSize = File::sizeFile(source);
+	double srcTime = File::modified(source);
+	if(srcSize != ch.srcSize || srcTime != ch.srcTime || srcTime >= File::modified(cpath)){
+		uint64_t hash;
+		if(!hashFile(source, hash)) return false;
+		mLastSource = source;
+		mLastHash = hash;
+		if(srcSize != ch.srcSize || hash != ch.srcHash) return false;
+
+		// Contents unchanged (e.g. touched or copied), so refresh time stamps
+		ch.srcTime = srcTime;
+		FILE * fp = fopen(cpath.c_str(), "r+b");
+		if(fp){
+			fwrite(&ch, sizeof(ch), 1, fp);
+			fclose(fp);
+		}
+	}
+
+	dst.shapeFrom(h, true);
+	Array& arr = dst.array();
+	if(!arr.data.ptr) arr.dataCalloc();
+	if(arr.size() != arrSize){
+		AL_WARN("could not allocate texture for %s", cpath.c_str());
+		return false;
+	}
+
+	const char * src = view.data() + sizeof(CacheHeader);
+	if(FLOAT16 == ch.storage){
+		float * out = (float *)arr.data.ptr;
+		for(size_t i=0; i<arrSize/4; ++i){
+			uint16_t v;
+			memcpy(&v, src + i*2, 2);
+			out[i] = fromHalf(v);
+		}
+	}
+	else{
+		memcpy(arr.data.ptr, src, arrSize);
+	}
+
+	dst.dirty();
+	mLastSource.clear();
+	return true;
+}
+
+bool WarpBlendCache::store(const std::string& source, const std::string& tag, const Array& src){
+	if(!mEnabled) return false;
+
+	const AlloArrayHeader& h = src.header;
+	size_t arrSize = src.size();
+	if(!src.data.ptr || 0 == arrSize || h.dimcount < 1 || h.dimcount > 3) return false;
+
+	uint64_t hash;
+	if(mLastSource == source){
+		hash = mLastHash;
+	}
+	else if(!hashFile(source, hash)){
+		return false;
+	}
+	mLastSource.clear();
+
+	CacheHeader ch;
+	memset(&ch, 0, sizeof(ch));
+	memcpy(ch.magic, "ALWB", 4);
+	ch.version = CACHE_VERSION;
+	ch.tag = hashString(tag);
+	ch.type = h.type;
+	ch.components = h.components;
+	ch.dimcount = h.dimcount;
+	ch.storage = (mStorage == FLOAT16 && h.type == AlloFloat32Ty && 0 == arrSize % 4) ? FLOAT16 : FLOAT32;
+	for(int i=0; i<h.dimcount; ++i){
+		ch.dim[i] = h.dim[i];
+		ch.stride[i] = h.stride[i];
+	}
+	ch.srcSize = File::sizeFile(source);
+	ch.srcTime = File::modified(source);
+	ch.srcHash = hash;
+
+	if(!mDirectory.empty() && !File::isDirectory(mDirectory)){
+		Dir::make(mDirectory);
+	}
+
+	// Write to a temporary file first so that readers never see a partial cache
+	std::string cpath = path(source, tag);
+	std::string tpath = cpath + ".tmp";
+	FILE * fp = fopen(tpath.c_str(), "wb");
+	if(!fp){
+		AL_WARN("could not write warp/blend cache %s", cpath.c_str());
+		return false;
+	}
+
+	bool ok = fwrite(&ch, sizeof(ch), 1, fp) == 1;
+	if(FLOAT16 == ch.storage){
+		const float * in = (const float *)src.data.ptr;
+		std::vector<uint16_t> half(arrSize/4);
+		for(size_t i=0; i<half.size(); ++i) half[i] = toHalf(in[i]);
+		ok = ok && fwrite(&half[0], 2, half.size(), fp) == half.size();
+	}
+	else{
+		ok = ok && fwrite(src.data.ptr, 1, arrSize, fp) == arrSize;
+	}
+	ok = (0 == fclose(fp)) && ok;
+
+	#ifdef AL_WINDOWS
+	if(ok) ::remove(cpath.c_str());
+	#endif
+	if(!ok || 0 != ::rename(tpath.c_str(), cpath.c_str())){
+		::remove(tpath.c_str());
+		AL_WARN("could not write warp/blend cache %s", cpath.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool WarpBlendCache::hashFile(const std::string& path, uint64_t& hash){
+	FileView view(path);
+	if(!view.data()) return false;
+
+	// FNV-1a over 64-bit words, then the remaining bytes
+	const uint64_t prime = 1099511628211ULL;
+	uint64_t h = 14695981039346656037ULL;
+	const char * p = view.data();
+	size_t n = view.size();
+	size_t i = 0;
+	for(; i+8 <= n; i+=8){
+		uint64_t w;
+		memcpy(&w, p+i, 8);
+		h = (h ^ w) * prime;
+	}
+	for(; i<n; ++i){
+		h = (h ^ uint8_t(p[i])) * prime;
+	}
+	hash = (h ^ uint64_t(n)) * prime;
+	return true;
+}
+
+uint16_t WarpBlendCache::toHalf(float v){
+	uint32_t x;
+	memcpy(&x, &v, 4);
+	uint32_t sign = (x >> 16) & 0x8000;
+	uint32_t bexp = (x >> 23) & 0xff;
+	uint32_t man = x & 0x7fffff;
+
+	// Infinity and NaN
+	if(0xff == bexp) return sign | 0x7c00 | (man ? 0x200 : 0);
+
+	int32_t exp = int32_t(bexp) - 127 + 15;
+	if(exp >= 31) return sign | 0x7c00;
+
+	// Subnormal or zero
+	if(exp <= 0){
+		if(exp < -10) return sign;
+		man |= 0x800000;
+		uint32_t shift = 14 - exp;
+		uint32_t h = man >> shift;
+		uint32_t rem = man & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if(rem > halfway || (rem == halfway && (h & 1))) ++h;
+		return sign | h;
+	}
+
+	// Normal; round to nearest even, a carry correctly bumps the exponent
+	uint32_t h = (uint32_t(exp) << 10) | (man >> 13);
+	uint32_t rem = man & 0x1fff;
+	if(rem > 0x1000 || (rem == 0x1000 && (h & 1))) ++h;
+	return sign | h;
+}
+
+float WarpBlendCache::fromHalf(uint16_t v){
+	uint32_t sign = uint32_t(v & 0x8000) << 16;
+	uint32_t exp = (v >> 10) & 0x1f;
+	uint32_t man = v & 0x3ff;
+	uint32_t x;
+
+	if(0 == exp){
+		if(0 == man){
+			x = sign;
+		}
+		else{ // subnormal, renormalize
+			exp = 127 - 15 + 1;
+			while(!(man & 0x400)){ man <<= 1; --exp; }
+			x = sign | (exp << 23) | ((man & 0x3ff) << 13);
+		}
+	}
+	else if(31 == exp){
+		x = sign | 0x7f800000 | (man << 13);
+	}
+	else{
+		x = sign | ((exp + 127 - 15) << 23) | (man << 13);
+	}
+
+	float r;
+	memcpy(&r, &x, 4);
+	return r;
+}
@@ -0,0 +1,302 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <cassert>
+#include <vector>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include "allocore/system/al_Time.hpp"
+#include "alloutil/al_FileMonitor.hpp"
+#include "alloutil/al_FileWatcher.hpp"
+#include "alloutil/al_ResourceManager.hpp"
+
+using namespace al;
+
+static const std::string DIR = "fileMonitorTests_dir/";
+
+static void writeFile(const std::string &path, const std::string &contents)
+{
+	FILE *fp = fopen(path.c_str(), "wb");
+	assert(fp);
+	fwrite(contents.data(), 1, contents.size(), fp);
+	fclose(fp);
+}
+
+// Move modification time, as polling may not resolve writes close in time
+static void bumpModified(const std::string &path, int seconds)
+{
+	struct utimbuf times;
+	times.actime = times.modtime = time(0) + seconds;
+	assert(0 == utime(path.c_str(), &times));
+}
+
+// Collect batches of changes reported over a duration
+static void collect(FileMonitor &m, std::vector<std::vector<std::string> > &batches, al_sec duration)
+{
+	al_sec end = al_steady_time() + duration;
+	while (al_steady_time() < end) {
+		std::vector<std::string> changed;
+		if (m.changes(changed)) {
+			batches.push_back(changed);
+		}
+		al_sleep(0.002);
+	}
+}
+
+void ut_debounce_test(void)
+{
+	std::string a = DIR + "a.txt", b = DIR + "b.txt";
+	writeFile(a, "a");
+	remove(b.c_str());
+
+	for (int notify = 0; notify < 2; notify++) {
+		FileMonitor m(notify ? FileMonitor::NOTIFY : FileMonitor::POLL);
+		if (notify && m.backend() != FileMonitor::NOTIFY) {
+			printf("(no notify backend) ");
+			break;
+		}
+		m.debounce(0.1);
+		assert(m.add(a) && m.add(b) && !m.add(a));
+		assert(m.size() == 2 && m.contains(b));
+
+		std::vector<std::vector<std::string> > batches;
+		collect(m, batches, 0.05);
+		assert(batches.empty());
+
+		// Several saves of one file and creation of another, in one batch
+		for (int i = 0; i < 5; i++) {
+			writeFile(a, i % 2 ? "aa" : "aaa");
+			bumpModified(a, i + 1);
+			al_sleep(0.01);
+		}
+		writeFile(b, "b");
+		bumpModified(b, 1);
+		std::vector<std::string> changed;
+		m.changes(changed);
+		assert(changed.empty() && m.pending());
+
+		collect(m, batches, 0.4);
+		assert(batches.size() == 1);
+		assert(batches[0].size() == 2);
+		assert(batches[0][0] == a && batches[0][1] == b);
+		assert(!m.pending());
+
+		// Deletion is a change; removed files are not reported
+		m.remove(a);
+		assert(!m.contains(a));
+		writeFile(a, "a");
+		remove(b.c_str());
+		batches.clear();
+		collect(m, batches, 0.3);
+		assert(batches.size() == 1 && batches[0].size() == 1 && batches[0][0] == b);
+	}
+}
+
+void ut_poll_test(void)
+{
+	std::string a = DIR + "a.txt";
+	writeFile(a, "a");
+
+	FileMonitor m(FileMonitor::POLL);
+	assert(m.backend() == FileMonitor::POLL && m.descriptor() == -1);
+	m.debounce(0).pollPeriod(0.2);
+	m.add(a);
+
+	// Not checked again until the polling period has passed
+	std::vector<std::string> changed;
+	m.changes(changed);
+	bumpModified(a, 10);
+	m.changes(changed);
+	assert(changed.empty());
+	al_sleep(0.25);
+	m.changes(changed);
+	assert(changed.size() == 1 && changed[0] == a);
+}
+
+void ut_overflow_test(void)
+{
+	FileMonitor m;
+	if (m.backend() != FileMonitor::NOTIFY) {
+		printf("(no notify backend) ");
+		return;
+	}
+	int maxEvents = 0;
+	FILE *fp = fopen("/proc/sys/fs/inotify/max_queued_events", "r");
+	if (fp) {
+		if (1 != fscanf(fp, "%d", &maxEvents)) maxEvents = 0;
+		fclose(fp);
+	}
+	if (maxEvents <= 0 || maxEvents > 1000000) {
+		printf("(queue size unknown) ");
+		return;
+	}
+
+	std::string a = DIR + "a.txt", x = DIR + "x.txt", y = DIR + "y.txt";
+	writeFile(a, "a");
+	m.debounce(0.02);
+	m.add(a);
+
+	// Writes to other files in the directory are not reported
+	int fx = open(x.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	int fy = open(y.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	assert(fx >= 0 && fy >= 0);
+	std::vector<std::vector<std::string> > batches;
+	collect(m, batches, 0.1);
+	assert(batches.empty());
+
+	// Overflowing the event queue reports all files, as events were lost.
+	// Alternating files keeps events from being merged.
+	for (int i = 0; i < maxEvents + 16; i++) {
+		assert(1 == write(i % 2 ? fy : fx, "z", 1));
+	}
+	close(fx);
+	close(fy);
+	collect(m, batches, 0.2);
+	assert(batches.size() == 1 && batches[0].size() == 1 && batches[0][0] == a);
+
+	remove(x.c_str());
+	remove(y.c_str());
+}
+
+void ut_reader_test(void)
+{
+	// Large files first, so that later requests tend to finish earlier
+	const int N = 16;
+	std::vector<std::string> contents(N);
+	for (int i = 0; i < N; i++) {
+		char name[32];
+		snprintf(name, sizeof(name), "r%d.txt", i);
+		contents[i] = std::string((N - i) * 65536, char('a' + i));
+		writeFile(DIR + name, contents[i]);
+	}
+
+	AsyncFileReader reader;
+	int tag;
+	for (int i = 0; i < N; i++) {
+		char name[32];
+		snprintf(name, sizeof(name), "r%d.txt", i);
+		reader.read(DIR + name, i == 5 ? &tag : (void *)0);
+	}
+	reader.read(DIR + "missing.txt");
+	reader.cancel(&tag);
+	assert(reader.size() == N + 1);
+
+	// Results arrive in order of request; cancelled ones are skipped
+	std::vector<AsyncFileReader::Result> results;
+	al_sec end = al_steady_time() + 10;
+	while (reader.size() && al_steady_time() < end) {
+		AsyncFileReader::Result r;
+		if (reader.completed(r)) {
+			results.push_back(r);
+		}
+	}
+	assert(results.size() == N);
+	for (int i = 0, j = 0; i < N; i++) {
+		if (i == 5) continue;
+		assert(results[j].ok && results[j].data == contents[i]);
+		j++;
+	}
+	assert(!results[N - 1].ok && results[N - 1].path == DIR + "missing.txt");
+
+	for (int i = 0; i < N; i++) {
+		char name[32];
+		snprintf(name, sizeof(name), "r%d.txt", i);
+		remove((DIR + name).c_str());
+	}
+}
+
+struct CountingWatcher : public FileWatcher {
+	CountingWatcher() : count(0) {}
+	virtual void onFileWatch(File &file) { ++count; }
+	virtual void onFileRead(File &file, const std::string &data) {
+		++count;
+		contents = data;
+	}
+	int count;
+	std::string contents;
+};
+
+void ut_watcher_test(void)
+{
+	std::string a = DIR + "w.txt";
+	writeFile(a, "one");
+	FileWatcher::debounce(0.05);
+
+	CountingWatcher sync, async;
+	async.asyncRead(true);
+	sync.watch(a);
+	assert(sync.count == 1);
+	async.watch(a, false);
+
+	// Several saves notify each watcher once
+	for (int i = 0; i < 5; i++) {
+		writeFile(a, "two");
+		bumpModified(a, i + 1);
+		al_sleep(0.01);
+	}
+	al_sec end = al_steady_time() + 0.4;
+	while (al_steady_time() < end) {
+		FileWatcher::pollAll();
+		al_sleep(0.002);
+	}
+	assert(sync.count == 2);
+	assert(async.count == 1 && async.contents == "two");
+
+	remove(a.c_str());
+}
+
+void ut_resource_test(void)
+{
+	std::string a = DIR + "res.txt";
+	writeFile(a, "one");
+
+	ResourceManager rm;
+	rm.paths.addSearchPath(DIR, false);
+	rm.monitor().debounce(0.02);
+	assert(rm.add("res.txt"));
+	assert(rm["res.txt"].loaded && rm["res.txt"].data == "one");
+	rm["res.txt"].loaded = false;
+
+	// Changed files are read in the background and installed by poll()
+	rm.asyncRead(true);
+	writeFile(a, "two");
+	bumpModified(a, 1);
+	bool changed = false;
+	al_sec end = al_steady_time() + 1;
+	while (!changed && al_steady_time() < end) {
+		changed = rm.poll();
+		al_sleep(0.002);
+	}
+	assert(changed);
+	assert(rm["res.txt"].loaded && rm["res.txt"].data == "two");
+
+	remove(a.c_str());
+}
+
+#define RUNTEST(Name)\
+	printf("%s ", #Name);\
+	ut_##Name();\
+	for(size_t i=0; i<32-strlen(#Name); ++i) printf(".");\
+	printf(" pass\n")
+
+int main()
+{
+	mkdir(DIR.c_str(), 0755);
+
+	RUNTEST(debounce_test);
+	RUNTEST(poll_test);
+	RUNTEST(overflow_test);
+	RUNTEST(reader_test);
+	RUNTEST(watcher_test);
+	RUNTEST(resource_test);
+
+	remove((DIR + "a.txt").c_str());
+	remove((DIR + "b.txt").c_str());
+	rmdir(DIR.c_str());
+	return 0;
+}
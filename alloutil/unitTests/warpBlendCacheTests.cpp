@@ -0,0 +1,262 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+#include <sys/types.h>
+#include <utime.h>
+
+#include "allocore/io/al_File.hpp"
+#include "alloutil/al_WarpBlendCache.hpp"
+
+using namespace al;
+
+static const char * SOURCE = "warpBlendCacheTests.bin";
+static const char * CACHE_DIR = "warpBlendCacheTests_cache";
+
+// Offset of the source time in the cache file header
+static const int SRC_TIME_OFFSET = 56;
+
+static void writeSource(unsigned char first)
+{
+	FILE *fp = fopen(SOURCE, "wb");
+	assert(fp);
+	fputc(first, fp);
+	for (int i = 1; i < 1000; i++) {
+		fputc(i & 255, fp);
+	}
+	fclose(fp);
+}
+
+static void setModified(const char *path, double secondsAgo)
+{
+	double t = File::modified(path) - secondsAgo;
+	struct utimbuf times;
+	times.actime = time_t(t);
+	times.modtime = time_t(t);
+	assert(0 == utime(path, &times));
+}
+
+// Writes the first size bytes of data to path
+static void writeFile(const std::string &path, const std::vector<char> &data, size_t size)
+{
+	FILE *fp = fopen(path.c_str(), "wb");
+	assert(fp);
+	fwrite(&data[0], 1, size, fp);
+	fclose(fp);
+}
+
+static void fillWarp(Array &a)
+{
+	a.formatAligned(4, AlloFloat32Ty, 33, 17, 4);
+	float *p = (float *)a.data.ptr;
+	for (size_t i = 0; i < a.size() / 4; i++) {
+		p[i] = (i % 7) * 0.25f - float(i) / 3.f;
+	}
+}
+
+void ut_half_test(void)
+{
+	assert(WarpBlendCache::toHalf(1.f) == 0x3c00);
+	assert(WarpBlendCache::toHalf(-2.f) == 0xc000);
+	assert(WarpBlendCache::toHalf(65504.f) == 0x7bff);
+	assert(WarpBlendCache::toHalf(1e6f) == 0x7c00);	// overflow to infinity
+	assert(WarpBlendCache::toHalf(std::pow(2.f, -24.f)) == 0x0001);
+	assert(WarpBlendCache::toHalf(std::pow(2.f, -26.f)) == 0);
+	assert(WarpBlendCache::fromHalf(0x0001) == std::pow(2.f, -24.f));
+
+	// Every half other than NaN round trips exactly
+	for (uint32_t h = 0; h < 0x10000; h++) {
+		if (((h >> 10) & 0x1f) == 31 && (h & 0x3ff)) {
+			continue;
+		}
+		assert(WarpBlendCache::toHalf(WarpBlendCache::fromHalf(h)) == h);
+	}
+	assert(std::isnan(WarpBlendCache::fromHalf(WarpBlendCache::toHalf(NAN))));
+
+	// Floats round to the nearest half
+	for (int i = -1000; i <= 1000; i++) {
+		float f = i * 0.01357f;
+		float g = WarpBlendCache::fromHalf(WarpBlendCache::toHalf(f));
+		assert(std::fabs(f - g) <= std::fabs(f) / 2048 + 1e-7);
+	}
+}
+
+void ut_round_trip_test(void)
+{
+	writeSource(0);
+	Array warp;
+	fillWarp(warp);
+	const float *in = (const float *)warp.data.ptr;
+
+	for (int half = 0; half < 2; half++) {
+		WarpBlendCache cache;
+		if (half) {
+			cache.directory(CACHE_DIR).storage(WarpBlendCache::FLOAT16);
+		}
+		Texture tex;
+		assert(!cache.load(SOURCE, "warp", tex));
+		assert(cache.store(SOURCE, "warp", warp));
+		assert(File::exists(cache.path(SOURCE, "warp")));
+
+		Texture loaded;
+		assert(cache.load(SOURCE, "warp", loaded));
+		const Array &out = loaded.array();
+		assert(out.isFormat(warp));
+		for (size_t i = 0; i < warp.size() / 4; i++) {
+			float x = in[i];
+			float y = ((const float *)out.data.ptr)[i];
+			if (half) {
+				assert(std::fabs(x - y) <= std::fabs(x) / 2048 + 1e-7);
+			} else {
+				assert(x == y);
+			}
+		}
+
+		// Another processing tag of the same source is not cached
+		assert(!cache.load(SOURCE, "blend", loaded));
+	}
+
+	// Byte arrays are stored as is, even with half storage
+	Array blend;
+	blend.formatAligned(3, AlloUInt8Ty, 7, 5, 4);
+	for (size_t i = 0; i < blend.size(); i++) {
+		blend.data.ptr[i] = char(i * 7);
+	}
+	WarpBlendCache cache;
+	cache.storage(WarpBlendCache::FLOAT16);
+	assert(cache.store(SOURCE, "blend", blend));
+	Texture tex;
+	assert(cache.load(SOURCE, "blend", tex));
+	assert(0 == memcmp(tex.array().data.ptr, blend.data.ptr, blend.size()));
+
+	remove(cache.path(SOURCE, "blend").c_str());
+	remove(cache.path(SOURCE, "warp").c_str());
+	remove(WarpBlendCache().directory(CACHE_DIR).path(SOURCE, "warp").c_str());
+	Dir::remove(CACHE_DIR);
+}
+
+void ut_invalidation_test(void)
+{
+	writeSource(0);
+	Array warp;
+	fillWarp(warp);
+	WarpBlendCache cache;
+	std::string path = cache.path(SOURCE, "warp");
+	Texture tex;
+
+	uint64_t hash, hash2;
+	assert(WarpBlendCache::hashFile(SOURCE, hash));
+	assert(!WarpBlendCache::hashFile("warpBlendCacheTests.missing", hash2));
+
+	// Cache written well after the source was modified
+	setModified(SOURCE, 100);
+	assert(cache.store(SOURCE, "warp", warp));
+	assert(cache.load(SOURCE, "warp", tex));
+
+	// A touched source with the same contents is rehashed, and its new time
+	// is recorded in the cache
+	setModified(SOURCE, -50);
+	assert(cache.load(SOURCE, "warp", tex));
+	FILE *fp = fopen(path.c_str(), "rb");
+	double srcTime = 0;
+	fseek(fp, SRC_TIME_OFFSET, SEEK_SET);
+	assert(1 == fread(&srcTime, sizeof(srcTime), 1, fp));
+	fclose(fp);
+	assert(srcTime == File::modified(SOURCE));
+
+	// Changed contents of the same size are rejected
+	writeSource(1);
+	assert(WarpBlendCache::hashFile(SOURCE, hash2) && hash2 != hash);
+	assert(!cache.load(SOURCE, "warp", tex));
+
+	// Storing after the rejected load writes a valid cache
+	assert(cache.store(SOURCE, "warp", warp));
+	assert(cache.load(SOURCE, "warp", tex));
+
+	// A source of another size is rejected
+	fp = fopen(SOURCE, "ab");
+	fputc(0, fp);
+	fclose(fp);
+	assert(!cache.load(SOURCE, "warp", tex));
+
+	// As is a missing source, or a disabled cache
+	writeSource(1);
+	assert(cache.store(SOURCE, "warp", warp));
+	cache.enabled(false);
+	assert(!cache.load(SOURCE, "warp", tex));
+	cache.enabled(true);
+	remove(SOURCE);
+	assert(!cache.load(SOURCE, "warp", tex));
+
+	remove(path.c_str());
+}
+
+void ut_corrupt_test(void)
+{
+	writeSource(0);
+	Array warp;
+	fillWarp(warp);
+	WarpBlendCache cache;
+	std::string path = cache.path(SOURCE, "warp");
+	Texture tex;
+
+	assert(cache.store(SOURCE, "warp", warp));
+	std::vector<char> good;
+	FILE *fp = fopen(path.c_str(), "rb");
+	fseek(fp, 0, SEEK_END);
+	good.resize(ftell(fp));
+	fseek(fp, 0, SEEK_SET);
+	assert(good.size() == fread(&good[0], 1, good.size(), fp));
+	fclose(fp);
+
+	// Truncated header or data
+	writeFile(path, good, 40);
+	assert(!cache.load(SOURCE, "warp", tex));
+	writeFile(path, good, good.size() - 1);
+	assert(!cache.load(SOURCE, "warp", tex));
+
+	// Foreign file
+	std::vector<char> bad(good);
+	memcpy(&bad[0], "RIFF", 4);
+	writeFile(path, bad, bad.size());
+	assert(!cache.load(SOURCE, "warp", tex));
+
+	// Other byte order or version
+	bad = good;
+	std::swap(bad[4], bad[7]);
+	std::swap(bad[5], bad[6]);
+	writeFile(path, bad, bad.size());
+	assert(!cache.load(SOURCE, "warp", tex));
+
+	// Empty file
+	writeFile(path, good, 0);
+	assert(!cache.load(SOURCE, "warp", tex));
+
+	// Intact file still loads
+	writeFile(path, good, good.size());
+	assert(cache.load(SOURCE, "warp", tex));
+
+	remove(path.c_str());
+	remove(SOURCE);
+}
+
+#define RUNTEST(Name)\
+	printf("%s ", #Name);\
+	ut_##Name();\
+	for(size_t i=0; i<32-strlen(#Name); ++i) printf(".");\
+	printf(" pass\n")
+
+int main()
+{
+	RUNTEST(half_test);
+	RUNTEST(round_trip_test);
+	RUNTEST(invalidation_test);
+	RUNTEST(corrupt_test);
+
+	return 0;
+}